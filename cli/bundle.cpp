@@ -0,0 +1,69 @@
+#include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+
+
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+
+int main(int argc, const char **argv) {
+    std::string detector_description_file_path;
+    std::string bundle_file_path;
+
+    po::options_description options_description("Model bundle options");
+    options_description.add_options()
+            ("help,h", "Show help")
+            ("detector_description_file,d",
+             po::value<std::string>(&detector_description_file_path)->required(),
+             "set the detector description json, its resource files are resolved against the current folder")
+            ("output,o",
+             po::value<std::string>(&bundle_file_path)->required(),
+             "set the bundle file, loaded by the {\"type\": \"bundle\", \"settings\": {\"bundle_file_name\": ...}} "
+             "description");
+
+    po::variables_map vm;
+    try {
+        auto parsed = po::command_line_parser(argc, argv).options(options_description).run();
+        po::store(parsed, vm);
+        if (vm.count("help")) {
+            options_description.print(std::cout);
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+    }
+    catch (const po::error &error) {
+        std::cerr << error.what();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const auto start_time = std::chrono::steady_clock::now();
+        detection::compile_bundle(detector_description_file_path, bundle_file_path);
+        const auto compile_time = std::chrono::steady_clock::now() - start_time;
+
+        // the same load the detecting workers do, so the printed time is the cold start of one detector
+        const auto load_start_time = std::chrono::steady_clock::now();
+        const detection::bundle::ModelBundle model_bundle{bundle_file_path};
+        detection::create_detector(model_bundle);
+        const auto load_time = std::chrono::steady_clock::now() - load_start_time;
+
+        std::cout << "bundle: " + bundle_file_path + ", " + std::to_string(fs::file_size(bundle_file_path)) +
+                     " bytes\n";
+        std::cout << "compiled in " +
+                     std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(compile_time).count()) +
+                     " ms, a detector is loaded in " +
+                     std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(load_time).count()) +
+                     " us\n";
+    } catch (const detection::CreationError &error) {
+        std::cerr << std::string(error.what()) + "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
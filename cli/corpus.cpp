@@ -0,0 +1,458 @@
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <boost/program_options.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+
+namespace config {
+    constexpr const char *DEFAULT_FACES_DIR = "corpus_faces";
+    constexpr const char *DEFAULT_SIZE_WEIGHTS = "40,30,20,9,1";
+    constexpr const char *MANIFEST_FILE_NAME = "corpus_manifest.csv";
+    constexpr double MAX_MEGAPIXELS = 50.0;
+} // namespace config
+
+
+namespace {
+
+    // thumbnail, small, medium, large and huge images, by the width range
+    struct SizeClass {
+        const char *name;
+        int min_width;
+        int max_width;
+    };
+
+    const std::vector<SizeClass> SIZE_CLASSES{
+            {"thumbnail", 64,   240},
+            {"small",     320,  1024},
+            {"medium",    1280, 2560},
+            {"large",     3000, 4500},
+            {"huge",      6000, 8660}
+    };
+
+    const std::vector<double> ASPECT_RATIOS{4.0 / 3.0, 3.0 / 2.0, 16.0 / 9.0, 1.0, 3.0 / 4.0};
+
+
+    struct CorpusSettings {
+        std::uint64_t seed;
+        std::size_t files_number;
+        std::size_t depth;
+        std::size_t fan_out;
+        double bmp_share;
+        double face_share;
+        double duplicate_share;
+        double corrupt_share;
+        std::vector<double> size_weights;
+    };
+
+
+    enum class FileKind {
+        NORMAL,
+        DUPLICATE,
+        TRUNCATED,
+        GARBAGE
+    };
+
+    const char *kind_name(FileKind kind) {
+        switch (kind) {
+            case FileKind::NORMAL:
+                return "normal";
+            case FileKind::DUPLICATE:
+                return "duplicate";
+            case FileKind::TRUNCATED:
+                return "truncated";
+            case FileKind::GARBAGE:
+                return "garbage";
+        }
+        return "unknown";
+    }
+
+
+    // everything about a file is derived from the seed and its index, so the threads number doesn't matter
+    struct FilePlan {
+        fs::path relative_path;
+        FileKind kind{FileKind::NORMAL};
+        cv::Size size;
+        bool is_bmp{false};
+        int jpeg_quality{90};
+        std::size_t faces_number{0};
+        std::size_t duplicate_of{0};
+        std::uint64_t image_seed{0};
+    };
+
+
+    std::vector<fs::path> make_folders(std::size_t depth, std::size_t fan_out) {
+        std::vector<fs::path> folders{fs::path()};
+        std::vector<fs::path> level{fs::path()};
+        for (std::size_t current_depth = 1; current_depth <= depth; current_depth++) {
+            std::vector<fs::path> next_level;
+            for (const auto &parent: level) {
+                for (std::size_t i = 0; i < fan_out; i++) {
+                    next_level.emplace_back(parent / ("dir_" + std::to_string(current_depth) + "_" +
+                                                      std::to_string(i)));
+                }
+            }
+            folders.insert(folders.end(), next_level.begin(), next_level.end());
+            level = std::move(next_level);
+        }
+        return folders;
+    }
+
+
+    // The std distributions are implementation defined, so the values are mapped from the raw output of
+    // the generator, whose sequence the standard fixes: the same seed gives the same corpus with any standard library.
+
+    // uniform in [0, size), the values below the threshold are rejected so every index is equally likely
+    std::size_t pick_index(std::mt19937_64 &rng, std::size_t size) {
+        const auto range = static_cast<std::uint64_t>(size);
+        const auto threshold = (0 - range) % range;
+        auto value = rng();
+        while (value < threshold) {
+            value = rng();
+        }
+        return static_cast<std::size_t>(value % range);
+    }
+
+
+    int pick_int(std::mt19937_64 &rng, int min_value, int max_value) {
+        return min_value + static_cast<int>(pick_index(rng, static_cast<std::size_t>(max_value - min_value) + 1));
+    }
+
+
+    // uniform in [0, 1) with the 53 bits of a double
+    double pick_share(std::mt19937_64 &rng) {
+        return static_cast<double>(rng() >> 11) * (1.0 / static_cast<double>(std::uint64_t{1} << 53));
+    }
+
+
+    // an index with the probability of its weight, the weights are non-negative and not all zero
+    std::size_t pick_weighted(std::mt19937_64 &rng, const std::vector<double> &weights) {
+        const auto total = std::accumulate(weights.begin(), weights.end(), 0.0);
+        auto value = pick_share(rng) * total;
+        for (std::size_t i = 0; i < weights.size(); i++) {
+            if ((value < weights[i]) && (weights[i] > 0)) {
+                return i;
+            }
+            value -= weights[i];
+        }
+        // the rounding of the subtractions may leave the value at the end, it goes to the last weighted index
+        for (std::size_t i = weights.size(); i > 0; i--) {
+            if (weights[i - 1] > 0) {
+                return i - 1;
+            }
+        }
+        return 0;
+    }
+
+
+    cv::Size pick_size(std::mt19937_64 &rng, const CorpusSettings &settings) {
+        const auto &size_class = SIZE_CLASSES[pick_weighted(rng, settings.size_weights)];
+        const auto width = pick_int(rng, size_class.min_width, size_class.max_width);
+        const auto aspect_ratio = ASPECT_RATIOS[pick_index(rng, ASPECT_RATIOS.size())];
+        auto height = std::max(1, static_cast<int>(width / aspect_ratio));
+
+        const auto max_pixels = config::MAX_MEGAPIXELS * 1e6;
+        if (static_cast<double>(width) * height > max_pixels) {
+            height = static_cast<int>(max_pixels / width);
+        }
+        return {width, height};
+    }
+
+
+    std::vector<FilePlan> plan_corpus(const CorpusSettings &settings) {
+        const auto folders = make_folders(settings.depth, settings.fan_out);
+
+        std::vector<FilePlan> plans(settings.files_number);
+        std::vector<std::size_t> normal_files;
+        for (std::size_t index = 0; index < settings.files_number; index++) {
+            std::seed_seq seed_sequence{settings.seed, static_cast<std::uint64_t>(index)};
+            std::mt19937_64 rng(seed_sequence);
+
+            auto &plan = plans[index];
+            plan.image_seed = rng();
+            plan.size = pick_size(rng, settings);
+            plan.is_bmp = pick_share(rng) < settings.bmp_share;
+            plan.jpeg_quality = pick_int(rng, 60, 95);
+            plan.faces_number = (pick_share(rng) < settings.face_share)
+                                ? 1 + pick_index(rng, 3) : 0;
+
+            const auto kind_value = pick_share(rng);
+            if (kind_value < settings.corrupt_share) {
+                plan.kind = (pick_share(rng) < 0.5) ? FileKind::TRUNCATED : FileKind::GARBAGE;
+            } else if ((kind_value < settings.corrupt_share + settings.duplicate_share) && !normal_files.empty()) {
+                plan.kind = FileKind::DUPLICATE;
+                plan.duplicate_of = normal_files[pick_index(rng, normal_files.size())];
+                plan.size = plans[plan.duplicate_of].size;
+                plan.is_bmp = plans[plan.duplicate_of].is_bmp;
+                plan.faces_number = plans[plan.duplicate_of].faces_number;
+            } else {
+                normal_files.push_back(index);
+            }
+
+            const auto &folder = folders[pick_index(rng, folders.size())];
+            plan.relative_path = folder / ("img_" + std::to_string(index) + (plan.is_bmp ? ".bmp" : ".jpg"));
+        }
+        return plans;
+    }
+
+
+    std::vector<cv::Mat> load_faces(const fs::path &faces_dir) {
+        std::vector<fs::path> face_paths;
+        if (fs::exists(faces_dir)) {
+            for (const auto &entry: fs::recursive_directory_iterator(faces_dir)) {
+                if (entry.is_regular_file()) {
+                    face_paths.push_back(entry.path());
+                }
+            }
+        }
+        // the order of a folder walk isn't defined, the patches order must be
+        std::sort(face_paths.begin(), face_paths.end());
+
+        std::vector<cv::Mat> faces;
+        for (const auto &face_path: face_paths) {
+            auto face = cv::imread(face_path.string(), cv::IMREAD_COLOR);
+            if (!face.empty()) {
+                faces.emplace_back(std::move(face));
+            }
+        }
+        return faces;
+    }
+
+
+    // smooth color blobs: a few random pixels upscaled, so even a 50 MP background costs one resize
+    cv::Mat make_background(cv::RNG &rng, const cv::Size &size) {
+        cv::Mat seed_image(rng.uniform(2, 12), rng.uniform(2, 12), CV_8UC3);
+        rng.fill(seed_image, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(256));
+        cv::Mat image;
+        cv::resize(seed_image, image, size, 0, 0, cv::INTER_CUBIC);
+        return image;
+    }
+
+
+    void paste_faces(cv::RNG &rng, cv::Mat &image, const std::vector<cv::Mat> &faces, std::size_t faces_number) {
+        for (std::size_t i = 0; (i < faces_number) && !faces.empty(); i++) {
+            const auto &face = faces[static_cast<std::size_t>(rng.uniform(0, static_cast<int>(faces.size())))];
+            const auto min_side = std::min(image.cols, image.rows);
+            const auto patch_height = std::clamp(static_cast<int>(min_side * rng.uniform(0.15, 0.5)), 1, image.rows);
+            const auto patch_width = std::clamp(patch_height * face.cols / std::max(face.rows, 1), 1, image.cols);
+
+            cv::Mat patch;
+            cv::resize(face, patch, cv::Size(patch_width, patch_height), 0, 0, cv::INTER_AREA);
+            const cv::Rect roi(rng.uniform(0, image.cols - patch_width + 1),
+                               rng.uniform(0, image.rows - patch_height + 1),
+                               patch_width, patch_height);
+            patch.copyTo(image(roi));
+        }
+    }
+
+
+    bool write_file(const fs::path &file_path, const std::vector<uchar> &data) {
+        std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(data.data()), static_cast<std::streamsize>(data.size()));
+        return static_cast<bool>(file);
+    }
+
+
+    bool generate_file(const fs::path &output_dir, const FilePlan &plan, const std::vector<cv::Mat> &faces) {
+        cv::RNG rng(plan.image_seed);
+        const auto file_path = output_dir / plan.relative_path;
+
+        if (plan.kind == FileKind::GARBAGE) {
+            std::vector<uchar> data(static_cast<std::size_t>(rng.uniform(1, 64 * 1024)));
+            for (auto &byte: data) {
+                byte = static_cast<uchar>(rng.uniform(0, 256));
+            }
+            return write_file(file_path, data);
+        }
+
+        auto image = make_background(rng, plan.size);
+        paste_faces(rng, image, faces, plan.faces_number);
+
+        std::vector<uchar> data;
+        if (plan.is_bmp) {
+            cv::imencode(".bmp", image, data);
+        } else {
+            cv::imencode(".jpg", image, data, {cv::IMWRITE_JPEG_QUALITY, plan.jpeg_quality});
+        }
+
+        if (plan.kind == FileKind::TRUNCATED) {
+            // a valid header, the pixel data is cut somewhere in the middle
+            data.resize(std::max<std::size_t>(data.size() * static_cast<std::size_t>(rng.uniform(10, 90)) / 100, 1));
+        }
+        return write_file(file_path, data);
+    }
+
+
+    void write_manifest(const fs::path &output_dir, const std::vector<FilePlan> &plans) {
+        std::ofstream manifest(output_dir / config::MANIFEST_FILE_NAME, std::ios::trunc);
+        manifest << "relative_path,kind,width,height,format,faces,duplicate_of\n";
+        for (const auto &plan: plans) {
+            manifest << plan.relative_path.generic_string() << "," << kind_name(plan.kind) << ","
+                     << plan.size.width << "," << plan.size.height << "," << (plan.is_bmp ? "bmp" : "jpg") << ","
+                     << plan.faces_number << ","
+                     << ((plan.kind == FileKind::DUPLICATE) ? plans[plan.duplicate_of].relative_path.generic_string()
+                                                            : std::string()) << "\n";
+        }
+    }
+
+
+    std::vector<double> parse_weights(const std::string &notation) {
+        std::vector<double> weights;
+        std::stringstream stream(notation);
+        std::string weight;
+        while (std::getline(stream, weight, ',')) {
+            try {
+                weights.push_back(std::stod(weight));
+            } catch (...) {
+                return {};
+            }
+        }
+        if (weights.size() != SIZE_CLASSES.size() ||
+            std::any_of(weights.begin(), weights.end(), [](double value) { return value < 0; }) ||
+            std::all_of(weights.begin(), weights.end(), [](double value) { return value == 0; })) {
+            return {};
+        }
+        return weights;
+    }
+
+}
+
+
+int main(int argc, const char **argv) {
+    std::string output_dir;
+    std::string faces_dir;
+    std::string size_weights;
+    CorpusSettings settings{};
+    unsigned threads_number;
+
+    po::options_description options_description("Corpus options");
+    options_description.add_options()
+            ("help,h", "Show help")
+            ("output_dir,o",
+             po::value<std::string>(&output_dir)->required(),
+             "set the folder the corpus is generated into")
+            ("seed",
+             po::value<std::uint64_t>(&settings.seed)->default_value(1),
+             "the same seed and options always produce the same corpus")
+            ("files_number,n",
+             po::value<std::size_t>(&settings.files_number)->default_value(1000),
+             "set the number of generated files")
+            ("depth",
+             po::value<std::size_t>(&settings.depth)->default_value(3),
+             "set the folders tree depth")
+            ("fan_out",
+             po::value<std::size_t>(&settings.fan_out)->default_value(4),
+             "set the subfolders number of every folder")
+            ("size_weights",
+             po::value<std::string>(&size_weights)->default_value(config::DEFAULT_SIZE_WEIGHTS),
+             "relative weights of thumbnail (64-240 px wide), small (320-1024), medium (1280-2560), "
+             "large (3000-4500) and huge (up to 50 MP) images")
+            ("bmp_share",
+             po::value<double>(&settings.bmp_share)->default_value(0.2),
+             "share of bmp images, the others are jpeg")
+            ("face_share",
+             po::value<double>(&settings.face_share)->default_value(0.3),
+             "share of images with 1 to 3 pasted face patches")
+            ("duplicate_share",
+             po::value<double>(&settings.duplicate_share)->default_value(0.05),
+             "share of byte-exact copies of other generated images")
+            ("corrupt_share",
+             po::value<double>(&settings.corrupt_share)->default_value(0.02),
+             "share of truncated images and random bytes with an image extension")
+            ("faces_dir",
+             po::value<std::string>(&faces_dir)->default_value(config::DEFAULT_FACES_DIR),
+             "set the folder with the face images pasted as patches")
+            ("threads",
+             po::value<unsigned>(&threads_number)->default_value(std::max(std::thread::hardware_concurrency(), 1U)),
+             "set the generating threads number");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, options_description), vm);
+        if (vm.count("help")) {
+            options_description.print(std::cout);
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+    }
+    catch (const po::error &error) {
+        std::cerr << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    settings.size_weights = parse_weights(size_weights);
+    if (settings.size_weights.empty()) {
+        std::cerr << "Incorrect size weights: " << size_weights << ", expected " << SIZE_CLASSES.size()
+                  << " comma separated non-negative numbers\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto faces = load_faces(faces_dir);
+    if ((settings.face_share > 0) && faces.empty()) {
+        std::cerr << "No face images were found in: " << faces_dir << "\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto plans = plan_corpus(settings);
+    try {
+        for (const auto &plan: plans) {
+            fs::create_directories(fs::path(output_dir) / plan.relative_path.parent_path());
+        }
+    } catch (const fs::filesystem_error &error) {
+        std::cerr << "Can't create the corpus folders: " << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    // the duplicates are copied once their sources exist
+    std::atomic<std::size_t> next_plan{0};
+    std::atomic<std::size_t> failed_files{0};
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < std::max(threads_number, 1U); i++) {
+        threads.emplace_back([&]() {
+            for (auto index = next_plan++; index < plans.size(); index = next_plan++) {
+                if ((plans[index].kind != FileKind::DUPLICATE) && !generate_file(output_dir, plans[index], faces)) {
+                    failed_files++;
+                }
+            }
+        });
+    }
+    for (auto &thread: threads) {
+        thread.join();
+    }
+
+    for (const auto &plan: plans) {
+        if (plan.kind == FileKind::DUPLICATE) {
+            std::error_code error;
+            fs::copy_file(fs::path(output_dir) / plans[plan.duplicate_of].relative_path,
+                          fs::path(output_dir) / plan.relative_path, fs::copy_options::overwrite_existing, error);
+            if (error) {
+                failed_files++;
+            }
+        }
+    }
+
+    write_manifest(output_dir, plans);
+
+    if (failed_files > 0) {
+        std::cerr << failed_files << " files were not written\n";
+        return EXIT_FAILURE;
+    }
+    std::cout << "Generated " << plans.size() << " files into " << output_dir << "\n";
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,129 @@
+#include "output/crop_container.hpp"
+
+#include <boost/program_options.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+
+namespace {
+
+    bool write_file(const fs::path &path, const std::vector<unsigned char> &bytes) {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        return static_cast<bool>(file);
+    }
+
+
+    // the same layout the files output mode writes next to the images
+    bool extract(const output::ContainerReader &reader, const fs::path &extract_dir) {
+        for (const auto &key: reader.keys()) {
+            const auto record = reader.read(key);
+            const auto image_path = extract_dir / fs::path(key);
+            fs::create_directories(image_path.parent_path());
+
+            std::ofstream result_json_file(image_path.string() + ".result.json", std::ios::trunc);
+            result_json_file << record.metadata;
+            if (!result_json_file) {
+                std::cerr << std::string("can't create result file by path: ") + image_path.string() + ".result.json\n";
+                return false;
+            }
+
+            for (std::size_t crop_index = 0; crop_index < record.crops.size(); crop_index++) {
+                const auto crop_path = image_path.string() + ".face_" + std::to_string(crop_index + 1) + ".jpg";
+                if (!write_file(crop_path, record.crops[crop_index])) {
+                    std::cerr << std::string("can't create crop file by path: ") + crop_path + "\n";
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+}
+
+
+int main(int argc, const char **argv) {
+    std::string container_dir;
+    std::string image_key;
+    int crop_index;
+    std::string output_path;
+    std::string extract_dir;
+
+    po::options_description options_description("Packed container options");
+    options_description.add_options()
+            ("help,h", "Show help")
+            ("container_dir,c",
+             po::value<std::string>(&container_dir)->required(),
+             "set the packed container folder written by cli_runner --packed_output_dir")
+            ("list,l", "print the image paths with their crops number")
+            ("image,i",
+             po::value<std::string>(&image_key),
+             "print the result json of the image given by its path relative to the images folder")
+            ("crop,n",
+             po::value<int>(&crop_index)->default_value(-1),
+             "write the crop of the given index (0-based) of the --image into the --output file")
+            ("output,o",
+             po::value<std::string>(&output_path),
+             "set the file for the extracted crop")
+            ("extract_dir,e",
+             po::value<std::string>(&extract_dir),
+             "unpack the whole container into the given folder as separate result and crop files");
+
+    po::variables_map vm;
+    try {
+        auto parsed = po::command_line_parser(argc, argv).options(options_description).run();
+        po::store(parsed, vm);
+        if (vm.count("help")) {
+            options_description.print(std::cout);
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+    }
+    catch (const po::error &error) {
+        std::cerr << error.what();
+        return EXIT_FAILURE;
+    }
+
+    try {
+        const output::ContainerReader reader(container_dir);
+
+        if (vm.count("list")) {
+            for (const auto &key: reader.keys()) {
+                std::cout << key + "\t" + std::to_string(reader.crops_number(key)) + "\n";
+            }
+        }
+
+        if (!image_key.empty() && (crop_index < 0)) {
+            std::cout << reader.read(image_key).metadata;
+        }
+
+        if (!image_key.empty() && (crop_index >= 0)) {
+            if (output_path.empty()) {
+                std::cerr << "The crop output file is not set\n";
+                return EXIT_FAILURE;
+            }
+            if (!write_file(output_path, reader.read_crop(image_key, static_cast<std::size_t>(crop_index)))) {
+                std::cerr << std::string("can't create crop file by path: ") + output_path + "\n";
+                return EXIT_FAILURE;
+            }
+        }
+
+        if (!extract_dir.empty()) {
+            if (!extract(reader, extract_dir)) {
+                return EXIT_FAILURE;
+            }
+            std::cout << std::to_string(reader.keys().size()) + " results were extracted into: " + extract_dir + "\n";
+        }
+    } catch (const output::ContainerError &error) {
+        std::cerr << std::string(error.what()) + "\n";
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
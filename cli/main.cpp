@@ -1,14 +1,22 @@
 #include "processor.h"
+#include "shard_results.hpp"
+#include "output/crop_container.hpp"
+#include "output/crop_writer.hpp"
 
 #include <boost/program_options.hpp>
 #include <boost/dll/import.hpp>
 #include <boost/property_tree/json_parser.hpp>
 #include <boost/foreach.hpp>
 
-#include <opencv2/imgcodecs.hpp>
-
+#include <atomic>
+#include <chrono>
+#include <csignal>
 #include <string>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 
 namespace po = boost::program_options;
@@ -18,6 +26,7 @@ namespace fs = boost::filesystem;
 
 namespace config {
     constexpr int DEFAULT_WORKER_NUMBER = 2;
+    constexpr int STATS_EXPORT_PERIOD_MS = 1000;
     constexpr const char *DEFAULT_DETECTOR_DESCRIPTION_FILE_NAME = "haar_detector_description.json";
 
 #if defined(__linux__)
@@ -32,14 +41,82 @@ namespace config {
     static_assert(false, "Unsupported platform");
 #endif
 
+    const std::map<std::string, DETECTION_MODE> DETECTION_MODES{
+            {"full", DETECTION_MODE::DETECTION_FULL},
+            {"count", DETECTION_MODE::DETECTION_COUNT},
+            {"presence", DETECTION_MODE::DETECTION_PRESENCE}};
+
 } // namespace config
 
 
+namespace shard_output {
+    // the notification callback is a plain function pointer, so the shard results stream is shared through here
+    fs::path images_dir;
+    std::mutex results_file_mutex;
+    std::ofstream results_file;
+} // namespace shard_output
+
+
+namespace packed_output {
+    // the crops and the result jsons go into one container instead of a file per crop and per image
+    fs::path images_dir;
+    std::unique_ptr<output::ContainerWriter> writer;
+} // namespace packed_output
+
+
+namespace crop_output {
+    // the face crops of both the files and the packed output, encoded and written off the detecting workers
+    std::unique_ptr<output::CropWriter> writer;
+
+    std::string crop_file_path(const std::string &image_path, std::size_t face_number) {
+        return image_path + ".face_" + std::to_string(face_number) + ".jpg";
+    }
+} // namespace crop_output
+
+
+namespace folder_output {
+    // one result.json per folder, streamed by the library
+    FolderResults *results = nullptr;
+    boost::function<RESULT_CODE(FolderResults *, const char *, const char *)> append_fn;
+} // namespace folder_output
+
+
+namespace interruption {
+    // set by SIGINT/SIGTERM, the main thread cancels the job: queued images are dropped, in-flight ones finish
+    std::atomic<bool> requested{false};
+
+    extern "C" void on_signal(int) {
+        requested = true;
+    }
+} // namespace interruption
+
+
+namespace reloading {
+    // set by SIGHUP, the main thread reloads the detector description file while the job goes on
+    std::atomic<bool> requested{false};
+
+    extern "C" void on_signal(int) {
+        requested = true;
+    }
+} // namespace reloading
+
+
 int main(int argc, const char **argv) {
     std::string detector_description_file;
     std::string images_dir;
     int workers_number;
+    int max_workers_number;
+    std::string scaling_log_path;
     std::string library_path;
+    std::string shard_notation;
+    std::string shard_results_dir;
+    int progress_interval_ms;
+    std::string stats_file_path;
+    std::string trace_file_path;
+    std::string packed_output_dir;
+    std::string detection_mode_name;
+    int keyframe_interval;
+    output::CropWriterConfig crop_writer_config;
 
     po::options_description options_description("Computation options");
     options_description.add_options()
@@ -57,7 +134,60 @@ int main(int argc, const char **argv) {
              "set images folder path")
             ("workers_number,w",
              po::value<int>(&workers_number)->default_value(config::DEFAULT_WORKER_NUMBER),
-             "set process worker number");
+             "set process worker number")
+            ("max_workers_number,m",
+             po::value<int>(&max_workers_number)->default_value(0),
+             "autoscale the workers between workers_number and the given number by the queue backlog")
+            ("scaling_log",
+             po::value<std::string>(&scaling_log_path),
+             "append the autoscaling decisions to the given file")
+            ("shard,s",
+             po::value<std::string>(&shard_notation),
+             "process only shard i of N (\"i/N\" notation) and write the results into a shard results file")
+            ("shard_results_dir,r",
+             po::value<std::string>(&shard_results_dir),
+             "set folder for the shard results file, the images folder by default")
+            ("worker_processes,p",
+             "run workers as separate processes, so a crash on a broken image doesn't abort the whole run")
+            ("progress_interval,g",
+             po::value<int>(&progress_interval_ms)->default_value(0),
+             "print the progress every given number of milliseconds, 0 disables the progress output")
+            ("stats_file",
+             po::value<std::string>(&stats_file_path),
+             "write the processing stats in Prometheus text format into the given file every second")
+            ("print_stats",
+             "print the processing stats json at the end")
+            ("trace_file,t",
+             po::value<std::string>(&trace_file_path),
+             "record the processing stages of every image into the given Chrome trace-event json file")
+            ("packed_output_dir,o",
+             po::value<std::string>(&packed_output_dir),
+             "write the face crops and the results into a packed container in the given folder "
+             "instead of the files next to the images, see crops_runner; a shard writes its container into "
+             "the \"shard_i_of_N\" subfolder, so the shards can share the folder")
+            ("detection_mode",
+             po::value<std::string>(&detection_mode_name)->default_value("full"),
+             "set what is detected: \"full\" face rects with the crops, \"count\" only the faces number, "
+             "\"presence\" only whether there is a face; count and presence write no crops")
+            ("keyframe_interval",
+             po::value<int>(&keyframe_interval)->default_value(0),
+             "detect the folders of numbered video frames in full every given number of frames and on the scene "
+             "changes only, following the faces in between; 0 detects every frame")
+            ("per_image_results",
+             "write a result json next to every image instead of one result.json per folder")
+            ("encoders_number",
+             po::value<std::size_t>(&crop_writer_config.encoders_number)->default_value(
+                     crop_writer_config.encoders_number),
+             "set number of the face crop encoding threads")
+            ("output_queue_size",
+             po::value<std::size_t>(&crop_writer_config.queue_capacity)->default_value(
+                     crop_writer_config.queue_capacity),
+             "set number of images waiting for the crop encoding, a full queue holds the workers back")
+            ("jpeg_quality",
+             po::value<int>(&crop_writer_config.jpeg_quality)->default_value(crop_writer_config.jpeg_quality),
+             "set face crops JPEG quality, 0-100")
+            ("optimize_huffman",
+             "optimize the JPEG Huffman tables of the face crops: smaller files, slower encoding");
 
     po::variables_map vm;
     try {
@@ -75,6 +205,22 @@ int main(int argc, const char **argv) {
         return EXIT_SUCCESS;
     }
 
+    std::optional<shard_results::Shard> shard;
+    if (vm.count("shard")) {
+        shard = shard_results::parse_shard(shard_notation);
+        if (!shard) {
+            std::cerr << std::string("Incorrect shard: ") + shard_notation + ", expected \"i/N\" with i < N\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    const auto detection_mode = config::DETECTION_MODES.find(detection_mode_name);
+    if (detection_mode == config::DETECTION_MODES.end()) {
+        std::cerr << std::string("Incorrect detection mode: ") + detection_mode_name +
+                     ", expected \"full\", \"count\" or \"presence\"\n";
+        return EXIT_FAILURE;
+    }
+
     if (fs::exists(library_path)) {
         std::cout << std::string("Loading the processor library by path: ") + library_path + "\n";
     } else {
@@ -82,22 +228,76 @@ int main(int argc, const char **argv) {
         return EXIT_FAILURE;
     }
 
-    boost::function<RESULT_CODE(int, const char *)> init_fn;
-    boost::function<RESULT_CODE(const char *, NotificationFunction)> process_fn;
+    boost::function<RESULT_CODE(int, const char *, EXECUTION_MODE)> init_fn;
+    boost::function<RESULT_CODE(int, int, const char *, const char *)> init_autoscaled_fn;
+    boost::function<RESULT_CODE(const char *)> reload_fn;
+    boost::function<void(ProcessParameters *)> init_process_parameters_fn;
+    boost::function<RESULT_CODE(const char *, const ProcessParameters *, NotificationFunction, JobHandle **)>
+            start_process_fn;
+    boost::function<RESULT_CODE(JobHandle *, JobProgress *)> get_job_progress_fn;
+    boost::function<RESULT_CODE(JobHandle *)> cancel_job_fn;
+    boost::function<RESULT_CODE(JobHandle *)> wait_job_fn;
+    boost::function<void(JobHandle *)> release_job_fn;
+    boost::function<RESULT_CODE(NotificationFunction)> get_stats_fn;
+    boost::function<RESULT_CODE(const char *, int)> export_stats_fn;
+    boost::function<RESULT_CODE(FolderResults **)> open_folder_results_fn;
+    boost::function<RESULT_CODE(FolderResults *)> close_folder_results_fn;
+    boost::function<RESULT_CODE(int)> start_tracing_fn;
+    boost::function<RESULT_CODE(const char *)> stop_tracing_fn;
     try {
-        init_fn = dll::import<RESULT_CODE(int, const char *)>(library_path, "init");
-        process_fn = dll::import<RESULT_CODE(const char *, NotificationFunction)>(library_path, "process");
+        init_fn = dll::import<RESULT_CODE(int, const char *, EXECUTION_MODE)>(library_path, "init_with_mode");
+        init_autoscaled_fn = dll::import<RESULT_CODE(int, int, const char *, const char *)>(library_path,
+                                                                                           "init_autoscaled");
+        reload_fn = dll::import<RESULT_CODE(const char *)>(library_path, "reload");
+        init_process_parameters_fn = dll::import<void(ProcessParameters *)>(library_path, "init_process_parameters");
+        start_process_fn = dll::import<RESULT_CODE(const char *, const ProcessParameters *, NotificationFunction,
+                                                   JobHandle **)>(library_path, "start_process");
+        get_job_progress_fn = dll::import<RESULT_CODE(JobHandle *, JobProgress *)>(library_path, "get_job_progress");
+        cancel_job_fn = dll::import<RESULT_CODE(JobHandle *)>(library_path, "cancel_job");
+        wait_job_fn = dll::import<RESULT_CODE(JobHandle *)>(library_path, "wait_job");
+        release_job_fn = dll::import<void(JobHandle *)>(library_path, "release_job");
+        get_stats_fn = dll::import<RESULT_CODE(NotificationFunction)>(library_path, "get_stats");
+        export_stats_fn = dll::import<RESULT_CODE(const char *, int)>(library_path, "export_stats");
+        open_folder_results_fn = dll::import<RESULT_CODE(FolderResults **)>(library_path, "open_folder_results");
+        folder_output::append_fn = dll::import<RESULT_CODE(FolderResults *, const char *, const char *)>(
+                library_path, "append_folder_result");
+        close_folder_results_fn = dll::import<RESULT_CODE(FolderResults *)>(library_path, "close_folder_results");
+        start_tracing_fn = dll::import<RESULT_CODE(int)>(library_path, "start_tracing");
+        stop_tracing_fn = dll::import<RESULT_CODE(const char *)>(library_path, "stop_tracing");
     } catch (const std::exception &error) {
         std::cerr << std::string("Library loading error: ") + error.what() + "\n";
         return EXIT_FAILURE;
     }
 
-    auto init_result_code = init_fn(workers_number, detector_description_file.c_str());
+    const auto execution_mode = vm.count("worker_processes") ? EXECUTION_MODE::EXECUTION_PROCESSES
+                                                             : EXECUTION_MODE::EXECUTION_THREADS;
+    if (!trace_file_path.empty()) {
+        // started before init, so the detectors loading is traced too
+        start_tracing_fn(0);
+    }
+
+    RESULT_CODE init_result_code;
+    if (max_workers_number > workers_number) {
+        if (execution_mode != EXECUTION_MODE::EXECUTION_THREADS) {
+            std::cerr << "Autoscaling is supported for worker threads only\n";
+            return EXIT_FAILURE;
+        }
+        init_result_code = init_autoscaled_fn(workers_number, max_workers_number, detector_description_file.c_str(),
+                                              scaling_log_path.empty() ? nullptr : scaling_log_path.c_str());
+    } else {
+        init_result_code = init_fn(workers_number, detector_description_file.c_str(), execution_mode);
+    }
     if (init_result_code != RESULT_CODE::INIT_SUCCESS) {
         std::cerr << "Library init failed\n";
         return EXIT_FAILURE;
     }
 
+    if (!stats_file_path.empty() &&
+        (export_stats_fn(stats_file_path.c_str(), config::STATS_EXPORT_PERIOD_MS) != RESULT_CODE::SUCCESS)) {
+        std::cerr << std::string("Can't export the stats into: ") + stats_file_path + "\n";
+        return EXIT_FAILURE;
+    }
+
     auto callback = [](const char *result_json_str) {
         std::stringstream json_buffer_for_parse;
         json_buffer_for_parse << result_json_str;
@@ -111,36 +311,83 @@ int main(int argc, const char **argv) {
         }
         const std::string image_path{image_path_str.value()};
 
-        auto img = cv::imread(image_path, cv::IMREAD_COLOR);
-        if (img.empty()) {
-            std::cerr << std::string("can't open image by path: ") + image_path + "\n";
-            return;
-        }
-
-        int detections_counter = 0;
+        // the crops are read, encoded and written by the crop writer pool, the worker only collects the faces
+        std::vector<cv::Rect> faces;
         auto detections_json_array = result_json_root.get_child_optional("detections");
         if (detections_json_array) {
             BOOST_FOREACH(boost::property_tree::ptree::value_type &rowPair, detections_json_array.value()) {
-                            detections_counter++;
-                            auto current_image_path =
-                                    image_path + ".face_" + std::to_string(detections_counter) + ".jpg";
-
                             auto &detection_obj = rowPair.second.get_child("");
-                            auto x = detection_obj.get_optional<int>("x");
-                            auto y = detection_obj.get_optional<int>("y");
-                            auto width = detection_obj.get_optional<int>("width");
-                            auto height = detection_obj.get_optional<int>("height");
+                            faces.emplace_back(detection_obj.get<int>("x"), detection_obj.get<int>("y"),
+                                               detection_obj.get<int>("width"), detection_obj.get<int>("height"));
+                            if (packed_output::writer) {
+                                detection_obj.add("crop_index", faces.size() - 1);
+                            } else {
+                                detection_obj.add("image_path", crop_output::crop_file_path(image_path, faces.size()));
+                            }
+                        }
+        }
+
+        // the count and presence modes give the faces number without the detections
+        const auto faces_number = result_json_root.get<std::size_t>("faces_number", faces.size());
+        std::cout << std::to_string(faces_number) + std::string(" detections by path: ") + image_path + "\n";
 
-                            cv::Mat flopped_face_roi;
-                            cv::Mat face_roi(img, cv::Rect(x.value(), y.value(), width.value(), height.value()));
-                            cv::flip(face_roi, flopped_face_roi, 0);
-                            cv::imwrite(current_image_path, flopped_face_roi);
+        if (packed_output::writer) {
+            std::ostringstream metadata;
+            boost::property_tree::write_json(metadata, result_json_root, false);
+            auto key = fs::path(image_path).lexically_relative(packed_output::images_dir).generic_string();
+            // an image without faces still gets its record, so it goes through the queue as well
+            crop_output::writer->push(output::CropTask{
+                    image_path, std::move(faces),
+                    [key = std::move(key), metadata = metadata.str()](output::EncodedCrops &&crops) {
+                        try {
+                            packed_output::writer->append(key, output::ContainerRecord{metadata, std::move(crops)});
+                        } catch (const output::ContainerError &error) {
+                            std::cerr << std::string(error.what()) + "\n";
+                            throw;
+                        }
+                    }});
+            return;
+        }
 
-                            detection_obj.add("image_path", current_image_path);
+        if (!faces.empty()) {
+            crop_output::writer->push(output::CropTask{
+                    image_path, std::move(faces),
+                    [image_path](output::EncodedCrops &&crops) {
+                        for (std::size_t i = 0; i < crops.size(); i++) {
+                            if (crops[i].empty()) {
+                                continue;
+                            }
+                            const auto crop_path = crop_output::crop_file_path(image_path, i + 1);
+                            std::ofstream crop_file(crop_path, std::ios::out | std::ios::binary | std::ios::trunc);
+                            crop_file.write(reinterpret_cast<const char *>(crops[i].data()),
+                                            static_cast<std::streamsize>(crops[i].size()));
+                            if (!crop_file) {
+                                std::cerr << std::string("can't write face crop by path: ") + crop_path + "\n";
+                            }
                         }
+                    }});
         }
 
-        std::cout << std::to_string(detections_counter) + std::string(" detections by path: ") + image_path + "\n";
+        if (shard_output::results_file.is_open()) {
+            boost::property_tree::ptree record;
+            record.add(shard_results::RELATIVE_PATH_KEY,
+                       fs::path(image_path).lexically_relative(shard_output::images_dir).generic_string());
+            record.add_child(shard_results::RESULT_KEY, result_json_root);
+
+            std::ostringstream record_line;
+            boost::property_tree::write_json(record_line, record, false);
+
+            std::lock_guard lk{shard_output::results_file_mutex};
+            shard_output::results_file << record_line.str();
+            return;
+        }
+
+        if (folder_output::results != nullptr) {
+            std::ostringstream result_json;
+            boost::property_tree::write_json(result_json, result_json_root, false);
+            folder_output::append_fn(folder_output::results, image_path.c_str(), result_json.str().c_str());
+            return;
+        }
 
         auto result_json_file_path = image_path + ".result.json";
         std::ofstream result_json_file(result_json_file_path);
@@ -152,7 +399,147 @@ int main(int argc, const char **argv) {
             return;
         }
     };
-    auto process_result_code = process_fn(images_dir.c_str(), callback);
+    ProcessParameters process_parameters;
+    init_process_parameters_fn(&process_parameters);
+    process_parameters.detection_mode = detection_mode->second;
+    process_parameters.keyframe_interval = keyframe_interval;
+    if (!packed_output_dir.empty()) {
+        // a container replaces the previous one in its folder, so every shard gets its own
+        if (shard) {
+            packed_output_dir = (fs::path(packed_output_dir) / shard_results::directory_name(shard.value())).string();
+        }
+        try {
+            packed_output::writer = std::make_unique<output::ContainerWriter>(packed_output_dir);
+        } catch (const output::ContainerError &error) {
+            std::cerr << std::string(error.what()) + "\n";
+            return EXIT_FAILURE;
+        }
+        packed_output::images_dir = fs::path(images_dir);
+        std::cout << std::string("Writing packed results to: ") + packed_output_dir + "\n";
+    }
+    if (shard) {
+        process_parameters.shard_index = shard->index;
+        process_parameters.shard_count = shard->count;
+    }
+    if (shard && !packed_output::writer) {
+        // a packed container keeps the relative paths itself, the shards write their own containers then
+        shard_output::images_dir = fs::path(images_dir);
+        auto results_file_path = (shard_results_dir.empty() ? fs::path(images_dir) : fs::path(shard_results_dir)) /
+                                 shard_results::file_name(shard.value());
+        shard_output::results_file.open(results_file_path.string(), std::ios::out | std::ios::trunc);
+        if (!shard_output::results_file) {
+            std::cerr << std::string("can't create shard results file by path: ") + results_file_path.string() + "\n";
+            return EXIT_FAILURE;
+        }
+        std::cout << std::string("Writing shard results to: ") + results_file_path.string() + "\n";
+    }
+
+    if (!packed_output::writer && !shard && !vm.count("per_image_results")) {
+        if (open_folder_results_fn(&folder_output::results) != RESULT_CODE::SUCCESS) {
+            std::cerr << "Can't start the folder results writing\n";
+            return EXIT_FAILURE;
+        }
+        process_parameters.folder_results = folder_output::results;
+    }
+
+    crop_writer_config.optimize_huffman = vm.count("optimize_huffman") > 0;
+    crop_output::writer = std::make_unique<output::CropWriter>(crop_writer_config);
+
+    std::signal(SIGINT, interruption::on_signal);
+    std::signal(SIGTERM, interruption::on_signal);
+#if defined(SIGHUP)
+    std::signal(SIGHUP, reloading::on_signal);
+#endif
+
+    JobHandle *job = nullptr;
+    auto process_result_code = start_process_fn(images_dir.c_str(), &process_parameters, callback, &job);
+    if (process_result_code == RESULT_CODE::PROCESS_SUCCESS) {
+        const auto POLL_PERIOD = std::chrono::milliseconds(50);
+        auto last_progress_output = std::chrono::steady_clock::now();
+        JobProgress progress{};
+        bool cancel_requested = false;
+        while ((get_job_progress_fn(job, &progress) == RESULT_CODE::SUCCESS) && !progress.finished) {
+            std::this_thread::sleep_for(POLL_PERIOD);
+
+            if (interruption::requested && !cancel_requested) {
+                std::cerr << "Interrupted, finishing the images in flight\n";
+                cancel_job_fn(job);
+                cancel_requested = true;
+            }
+
+            if (reloading::requested.exchange(false)) {
+                if (reload_fn(detector_description_file.c_str()) == RESULT_CODE::INIT_SUCCESS) {
+                    std::cout << std::string("Detector description was reloaded from: ") +
+                                 detector_description_file + "\n";
+                } else {
+                    std::cerr << std::string("Can't reload the detector description from: ") +
+                                 detector_description_file + ", the previous one is kept\n";
+                }
+            }
+
+            const auto now = std::chrono::steady_clock::now();
+            if ((progress_interval_ms > 0) &&
+                (now - last_progress_output >= std::chrono::milliseconds(progress_interval_ms))) {
+                last_progress_output = now;
+                std::cout << "progress: " + std::to_string(progress.discovered) + " discovered, " +
+                             std::to_string(progress.queued) + " queued, " +
+                             std::to_string(progress.detected) + " detected, " +
+                             std::to_string(progress.failed) + " failed, " +
+                             std::to_string(progress.dropped) + " dropped, " +
+                             std::to_string(static_cast<int>(progress.images_per_second)) + " images/sec" +
+                             (progress.walk_finished ? "" : ", still walking") + "\n";
+            }
+        }
+
+        process_result_code = wait_job_fn(job);
+        release_job_fn(job);
+    }
+
+    // before the container close, the writer appends the last records
+    crop_output::writer->close();
+    const auto crop_writer_stats = crop_output::writer->stats();
+    if (crop_writer_stats.failed_images > 0) {
+        std::cerr << std::to_string(crop_writer_stats.failed_images) + " images couldn't be read for the face crops\n";
+    }
+
+    if (shard_output::results_file.is_open()) {
+        shard_output::results_file.close();
+    }
+
+    if ((folder_output::results != nullptr) &&
+        (close_folder_results_fn(folder_output::results) != RESULT_CODE::SUCCESS)) {
+        std::cerr << "Can't write some of the folder result files\n";
+        process_result_code = RESULT_CODE::PROCESS_UNEXPECTED_ERROR;
+    }
+
+    if (packed_output::writer) {
+        try {
+            packed_output::writer->close();
+        } catch (const output::ContainerError &error) {
+            std::cerr << std::string(error.what()) + "\n";
+            process_result_code = RESULT_CODE::PROCESS_UNEXPECTED_ERROR;
+        }
+    }
+
+    if (!trace_file_path.empty()) {
+        if (stop_tracing_fn(trace_file_path.c_str()) == RESULT_CODE::SUCCESS) {
+            std::cout << std::string("Trace was written to: ") + trace_file_path + "\n";
+        } else {
+            std::cerr << std::string("Can't write the trace file: ") + trace_file_path + "\n";
+        }
+    }
+
+    if (vm.count("print_stats")) {
+        get_stats_fn([](const char *stats_json_str) { std::cout << stats_json_str; });
+        boost::property_tree::ptree crop_writer_stats_json;
+        crop_writer_stats_json.add_child("crop_writer", output::to_json(crop_writer_stats));
+        boost::property_tree::write_json(std::cout, crop_writer_stats_json);
+    }
+
+    if (process_result_code == RESULT_CODE::PROCESS_CANCELLED) {
+        std::cerr << "Library image process was cancelled, the results are partial\n";
+        return EXIT_FAILURE;
+    }
     if (process_result_code != RESULT_CODE::PROCESS_SUCCESS) {
         std::cerr << "Library image process failed\n";
         return EXIT_FAILURE;
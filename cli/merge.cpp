@@ -0,0 +1,170 @@
+#include "shard_results.hpp"
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+
+
+namespace po = boost::program_options;
+namespace fs = boost::filesystem;
+namespace pt = boost::property_tree;
+
+
+namespace {
+
+    // replaces the image path prefix of every string value, so crop paths recorded on another node
+    // point to the merged images folder
+    void rebase_paths(pt::ptree &node, const std::string &old_image_path, const std::string &new_image_path) {
+        if (node.empty()) {
+            const auto value = node.get_value<std::string>();
+            if (value.compare(0, old_image_path.size(), old_image_path) == 0) {
+                node.put_value(new_image_path + value.substr(old_image_path.size()));
+            }
+            return;
+        }
+
+        for (auto &child: node) {
+            rebase_paths(child.second, old_image_path, new_image_path);
+        }
+    }
+
+}
+
+
+int main(int argc, const char **argv) {
+    std::string images_dir;
+    std::string shard_results_dir;
+
+    po::options_description options_description("Merge options");
+    options_description.add_options()
+            ("help,h", "Show help")
+            ("images_dir,i",
+             po::value<std::string>(&images_dir)->required(),
+             "set images folder path the shards were processed from")
+            ("shard_results_dir,r",
+             po::value<std::string>(&shard_results_dir),
+             "set folder with the shard results files, the images folder by default")
+            ("remove_shard_results", "remove the shard results files after the successful merge");
+
+    po::variables_map vm;
+    try {
+        auto parsed = po::command_line_parser(argc, argv).options(options_description).allow_unregistered().run();
+        po::store(parsed, vm);
+        po::notify(vm);
+    }
+    catch (const po::error &error) {
+        std::cerr << error.what();
+        return EXIT_FAILURE;
+    }
+
+    if (vm.count("help")) {
+        options_description.print(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    const fs::path results_dir{shard_results_dir.empty() ? images_dir : shard_results_dir};
+    if (!fs::is_directory(results_dir)) {
+        std::cerr << std::string("The shard results folder was not found by path: ") + results_dir.string() + "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::map<int, fs::path> shard_files;
+    int shard_count = 0;
+    for (const auto &entry: fs::directory_iterator(results_dir)) {
+        auto shard = shard_results::parse_file_name(entry.path().filename().string());
+        if (!shard || !fs::is_regular_file(entry.path())) {
+            continue;
+        }
+
+        if ((shard_count != 0) && (shard_count != shard->count)) {
+            std::cerr << std::string("Shard results of different shard counts were found in: ") +
+                         results_dir.string() + "\n";
+            return EXIT_FAILURE;
+        }
+        shard_count = shard->count;
+        shard_files.emplace(shard->index, entry.path());
+    }
+
+    if (shard_count == 0) {
+        std::cerr << std::string("No shard results were found in: ") + results_dir.string() + "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (static_cast<int>(shard_files.size()) != shard_count) {
+        for (int index = 0; index < shard_count; index++) {
+            if (!shard_files.count(index)) {
+                std::cerr << std::string("Missing results of shard ") + std::to_string(index) + "/" +
+                             std::to_string(shard_count) + "\n";
+            }
+        }
+        return EXIT_FAILURE;
+    }
+
+    std::set<std::string> merged_paths;
+    for (const auto &[index, shard_file_path]: shard_files) {
+        std::ifstream shard_file(shard_file_path.string());
+        if (!shard_file) {
+            std::cerr << std::string("can't open shard results file by path: ") + shard_file_path.string() + "\n";
+            return EXIT_FAILURE;
+        }
+
+        std::size_t line_number = 0;
+        std::string line;
+        while (std::getline(shard_file, line)) {
+            line_number++;
+            if (line.empty()) {
+                continue;
+            }
+
+            pt::ptree record;
+            try {
+                std::stringstream line_buffer{line};
+                pt::read_json(line_buffer, record);
+            } catch (const std::exception &error) {
+                std::cerr << shard_file_path.string() + ":" + std::to_string(line_number) +
+                             " :: broken shard record, the shard was probably interrupted\n";
+                return EXIT_FAILURE;
+            }
+
+            auto relative_path = record.get_optional<std::string>(shard_results::RELATIVE_PATH_KEY);
+            auto result = record.get_child_optional(shard_results::RESULT_KEY);
+            if (!relative_path || !result) {
+                std::cerr << shard_file_path.string() + ":" + std::to_string(line_number) + " :: incomplete record\n";
+                return EXIT_FAILURE;
+            }
+
+            if (!merged_paths.insert(relative_path.value()).second) {
+                std::cerr << std::string("Image was processed by several shards: ") + relative_path.value() + "\n";
+                return EXIT_FAILURE;
+            }
+
+            const auto image_path = (fs::path(images_dir) / fs::path(relative_path.value())).make_preferred().string();
+            auto result_json_root = result.value();
+            rebase_paths(result_json_root, result_json_root.get<std::string>("image_path", image_path), image_path);
+
+            auto result_json_file_path = image_path + ".result.json";
+            std::ofstream result_json_file(result_json_file_path);
+            if (!result_json_file) {
+                std::cerr << std::string("can't create result file by path: ") + result_json_file_path + "\n";
+                return EXIT_FAILURE;
+            }
+            pt::write_json(result_json_file, result_json_root);
+        }
+    }
+
+    std::cout << std::to_string(merged_paths.size()) + " results of " + std::to_string(shard_count) +
+                 " shards merged into: " + images_dir + "\n";
+
+    if (vm.count("remove_shard_results")) {
+        for (const auto &[index, shard_file_path]: shard_files) {
+            fs::remove(shard_file_path);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
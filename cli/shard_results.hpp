@@ -0,0 +1,86 @@
+#pragma once
+
+#include <boost/filesystem.hpp>
+
+#include <optional>
+#include <string>
+
+
+namespace shard_results {
+
+    // every line of a shard results file is a standalone json object with these keys
+    constexpr const char *RELATIVE_PATH_KEY = "relative_path";
+    constexpr const char *RESULT_KEY = "result";
+
+    constexpr const char *FILE_NAME_PREFIX = "shard_";
+    constexpr const char *FILE_NAME_SEPARATOR = "_of_";
+    constexpr const char *FILE_NAME_SUFFIX = ".results.jsonl";
+
+
+    struct Shard {
+        int index;
+        int count;
+    };
+
+
+    inline std::optional<int> parse_number(const std::string &value) {
+        if (value.empty() || (value.find_first_not_of("0123456789") != std::string::npos) || (value.size() > 9)) {
+            return std::nullopt;
+        }
+
+        return std::stoi(value);
+    }
+
+
+    // parses "i/N" notation, returns nothing for malformed or out of range values
+    inline std::optional<Shard> parse_shard(const std::string &shard_notation) {
+        const auto separator_position = shard_notation.find('/');
+        if (separator_position == std::string::npos) {
+            return std::nullopt;
+        }
+
+        auto index = parse_number(shard_notation.substr(0, separator_position));
+        auto count = parse_number(shard_notation.substr(separator_position + 1));
+        if (!index || !count || (count.value() < 1) || (index.value() >= count.value())) {
+            return std::nullopt;
+        }
+
+        return Shard{index.value(), count.value()};
+    }
+
+
+    inline std::string file_name(const Shard &shard) {
+        return std::string{FILE_NAME_PREFIX} + std::to_string(shard.index) + FILE_NAME_SEPARATOR +
+               std::to_string(shard.count) + FILE_NAME_SUFFIX;
+    }
+
+
+    // the folder of the packed container of a shard within the given container folder, e.g. "shard_0_of_4"
+    inline std::string directory_name(const Shard &shard) {
+        return std::string{FILE_NAME_PREFIX} + std::to_string(shard.index) + FILE_NAME_SEPARATOR +
+               std::to_string(shard.count);
+    }
+
+
+    // restores the shard from a file name created by file_name()
+    inline std::optional<Shard> parse_file_name(const std::string &name) {
+        const std::string prefix{FILE_NAME_PREFIX};
+        const std::string separator{FILE_NAME_SEPARATOR};
+        const std::string suffix{FILE_NAME_SUFFIX};
+
+        if ((name.size() <= prefix.size() + suffix.size()) || (name.compare(0, prefix.size(), prefix) != 0) ||
+            (name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0)) {
+            return std::nullopt;
+        }
+
+        const auto body = name.substr(prefix.size(), name.size() - prefix.size() - suffix.size());
+        const auto separator_position = body.find(separator);
+        if (separator_position == std::string::npos) {
+            return std::nullopt;
+        }
+
+        return parse_shard(body.substr(0, separator_position) + "/" +
+                           body.substr(separator_position + separator.size()));
+    }
+
+} // namespace shard_results
\ No newline at end of file
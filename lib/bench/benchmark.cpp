@@ -0,0 +1,39 @@
+#include "benchmark.hpp"
+
+
+namespace bench {
+
+    Result measure(const std::string &name, const Settings &settings, const Body &body) {
+        using Clock = std::chrono::steady_clock;
+
+        body();
+
+        processing::Histogram durations_ns;
+        std::uint64_t items = 0;
+        const auto start_time = Clock::now();
+        auto elapsed = Clock::duration::zero();
+        while ((elapsed < settings.min_time) || (durations_ns.count() < settings.min_iterations)) {
+            const auto iteration_start_time = Clock::now();
+            items += body();
+            const auto iteration_end_time = Clock::now();
+            durations_ns.record(static_cast<std::uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(iteration_end_time - iteration_start_time)
+                            .count()));
+            elapsed = iteration_end_time - start_time;
+        }
+
+        const auto elapsed_seconds = std::chrono::duration<double>(elapsed).count();
+        return Result{name,
+                      durations_ns.count(),
+                      static_cast<double>(items) / elapsed_seconds,
+                      static_cast<double>(durations_ns.sum()) / static_cast<double>(durations_ns.count()) / 1e3,
+                      static_cast<double>(durations_ns.percentile(0.5)) / 1e3,
+                      static_cast<double>(durations_ns.percentile(0.99)) / 1e3};
+    }
+
+
+    bool is_selected(const std::string &name, const Settings &settings) {
+        return settings.filter.empty() || (name.find(settings.filter) != std::string::npos);
+    }
+
+} // namespace bench
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "processor/histogram.hpp"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+namespace bench {
+
+    struct Settings {
+        std::chrono::milliseconds min_time{2000};
+        std::size_t min_iterations{5};
+        std::string filter;                    // runs only the benchmarks whose names contain it
+        std::filesystem::path image_path;      // the source of the per-resolution detector inputs
+        std::filesystem::path images_dir;      // the end-to-end processor input
+        std::filesystem::path haar_description_path;
+        std::filesystem::path caffe_description_path;
+        std::size_t max_workers_number{4};
+    };
+
+
+    struct Result {
+        std::string name;
+        std::uint64_t iterations;
+        double items_per_second;
+        double mean_us;                        // per iteration
+        double p50_us;
+        double p99_us;
+    };
+
+
+    // the body runs one iteration and returns the number of processed items (images, tasks)
+    using Body = std::function<std::size_t()>;
+
+    // repeats the body until both min_time and min_iterations are reached, after one warm-up iteration
+    Result measure(const std::string &name, const Settings &settings, const Body &body);
+
+    bool is_selected(const std::string &name, const Settings &settings);
+
+    std::vector<Result> run_detector_benchmarks(const Settings &settings);
+
+    std::vector<Result> run_processor_benchmarks(const Settings &settings);
+
+} // namespace bench
\ No newline at end of file
@@ -0,0 +1,268 @@
+#include "benchmark.hpp"
+
+#include "detector/caffe_detector.hpp"
+#include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+#include "processor/sequence_tracker.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <iomanip>
+#include <iostream>
+#include <optional>
+
+
+namespace {
+
+    const std::vector<cv::Size> RESOLUTIONS{{320, 240}, {640, 480}, {1280, 720}, {1920, 1080}, {3840, 2160}};
+    const cv::Size CORPUS_RESOLUTION{640, 480};
+    const int SEQUENCE_FRAMES_NUMBER{60};
+
+    const std::vector<std::pair<std::string, detection::Mode>> MODES{{"full",     detection::Mode::FULL},
+                                                                     {"count",    detection::Mode::COUNT},
+                                                                     {"presence", detection::Mode::PRESENCE}};
+
+
+    // the settings are overridden by the given "settings." paths and values
+    std::unique_ptr<detection::Detector> load_detector(
+            const std::filesystem::path &description_path,
+            const std::vector<std::pair<std::string, std::string>> &overridden_settings = {}) {
+        if (!std::filesystem::exists(description_path)) {
+            std::cerr << "detector description was not found by path: " << description_path.string()
+                      << ", its benchmarks are skipped\n";
+            return nullptr;
+        }
+
+        try {
+            boost::property_tree::ptree settings;
+            boost::property_tree::read_json(description_path.string(), settings);
+            for (const auto &[path, value]: overridden_settings) {
+                settings.put("settings." + path, value);
+            }
+            return detection::create_detector(settings);
+        } catch (const std::exception &error) {
+            std::cerr << "detector creation failed: " << error.what() << ", its benchmarks are skipped\n";
+            return nullptr;
+        }
+    }
+
+
+    // the images of the folder with their upside down copies, which a frontal face detector finds no faces on,
+    // so most of the corpus is negative as the traffic of the presence and count jobs
+    std::vector<cv::Mat> load_corpus(const std::filesystem::path &images_dir) {
+        std::vector<cv::Mat> corpus;
+        if (!std::filesystem::exists(images_dir)) {
+            return corpus;
+        }
+
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(images_dir)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+            const auto image = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+            if (image.empty()) {
+                continue;
+            }
+
+            cv::Mat resized_image, flipped_image;
+            cv::resize(image, resized_image, CORPUS_RESOLUTION, 0, 0, cv::INTER_LINEAR);
+            cv::flip(resized_image, flipped_image, 0);
+            corpus.emplace_back(std::move(resized_image));
+            corpus.emplace_back(std::move(flipped_image));
+        }
+        return corpus;
+    }
+
+
+    // one iteration detects the whole corpus in every mode, the speedups over the full mode go to stderr
+    void run_modes(const std::string &detector_name, detection::Detector *detector,
+                   const std::vector<cv::Mat> &corpus, const bench::Settings &settings,
+                   std::vector<bench::Result> &results) {
+        if (corpus.empty()) {
+            return;
+        }
+
+        std::size_t positive_images = 0;
+        for (const auto &image: corpus) {
+            positive_images += detector->detect(image).empty() ? 0 : 1;
+        }
+        std::cerr << detector_name << " mode corpus: " << corpus.size() << " images, " << positive_images
+                  << " with faces\n";
+
+        std::optional<double> full_items_per_second;
+        for (const auto &[mode_name, mode]: MODES) {
+            const auto name = detector_name + ".mode/" + mode_name;
+            if (!bench::is_selected(name, settings)) {
+                continue;
+            }
+
+            results.emplace_back(bench::measure(name, settings, [detector, &corpus, mode = mode]() {
+                for (const auto &image: corpus) {
+                    if (mode == detection::Mode::FULL) {
+                        detector->detect(image);
+                    } else {
+                        detector->count(image, mode);
+                    }
+                }
+                return corpus.size();
+            }));
+
+            if (mode == detection::Mode::FULL) {
+                full_items_per_second = results.back().items_per_second;
+            } else if (full_items_per_second && (full_items_per_second.value() > 0)) {
+                std::cerr << std::fixed << std::setprecision(2) << name << " speedup over full: x"
+                          << results.back().items_per_second / full_items_per_second.value() << "\n";
+            }
+        }
+    }
+
+
+    // a camera panning over the source image by a few pixels per frame, in the corpus resolution
+    std::vector<cv::Mat> make_sequence(const cv::Mat &source_image) {
+        cv::Mat scene;
+        cv::resize(source_image, scene, cv::Size(CORPUS_RESOLUTION.width + 2 * SEQUENCE_FRAMES_NUMBER,
+                                                 CORPUS_RESOLUTION.height + SEQUENCE_FRAMES_NUMBER),
+                   0, 0, cv::INTER_LINEAR);
+        std::vector<cv::Mat> frames;
+        for (int i = 0; i < SEQUENCE_FRAMES_NUMBER; i++) {
+            frames.emplace_back(scene(cv::Rect(2 * i, i, CORPUS_RESOLUTION.width, CORPUS_RESOLUTION.height)).clone());
+        }
+        return frames;
+    }
+
+
+    // one iteration detects the whole sequence, either every frame or the keyframes with the faces followed
+    // in between; the speedup of the tracking and its drift from the detection of every frame go to stderr
+    void run_sequence(const std::string &detector_name, detection::Detector *detector,
+                      const std::vector<cv::Mat> &frames, const bench::Settings &settings,
+                      std::vector<bench::Result> &results) {
+        const processing::SequenceConfig config;
+        const auto track_sequence = [detector, &frames, &config](std::vector<std::vector<cv::Rect>> &frames_faces) {
+            processing::SequenceTracker tracker{config};
+            std::size_t detected_frames_number = 0;
+            for (std::size_t i = 0; i < frames.size(); i++) {
+                if (tracker.track(frames[i], frames_faces[i]) != processing::FrameKind::TRACKED) {
+                    frames_faces[i] = detector->detect(frames[i]);
+                    tracker.reset(frames_faces[i]);
+                    detected_frames_number++;
+                }
+            }
+            return detected_frames_number;
+        };
+
+        const auto full_name = detector_name + ".sequence/full";
+        const auto tracked_name = detector_name + ".sequence/tracked";
+        std::optional<double> full_items_per_second;
+        if (bench::is_selected(full_name, settings)) {
+            results.emplace_back(bench::measure(full_name, settings, [detector, &frames]() {
+                for (const auto &frame: frames) {
+                    detector->detect(frame);
+                }
+                return frames.size();
+            }));
+            full_items_per_second = results.back().items_per_second;
+        }
+        if (!bench::is_selected(tracked_name, settings)) {
+            return;
+        }
+
+        std::vector<std::vector<cv::Rect>> frames_faces(frames.size());
+        results.emplace_back(bench::measure(tracked_name, settings, [&track_sequence, &frames_faces]() {
+            track_sequence(frames_faces);
+            return frames_faces.size();
+        }));
+        if (full_items_per_second && (full_items_per_second.value() > 0)) {
+            std::cerr << std::fixed << std::setprecision(2) << tracked_name << " speedup over full: x"
+                      << results.back().items_per_second / full_items_per_second.value() << "\n";
+        }
+
+        const auto detected_frames_number = track_sequence(frames_faces);
+        double drift_sum = 0.0;
+        double max_drift = 0.0;
+        for (std::size_t i = 0; i < frames.size(); i++) {
+            const auto drift = processing::faces_drift(frames_faces[i], detector->detect(frames[i]));
+            drift_sum += drift;
+            max_drift = std::max(max_drift, drift);
+        }
+        std::cerr << std::fixed << std::setprecision(2) << tracked_name << ": " << detected_frames_number << " of "
+                  << frames.size() << " frames detected, drift from full: mean " << 100 * drift_sum / frames.size()
+                  << "%, max " << 100 * max_drift << "%\n";
+    }
+
+
+    std::string resolution_name(const cv::Size &size) {
+        return std::to_string(size.width) + "x" + std::to_string(size.height);
+    }
+
+
+    // the preparation of both detectors is a const member, so one template covers them
+    template<typename DetectorType>
+    void run_detector(const std::string &detector_name, detection::Detector *detector,
+                      const std::vector<cv::Mat> &images, const bench::Settings &settings,
+                      std::vector<bench::Result> &results) {
+        auto *typed_detector = dynamic_cast<DetectorType *>(detector);
+        for (std::size_t i = 0; i < RESOLUTIONS.size(); i++) {
+            const auto &image = images[i];
+
+            const auto prepare_name = detector_name + ".prepare/" + resolution_name(RESOLUTIONS[i]);
+            if ((typed_detector != nullptr) && bench::is_selected(prepare_name, settings)) {
+                results.emplace_back(bench::measure(prepare_name, settings, [typed_detector, &image]() {
+                    auto prepared_image = typed_detector->prepare_image_for_detection(image);
+                    return prepared_image.empty() ? 0 : 1;
+                }));
+            }
+
+            const auto detect_name = detector_name + ".detect/" + resolution_name(RESOLUTIONS[i]);
+            if (bench::is_selected(detect_name, settings)) {
+                results.emplace_back(bench::measure(detect_name, settings, [detector, &image]() {
+                    detector->detect(image);
+                    return 1;
+                }));
+            }
+        }
+    }
+
+}
+
+
+namespace bench {
+
+    std::vector<Result> run_detector_benchmarks(const Settings &settings) {
+        std::vector<Result> results;
+
+        const auto source_image = cv::imread(settings.image_path.string(), cv::IMREAD_COLOR);
+        if (source_image.empty()) {
+            std::cerr << "benchmark image was not loaded by path: " << settings.image_path.string()
+                      << ", the detector benchmarks are skipped\n";
+            return results;
+        }
+
+        std::vector<cv::Mat> images;
+        for (const auto &resolution: RESOLUTIONS) {
+            cv::Mat image;
+            cv::resize(source_image, image, resolution, 0, 0, cv::INTER_LINEAR);
+            images.emplace_back(std::move(image));
+        }
+
+        const auto corpus = load_corpus(settings.images_dir);
+        const auto sequence = make_sequence(source_image);
+        if (auto detector = load_detector(settings.haar_description_path)) {
+            run_detector<detection::haar::HaarDetector>("haar", detector.get(), images, settings, results);
+            run_modes("haar", detector.get(), corpus, settings, results);
+            run_sequence("haar", detector.get(), sequence, settings, results);
+        }
+        if (auto detector = load_detector(settings.caffe_description_path)) {
+            run_detector<detection::caffe::CaffeDetector>("caffe", detector.get(), images, settings, results);
+            run_modes("caffe", detector.get(), corpus, settings, results);
+            run_sequence("caffe", detector.get(), sequence, settings, results);
+        }
+        if (auto detector = load_detector(settings.caffe_description_path, {{"input_shape", "aspect"}})) {
+            run_detector<detection::caffe::CaffeDetector>("caffe_aspect", detector.get(), images, settings, results);
+        }
+        return results;
+    }
+
+} // namespace bench
\ No newline at end of file
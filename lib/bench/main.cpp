@@ -0,0 +1,193 @@
+#include "benchmark.hpp"
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+
+
+namespace po = boost::program_options;
+namespace fs = std::filesystem;
+
+
+namespace config {
+    constexpr const char *DEFAULT_IMAGE_NAME = "bench_resources/face_front_1_rgb.bmp";
+    constexpr const char *DEFAULT_IMAGES_DIR = "bench_resources";
+    constexpr const char *DEFAULT_HAAR_DESCRIPTION_FILE_NAME = "haar_detector_description.json";
+    constexpr const char *DEFAULT_CAFFE_DESCRIPTION_FILE_NAME = "caffe_detector_description.json";
+    constexpr double DEFAULT_REGRESSION_THRESHOLD = 0.1;
+} // namespace config
+
+
+namespace {
+
+    void write_json(std::ostream &os, const std::vector<bench::Result> &results) {
+        os << std::fixed << std::setprecision(3) << "{\n  \"results\": [";
+        for (std::size_t i = 0; i < results.size(); i++) {
+            const auto &result = results[i];
+            os << (i ? ",\n" : "\n") << "    {\"name\": \"" << result.name << "\", \"iterations\": " << result.iterations
+               << ", \"items_per_second\": " << result.items_per_second << ", \"mean_us\": " << result.mean_us
+               << ", \"p50_us\": " << result.p50_us << ", \"p99_us\": " << result.p99_us << "}";
+        }
+        os << "\n  ]\n}\n";
+    }
+
+
+    void write_csv(std::ostream &os, const std::vector<bench::Result> &results) {
+        os << std::fixed << std::setprecision(3) << "name,iterations,items_per_second,mean_us,p50_us,p99_us\n";
+        for (const auto &result: results) {
+            os << result.name << "," << result.iterations << "," << result.items_per_second << ","
+               << result.mean_us << "," << result.p50_us << "," << result.p99_us << "\n";
+        }
+    }
+
+
+    // the benchmark name to its throughput, read from a json written by a previous run
+    std::map<std::string, double> read_baseline(const fs::path &baseline_path) {
+        boost::property_tree::ptree root;
+        boost::property_tree::read_json(baseline_path.string(), root);
+
+        std::map<std::string, double> baseline;
+        for (const auto &[key, result]: root.get_child("results")) {
+            baseline[result.get<std::string>("name")] = result.get<double>("items_per_second");
+        }
+        return baseline;
+    }
+
+
+    // prints the throughput change of every benchmark present in both runs to stderr, so the standard output
+    // stays machine-readable; returns the regressions number
+    std::size_t compare(const std::vector<bench::Result> &results, const std::map<std::string, double> &baseline,
+                        double threshold) {
+        std::size_t regressions_number = 0;
+        std::cerr << std::fixed << std::setprecision(1);
+        for (const auto &result: results) {
+            auto it = baseline.find(result.name);
+            if ((it == baseline.end()) || (it->second <= 0)) {
+                std::cerr << std::left << std::setw(40) << result.name << " no baseline\n";
+                continue;
+            }
+
+            const auto change = result.items_per_second / it->second - 1.0;
+            const bool regressed = change < -threshold;
+            regressions_number += regressed ? 1 : 0;
+            std::cerr << std::left << std::setw(40) << result.name << std::right << std::setw(8)
+                      << std::showpos << change * 100 << std::noshowpos << "%"
+                      << (regressed ? "  REGRESSION" : "") << "\n";
+        }
+        return regressions_number;
+    }
+
+}
+
+
+int main(int argc, const char **argv) {
+    bench::Settings settings;
+    int min_time_ms;
+    std::string image_path;
+    std::string images_dir;
+    std::string haar_description_path;
+    std::string caffe_description_path;
+    std::string output_path;
+    std::string format;
+    std::string baseline_path;
+    double threshold;
+
+    po::options_description options_description("Benchmark options");
+    options_description.add_options()
+            ("help,h", "Show help")
+            ("filter,f",
+             po::value<std::string>(&settings.filter),
+             "run only the benchmarks whose names contain the given string")
+            ("min_time",
+             po::value<int>(&min_time_ms)->default_value(2000),
+             "minimal measuring time of every benchmark in milliseconds")
+            ("image",
+             po::value<std::string>(&image_path)->default_value(config::DEFAULT_IMAGE_NAME),
+             "set the image resized to every detector benchmark resolution")
+            ("images_dir,i",
+             po::value<std::string>(&images_dir)->default_value(config::DEFAULT_IMAGES_DIR),
+             "set the images folder for the end-to-end processor benchmarks")
+            ("haar_description",
+             po::value<std::string>(&haar_description_path)->default_value(
+                     config::DEFAULT_HAAR_DESCRIPTION_FILE_NAME),
+             "set the haar detector description file, also used by the processor benchmarks")
+            ("caffe_description",
+             po::value<std::string>(&caffe_description_path)->default_value(
+                     config::DEFAULT_CAFFE_DESCRIPTION_FILE_NAME),
+             "set the caffe detector description file")
+            ("max_workers_number,w",
+             po::value<std::size_t>(&settings.max_workers_number)->default_value(4),
+             "the processor benchmarks run with 1 to the given number of workers")
+            ("output,o",
+             po::value<std::string>(&output_path),
+             "write the results into the given file instead of the standard output")
+            ("format",
+             po::value<std::string>(&format)->default_value("json"),
+             "results format: json or csv")
+            ("baseline,b",
+             po::value<std::string>(&baseline_path),
+             "compare the throughput with the given results json, exit with failure on a regression")
+            ("threshold",
+             po::value<double>(&threshold)->default_value(config::DEFAULT_REGRESSION_THRESHOLD),
+             "throughput drop treated as a regression, 0.1 is 10%");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, options_description), vm);
+        po::notify(vm);
+    }
+    catch (const po::error &error) {
+        std::cerr << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (vm.count("help")) {
+        options_description.print(std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    if ((format != "json") && (format != "csv")) {
+        std::cerr << "Unknown results format: " << format << "\n";
+        return EXIT_FAILURE;
+    }
+
+    settings.min_time = std::chrono::milliseconds(std::max(min_time_ms, 0));
+    settings.image_path = image_path;
+    settings.images_dir = images_dir;
+    settings.haar_description_path = haar_description_path;
+    settings.caffe_description_path = caffe_description_path;
+
+    std::map<std::string, double> baseline;
+    if (!baseline_path.empty()) {
+        try {
+            baseline = read_baseline(baseline_path);
+        } catch (const std::exception &error) {
+            std::cerr << "Can't read the baseline: " << error.what() << "\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    auto results = bench::run_detector_benchmarks(settings);
+    auto processor_results = bench::run_processor_benchmarks(settings);
+    results.insert(results.end(), processor_results.begin(), processor_results.end());
+
+    if (output_path.empty()) {
+        (format == "json") ? write_json(std::cout, results) : write_csv(std::cout, results);
+    } else {
+        std::ofstream output(output_path, std::ios::out | std::ios::trunc);
+        if (!output) {
+            std::cerr << "Can't create the results file: " << output_path << "\n";
+            return EXIT_FAILURE;
+        }
+        (format == "json") ? write_json(output, results) : write_csv(output, results);
+    }
+
+    if (!baseline_path.empty() && (compare(results, baseline, threshold) > 0)) {
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#include "benchmark.hpp"
+
+#include "processor/processor.hpp"
+
+#include <iostream>
+#include <thread>
+
+
+namespace {
+
+    const std::size_t QUEUE_TASKS_NUMBER{100000};
+
+
+    // one producer and the given number of consumers pass QUEUE_TASKS_NUMBER empty tasks through the scheduler
+    std::size_t pass_tasks_through_scheduler(std::size_t consumers_number) {
+        processing::Scheduler scheduler{1000, {std::chrono::milliseconds(0), std::chrono::milliseconds(500),
+                                               std::chrono::milliseconds(2000)}};
+        auto job = std::make_shared<processing::Job>(scheduler, [](const processing::ImageResult &) {},
+                                                     PRIORITY_CLASS::PRIORITY_NORMAL, std::nullopt,
+                                                     DEADLINE_POLICY::DEADLINE_DROP);
+
+        std::atomic<std::size_t> consumed_tasks{0};
+        std::vector<std::thread> consumers;
+        for (std::size_t i = 0; i < consumers_number; i++) {
+            consumers.emplace_back([&scheduler, &consumed_tasks]() {
+                while (scheduler.pop()) {
+                    consumed_tasks.fetch_add(1, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        for (std::size_t i = 0; i < QUEUE_TASKS_NUMBER; i++) {
+            scheduler.push(processing::Task{std::string(), job, processing::Clock::time_point{}});
+        }
+        while (consumed_tasks.load(std::memory_order_relaxed) < QUEUE_TASKS_NUMBER) {
+            std::this_thread::yield();
+        }
+
+        scheduler.close();
+        for (auto &consumer: consumers) {
+            consumer.join();
+        }
+        return QUEUE_TASKS_NUMBER;
+    }
+
+}
+
+
+namespace bench {
+
+    std::vector<Result> run_processor_benchmarks(const Settings &settings) {
+        std::vector<Result> results;
+
+        for (std::size_t consumers_number: {1, 2, 4, 8}) {
+            const auto name = "scheduler.throughput/" + std::to_string(consumers_number) + "_consumers";
+            if (is_selected(name, settings)) {
+                results.emplace_back(measure(name, settings, [consumers_number]() {
+                    return pass_tasks_through_scheduler(consumers_number);
+                }));
+            }
+        }
+
+        if (!std::filesystem::exists(settings.images_dir)) {
+            std::cerr << "images folder was not found by path: " << settings.images_dir.string()
+                      << ", the processor benchmarks are skipped\n";
+            return results;
+        }
+
+        for (std::size_t workers_number = 1; workers_number <= settings.max_workers_number; workers_number++) {
+            const auto name = "processor.process/" + std::to_string(workers_number) + "_workers";
+            if (!is_selected(name, settings)) {
+                continue;
+            }
+
+            processing::Processor processor;
+            auto init_result = processor.init(
+                    processing::InitConfig{workers_number, settings.haar_description_path.string()});
+            if (init_result != RESULT_CODE::INIT_SUCCESS) {
+                std::cerr << "processor init failed with code " << init_result << ", " << name << " is skipped\n";
+                continue;
+            }
+
+            results.emplace_back(measure(name, settings, [&processor, &settings]() {
+                std::atomic<std::size_t> images_number{0};
+                processor.process(settings.images_dir.string(),
+                                  [&images_number](std::string processed_image_path, std::vector<cv::Rect> faces) {
+                                      images_number++;
+                                  });
+                return images_number.load();
+            }));
+        }
+        return results;
+    }
+
+} // namespace bench
\ No newline at end of file
@@ -0,0 +1,415 @@
+#include "processor/processor.hpp"
+
+#include <pybind11/pybind11.h>
+#include <pybind11/numpy.h>
+#include <pybind11/stl.h>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <sstream>
+
+
+namespace py = pybind11;
+
+
+namespace {
+
+    // how often a waiting consumer checks whether a job without further results has been completed
+    const std::chrono::milliseconds COMPLETION_POLL_PERIOD{20};
+
+
+    // Filled by the workers without ever taking the GIL, emptied by the python side in batches.
+    class ResultQueue {
+    public:
+        void push(const processing::ImageResult &result) {
+            {
+                std::lock_guard lk{_mutex};
+                _results.push_back(result);
+            }
+            _result_conditional_variable.notify_one();
+        }
+
+        // waits until a result is available, the job is completed or the timeout has expired;
+        // expects the GIL to be released
+        std::vector<processing::ImageResult> take(std::size_t max_results, const processing::Job &job,
+                                                  std::optional<std::chrono::milliseconds> timeout) {
+            const auto deadline = processing::Clock::now() + timeout.value_or(std::chrono::milliseconds(0));
+            std::unique_lock lk{_mutex};
+            while (_results.empty() && !job.progress().finished) {
+                auto wait_until = processing::Clock::now() + COMPLETION_POLL_PERIOD;
+                if (timeout) {
+                    if (processing::Clock::now() >= deadline) {
+                        break;
+                    }
+                    wait_until = std::min(wait_until, deadline);
+                }
+                _result_conditional_variable.wait_until(lk, wait_until);
+            }
+
+            std::vector<processing::ImageResult> results;
+            while (!_results.empty() && (results.size() < max_results)) {
+                results.emplace_back(std::move(_results.front()));
+                _results.pop_front();
+            }
+            return results;
+        }
+
+        bool empty() const {
+            std::lock_guard lk{_mutex};
+            return _results.empty();
+        }
+
+    private:
+        mutable std::mutex _mutex;
+        std::condition_variable _result_conditional_variable;
+        std::deque<processing::ImageResult> _results;
+    };
+
+
+    void check_result(RESULT_CODE result_code, RESULT_CODE expected_code, const char *operation) {
+        if (result_code != expected_code) {
+            throw std::runtime_error(std::string(operation) + " failed with the result code " +
+                                     std::to_string(static_cast<int>(result_code)));
+        }
+    }
+
+
+    // wraps the array memory without a copy, the pixels of a row must be contiguous
+    cv::Mat to_mat(const py::buffer &image) {
+        const auto info = image.request();
+        if (info.format != py::format_descriptor<std::uint8_t>::format()) {
+            throw py::value_error("an uint8 image is expected");
+        }
+        if ((info.ndim != 2) && (info.ndim != 3)) {
+            throw py::value_error("an image of the (height, width) or (height, width, channels) shape is expected");
+        }
+
+        const auto channels = (info.ndim == 3) ? info.shape[2] : 1;
+        if ((channels != 1) && (channels != 3)) {
+            throw py::value_error("an image with 1 or 3 channels is expected");
+        }
+        if ((info.strides[0] <= 0) || (info.strides[1] != channels) || ((info.ndim == 3) && (info.strides[2] != 1))) {
+            throw py::value_error("the image rows must be contiguous, use numpy.ascontiguousarray()");
+        }
+
+        return cv::Mat(static_cast<int>(info.shape[0]), static_cast<int>(info.shape[1]),
+                       CV_8UC(static_cast<int>(channels)), info.ptr, static_cast<std::size_t>(info.strides[0]));
+    }
+
+
+    // an (n, 4) int32 array of x, y, width, height rows
+    py::array_t<std::int32_t> to_array(const std::vector<cv::Rect> &faces) {
+        py::array_t<std::int32_t> array({static_cast<py::ssize_t>(faces.size()), py::ssize_t{4}});
+        auto view = array.mutable_unchecked<2>();
+        for (std::size_t i = 0; i < faces.size(); i++) {
+            const auto row = static_cast<py::ssize_t>(i);
+            view(row, 0) = faces[i].x;
+            view(row, 1) = faces[i].y;
+            view(row, 2) = faces[i].width;
+            view(row, 3) = faces[i].height;
+        }
+        return array;
+    }
+
+
+    processing::ProcessOptions make_options(PRIORITY_CLASS priority, std::optional<std::int64_t> deadline_ms,
+                                            DEADLINE_POLICY deadline_policy) {
+        processing::ProcessOptions options;
+        options.priority = priority;
+        if (deadline_ms) {
+            options.deadline = std::chrono::milliseconds(deadline_ms.value());
+        }
+        options.deadline_policy = deadline_policy;
+        return options;
+    }
+
+
+    class PythonJob {
+    public:
+        PythonJob(std::shared_ptr<ResultQueue> results, std::vector<py::buffer> images, bool is_in_memory)
+                : _results{std::move(results)}, _images{std::move(images)}, _is_in_memory{is_in_memory} {
+        }
+
+        PythonJob(const PythonJob &) = delete;
+
+        PythonJob &operator=(const PythonJob &) = delete;
+
+        // the workers may still read the arrays, so they are released only once the job is completed
+        ~PythonJob() {
+            if (_job) {
+                py::gil_scoped_release release;
+                _job->cancel();
+                _job->wait();
+            }
+        }
+
+        std::shared_ptr<processing::Job> &job() {
+            return _job;
+        }
+
+        // up to max_results (key, faces) tuples, the key is the image index of submit() or the image path;
+        // an empty list once the job is completed and every result is taken, or when the timeout has expired
+        py::list next_batch(std::size_t max_results, std::optional<double> timeout_seconds) {
+            std::optional<std::chrono::milliseconds> timeout;
+            if (timeout_seconds) {
+                timeout = std::chrono::milliseconds(static_cast<std::int64_t>(timeout_seconds.value() * 1000));
+            }
+
+            std::vector<processing::ImageResult> results;
+            {
+                py::gil_scoped_release release;
+                results = _results->take(std::max<std::size_t>(max_results, 1), *_job, timeout);
+            }
+
+            py::list batch;
+            for (const auto &result: results) {
+                if (_is_in_memory) {
+                    batch.append(py::make_tuple(result.image_index, to_array(result.faces)));
+                } else {
+                    batch.append(py::make_tuple(result.image_path, to_array(result.faces)));
+                }
+            }
+            return batch;
+        }
+
+        bool is_exhausted() const {
+            return _job->progress().finished && _results->empty();
+        }
+
+        py::dict progress() const {
+            const auto progress = _job->progress();
+            py::dict dict;
+            dict["discovered"] = progress.discovered;
+            dict["queued"] = progress.queued;
+            dict["decoded"] = progress.decoded;
+            dict["detected"] = progress.detected;
+            dict["failed"] = progress.failed;
+            dict["dropped"] = progress.dropped;
+            dict["images_per_second"] = progress.images_per_second;
+            dict["walk_finished"] = progress.walk_finished;
+            dict["finished"] = progress.finished;
+            dict["cancelled"] = progress.cancelled;
+            return dict;
+        }
+
+        void cancel() {
+            _job->cancel();
+        }
+
+        RESULT_CODE wait() {
+            py::gil_scoped_release release;
+            return _job->wait();
+        }
+
+    private:
+        std::shared_ptr<processing::Job> _job;
+        std::shared_ptr<ResultQueue> _results;
+        const std::vector<py::buffer> _images;
+        const bool _is_in_memory;
+    };
+
+
+    py::object next_result(PythonJob &job) {
+        auto batch = job.next_batch(1, std::nullopt);
+        if (batch.empty()) {
+            throw py::stop_iteration();
+        }
+        return batch[0];
+    }
+
+
+    class PythonProcessor {
+    public:
+        PythonProcessor(const std::string &detector_description_file_path, std::size_t workers_number,
+                        std::optional<std::size_t> max_workers_number) {
+            processing::InitConfig config{workers_number, detector_description_file_path};
+            if (max_workers_number) {
+                config.autoscaling = processing::AutoscalingConfig{workers_number, max_workers_number.value()};
+            }
+
+            RESULT_CODE init_result;
+            {
+                py::gil_scoped_release release;
+                init_result = _processor.init(config);
+            }
+            check_result(init_result, RESULT_CODE::INIT_SUCCESS, "init");
+        }
+
+        std::unique_ptr<PythonJob> submit(const py::iterable &images, const processing::ProcessOptions &options) {
+            std::vector<py::buffer> buffers;
+            std::vector<cv::Mat> mats;
+            for (const auto &image: images) {
+                buffers.emplace_back(py::reinterpret_borrow<py::buffer>(image));
+                mats.emplace_back(to_mat(buffers.back()));
+            }
+
+            auto results = std::make_shared<ResultQueue>();
+            auto job = std::make_unique<PythonJob>(results, std::move(buffers), true);
+            RESULT_CODE start_result;
+            {
+                py::gil_scoped_release release;
+                start_result = _processor.start(std::move(mats), options,
+                                                [results](const processing::ImageResult &result) {
+                                                    results->push(result);
+                                                }, job->job());
+            }
+            check_result(start_result, RESULT_CODE::PROCESS_SUCCESS, "submit");
+            return job;
+        }
+
+        std::unique_ptr<PythonJob> process_folder(const std::string &path_to_image_folder,
+                                                  const processing::ProcessOptions &options) {
+            auto results = std::make_shared<ResultQueue>();
+            auto job = std::make_unique<PythonJob>(results, std::vector<py::buffer>{}, false);
+            RESULT_CODE start_result;
+            {
+                py::gil_scoped_release release;
+                start_result = _processor.start(path_to_image_folder, options,
+                                                [results](const processing::ImageResult &result) {
+                                                    results->push(result);
+                                                }, job->job());
+            }
+            check_result(start_result, RESULT_CODE::PROCESS_SUCCESS, "process_folder");
+            return job;
+        }
+
+        // the faces of every image in the submission order, the images are detected by the whole worker pool
+        py::list detect_batch(const py::iterable &images, const processing::ProcessOptions &options) {
+            py::list images_list(images);
+            auto job = submit(images_list, options);
+            check_result(job->wait(), RESULT_CODE::PROCESS_SUCCESS, "detect");
+
+            py::list faces;
+            for (std::size_t i = 0; i < images_list.size(); i++) {
+                faces.append(py::none());
+            }
+            for (auto batch = job->next_batch(images_list.size(), 0.0); !batch.empty();
+                 batch = job->next_batch(images_list.size(), 0.0)) {
+                for (const auto &item: batch) {
+                    auto result = item.cast<py::tuple>();
+                    faces[result[0].cast<std::size_t>()] = result[1];
+                }
+            }
+            return faces;
+        }
+
+        std::string stats() const {
+            std::ostringstream oss;
+            boost::property_tree::write_json(oss, _processor.stats().to_json());
+            return oss.str();
+        }
+
+        std::size_t active_workers_number() const {
+            return _processor.active_workers_number();
+        }
+
+        void reload(const std::string &detector_description_file_path) {
+            RESULT_CODE reload_result;
+            {
+                py::gil_scoped_release release;
+                reload_result = _processor.reload(detector_description_file_path);
+            }
+            check_result(reload_result, RESULT_CODE::INIT_SUCCESS, "reload");
+        }
+
+        std::uint64_t config_version() const {
+            return _processor.config_version();
+        }
+
+    private:
+        processing::Processor _processor;
+    };
+
+}
+
+
+PYBIND11_MODULE(face_detection, m) {
+    m.doc() = "Face detection over a pool of native workers, the GIL is released while the images are detected";
+
+    py::enum_<PRIORITY_CLASS>(m, "Priority")
+            .value("INTERACTIVE", PRIORITY_CLASS::PRIORITY_INTERACTIVE)
+            .value("NORMAL", PRIORITY_CLASS::PRIORITY_NORMAL)
+            .value("BACKFILL", PRIORITY_CLASS::PRIORITY_BACKFILL);
+
+    py::enum_<DEADLINE_POLICY>(m, "DeadlinePolicy")
+            .value("DROP", DEADLINE_POLICY::DEADLINE_DROP)
+            .value("FLAG", DEADLINE_POLICY::DEADLINE_FLAG);
+
+    py::class_<PythonJob>(m, "Job")
+            .def("next_batch", &PythonJob::next_batch, py::arg("max_results") = 64, py::arg("timeout") = py::none(),
+                 "Takes up to max_results (key, faces) tuples as soon as one is available, the key is the image "
+                 "index for submit() and the path for process_folder(), faces is an (n, 4) int32 array of x, y, "
+                 "width, height; an empty list once the job is exhausted or the timeout in seconds has expired")
+            .def("progress", &PythonJob::progress)
+            .def("cancel", &PythonJob::cancel)
+            .def("wait", [](PythonJob &job) { return static_cast<int>(job.wait()); },
+                 "Blocks until the job is completed, returns the result code")
+            .def_property_readonly("exhausted", &PythonJob::is_exhausted)
+            .def("__iter__", [](py::object self) { return self; })
+            .def("__next__", &next_result)
+            .def("__aiter__", [](py::object self) { return self; })
+            .def("__anext__", [](py::object self) {
+                // the blocking wait runs in the default executor with the GIL released, the event loop keeps going
+                auto loop = py::module_::import("asyncio").attr("get_running_loop")();
+                return loop.attr("run_in_executor")(py::none(), py::cpp_function([self]() {
+                    auto &job = self.cast<PythonJob &>();
+                    auto batch = job.next_batch(1, std::nullopt);
+                    if (batch.empty()) {
+                        PyErr_SetNone(PyExc_StopAsyncIteration);
+                        throw py::error_already_set();
+                    }
+                    return py::object(batch[0]);
+                }));
+            });
+
+    py::class_<PythonProcessor>(m, "Processor")
+            .def(py::init<const std::string &, std::size_t, std::optional<std::size_t>>(),
+                 py::arg("detector_description_file"), py::arg("workers_number") = 2,
+                 py::arg("max_workers_number") = py::none(),
+                 "The workers number is scaled up to max_workers_number by the load when it is given")
+            .def("submit",
+                 [](PythonProcessor &processor, const py::iterable &images, PRIORITY_CLASS priority,
+                    std::optional<std::int64_t> deadline_ms, DEADLINE_POLICY deadline_policy) {
+                     return processor.submit(images, make_options(priority, deadline_ms, deadline_policy));
+                 },
+                 py::arg("images"), py::arg("priority") = PRIORITY_CLASS::PRIORITY_NORMAL,
+                 py::arg("deadline_ms") = py::none(), py::arg("deadline_policy") = DEADLINE_POLICY::DEADLINE_DROP,
+                 py::keep_alive<0, 1>(),
+                 "Starts the detection of uint8 numpy images (BGR or grayscale) without copying them, "
+                 "returns a job iterating over the results as they are detected")
+            .def("process_folder",
+                 [](PythonProcessor &processor, const std::string &path, PRIORITY_CLASS priority,
+                    std::optional<std::int64_t> deadline_ms, DEADLINE_POLICY deadline_policy) {
+                     return processor.process_folder(path, make_options(priority, deadline_ms, deadline_policy));
+                 },
+                 py::arg("path"), py::arg("priority") = PRIORITY_CLASS::PRIORITY_NORMAL,
+                 py::arg("deadline_ms") = py::none(), py::arg("deadline_policy") = DEADLINE_POLICY::DEADLINE_DROP,
+                 py::keep_alive<0, 1>(),
+                 "Starts the detection of an image file or of every image of a folder")
+            .def("detect_batch",
+                 [](PythonProcessor &processor, const py::iterable &images, PRIORITY_CLASS priority) {
+                     return processor.detect_batch(images, make_options(priority, std::nullopt,
+                                                                        DEADLINE_POLICY::DEADLINE_DROP));
+                 },
+                 py::arg("images"), py::arg("priority") = PRIORITY_CLASS::PRIORITY_NORMAL,
+                 "Detects the images on the worker pool and returns their faces arrays in the images order, "
+                 "None for an image which failed")
+            .def("detect",
+                 [](PythonProcessor &processor, const py::buffer &image, PRIORITY_CLASS priority) {
+                     py::list images;
+                     images.append(image);
+                     return processor.detect_batch(images, make_options(priority, std::nullopt,
+                                                                        DEADLINE_POLICY::DEADLINE_DROP))[0];
+                 },
+                 py::arg("image"), py::arg("priority") = PRIORITY_CLASS::PRIORITY_INTERACTIVE,
+                 "Detects one image, returns its faces array or None if it failed")
+            .def("stats", &PythonProcessor::stats, "The processing counters and stage latencies as a json string")
+            .def_property_readonly("active_workers_number", &PythonProcessor::active_workers_number)
+            .def("reload", &PythonProcessor::reload, py::arg("detector_description_file"),
+                 "Swaps in a new detector description without stopping the workers, the images in flight finish "
+                 "on the old one")
+            .def_property_readonly("config_version", &PythonProcessor::config_version);
+}
\ No newline at end of file
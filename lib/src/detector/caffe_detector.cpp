@@ -1,6 +1,8 @@
 #include "caffe_detector.hpp"
 #include "error.hpp"
 
+#include "tracing/tracing.hpp"
+
 
 namespace detection {
     namespace caffe {
@@ -17,73 +19,144 @@ namespace detection {
         }
 
 
+        CaffeDetector::CaffeDetector(Settings &&settings, std::string_view net_structure,
+                                     std::string_view net_weights) : _detector_settings{std::move(settings)} {
+            try {
+                _detector = cv::dnn::readNetFromCaffe(net_structure.data(), net_structure.size(),
+                                                      net_weights.data(), net_weights.size());
+            }
+            catch (std::exception const &e) {
+                RAISE_ERROR(CreationError, std::string("loading of caffe model failed: ") + e.what());
+            }
+        }
+
+
         std::vector<cv::Rect> CaffeDetector::detect(const cv::Mat &image) {
+            return create_results(forward(image), image.size());
+        }
+
+
+        std::size_t CaffeDetector::count(const cv::Mat &image, Mode mode) {
+            if (mode == Mode::FULL) {
+                return detect(image).size();
+            }
+
+            const auto results = forward(image);
+            tracing::Scope scope{"caffe.count"};
+            const int ARGUMENTS_NUMBER = 7;
+            auto detections = results.reshape(1, 1);
+            const int detections_number = detections.cols / ARGUMENTS_NUMBER;
+
+            std::size_t faces_number = 0;
+            for (int current_detection = 0; current_detection < detections_number; current_detection++) {
+                if (is_face(detections, current_detection * ARGUMENTS_NUMBER)) {
+                    faces_number++;
+                    if (mode == Mode::PRESENCE) {
+                        break;
+                    }
+                }
+            }
+            return faces_number;
+        }
+
+
+        cv::Mat CaffeDetector::forward(const cv::Mat &image) {
             cv::Mat blob = cv::dnn::blobFromImage(prepare_image_for_detection(image));
-            cv::Mat results;
-            {
-                std::lock_guard lk{_mutex};
-                _detector.setInput(blob);
-                results = _detector.forward();
+            std::lock_guard lk{_mutex};
+            tracing::Scope scope{"caffe.forward"};
+            _detector.setInput(blob);
+            return _detector.forward();
+        }
+
+
+        bool CaffeDetector::is_face(const cv::Mat &detections, int shift) const {
+            // auto image_id = detections.at<float>(0, shift + 0);
+            auto is_face = detections.at<float>(0, shift + 1);
+            if ((0.97f > is_face) || (is_face > 1.03f)) { // face class equal 1
+                return false;
             }
 
-            return create_results(results, image.cols, image.rows);
+            auto confidence = detections.at<float>(0, shift + 2);
+            return confidence >= _detector_settings.confidence_level;
         }
 
 
         cv::Mat CaffeDetector::prepare_image_for_detection(const cv::Mat &image) const {
+            tracing::Scope scope{"caffe.prepare"};
             if (image.empty()) {
                 RAISE_ERROR(ProcessingError, "empty image");
             }
 
-            const auto input_image_max_dimension = cv::max(image.cols, image.rows);
-            const float scale_factor = static_cast<float>(_detector_settings.target_image_size) /
-                                       static_cast<float>(input_image_max_dimension);
-            const auto resized_image_width = int(static_cast<float>(image.cols) * scale_factor);
-            const auto resized_image_height = int(static_cast<float>(image.rows) * scale_factor);
-
+            const auto layout = input_layout(image.size());
             cv::Mat resized_image, prepared_image;
-            cv::resize(image, resized_image, cv::Size(resized_image_width, resized_image_height));
+            cv::resize(image, resized_image, layout.content_size);
             cv::copyMakeBorder(resized_image, prepared_image,
-                               _detector_settings.target_image_size - resized_image_height,
-                               0, 0,
-                               _detector_settings.target_image_size - resized_image_width,
+                               layout.content_top,
+                               layout.input_size.height - layout.content_top - layout.content_size.height,
+                               0,
+                               layout.input_size.width - layout.content_size.width,
                                cv::BORDER_REPLICATE);
 
             return prepared_image;
         }
 
 
+        CaffeDetector::InputLayout CaffeDetector::input_layout(const cv::Size &image_size) const {
+            const auto target_image_size = _detector_settings.target_image_size;
+            const float scale_factor = static_cast<float>(target_image_size) /
+                                       static_cast<float>(cv::max(image_size.width, image_size.height));
+            const cv::Size content_size(cv::max(1, int(static_cast<float>(image_size.width) * scale_factor)),
+                                        cv::max(1, int(static_cast<float>(image_size.height) * scale_factor)));
+
+            if (_detector_settings.input_shape == InputShape::SQUARE) {
+                return InputLayout{cv::Size(target_image_size, target_image_size), content_size,
+                                   target_image_size - content_size.height};
+            }
+
+            const auto stride = _detector_settings.stride;
+            const auto round_up = [stride](int side) {
+                return (side + stride - 1) / stride * stride;
+            };
+            return InputLayout{cv::Size(round_up(content_size.width), round_up(content_size.height)), content_size, 0};
+        }
+
+
         std::vector<cv::Rect>
-        CaffeDetector::create_results(const cv::Mat &raw_results, int image_input_width, int image_input_height) const {
+        CaffeDetector::create_results(const cv::Mat &raw_results, const cv::Size &image_size) const {
+            tracing::Scope scope{"caffe.results"};
             const int ARGUMENTS_NUMBER = 7; // model has 7 positional result arguments for every detection
             auto detections = raw_results.reshape(1, 1);
             const int detections_number = detections.cols / ARGUMENTS_NUMBER;
 
+            // the detections are normalized by the network input, the padding is dropped and the scaling undone
+            const auto layout = input_layout(image_size);
+            const auto scale_x = static_cast<float>(layout.content_size.width) / static_cast<float>(image_size.width);
+            const auto scale_y = static_cast<float>(layout.content_size.height) / static_cast<float>(image_size.height);
+            const auto to_image_x = [&layout, scale_x](float x) {
+                return x * static_cast<float>(layout.input_size.width) / scale_x;
+            };
+            const auto to_image_y = [&layout, scale_y](float y) {
+                return (y * static_cast<float>(layout.input_size.height) - static_cast<float>(layout.content_top)) /
+                       scale_y;
+            };
+            const cv::Rect image_rect(0, 0, image_size.width, image_size.height);
+
             std::vector<cv::Rect> result_rects;
             for (int current_detection = 0; current_detection < detections_number; current_detection++) {
                 const int shift = current_detection * ARGUMENTS_NUMBER;
-                // auto image_id = detections.at<float>(0, shift + 0);
-                auto is_face = detections.at<float>(0, shift + 1);
-                if ((0.97f > is_face) || (is_face > 1.03f)) { // face class equal 1
+                if (!is_face(detections, shift)) {
                     continue;
                 }
 
-                auto confidence = detections.at<float>(0, shift + 2);
-                if (confidence < _detector_settings.confidence_level) {
-                    continue;
-                }
+                auto left = to_image_x(detections.at<float>(0, shift + 3));
+                auto top = to_image_y(detections.at<float>(0, shift + 4));
+                auto right = to_image_x(detections.at<float>(0, shift + 5));
+                auto bottom = to_image_y(detections.at<float>(0, shift + 6));
 
-                auto left = static_cast<float>(image_input_width) * detections.at<float>(0, shift + 3);
-                auto top = static_cast<float>(image_input_width) * detections.at<float>(0, shift + 4);
-                auto right = static_cast<float>(image_input_height) * detections.at<float>(0, shift + 5);
-                auto bottom = static_cast<float>(image_input_height) * detections.at<float>(0, shift + 6);
-                auto height = int(bottom - top);
-                auto width = int(right - left);
-
-                result_rects.emplace_back(static_cast<int>(left),
-                                          static_cast<int>(top),
-                                          static_cast<int>(width),
-                                          static_cast<int>(height));
+                result_rects.emplace_back(cv::Rect(static_cast<int>(left),
+                                                   static_cast<int>(top),
+                                                   static_cast<int>(right - left),
+                                                   static_cast<int>(bottom - top)) & image_rect);
             }
 
             return result_rects;
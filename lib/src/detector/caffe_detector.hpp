@@ -7,16 +7,27 @@
 
 #include <filesystem>
 #include <mutex>
+#include <string_view>
 
 
 namespace detection {
     namespace caffe {
 
+        enum class InputShape {
+            SQUARE, // the image is padded to a square of the target size
+            ASPECT  // the long side is scaled to the target size, both sides are rounded up to the stride
+        };
+
+
         struct Settings {
             std::filesystem::path net_structure_path;
             std::filesystem::path net_weights_path;
             int target_image_size;
             float confidence_level;
+            InputShape input_shape{InputShape::SQUARE};
+            // the network input sides are multiples of it in the ASPECT shape, so the images of close aspect
+            // ratios share one input shape and the network isn't reshaped between them
+            int stride{32};
 
             Settings() = delete;
 
@@ -33,19 +44,41 @@ namespace detection {
         public:
             explicit CaffeDetector(Settings &&settings);
 
+            // loads the network from the given prototxt and weights, e.g. mapped bundle entries, instead of the files;
+            // the network copies them, they needn't outlive the detector
+            CaffeDetector(Settings &&settings, std::string_view net_structure, std::string_view net_weights);
+
             ~CaffeDetector() override = default;
 
             std::vector<cv::Rect> detect(const cv::Mat &image) override;
 
+            // the network runs in full, the detections are only counted, PRESENCE stops at the first face
+            std::size_t count(const cv::Mat &image, Mode mode) override;
+
+            // the first step of detect(), public to be measured alone by the benchmarks
+            cv::Mat prepare_image_for_detection(const cv::Mat &image) const;
+
         private:
+            // where the scaled image lies in the network input
+            struct InputLayout {
+                cv::Size input_size;
+                cv::Size content_size;
+                int content_top;
+            };
+
             std::mutex _mutex;
             Settings _detector_settings;
             cv::dnn::Net _detector;
 
-            cv::Mat prepare_image_for_detection(const cv::Mat &image) const;
+            cv::Mat forward(const cv::Mat &image);
+
+            // the face class above the confidence level
+            bool is_face(const cv::Mat &detections, int shift) const;
+
+            InputLayout input_layout(const cv::Size &image_size) const;
 
-            std::vector<cv::Rect>
-            create_results(const cv::Mat &raw_results, int image_input_width, int image_input_height) const;
+            // maps the normalized detections from the network input back to the image
+            std::vector<cv::Rect> create_results(const cv::Mat &raw_results, const cv::Size &image_size) const;
         };
 
     } // namespace haar
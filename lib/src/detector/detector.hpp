@@ -2,16 +2,74 @@
 
 #include <opencv2/imgproc.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
 #include <vector>
 
 
 namespace detection {
 
+    // FULL finds every face with its rect, COUNT only the faces number without refining the rects,
+    // PRESENCE only whether there is a face and stops at the first one
+    enum class Mode {
+        FULL,
+        COUNT,
+        PRESENCE
+    };
+
+
+    // what is known of an image besides its pixels
+    struct ImageSource {
+        std::string_view path;          // empty for the in-memory images
+        std::uintmax_t file_size{0};    // 0 for the in-memory images
+    };
+
+
     class Detector {
     public:
         virtual ~Detector() = default;
 
         virtual std::vector<cv::Rect> detect(const cv::Mat &image) = 0;
+
+        // the faces number, 0 or 1 for PRESENCE; detects in full unless the detector has a cheaper search
+        virtual std::size_t count(const cv::Mat &image, Mode mode) {
+            const auto faces_number = detect(image).size();
+            return (mode == Mode::PRESENCE) ? std::min<std::size_t>(faces_number, 1) : faces_number;
+        }
+
+        // the source is looked at by the routing detectors only
+        virtual std::vector<cv::Rect> detect(const cv::Mat &image, const ImageSource &) {
+            return detect(image);
+        }
+
+        virtual std::size_t count(const cv::Mat &image, Mode mode, const ImageSource &) {
+            return count(image, mode);
+        }
+
+        // pays the lazy allocations of the first detections on a synthetic image, a routing detector warms up
+        // every sub-detector whatever route the image would take
+        virtual void warm_up(const cv::Mat &image) {
+            detect(image);
+        }
+
+        // the names of the routes, known once the detector is built, empty for a detector without routes
+        virtual const std::vector<std::string> &route_names() const {
+            static const std::vector<std::string> no_route_names;
+            return no_route_names;
+        }
+
+        // the index in route_names() of the route the image would take, 0 for a detector without routes
+        virtual std::size_t route_index(const cv::Mat &, const ImageSource &) const {
+            return 0;
+        }
+
+        // the name of the route the image would take, empty for a detector without routes
+        std::string_view route(const cv::Mat &image, const ImageSource &source) const {
+            const auto &names = route_names();
+            return names.empty() ? std::string_view{} : std::string_view{names[route_index(image, source)]};
+        }
     };
 
 } // namespace detection
\ No newline at end of file
@@ -2,6 +2,16 @@
 #include "haar_detector.hpp"
 #include "caffe_detector.hpp"
 #include "error.hpp"
+#include "model_bundle.hpp"
+#include "router_detector.hpp"
+
+#include "tracing/tracing.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <cctype>
+#include <fstream>
+#include <sstream>
 
 
 namespace {
@@ -32,17 +42,74 @@ namespace {
         std::string{"\" parameter type. need object"});                                                                     \
     }
 
+
+
+    // a resource file name of a bundled description is the name of its bundle entry
+    std::filesystem::path find_resource(const std::string &file_name, const std::string &resource_description,
+                                        const detection::bundle::ModelBundle *bundle) {
+        if (bundle != nullptr) {
+            if (!bundle->contains(file_name)) {
+                RAISE_ERROR(detection::CreationError,
+                            resource_description + " was not found in the model bundle: " + file_name);
+            }
+            return file_name;
+        }
+
+        auto file_path = std::filesystem::current_path() / file_name;
+        if (!std::filesystem::exists(file_path)) {
+            RAISE_ERROR(detection::CreationError, resource_description + " was not found by path: " +
+                                                  file_path.string());
+        }
+        return file_path;
+    }
+
+
+    std::string read_resource(const std::filesystem::path &file_path) {
+        std::ifstream file(file_path, std::ios::binary);
+        if (!file) {
+            RAISE_ERROR(detection::CreationError, std::string("can't read resource file: ") + file_path.string());
+        }
+
+        std::ostringstream content;
+        content << file.rdbuf();
+        return content.str();
+    }
+
+
+    // drops the indentation and the line breaks, which are most of a cascade file, keeps a single space
+    // between the values and the comments as they are
+    std::string minify_xml(const std::string &xml) {
+        std::string result;
+        result.reserve(xml.size());
+        for (std::size_t i = 0; i < xml.size();) {
+            if (xml.compare(i, 4, "<!--") == 0) {
+                const auto comment_end = xml.find("-->", i);
+                const auto next = (comment_end == std::string::npos) ? xml.size() : comment_end + 3;
+                result.append(xml, i, next - i);
+                i = next;
+            } else if (std::isspace(static_cast<unsigned char>(xml[i]))) {
+                while ((i < xml.size()) && std::isspace(static_cast<unsigned char>(xml[i]))) {
+                    i++;
+                }
+                if (!result.empty() && (result.back() != '>') && (i < xml.size()) && (xml[i] != '<')) {
+                    result.push_back(' ');
+                }
+            } else {
+                result.push_back(xml[i]);
+                i++;
+            }
+        }
+        return result;
+    }
+
 }
 
 namespace detection {
 
-    haar::Settings create_haar_cascade_detector_settings(const boost::property_tree::ptree &settings) {
+    haar::Settings create_haar_cascade_detector_settings(const boost::property_tree::ptree &settings,
+                                                         const bundle::ModelBundle *bundle) {
         GET_VALUE_CHECKED(settings, "cascade_file_name", std::string, cascade_file_name);
-        auto cascade_file_path = std::filesystem::current_path() / cascade_file_name;
-        if (!std::filesystem::exists(cascade_file_path)) {
-            RAISE_ERROR(CreationError, std::string("haar cascade detector xml file was not found by path: ") +
-                                       cascade_file_path.c_str());
-        }
+        auto cascade_file_path = find_resource(cascade_file_name, "haar cascade detector xml file", bundle);
 
         GET_VALUE_CHECKED(settings, "neighbors_number", int32_t, neighbors_number);
         GET_VALUE_CHECKED(settings, "scale_factor", float, scale_factor);
@@ -63,41 +130,201 @@ namespace detection {
     }
 
 
-    caffe::Settings create_caffe_cascade_detector_settings(const boost::property_tree::ptree &settings) {
+    caffe::Settings create_caffe_cascade_detector_settings(const boost::property_tree::ptree &settings,
+                                                           const bundle::ModelBundle *bundle) {
         GET_VALUE_CHECKED(settings, "network_structure_file", std::string, network_structure_file_name);
-        auto network_structure_file_path = std::filesystem::current_path() / network_structure_file_name;
-        if (!std::filesystem::exists(network_structure_file_path)) {
-            RAISE_ERROR(CreationError, std::string("network structure protobuf file was not found by path: ") +
-                                       network_structure_file_path.c_str());
-        }
+        auto network_structure_file_path = find_resource(network_structure_file_name,
+                                                         "network structure protobuf file", bundle);
 
         GET_VALUE_CHECKED(settings, "weights_file_name", std::string, weights_file_name);
-        auto weights_file_path = std::filesystem::current_path() / weights_file_name;
-        if (!std::filesystem::exists(weights_file_path)) {
-            RAISE_ERROR(CreationError, std::string("network weights file was not found by path: ") +
-                                       weights_file_path.c_str());
-        }
+        auto weights_file_path = find_resource(weights_file_name, "network weights file", bundle);
 
         GET_VALUE_CHECKED(settings, "target_image_size", int, target_image_size);
         GET_VALUE_CHECKED(settings, "confidence_level", float, confidence_level);
+        if (target_image_size <= 0) {
+            RAISE_ERROR(CreationError, "\"target_image_size\" should be positive");
+        }
+
+        caffe::Settings caffe_settings{network_structure_file_path, weights_file_path, target_image_size,
+                                       confidence_level};
+        const auto input_shape = settings.get<std::string>("input_shape", "square");
+        if (input_shape == "aspect") {
+            caffe_settings.input_shape = caffe::InputShape::ASPECT;
+        } else if (input_shape != "square") {
+            RAISE_ERROR(CreationError, "\"input_shape\" should be \"square\" or \"aspect\", not " + input_shape);
+        }
+        try {
+            caffe_settings.stride = settings.get<int>("stride", caffe_settings.stride);
+        }
+        catch (std::exception const &e) {
+            RAISE_ERROR(CreationError, "incorrect \"stride\" parameter type. need int");
+        }
+        if (caffe_settings.stride <= 0) {
+            RAISE_ERROR(CreationError, "\"stride\" should be positive");
+        }
+        return caffe_settings;
+    }
+
+
+    router::Rule create_route_rule(const boost::property_tree::ptree &settings) {
+        router::Rule rule;
+        try {
+            rule.min_width = settings.get<int>("min_width", 0);
+            rule.max_width = settings.get<int>("max_width", 0);
+            rule.min_height = settings.get<int>("min_height", 0);
+            rule.max_height = settings.get<int>("max_height", 0);
+            rule.min_aspect_ratio = settings.get<double>("min_aspect_ratio", 0);
+            rule.max_aspect_ratio = settings.get<double>("max_aspect_ratio", 0);
+            rule.min_file_size = settings.get<std::uintmax_t>("min_file_size", 0);
+            rule.max_file_size = settings.get<std::uintmax_t>("max_file_size", 0);
+            rule.path_contains = settings.get<std::string>("path_contains", "");
+        }
+        catch (std::exception const &e) {
+            RAISE_ERROR(CreationError, std::string("incorrect route rule: ") + e.what());
+        }
+        return rule;
+    }
+
 
-        return caffe::Settings{network_structure_file_path, weights_file_path, target_image_size, confidence_level};
+    std::vector<router::Route> create_router_detector_settings(const boost::property_tree::ptree &settings) {
+        GET_CHILD_CHECKED(settings, "routes", routes_array);
+
+        std::vector<router::Route> routes;
+        for (const auto &[key, route_object]: routes_array) {
+            GET_VALUE_CHECKED(route_object, "name", std::string, route_name);
+            GET_CHILD_CHECKED(route_object, "detector", detector_description);
+            std::size_t max_workers;
+            try {
+                max_workers = route_object.get<std::size_t>("max_workers", 0);
+            }
+            catch (std::exception const &e) {
+                RAISE_ERROR(CreationError, std::string("incorrect \"max_workers\" of route ") + route_name);
+            }
+            routes.push_back(router::Route{route_name, create_route_rule(route_object), detector_description,
+                                           max_workers});
+        }
+        return routes;
     }
 
 
     std::unique_ptr<Detector> create_detector(const boost::property_tree::ptree &settings) {
+        return create_detector(settings, std::make_shared<router::WorkerShares>());
+    }
+
+
+    std::unique_ptr<Detector> create_detector(const boost::property_tree::ptree &settings,
+                                              const std::shared_ptr<router::WorkerShares> &worker_shares) {
         GET_VALUE_CHECKED(settings, "type", std::string, detector_type_name);
         GET_CHILD_CHECKED(settings, "settings", detector_settings_object);
 
         if (detector_type_name == "haar") {
             return std::make_unique<detection::haar::HaarDetector>(
-                    create_haar_cascade_detector_settings(detector_settings_object));
+                    create_haar_cascade_detector_settings(detector_settings_object, nullptr));
         } else if (detector_type_name == "caffe") {
             return std::make_unique<detection::caffe::CaffeDetector>(
-                    create_caffe_cascade_detector_settings(detector_settings_object));
+                    create_caffe_cascade_detector_settings(detector_settings_object, nullptr));
+        } else if (detector_type_name == "bundle") {
+            return create_detector(*map_bundle(settings));
+        } else if (detector_type_name == "router") {
+            return std::make_unique<detection::router::RouterDetector>(
+                    create_router_detector_settings(detector_settings_object), worker_shares);
         }
 
         RAISE_ERROR(CreationError, detector_type_name + " is not implemented detector type");
     }
 
+
+    std::unique_ptr<bundle::ModelBundle> map_bundle(const boost::property_tree::ptree &settings) {
+        GET_VALUE_CHECKED(settings, "type", std::string, detector_type_name);
+        if (detector_type_name != "bundle") {
+            return nullptr;
+        }
+
+        GET_CHILD_CHECKED(settings, "settings", detector_settings_object);
+        GET_VALUE_CHECKED(detector_settings_object, "bundle_file_name", std::string, bundle_file_name);
+        return std::make_unique<bundle::ModelBundle>(std::filesystem::current_path() / bundle_file_name);
+    }
+
+
+    std::unique_ptr<Detector> create_detector(const bundle::ModelBundle &model_bundle) {
+        tracing::Scope scope{"create_bundled_detector"};
+        const auto &description = model_bundle.description();
+        GET_VALUE_CHECKED(description, "type", std::string, detector_type_name);
+        GET_CHILD_CHECKED(description, "settings", detector_settings_object);
+
+        // the parsers copy the mapped entries: the haar cascade xml into a string for cv::FileStorage, the caffe
+        // network into its own buffers; the bundle is only needed until the detector is created
+        if (detector_type_name == "haar") {
+            auto settings = create_haar_cascade_detector_settings(detector_settings_object, &model_bundle);
+            const auto cascade_xml = model_bundle.entry(settings.cascade_path.string());
+            return std::make_unique<detection::haar::HaarDetector>(std::move(settings), cascade_xml);
+        } else if (detector_type_name == "caffe") {
+            auto settings = create_caffe_cascade_detector_settings(detector_settings_object, &model_bundle);
+            const auto net_structure = model_bundle.entry(settings.net_structure_path.string());
+            const auto net_weights = model_bundle.entry(settings.net_weights_path.string());
+            return std::make_unique<detection::caffe::CaffeDetector>(std::move(settings), net_structure, net_weights);
+        }
+
+        RAISE_ERROR(CreationError, detector_type_name + " detector type can't be bundled");
+    }
+
+
+    void compile_bundle(const std::filesystem::path &description_file_path,
+                        const std::filesystem::path &bundle_file_path) {
+        boost::property_tree::ptree description;
+        try {
+            boost::property_tree::read_json(description_file_path.string(), description);
+        }
+        catch (std::exception const &e) {
+            RAISE_ERROR(CreationError, std::string("can't read detector description: ") + e.what());
+        }
+        GET_VALUE_CHECKED(description, "type", std::string, detector_type_name);
+        GET_CHILD_CHECKED(description, "settings", detector_settings_object);
+
+        // the description goes first, it is filled once the resource names are replaced by the entry names
+        std::vector<std::pair<std::string, std::string>> entries{{bundle::DESCRIPTION_ENTRY_NAME, std::string()}};
+        const auto add_resource = [&entries, &detector_settings_object](const std::string &key,
+                                                                        const std::string &resource_description,
+                                                                        bool is_xml) {
+            GET_VALUE_CHECKED(detector_settings_object, key, std::string, file_name);
+            const auto file_path = find_resource(file_name, resource_description, nullptr);
+            const auto content = read_resource(file_path);
+            const auto entry_name = file_path.filename().string();
+            entries.emplace_back(entry_name, is_xml ? minify_xml(content) : content);
+            detector_settings_object.put(key, entry_name);
+        };
+
+        if (detector_type_name == "haar") {
+            add_resource("cascade_file_name", "haar cascade detector xml file", true);
+        } else if (detector_type_name == "caffe") {
+            add_resource("network_structure_file", "network structure protobuf file", false);
+            add_resource("weights_file_name", "network weights file", false);
+        } else {
+            RAISE_ERROR(CreationError, detector_type_name + " detector type can't be bundled");
+        }
+
+        description.put_child("settings", detector_settings_object);
+        std::ostringstream description_json;
+        boost::property_tree::write_json(description_json, description);
+        entries.front().second = description_json.str();
+
+        // checked before it replaces the previous bundle, so a bundle which can't be loaded is never installed
+        const std::filesystem::path compiled_file_path{bundle_file_path.string() + ".compiled"};
+        bundle::write_bundle(compiled_file_path, entries);
+        try {
+            const bundle::ModelBundle model_bundle{compiled_file_path};
+            create_detector(model_bundle);
+        } catch (...) {
+            std::filesystem::remove(compiled_file_path);
+            throw;
+        }
+
+        std::error_code error_code;
+        std::filesystem::rename(compiled_file_path, bundle_file_path, error_code);
+        if (error_code) {
+            std::filesystem::remove(compiled_file_path);
+            RAISE_ERROR(CreationError, std::string("can't write model bundle by path: ") + bundle_file_path.string());
+        }
+    }
+
 } // namespace detection
\ No newline at end of file
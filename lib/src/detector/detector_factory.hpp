@@ -1,14 +1,36 @@
 #pragma once
 
 #include "haar_detector.hpp"
+#include "model_bundle.hpp"
+#include "router_detector.hpp"
 
 #include <boost/property_tree/ptree.hpp>
 
+#include <filesystem>
 #include <memory>
 
 
 namespace detection {
 
+    // the "bundle" type maps a compiled bundle given by its "bundle_file_name" instead of parsing the resources;
+    // the "router" type sends every image to one of its "routes", each one a rule with a "name", a "detector"
+    // description and the optional "max_workers", see router::Rule for the rule keys
     std::unique_ptr<Detector> create_detector(const boost::property_tree::ptree &settings);
 
+    // the routers built with the same shares keep the max_workers of their routes together
+    std::unique_ptr<Detector> create_detector(const boost::property_tree::ptree &settings,
+                                              const std::shared_ptr<router::WorkerShares> &worker_shares);
+
+    // maps the bundle of a "bundle" description, e.g. once for many detectors; nullptr for the other types,
+    // throws CreationError
+    std::unique_ptr<bundle::ModelBundle> map_bundle(const boost::property_tree::ptree &settings);
+
+    std::unique_ptr<Detector> create_detector(const bundle::ModelBundle &model_bundle);
+
+    // compiles the description and its resource files into a model bundle: the resources are laid out page aligned
+    // to be mapped, the haar cascade xml is stripped of its formatting; the bundle is loaded once before it replaces
+    // the bundle file, throws CreationError
+    void compile_bundle(const std::filesystem::path &description_file_path,
+                        const std::filesystem::path &bundle_file_path);
+
 } // namespace detection
@@ -12,6 +12,15 @@ namespace detection {
     }
 
 
+    BusyError::BusyError(const std::string &message, Subscription subscription)
+            : ProcessingError{message}, _subscription{std::move(subscription)} {}
+
+
+    bool BusyError::notify_when_free(std::function<bool()> &&callback) const {
+        return _subscription(std::move(callback));
+    }
+
+
     std::ostream &operator<<(std::ostream &os, const Error &error) {
         return os << error.what();
     }
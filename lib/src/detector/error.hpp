@@ -4,6 +4,7 @@
 #include <boost/current_function.hpp>
 
 #include <exception>
+#include <functional>
 #include <string>
 #include <iostream>
 
@@ -43,6 +44,25 @@ namespace detection {
     };
 
 
+    // Thrown instead of waiting for a capacity shared by the detectors, e.g. the worker share of a route: the image
+    // isn't failed, it is detected again once the capacity is free.
+    class BusyError : public ProcessingError {
+    public:
+        // registers the callback the way notify_when_free() describes
+        using Subscription = std::function<bool(std::function<bool()> &&callback)>;
+
+        BusyError(const std::string &message, Subscription subscription);
+
+        // returns false without calling back if the capacity is free already, otherwise the callback is called once
+        // it gets free, on the thread freeing it; the callback returns whether the image is retried, the capacity
+        // is offered to the next callback otherwise
+        bool notify_when_free(std::function<bool()> &&callback) const;
+
+    private:
+        Subscription _subscription;
+    };
+
+
     std::ostream &operator<<(std::ostream &os, const Error &error);
 
 
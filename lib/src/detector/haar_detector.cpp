@@ -1,6 +1,23 @@
 ﻿#include "haar_detector.hpp"
 #include "error.hpp"
 
+#include "tracing/tracing.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+    // the face sizes of a presence search are split into the bands searched one after another
+    const int PRESENCE_BANDS_NUMBER = 3;
+    // every band reaches this size ratio beyond its boundaries, so the windows of a face on a band boundary are
+    // grouped together in one of the bands; a fixed ratio, as the steps of a coarse pyramid would make every
+    // band search the levels of its neighbours too
+    const double PRESENCE_BAND_OVERLAP = 1.2;
+
+}
+
 
 namespace detection {
     namespace haar {
@@ -9,6 +26,25 @@ namespace detection {
             // TODO: check all settings values for validity
             try {
                 _cascade_classifier.load(_detector_settings.cascade_path.string());
+                _presence_bands = make_presence_bands();
+            }
+            catch (std::exception const &e) {
+                RAISE_ERROR(CreationError, std::string("loading of haar cascade failed: ") + e.what());
+            }
+        }
+
+
+        HaarDetector::HaarDetector(Settings &&settings, std::string_view cascade_xml)
+                : _detector_settings{std::move(settings)} {
+            try {
+                cv::FileStorage storage(std::string(cascade_xml), cv::FileStorage::READ | cv::FileStorage::MEMORY);
+                if (!storage.isOpened() || !_cascade_classifier.read(storage.getFirstTopLevelNode())) {
+                    RAISE_ERROR(CreationError, "incorrect haar cascade xml");
+                }
+                _presence_bands = make_presence_bands();
+            }
+            catch (CreationError const &) {
+                throw;
             }
             catch (std::exception const &e) {
                 RAISE_ERROR(CreationError, std::string("loading of haar cascade failed: ") + e.what());
@@ -22,22 +58,115 @@ namespace detection {
             std::vector<cv::Rect> rects;
             {
                 std::lock_guard lk{_mutex};
-                try {
-                    _cascade_classifier.detectMultiScale(prepared_image, rects, _detector_settings.scale_factor,
-                                                         _detector_settings.neighbors_number,
-                                                         cv::CASCADE_SCALE_IMAGE, _detector_settings.minimum_face_size,
-                                                         _detector_settings.maximum_face_size);
+                rects = detect_prepared(prepared_image, cv::CASCADE_SCALE_IMAGE, _detector_settings.minimum_face_size,
+                                        _detector_settings.maximum_face_size);
+            }
+
+            return restore_rects(rects);
+        }
+
+
+        std::size_t HaarDetector::count(const cv::Mat &image, Mode mode) {
+            if (mode == Mode::FULL) {
+                return detect(image).size();
+            }
+
+            cv::Mat prepared_image{prepare_image_for_detection(image)};
+            const auto &min_size = _detector_settings.minimum_face_size;
+            const auto &max_size = _detector_settings.maximum_face_size;
+            std::lock_guard lk{_mutex};
+            if (mode == Mode::COUNT) {
+                return detect_prepared(prepared_image, cv::CASCADE_SCALE_IMAGE, min_size, max_size).size();
+            }
+
+            // the large faces are searched on the few smallest pyramid levels, so a positive image usually stops
+            // early; the flags make an old format cascade do the same search itself, a new format one ignores them
+            tracing::Scope scope{"haar.presence"};
+            for (const auto &[band_min_size, band_max_size]: _presence_bands) {
+                const auto rects = detect_prepared(prepared_image, cv::CASCADE_SCALE_IMAGE |
+                                                                   cv::CASCADE_FIND_BIGGEST_OBJECT |
+                                                                   cv::CASCADE_DO_ROUGH_SEARCH,
+                                                   band_min_size, band_max_size);
+                if (!rects.empty()) {
+                    return 1;
+                }
+            }
+            return 0;
+        }
+
+
+        const std::vector<std::pair<cv::Size, cv::Size>> &HaarDetector::presence_bands() const {
+            return _presence_bands;
+        }
+
+
+        std::vector<std::pair<cv::Size, cv::Size>> HaarDetector::make_presence_bands() const {
+            const auto &min_size = _detector_settings.minimum_face_size;
+            const auto &max_size = _detector_settings.maximum_face_size;
+            const double scale_factor = _detector_settings.scale_factor;
+            if (_cascade_classifier.empty() || (scale_factor <= 1.0)) {
+                return {{min_size, max_size}};
+            }
+
+            // the scales of the detectMultiScale pyramid levels within the face sizes, as it chooses them
+            const auto window_size = _cascade_classifier.getOriginalWindowSize();
+            std::vector<double> level_scales;
+            for (double scale = 1.0; ; scale *= scale_factor) {
+                const cv::Size level_size(cvRound(window_size.width * scale), cvRound(window_size.height * scale));
+                if ((level_size.width > max_size.width) || (level_size.height > max_size.height)) {
+                    break;
                 }
-                catch (std::exception const &e) {
-                    RAISE_ERROR(CreationError, std::string("detection error: ") + e.what());
+                if ((level_size.width >= min_size.width) && (level_size.height >= min_size.height)) {
+                    level_scales.push_back(scale);
                 }
             }
+            const auto bands_number = std::min<std::size_t>(PRESENCE_BANDS_NUMBER, level_scales.size());
+            if (bands_number < 2) {
+                return {{min_size, max_size}};
+            }
 
-            return restore_rects(rects);
+            // the levels are split from the largest down, a band boundary lies halfway between two levels
+            const auto clamp_size = [&min_size, &max_size, &window_size](double scale) {
+                return cv::Size(std::clamp(static_cast<int>(window_size.width * scale), min_size.width,
+                                           max_size.width),
+                                std::clamp(static_cast<int>(window_size.height * scale), min_size.height,
+                                           max_size.height));
+            };
+            std::reverse(level_scales.begin(), level_scales.end());
+            const double half_step = std::sqrt(scale_factor);
+            std::vector<std::pair<cv::Size, cv::Size>> bands;
+            for (std::size_t band = 0; band < bands_number; band++) {
+                const auto first_level = band * level_scales.size() / bands_number;
+                const auto last_level = (band + 1) * level_scales.size() / bands_number - 1;
+                const auto band_min_size = (band + 1 < bands_number)
+                                           ? clamp_size(level_scales[last_level] / half_step / PRESENCE_BAND_OVERLAP)
+                                           : min_size;
+                const auto band_max_size = (band > 0)
+                                           ? clamp_size(level_scales[first_level] * half_step * PRESENCE_BAND_OVERLAP)
+                                           : max_size;
+                bands.emplace_back(band_min_size, band_max_size);
+            }
+            return bands;
+        }
+
+
+        std::vector<cv::Rect> HaarDetector::detect_prepared(const cv::Mat &prepared_image, int flags,
+                                                            const cv::Size &min_size, const cv::Size &max_size) {
+            tracing::Scope scope{"haar.detectMultiScale"};
+            std::vector<cv::Rect> rects;
+            try {
+                _cascade_classifier.detectMultiScale(prepared_image, rects, _detector_settings.scale_factor,
+                                                     _detector_settings.neighbors_number, flags, min_size, max_size);
+            }
+            catch (std::exception const &e) {
+                RAISE_ERROR(CreationError, std::string("detection error: ") + e.what());
+            }
+            return rects;
         }
 
 
         cv::Mat HaarDetector::prepare_image_for_detection(const cv::Mat &image) const {
+            tracing::Scope scope{"haar.prepare"};
             if (image.empty()) {
                 RAISE_ERROR(ProcessingError, "empty image");
             }
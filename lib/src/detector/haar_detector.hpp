@@ -7,6 +7,9 @@
 
 #include <filesystem>
 #include <mutex>
+#include <string_view>
+#include <utility>
+#include <vector>
 
 
 namespace detection {
@@ -34,16 +37,35 @@ namespace detection {
         public:
             explicit HaarDetector(Settings &&settings);
 
+            // loads the cascade from the given xml, e.g. a mapped bundle entry, instead of the cascade file;
+            // the xml is copied for cv::FileStorage, it needn't outlive the detector
+            HaarDetector(Settings &&settings, std::string_view cascade_xml);
+
             ~HaarDetector() override = default;
 
             std::vector<cv::Rect> detect(const cv::Mat &image) override;
 
+            // COUNT skips the restoring of the rects to the image scale, PRESENCE searches the face sizes
+            // from the largest down in bands and stops at the first band with a face
+            std::size_t count(const cv::Mat &image, Mode mode) override;
+
+            // the first step of detect(), public to be measured alone by the benchmarks
+            cv::Mat prepare_image_for_detection(const cv::Mat &image) const;
+
+            // the minimum and maximum face sizes of the presence bands from the largest, public for the tests
+            const std::vector<std::pair<cv::Size, cv::Size>> &presence_bands() const;
+
         private:
             std::mutex _mutex;
             Settings _detector_settings;
             cv::CascadeClassifier _cascade_classifier;
+            std::vector<std::pair<cv::Size, cv::Size>> _presence_bands;
 
-            cv::Mat prepare_image_for_detection(const cv::Mat &image) const;
+            // expects _mutex to be locked
+            std::vector<cv::Rect> detect_prepared(const cv::Mat &prepared_image, int flags, const cv::Size &min_size,
+                                                  const cv::Size &max_size);
+
+            std::vector<std::pair<cv::Size, cv::Size>> make_presence_bands() const;
 
             std::vector<cv::Rect> restore_rects(const std::vector<cv::Rect> &rects) const;
         };
@@ -0,0 +1,223 @@
+#include "model_bundle.hpp"
+#include "error.hpp"
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace {
+
+    const char BUNDLE_MAGIC[8] = {'F', 'D', 'B', 'U', 'N', 'D', 'L', 'E'};
+    const char *TEMPORARY_SUFFIX = ".tmp";
+
+
+    void append_uint(std::string &bytes, std::uint64_t value, int size) {
+        for (int shift = 0; shift < size * 8; shift += 8) {
+            bytes.push_back(static_cast<char>((value >> shift) & 0xFF));
+        }
+    }
+
+
+    // little-endian, the position is moved past the value; throws CreationError past the end
+    std::uint64_t parse_uint(const char *data, std::size_t size, std::size_t &position, int value_size) {
+        if ((position > size) || (size - position < static_cast<std::size_t>(value_size))) {
+            RAISE_ERROR(detection::CreationError, "truncated model bundle header");
+        }
+
+        std::uint64_t value = 0;
+        for (int i = 0; i < value_size; i++) {
+            value |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[position + i])) << (8 * i);
+        }
+        position += value_size;
+        return value;
+    }
+
+
+    std::size_t align(std::size_t offset) {
+        const auto ALIGNMENT = detection::bundle::ENTRY_ALIGNMENT;
+        return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+}
+
+
+namespace detection {
+    namespace bundle {
+
+        MappedFile::MappedFile(const std::filesystem::path &path) {
+#if defined(__unix__) || defined(__APPLE__)
+            const int file = ::open(path.c_str(), O_RDONLY);
+            if (file < 0) {
+                RAISE_ERROR(CreationError, std::string("can't open model bundle by path: ") + path.string());
+            }
+
+            struct stat file_stat{};
+            if ((::fstat(file, &file_stat) != 0) || (file_stat.st_size <= 0)) {
+                ::close(file);
+                RAISE_ERROR(CreationError, std::string("can't read model bundle by path: ") + path.string());
+            }
+
+            _size = static_cast<std::size_t>(file_stat.st_size);
+            void *mapping = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, file, 0);
+            // the mapping stays valid after the descriptor is closed
+            ::close(file);
+            if (mapping == MAP_FAILED) {
+                RAISE_ERROR(CreationError, std::string("can't map model bundle by path: ") + path.string());
+            }
+            _data = static_cast<const char *>(mapping);
+#else
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file) {
+                RAISE_ERROR(CreationError, std::string("can't open model bundle by path: ") + path.string());
+            }
+
+            _buffer.resize(static_cast<std::size_t>(file.tellg()));
+            file.seekg(0);
+            if (!file.read(_buffer.data(), static_cast<std::streamsize>(_buffer.size()))) {
+                RAISE_ERROR(CreationError, std::string("can't read model bundle by path: ") + path.string());
+            }
+            _data = _buffer.data();
+            _size = _buffer.size();
+#endif
+        }
+
+
+        MappedFile::~MappedFile() {
+#if defined(__unix__) || defined(__APPLE__)
+            if (_data != nullptr) {
+                ::munmap(const_cast<char *>(_data), _size);
+            }
+#endif
+        }
+
+
+        const char *MappedFile::data() const {
+            return _data;
+        }
+
+
+        std::size_t MappedFile::size() const {
+            return _size;
+        }
+
+
+        ModelBundle::ModelBundle(const std::filesystem::path &path) : _file{path} {
+            const auto *data = _file.data();
+            const auto size = _file.size();
+            if ((size < sizeof(BUNDLE_MAGIC)) || !std::equal(BUNDLE_MAGIC, BUNDLE_MAGIC + sizeof(BUNDLE_MAGIC), data)) {
+                RAISE_ERROR(CreationError, std::string("not a model bundle: ") + path.string());
+            }
+
+            std::size_t position = sizeof(BUNDLE_MAGIC);
+            const auto version = parse_uint(data, size, position, 4);
+            if (version != FORMAT_VERSION) {
+                RAISE_ERROR(CreationError, std::string("unsupported model bundle version ") + std::to_string(version) +
+                                           " of " + path.string() + ", expected " + std::to_string(FORMAT_VERSION));
+            }
+
+            const auto entries_number = parse_uint(data, size, position, 4);
+            for (std::uint64_t i = 0; i < entries_number; i++) {
+                const auto name_size = static_cast<std::size_t>(parse_uint(data, size, position, 4));
+                if (size - position < name_size) {
+                    RAISE_ERROR(CreationError, "truncated model bundle header");
+                }
+                std::string name(data + position, name_size);
+                position += name_size;
+
+                const auto offset = parse_uint(data, size, position, 8);
+                const auto entry_size = parse_uint(data, size, position, 8);
+                if ((offset > size) || (entry_size > size - offset)) {
+                    RAISE_ERROR(CreationError, std::string("model bundle entry ") + name + " is out of the file");
+                }
+                _entries[name] = std::string_view(data + offset, static_cast<std::size_t>(entry_size));
+            }
+
+            const auto description = entry(DESCRIPTION_ENTRY_NAME);
+            std::stringstream buffer;
+            buffer << description;
+            try {
+                boost::property_tree::read_json(buffer, _description);
+            } catch (std::exception const &e) {
+                RAISE_ERROR(CreationError, std::string("bad model bundle description: ") + e.what());
+            }
+        }
+
+
+        const boost::property_tree::ptree &ModelBundle::description() const {
+            return _description;
+        }
+
+
+        bool ModelBundle::contains(const std::string &entry_name) const {
+            return _entries.count(entry_name) > 0;
+        }
+
+
+        std::string_view ModelBundle::entry(const std::string &entry_name) const {
+            auto it = _entries.find(entry_name);
+            if (it == _entries.end()) {
+                RAISE_ERROR(CreationError, std::string("model bundle has no entry ") + entry_name);
+            }
+            return it->second;
+        }
+
+
+        void write_bundle(const std::filesystem::path &path,
+                          const std::vector<std::pair<std::string, std::string>> &entries) {
+            std::size_t header_size = sizeof(BUNDLE_MAGIC) + 4 + 4;
+            for (const auto &[name, content]: entries) {
+                header_size += 4 + name.size() + 8 + 8;
+            }
+
+            std::string header(BUNDLE_MAGIC, sizeof(BUNDLE_MAGIC));
+            append_uint(header, FORMAT_VERSION, 4);
+            append_uint(header, entries.size(), 4);
+            std::vector<std::size_t> offsets;
+            auto offset = align(header_size);
+            for (const auto &[name, content]: entries) {
+                append_uint(header, name.size(), 4);
+                header += name;
+                append_uint(header, offset, 8);
+                append_uint(header, content.size(), 8);
+                offsets.push_back(offset);
+                offset = align(offset + content.size());
+            }
+
+            const auto temporary_path = path.string() + TEMPORARY_SUFFIX;
+            {
+                std::ofstream file(temporary_path, std::ios::out | std::ios::binary | std::ios::trunc);
+                if (!file) {
+                    RAISE_ERROR(CreationError, std::string("can't create model bundle by path: ") + path.string());
+                }
+                file << header;
+                for (std::size_t i = 0; i < entries.size(); i++) {
+                    file << std::string(offsets[i] - static_cast<std::size_t>(file.tellp()), '\0');
+                    file << entries[i].second;
+                }
+                file.close();
+                if (!file) {
+                    std::filesystem::remove(temporary_path);
+                    RAISE_ERROR(CreationError, std::string("can't write model bundle by path: ") + path.string());
+                }
+            }
+
+            std::error_code error_code;
+            std::filesystem::rename(temporary_path, path, error_code);
+            if (error_code) {
+                std::filesystem::remove(temporary_path);
+                RAISE_ERROR(CreationError, std::string("can't write model bundle by path: ") + path.string());
+            }
+        }
+
+    } // namespace bundle
+} // namespace detection
\ No newline at end of file
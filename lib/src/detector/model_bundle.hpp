@@ -0,0 +1,72 @@
+#pragma once
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace detection {
+    namespace bundle {
+
+        constexpr std::uint32_t FORMAT_VERSION = 1;
+        // the detector description with the resource file names replaced by the entry names
+        constexpr const char *DESCRIPTION_ENTRY_NAME = "description.json";
+        // the entries start at page boundaries, so the mapped pages are shared by the processes loading the bundle;
+        // the detectors still copy an entry into their own model while they parse it
+        constexpr std::size_t ENTRY_ALIGNMENT = 4096;
+
+
+        // Read-only mapping of a whole file: the pages are shared through the page cache by every process
+        // mapping the file; the file is read into memory where mmap isn't available.
+        class MappedFile {
+        public:
+            explicit MappedFile(const std::filesystem::path &path);
+
+            MappedFile(const MappedFile &) = delete;
+
+            MappedFile &operator=(const MappedFile &) = delete;
+
+            ~MappedFile();
+
+            const char *data() const;
+
+            std::size_t size() const;
+
+        private:
+            const char *_data{nullptr};
+            std::size_t _size{0};
+            std::vector<char> _buffer;
+        };
+
+
+        // A detector description compiled with its resources into one versioned file, see compile_bundle();
+        // throws CreationError if the file isn't a bundle of the supported version.
+        class ModelBundle {
+        public:
+            explicit ModelBundle(const std::filesystem::path &path);
+
+            const boost::property_tree::ptree &description() const;
+
+            bool contains(const std::string &entry_name) const;
+
+            // valid while the bundle lives; throws CreationError if there is no such entry
+            std::string_view entry(const std::string &entry_name) const;
+
+        private:
+            MappedFile _file;
+            std::map<std::string, std::string_view> _entries;
+            boost::property_tree::ptree _description;
+        };
+
+
+        // writes the entries through a temporary file renamed at the end; throws CreationError
+        void write_bundle(const std::filesystem::path &path,
+                          const std::vector<std::pair<std::string, std::string>> &entries);
+
+    } // namespace bundle
+} // namespace detection
\ No newline at end of file
@@ -0,0 +1,165 @@
+#include "router_detector.hpp"
+#include "detector_factory.hpp"
+#include "error.hpp"
+
+#include "tracing/tracing.hpp"
+
+
+namespace detection {
+    namespace router {
+
+        bool Rule::matches(const cv::Mat &image, const ImageSource &source) const {
+            const auto within = [](auto value, auto min_value, auto max_value) {
+                return (value >= min_value) && ((max_value == 0) || (value <= max_value));
+            };
+
+            if (!within(image.cols, min_width, max_width) || !within(image.rows, min_height, max_height)) {
+                return false;
+            }
+
+            const double aspect_ratio = (image.rows > 0) ? static_cast<double>(image.cols) / image.rows : 0;
+            if (!within(aspect_ratio, min_aspect_ratio, max_aspect_ratio)) {
+                return false;
+            }
+
+            // the in-memory images have no file, their size doesn't limit them
+            if ((source.file_size > 0) && !within(source.file_size, min_file_size, max_file_size)) {
+                return false;
+            }
+
+            return path_contains.empty() || (source.path.find(path_contains) != std::string_view::npos);
+        }
+
+
+        bool WorkerShares::try_acquire(const std::string &route_name, std::size_t max_workers) {
+            std::lock_guard lk{_mutex};
+            auto &route_share = _route_shares[route_name];
+            if ((max_workers > 0) && (route_share.active_workers >= max_workers)) {
+                return false;
+            }
+            route_share.active_workers++;
+            return true;
+        }
+
+
+        void WorkerShares::release(const std::string &route_name) {
+            std::unique_lock lk{_mutex};
+            auto &route_share = _route_shares[route_name];
+            route_share.active_workers--;
+
+            // the callbacks are never called under the lock, one retried image takes the slot
+            while (!route_share.callbacks.empty()) {
+                auto callback = std::move(route_share.callbacks.front());
+                route_share.callbacks.pop_front();
+                lk.unlock();
+                if (callback()) {
+                    return;
+                }
+                lk.lock();
+            }
+        }
+
+
+        bool WorkerShares::notify_when_free(const std::string &route_name, std::size_t max_workers,
+                                            std::function<bool()> &&callback) {
+            std::lock_guard lk{_mutex};
+            auto &route_share = _route_shares[route_name];
+            if ((max_workers == 0) || (route_share.active_workers < max_workers)) {
+                return false;
+            }
+            route_share.callbacks.emplace_back(std::move(callback));
+            return true;
+        }
+
+
+        RouterDetector::RouterDetector(std::vector<Route> routes, std::shared_ptr<WorkerShares> worker_shares)
+                : _routes{std::move(routes)}, _worker_shares{std::move(worker_shares)} {
+            if (_routes.empty()) {
+                RAISE_ERROR(CreationError, "router detector has no routes");
+            }
+
+            for (const auto &route: _routes) {
+                tracing::Scope scope{"router.create", route.name};
+                _route_names.push_back(route.name);
+                _detectors.emplace_back(create_detector(route.detector_description, _worker_shares));
+            }
+        }
+
+
+        std::size_t RouterDetector::find_route(const cv::Mat &image, const ImageSource &source) const {
+            for (std::size_t i = 0; i < _routes.size(); i++) {
+                if (_routes[i].rule.matches(image, source)) {
+                    return i;
+                }
+            }
+            RAISE_ERROR(ProcessingError, std::string("no route for the image ") + std::to_string(image.cols) + "x" +
+                                         std::to_string(image.rows) + " " + std::string(source.path));
+        }
+
+
+        template<typename Detection>
+        auto RouterDetector::run_on_route(const cv::Mat &image, const ImageSource &source, Detection &&detection) {
+            const auto route_index = find_route(image, source);
+            const auto &route = _routes[route_index];
+            if (!_worker_shares->try_acquire(route.name, route.max_workers)) {
+                throw BusyError{"route " + route.name + " has used up its worker share",
+                                [worker_shares = _worker_shares, route_name = route.name,
+                                 max_workers = route.max_workers](std::function<bool()> &&callback) {
+                                    return worker_shares->notify_when_free(route_name, max_workers,
+                                                                           std::move(callback));
+                                }};
+            }
+
+            try {
+                auto result = detection(*_detectors[route_index]);
+                _worker_shares->release(route.name);
+                return result;
+            } catch (...) {
+                _worker_shares->release(route.name);
+                throw;
+            }
+        }
+
+        std::vector<cv::Rect> RouterDetector::detect(const cv::Mat &image) {
+            return detect(image, ImageSource{});
+        }
+
+
+        std::size_t RouterDetector::count(const cv::Mat &image, Mode mode) {
+            return count(image, mode, ImageSource{});
+        }
+
+
+        std::vector<cv::Rect> RouterDetector::detect(const cv::Mat &image, const ImageSource &source) {
+            return run_on_route(image, source, [&image, &source](Detector &detector) {
+                return detector.detect(image, source);
+            });
+        }
+
+
+        std::size_t RouterDetector::count(const cv::Mat &image, Mode mode, const ImageSource &source) {
+            return run_on_route(image, source, [&image, mode, &source](Detector &detector) {
+                return detector.count(image, mode, source);
+            });
+        }
+
+
+        const std::vector<std::string> &RouterDetector::route_names() const {
+            return _route_names;
+        }
+
+
+        std::size_t RouterDetector::route_index(const cv::Mat &image, const ImageSource &source) const {
+            return find_route(image, source);
+        }
+
+
+        void RouterDetector::warm_up(const cv::Mat &image) {
+            for (std::size_t i = 0; i < _detectors.size(); i++) {
+                tracing::Scope scope{"router.warm_up", _routes[i].name};
+                _detectors[i]->warm_up(image);
+            }
+        }
+
+    } // namespace router
+} // namespace detection
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "detector.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace detection {
+    namespace router {
+
+        // the image properties known before the detection, the unset bounds don't limit the route
+        struct Rule {
+            int min_width{0};
+            int max_width{0};
+            int min_height{0};
+            int max_height{0};
+            double min_aspect_ratio{0};     // width / height
+            double max_aspect_ratio{0};
+            std::uintmax_t min_file_size{0};
+            std::uintmax_t max_file_size{0};
+            std::string path_contains;
+
+            bool matches(const cv::Mat &image, const ImageSource &source) const;
+        };
+
+
+        struct Route {
+            std::string name;
+            Rule rule;
+            boost::property_tree::ptree detector_description;
+            std::size_t max_workers{0};     // the workers detecting on the route at once, 0 is unlimited
+        };
+
+
+        // Shared by the routers built from one description, e.g. by the workers of a detector pool, so the
+        // max_workers of a route holds across all of them. A worker over the limit doesn't wait for a slot,
+        // it is told to try the image again once a worker of the route is done, so it goes on with the other
+        // routes meanwhile.
+        class WorkerShares {
+        public:
+            // returns false if the route has max_workers detecting already
+            bool try_acquire(const std::string &route_name, std::size_t max_workers);
+
+            // offers the freed slot to the callbacks waiting for the route in their order
+            void release(const std::string &route_name);
+
+            // returns false if the route has a free slot, otherwise calls back on the next release
+            bool notify_when_free(const std::string &route_name, std::size_t max_workers,
+                                  std::function<bool()> &&callback);
+
+        private:
+            struct RouteShare {
+                std::size_t active_workers{0};
+                std::deque<std::function<bool()>> callbacks;
+            };
+
+            std::mutex _mutex;
+            std::map<std::string, RouteShare> _route_shares;
+        };
+
+
+        // Sends every image to the sub-detector of the first route whose rule it matches, by the dimensions,
+        // aspect ratio, file size and path, e.g. the small portraits to a haar detector and the large group photos
+        // to a caffe one; throws ProcessingError for an image matching no route and BusyError for an image whose
+        // route has used up its worker share.
+        class RouterDetector : public Detector {
+        public:
+            // builds the sub-detectors, throws CreationError
+            RouterDetector(std::vector<Route> routes, std::shared_ptr<WorkerShares> worker_shares);
+
+            ~RouterDetector() override = default;
+
+            std::vector<cv::Rect> detect(const cv::Mat &image) override;
+
+            std::size_t count(const cv::Mat &image, Mode mode) override;
+
+            std::vector<cv::Rect> detect(const cv::Mat &image, const ImageSource &source) override;
+
+            std::size_t count(const cv::Mat &image, Mode mode, const ImageSource &source) override;
+
+            const std::vector<std::string> &route_names() const override;
+
+            std::size_t route_index(const cv::Mat &image, const ImageSource &source) const override;
+
+            // outside the worker shares, the detector isn't serving yet
+            void warm_up(const cv::Mat &image) override;
+
+        private:
+            const std::vector<Route> _routes;
+            std::vector<std::string> _route_names;
+            const std::shared_ptr<WorkerShares> _worker_shares;
+            std::vector<std::unique_ptr<Detector>> _detectors;
+
+            std::size_t find_route(const cv::Mat &image, const ImageSource &source) const;
+
+            // runs the detection on the route's sub-detector within the route's worker share, throws BusyError
+            // without a free slot
+            template<typename Detection>
+            auto run_on_route(const cv::Mat &image, const ImageSource &source, Detection &&detection);
+        };
+
+    } // namespace router
+} // namespace detection
\ No newline at end of file
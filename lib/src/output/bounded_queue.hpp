@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+
+namespace output {
+
+    // Blocking queue of a fixed capacity between the output stages; a full queue holds the producer back,
+    // and the time it was held is reported, so the backpressure is measurable.
+    template<typename T>
+    class BoundedQueue {
+    public:
+        explicit BoundedQueue(std::size_t capacity) : _capacity{std::max<std::size_t>(capacity, 1)} {
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        // blocks while the queue is full, returns false if the queue is closed, the value is dropped then;
+        // blocked_time receives the waiting time
+        bool push(T &&value, std::chrono::steady_clock::duration &blocked_time) {
+            std::unique_lock lk{_mutex};
+            blocked_time = std::chrono::steady_clock::duration::zero();
+            if (!_closed && (_values.size() >= _capacity)) {
+                const auto start_time = std::chrono::steady_clock::now();
+                _space_conditional_variable.wait(lk, [this]() { return _closed || (_values.size() < _capacity); });
+                blocked_time = std::chrono::steady_clock::now() - start_time;
+            }
+            if (_closed) {
+                return false;
+            }
+
+            _values.emplace_back(std::move(value));
+            _max_size = std::max(_max_size, _values.size());
+            lk.unlock();
+            _value_conditional_variable.notify_one();
+            return true;
+        }
+
+        // blocks until a value is available, returns nothing once the queue is closed and drained
+        std::optional<T> pop() {
+            std::unique_lock lk{_mutex};
+            _value_conditional_variable.wait(lk, [this]() { return _closed || !_values.empty(); });
+            if (_values.empty()) {
+                return std::nullopt;
+            }
+
+            std::optional<T> value{std::move(_values.front())};
+            _values.pop_front();
+            lk.unlock();
+            _space_conditional_variable.notify_one();
+            return value;
+        }
+
+        // takes every waiting value at once, blocks like pop(); returns false once the queue is closed and drained
+        bool pop_all(std::vector<T> &values) {
+            std::unique_lock lk{_mutex};
+            _value_conditional_variable.wait(lk, [this]() { return _closed || !_values.empty(); });
+            if (_values.empty()) {
+                return false;
+            }
+
+            std::move(_values.begin(), _values.end(), std::back_inserter(values));
+            _values.clear();
+            lk.unlock();
+            _space_conditional_variable.notify_all();
+            return true;
+        }
+
+        // the values already queued are still popped
+        void close() {
+            {
+                std::lock_guard lk{_mutex};
+                _closed = true;
+            }
+            _value_conditional_variable.notify_all();
+            _space_conditional_variable.notify_all();
+        }
+
+        std::size_t size() const {
+            std::lock_guard lk{_mutex};
+            return _values.size();
+        }
+
+        std::size_t max_size() const {
+            std::lock_guard lk{_mutex};
+            return _max_size;
+        }
+
+        std::size_t capacity() const {
+            return _capacity;
+        }
+
+    private:
+        const std::size_t _capacity;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _value_conditional_variable;
+        std::condition_variable _space_conditional_variable;
+        std::deque<T> _values;
+        std::size_t _max_size{0};
+        bool _closed{false};
+    };
+
+} // namespace output
\ No newline at end of file
@@ -0,0 +1,471 @@
+#include "crop_container.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#elif defined(_WIN32)
+#include <io.h>
+#endif
+
+
+namespace {
+
+    // "FDCR" little-endian, starts every record, so a reader pointed to a wrong offset fails loudly
+    const std::uint32_t RECORD_MAGIC{0x52434446};
+    const char *INDEX_HEADER = "# face crop container 1";
+    const char *TEMPORARY_SUFFIX = ".tmp";
+
+    void append_u32(std::vector<char> &bytes, std::uint32_t value) {
+        for (int shift = 0; shift < 32; shift += 8) {
+            bytes.push_back(static_cast<char>((value >> shift) & 0xFF));
+        }
+    }
+
+
+    std::uint32_t parse_u32(const unsigned char *bytes) {
+        return static_cast<std::uint32_t>(bytes[0]) | (static_cast<std::uint32_t>(bytes[1]) << 8) |
+               (static_cast<std::uint32_t>(bytes[2]) << 16) | (static_cast<std::uint32_t>(bytes[3]) << 24);
+    }
+
+
+    std::uint32_t checked_u32(std::size_t value) {
+        if (value > std::numeric_limits<std::uint32_t>::max()) {
+            throw output::ContainerError("A container record part is larger than 4 GiB");
+        }
+        return static_cast<std::uint32_t>(value);
+    }
+
+
+    void sync_file(std::FILE *file, const std::filesystem::path &path) {
+        if (std::fflush(file) != 0) {
+            throw output::ContainerError("Can't write the container file: " + path.string());
+        }
+#if defined(__unix__) || defined(__APPLE__)
+        if (::fsync(::fileno(file)) != 0) {
+            throw output::ContainerError("Can't sync the container file: " + path.string());
+        }
+#elif defined(_WIN32)
+        if (::_commit(::_fileno(file)) != 0) {
+            throw output::ContainerError("Can't sync the container file: " + path.string());
+        }
+#endif
+    }
+
+
+    // the keys are image paths, which may hold any symbol but the zero one
+    std::string escape_key(const std::string &key) {
+        std::string escaped;
+        escaped.reserve(key.size());
+        for (const auto symbol: key) {
+            switch (symbol) {
+                case '\\':
+                    escaped += "\\\\";
+                    break;
+                case '\t':
+                    escaped += "\\t";
+                    break;
+                case '\n':
+                    escaped += "\\n";
+                    break;
+                case '\r':
+                    escaped += "\\r";
+                    break;
+                default:
+                    escaped += symbol;
+            }
+        }
+        return escaped;
+    }
+
+
+    std::string unescape_key(const std::string &escaped) {
+        std::string key;
+        key.reserve(escaped.size());
+        for (std::size_t i = 0; i < escaped.size(); i++) {
+            if ((escaped[i] != '\\') || (i + 1 == escaped.size())) {
+                key += escaped[i];
+                continue;
+            }
+            switch (escaped[++i]) {
+                case 't':
+                    key += '\t';
+                    break;
+                case 'n':
+                    key += '\n';
+                    break;
+                case 'r':
+                    key += '\r';
+                    break;
+                default:
+                    key += escaped[i];
+            }
+        }
+        return key;
+    }
+
+}
+
+
+namespace output {
+
+    std::string segment_file_name(std::uint32_t segment_index) {
+        auto number = std::to_string(segment_index);
+        if (number.size() < 5) {
+            number.insert(0, 5 - number.size(), '0');
+        }
+        return std::string{SEGMENT_FILE_PREFIX} + number + SEGMENT_FILE_SUFFIX;
+    }
+
+
+    ContainerWriter::ContainerWriter(const std::filesystem::path &directory, const ContainerConfig &config)
+            : _directory{directory}, _config{config} {
+        std::error_code error_code;
+        std::filesystem::create_directories(_directory, error_code);
+        if (error_code) {
+            throw ContainerError("Can't create the container folder: " + _directory.string());
+        }
+
+        // the segments of a previous container would be left behind by a smaller one
+        for (std::uint32_t segment_index = 0;; segment_index++) {
+            if (!std::filesystem::remove(_directory / segment_file_name(segment_index), error_code)) {
+                break;
+            }
+        }
+        std::filesystem::remove(_directory / INDEX_FILE_NAME, error_code);
+
+        _buffer.reserve(std::max<std::size_t>(_config.write_buffer_size, 1));
+        open_segment();
+    }
+
+
+    ContainerWriter::~ContainerWriter() {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+
+    void ContainerWriter::append(const std::string &key, const ContainerRecord &record) {
+        std::vector<char> header;
+        header.reserve(12 + 4 * record.crops.size());
+        append_u32(header, RECORD_MAGIC);
+        append_u32(header, checked_u32(record.metadata.size()));
+        append_u32(header, checked_u32(record.crops.size()));
+        std::uint64_t crops_size = 0;
+        for (const auto &crop: record.crops) {
+            append_u32(header, checked_u32(crop.size()));
+            crops_size += crop.size();
+        }
+        const std::uint64_t record_size = header.size() + record.metadata.size() + crops_size;
+
+        std::lock_guard lk{_mutex};
+        if (_closed) {
+            throw ContainerError("The container is closed: " + _directory.string());
+        }
+
+        if ((_segment_size > 0) && (_segment_size + record_size > _config.max_segment_size)) {
+            close_segment();
+            _segment_index++;
+            open_segment();
+        }
+
+        _locations.push_back(Location{key, _segment_index, _segment_size, record_size});
+        write(header.data(), header.size());
+        write(record.metadata.data(), record.metadata.size());
+        for (const auto &crop: record.crops) {
+            write(crop.data(), crop.size());
+        }
+    }
+
+
+    void ContainerWriter::close() {
+        std::lock_guard lk{_mutex};
+        if (_closed) {
+            return;
+        }
+        _closed = true;
+
+        close_segment();
+        write_index();
+    }
+
+
+    void ContainerWriter::open_segment() {
+        const auto path = _directory / segment_file_name(_segment_index);
+        _segment = std::fopen(path.string().c_str(), "wb");
+        if (_segment == nullptr) {
+            throw ContainerError("Can't create the container segment: " + path.string());
+        }
+        // the own buffer is large enough, the stdio one would only add a copy
+        std::setvbuf(_segment, nullptr, _IONBF, 0);
+        _segment_size = 0;
+    }
+
+
+    void ContainerWriter::close_segment() {
+        if (_segment == nullptr) {
+            return;
+        }
+
+        const auto path = _directory / segment_file_name(_segment_index);
+        try {
+            flush_buffer();
+            sync_file(_segment, path);
+        } catch (...) {
+            std::fclose(_segment);
+            _segment = nullptr;
+            throw;
+        }
+        const auto result = std::fclose(_segment);
+        _segment = nullptr;
+        if (result != 0) {
+            throw ContainerError("Can't close the container segment: " + path.string());
+        }
+    }
+
+
+    void ContainerWriter::write(const void *data, std::size_t size) {
+        _segment_size += size;
+        if (_buffer.size() + size > _buffer.capacity()) {
+            flush_buffer();
+        }
+
+        if (size >= _buffer.capacity()) {
+            // a part larger than the buffer goes to the file without a copy
+            if (std::fwrite(data, 1, size, _segment) != size) {
+                throw ContainerError("Can't write the container segment: " +
+                                     (_directory / segment_file_name(_segment_index)).string());
+            }
+            return;
+        }
+
+        const auto bytes = static_cast<const char *>(data);
+        _buffer.insert(_buffer.end(), bytes, bytes + size);
+    }
+
+
+    void ContainerWriter::flush_buffer() {
+        if (_buffer.empty()) {
+            return;
+        }
+
+        const auto buffered_size = _buffer.size();
+        const auto written_size = std::fwrite(_buffer.data(), 1, buffered_size, _segment);
+        _buffer.clear();
+        if (written_size != buffered_size) {
+            throw ContainerError("Can't write the container segment: " +
+                                 (_directory / segment_file_name(_segment_index)).string());
+        }
+    }
+
+
+    void ContainerWriter::write_index() {
+        std::string index{INDEX_HEADER};
+        index += '\n';
+        for (const auto &location: _locations) {
+            index += escape_key(location.key) + '\t' + std::to_string(location.segment_index) + '\t' +
+                     std::to_string(location.offset) + '\t' + std::to_string(location.size) + '\n';
+        }
+
+        // the index appears at once, so a container with an index is always complete
+        const auto path = _directory / INDEX_FILE_NAME;
+        auto temporary_path = path;
+        temporary_path += TEMPORARY_SUFFIX;
+        auto file = std::fopen(temporary_path.string().c_str(), "wb");
+        if (file == nullptr) {
+            throw ContainerError("Can't create the container index: " + temporary_path.string());
+        }
+        const auto written_size = std::fwrite(index.data(), 1, index.size(), file);
+        try {
+            if (written_size != index.size()) {
+                throw ContainerError("Can't write the container index: " + temporary_path.string());
+            }
+            sync_file(file, temporary_path);
+        } catch (...) {
+            std::fclose(file);
+            throw;
+        }
+        std::fclose(file);
+
+        std::error_code error_code;
+        std::filesystem::rename(temporary_path, path, error_code);
+        if (error_code) {
+            throw ContainerError("Can't write the container index: " + path.string());
+        }
+    }
+
+
+    ContainerReader::ContainerReader(const std::filesystem::path &directory) : _directory{directory} {
+        const auto path = _directory / INDEX_FILE_NAME;
+        std::ifstream index(path);
+        if (!index) {
+            throw ContainerError("Can't open the container index: " + path.string());
+        }
+
+        std::string line;
+        if (!std::getline(index, line) || (line != INDEX_HEADER)) {
+            throw ContainerError("Unknown container index format: " + path.string());
+        }
+
+        while (std::getline(index, line)) {
+            if (line.empty()) {
+                continue;
+            }
+
+            const auto key_end = line.find('\t');
+            std::istringstream fields(key_end == std::string::npos ? std::string{} : line.substr(key_end + 1));
+            Location location{};
+            if (!(fields >> location.segment_index >> location.offset >> location.size)) {
+                throw ContainerError("Broken container index line: " + line);
+            }
+
+            auto key = unescape_key(line.substr(0, key_end));
+            if (_locations.find(key) == _locations.end()) {
+                _keys.push_back(key);
+            }
+            _locations[key] = location;
+        }
+    }
+
+
+    const std::vector<std::string> &ContainerReader::keys() const {
+        return _keys;
+    }
+
+
+    bool ContainerReader::contains(const std::string &key) const {
+        return _locations.find(key) != _locations.end();
+    }
+
+
+    ContainerRecord ContainerReader::read(const std::string &key) const {
+        const auto &location = locate(key);
+        auto segment = open_segment(location);
+
+        ContainerRecord record;
+        try {
+            const auto header = read_header(segment, location);
+            record.metadata.resize(header.metadata_size);
+            bool is_read = std::fread(record.metadata.data(), 1, header.metadata_size, segment) ==
+                           header.metadata_size;
+            for (auto crop_size: header.crop_sizes) {
+                if (!is_read) {
+                    break;
+                }
+                record.crops.emplace_back(crop_size);
+                is_read = std::fread(record.crops.back().data(), 1, crop_size, segment) == crop_size;
+            }
+            if (!is_read) {
+                throw ContainerError("Truncated container record: " + key);
+            }
+        } catch (...) {
+            std::fclose(segment);
+            throw;
+        }
+        std::fclose(segment);
+
+        return record;
+    }
+
+
+    std::vector<unsigned char> ContainerReader::read_crop(const std::string &key, std::size_t crop_index) const {
+        const auto &location = locate(key);
+        auto segment = open_segment(location);
+
+        std::vector<unsigned char> crop;
+        try {
+            const auto header = read_header(segment, location);
+            if (crop_index >= header.crop_sizes.size()) {
+                throw ContainerError("No crop " + std::to_string(crop_index) + " in the container record: " + key);
+            }
+
+            std::uint64_t skipped_size = header.metadata_size;
+            for (std::size_t i = 0; i < crop_index; i++) {
+                skipped_size += header.crop_sizes[i];
+            }
+            crop.resize(header.crop_sizes[crop_index]);
+            const auto crop_offset = std::ftell(segment) + static_cast<long>(skipped_size);
+            if ((std::fseek(segment, crop_offset, SEEK_SET) != 0) ||
+                (std::fread(crop.data(), 1, crop.size(), segment) != crop.size())) {
+                throw ContainerError("Truncated container record: " + key);
+            }
+        } catch (...) {
+            std::fclose(segment);
+            throw;
+        }
+        std::fclose(segment);
+
+        return crop;
+    }
+
+
+    std::size_t ContainerReader::crops_number(const std::string &key) const {
+        const auto &location = locate(key);
+        auto segment = open_segment(location);
+
+        std::size_t number;
+        try {
+            number = read_header(segment, location).crop_sizes.size();
+        } catch (...) {
+            std::fclose(segment);
+            throw;
+        }
+        std::fclose(segment);
+
+        return number;
+    }
+
+
+    const ContainerReader::Location &ContainerReader::locate(const std::string &key) const {
+        const auto location = _locations.find(key);
+        if (location == _locations.end()) {
+            throw ContainerError("No container record for: " + key);
+        }
+        return location->second;
+    }
+
+
+    ContainerReader::Header ContainerReader::read_header(std::FILE *segment, const Location &location) const {
+        unsigned char fixed_part[12];
+        if ((std::fseek(segment, static_cast<long>(location.offset), SEEK_SET) != 0) ||
+            (std::fread(fixed_part, 1, sizeof(fixed_part), segment) != sizeof(fixed_part)) ||
+            (parse_u32(fixed_part) != RECORD_MAGIC)) {
+            throw ContainerError("Broken container record at offset " + std::to_string(location.offset) +
+                                 " of the segment " + segment_file_name(location.segment_index));
+        }
+
+        Header header;
+        header.metadata_size = parse_u32(fixed_part + 4);
+        const auto crops_number = parse_u32(fixed_part + 8);
+        if (12 + std::uint64_t{4} * crops_number + header.metadata_size > location.size) {
+            throw ContainerError("Broken container record at offset " + std::to_string(location.offset) +
+                                 " of the segment " + segment_file_name(location.segment_index));
+        }
+
+        std::vector<unsigned char> sizes(std::size_t{4} * crops_number);
+        if (std::fread(sizes.data(), 1, sizes.size(), segment) != sizes.size()) {
+            throw ContainerError("Truncated container record at offset " + std::to_string(location.offset) +
+                                 " of the segment " + segment_file_name(location.segment_index));
+        }
+        for (std::size_t i = 0; i < crops_number; i++) {
+            header.crop_sizes.push_back(parse_u32(sizes.data() + 4 * i));
+        }
+        return header;
+    }
+
+
+    std::FILE *ContainerReader::open_segment(const Location &location) const {
+        const auto path = _directory / segment_file_name(location.segment_index);
+        auto segment = std::fopen(path.string().c_str(), "rb");
+        if (segment == nullptr) {
+            throw ContainerError("Can't open the container segment: " + path.string());
+        }
+        return segment;
+    }
+
+} // namespace output
\ No newline at end of file
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+// Packed output: the encoded face crops and the result json of every source image are appended to a few large
+// segment files, an index maps the image key (its path relative to the images folder) to its record.
+namespace output {
+
+    class ContainerError : public std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
+
+    constexpr const char *INDEX_FILE_NAME = "index.tsv";
+    constexpr const char *SEGMENT_FILE_PREFIX = "segment_";
+    constexpr const char *SEGMENT_FILE_SUFFIX = ".crops";
+
+
+    struct ContainerConfig {
+        // a record never spans two segments, so a segment exceeds it by at most one record
+        std::uint64_t max_segment_size{std::uint64_t{1} << 30};
+        // the records are gathered in memory and written by chunks of that size
+        std::size_t write_buffer_size{std::size_t{8} << 20};
+    };
+
+
+    struct ContainerRecord {
+        std::string metadata;
+        std::vector<std::vector<unsigned char>> crops;
+    };
+
+
+    // Thread-safe appender of a container, the callers encode the crops before, so the lock covers a memory copy
+    // and, once in a while, one large sequential write.
+    class ContainerWriter {
+    public:
+        // creates the folder, a container already there is overwritten
+        explicit ContainerWriter(const std::filesystem::path &directory, const ContainerConfig &config = {});
+
+        ContainerWriter(const ContainerWriter &) = delete;
+
+        ContainerWriter &operator=(const ContainerWriter &) = delete;
+
+        // closes the container, the errors are swallowed, call close() to get them
+        ~ContainerWriter();
+
+        // a key appended twice is read as its last record
+        void append(const std::string &key, const ContainerRecord &record);
+
+        // writes the buffered records, syncs every segment once and writes the index; no appends afterwards
+        void close();
+
+    private:
+        struct Location {
+            std::string key;
+            std::uint32_t segment_index;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        const std::filesystem::path _directory;
+        const ContainerConfig _config;
+
+        std::mutex _mutex;
+        bool _closed{false};
+        std::FILE *_segment{nullptr};
+        std::uint32_t _segment_index{0};
+        std::uint64_t _segment_size{0};
+        std::vector<char> _buffer;
+        std::vector<Location> _locations;
+
+        void open_segment();
+
+        // flushes and syncs the current segment
+        void close_segment();
+
+        void write(const void *data, std::size_t size);
+
+        void flush_buffer();
+
+        void write_index();
+    };
+
+
+    // Random access to the records of a closed container; every read opens the segment, so it is thread-safe.
+    class ContainerReader {
+    public:
+        explicit ContainerReader(const std::filesystem::path &directory);
+
+        // in the order of appending
+        const std::vector<std::string> &keys() const;
+
+        bool contains(const std::string &key) const;
+
+        ContainerRecord read(const std::string &key) const;
+
+        // reads one crop only, skipping the metadata and the other crops
+        std::vector<unsigned char> read_crop(const std::string &key, std::size_t crop_index) const;
+
+        std::size_t crops_number(const std::string &key) const;
+
+    private:
+        struct Location {
+            std::uint32_t segment_index;
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        struct Header {
+            std::uint32_t metadata_size;
+            std::vector<std::uint32_t> crop_sizes;
+        };
+
+        const std::filesystem::path _directory;
+        std::vector<std::string> _keys;
+        std::unordered_map<std::string, Location> _locations;
+
+        const Location &locate(const std::string &key) const;
+
+        Header read_header(std::FILE *segment, const Location &location) const;
+
+        std::FILE *open_segment(const Location &location) const;
+    };
+
+
+    std::string segment_file_name(std::uint32_t segment_index);
+
+} // namespace output
\ No newline at end of file
@@ -0,0 +1,178 @@
+#include "crop_writer.hpp"
+
+#include "tracing/tracing.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+
+
+namespace {
+
+    std::uint64_t elapsed_us(std::chrono::steady_clock::time_point start_time) {
+        return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start_time).count());
+    }
+
+}
+
+
+namespace output {
+
+    CropWriter::CropWriter(const CropWriterConfig &config)
+            : _config{config},
+              _encoding_parameters{cv::IMWRITE_JPEG_QUALITY, std::clamp(config.jpeg_quality, 0, 100),
+                                   cv::IMWRITE_JPEG_OPTIMIZE, config.optimize_huffman ? 1 : 0},
+              _tasks{config.queue_capacity}, _encoded_tasks{config.queue_capacity} {
+        for (std::size_t i = 0; i < std::max<std::size_t>(_config.encoders_number, 1); i++) {
+            _encoders.emplace_back([this]() { run_encoder(); });
+        }
+        _writer = std::thread([this]() { run_writer(); });
+    }
+
+
+    CropWriter::~CropWriter() {
+        close();
+    }
+
+
+    void CropWriter::push(CropTask &&task) {
+        std::chrono::steady_clock::duration blocked_time;
+        _tasks.push(std::move(task), blocked_time);
+        if (blocked_time > std::chrono::steady_clock::duration::zero()) {
+            _blocked_pushes.fetch_add(1, std::memory_order_relaxed);
+            _blocked_time_us.fetch_add(static_cast<std::uint64_t>(
+                                               std::chrono::duration_cast<std::chrono::microseconds>(
+                                                       blocked_time).count()),
+                                       std::memory_order_relaxed);
+        }
+    }
+
+
+    void CropWriter::close() {
+        // the stages are drained in order: the encoders finish the queued tasks, then the writer the encoded ones
+        _tasks.close();
+        for (auto &encoder: _encoders) {
+            if (encoder.joinable()) {
+                encoder.join();
+            }
+        }
+        _encoded_tasks.close();
+        if (_writer.joinable()) {
+            _writer.join();
+        }
+    }
+
+
+    CropWriterStats CropWriter::stats() const {
+        return CropWriterStats{_images.load(std::memory_order_relaxed),
+                               _crops.load(std::memory_order_relaxed),
+                               _failed_images.load(std::memory_order_relaxed),
+                               _failed_writes.load(std::memory_order_relaxed),
+                               _tasks.size(),
+                               _tasks.max_size(),
+                               _tasks.capacity(),
+                               _blocked_pushes.load(std::memory_order_relaxed),
+                               std::chrono::microseconds(_blocked_time_us.load(std::memory_order_relaxed)),
+                               std::chrono::microseconds(_read_time_us.load(std::memory_order_relaxed)),
+                               std::chrono::microseconds(_encode_time_us.load(std::memory_order_relaxed)),
+                               std::chrono::microseconds(_write_time_us.load(std::memory_order_relaxed))};
+    }
+
+
+    void CropWriter::run_encoder() {
+        tracing::set_thread_name("crop_encoder");
+        while (auto task = _tasks.pop()) {
+            EncodedTask encoded_task{encode(task.value()), std::move(task->write)};
+            std::chrono::steady_clock::duration blocked_time;
+            _encoded_tasks.push(std::move(encoded_task), blocked_time);
+        }
+    }
+
+
+    void CropWriter::run_writer() {
+        tracing::set_thread_name("crop_writer");
+        std::vector<EncodedTask> encoded_tasks;
+        while (_encoded_tasks.pop_all(encoded_tasks)) {
+            tracing::Scope scope{"write_crops"};
+            const auto start_time = std::chrono::steady_clock::now();
+            for (auto &encoded_task: encoded_tasks) {
+                try {
+                    encoded_task.write(std::move(encoded_task.crops));
+                } catch (...) {
+                    _failed_writes.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            _write_time_us.fetch_add(elapsed_us(start_time), std::memory_order_relaxed);
+            encoded_tasks.clear();
+        }
+    }
+
+
+    EncodedCrops CropWriter::encode(const CropTask &task) {
+        _images.fetch_add(1, std::memory_order_relaxed);
+        if (task.faces.empty()) {
+            return {};
+        }
+
+        tracing::Scope scope{"encode_crops", task.image_path};
+        auto start_time = std::chrono::steady_clock::now();
+        cv::Mat image;
+        try {
+            image = cv::imread(task.image_path, cv::IMREAD_COLOR);
+        } catch (...) {
+            // image stays empty
+        }
+        _read_time_us.fetch_add(elapsed_us(start_time), std::memory_order_relaxed);
+        if (image.empty()) {
+            _failed_images.fetch_add(1, std::memory_order_relaxed);
+            return {};
+        }
+
+        start_time = std::chrono::steady_clock::now();
+        EncodedCrops crops(task.faces.size());
+        const cv::Rect image_rect(0, 0, image.cols, image.rows);
+        cv::Mat flopped_face_roi;
+        for (std::size_t i = 0; i < task.faces.size(); i++) {
+            const auto face_rect = task.faces[i] & image_rect;
+            if (face_rect.empty()) {
+                continue;
+            }
+
+            cv::flip(image(face_rect), flopped_face_roi, 0);
+            try {
+                cv::imencode(".jpg", flopped_face_roi, crops[i], _encoding_parameters);
+                _crops.fetch_add(1, std::memory_order_relaxed);
+            } catch (...) {
+                crops[i].clear();
+            }
+        }
+        _encode_time_us.fetch_add(elapsed_us(start_time), std::memory_order_relaxed);
+        return crops;
+    }
+
+
+    boost::property_tree::ptree to_json(const CropWriterStats &stats) {
+        boost::property_tree::ptree root;
+        root.add("images", stats.images);
+        root.add("crops", stats.crops);
+        root.add("failed_images", stats.failed_images);
+        root.add("failed_writes", stats.failed_writes);
+
+        boost::property_tree::ptree queue;
+        queue.add("queued_images", stats.queued_images);
+        queue.add("max_queued_images", stats.max_queued_images);
+        queue.add("capacity", stats.queue_capacity);
+        queue.add("blocked_pushes", stats.blocked_pushes);
+        queue.add("blocked_us", stats.blocked_time.count());
+        root.add_child("queue", queue);
+
+        boost::property_tree::ptree stages;
+        stages.add("read_us", stats.read_time.count());
+        stages.add("encode_us", stats.encode_time.count());
+        stages.add("write_us", stats.write_time.count());
+        root.add_child("stages", stages);
+        return root;
+    }
+
+} // namespace output
\ No newline at end of file
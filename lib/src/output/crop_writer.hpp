@@ -0,0 +1,116 @@
+#pragma once
+
+#include "bounded_queue.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace output {
+
+    using EncodedCrops = std::vector<std::vector<unsigned char>>;
+
+
+    struct CropTask {
+        std::string image_path;
+        std::vector<cv::Rect> faces;
+        // called on the writer thread with the crops in the order of the faces; the crops are empty if the image
+        // couldn't be read, a crop is empty if its face is outside of the image
+        std::function<void(EncodedCrops &&crops)> write;
+    };
+
+
+    struct CropWriterConfig {
+        std::size_t encoders_number{2};
+        // images waiting for an encoder, and encoded images waiting for the writer
+        std::size_t queue_capacity{256};
+        int jpeg_quality{95};
+        // smaller files for a slower encoding, off keeps the libjpeg(-turbo) baseline fast path
+        bool optimize_huffman{false};
+    };
+
+
+    struct CropWriterStats {
+        std::uint64_t images;
+        std::uint64_t crops;
+        std::uint64_t failed_images;        // couldn't be read
+        std::uint64_t failed_writes;        // the write function has thrown
+        std::size_t queued_images;          // waiting for an encoder at the moment of the snapshot
+        std::size_t max_queued_images;
+        std::size_t queue_capacity;
+        // the backpressure: the pushes which found the queue full and how long they waited for a space
+        std::uint64_t blocked_pushes;
+        std::chrono::microseconds blocked_time;
+        std::chrono::microseconds read_time;
+        std::chrono::microseconds encode_time;
+        std::chrono::microseconds write_time;
+    };
+
+
+    // Takes the face crops off the detecting threads: push() only queues the image path and the faces, a pool of
+    // encoders reads the image, flips and JPEG-encodes the crops, and a single writer thread passes the encoded
+    // images to their write functions in batches, so the files are written one after another, not in between
+    // the encoding.
+    class CropWriter {
+    public:
+        explicit CropWriter(const CropWriterConfig &config = {});
+
+        CropWriter(const CropWriter &) = delete;
+
+        CropWriter &operator=(const CropWriter &) = delete;
+
+        ~CropWriter();
+
+        // blocks while the queue is full, the tasks pushed after the close are dropped
+        void push(CropTask &&task);
+
+        // encodes and writes the queued tasks and stops the threads
+        void close();
+
+        CropWriterStats stats() const;
+
+    private:
+        struct EncodedTask {
+            EncodedCrops crops;
+            std::function<void(EncodedCrops &&crops)> write;
+        };
+
+        const CropWriterConfig _config;
+        const std::vector<int> _encoding_parameters;
+
+        BoundedQueue<CropTask> _tasks;
+        BoundedQueue<EncodedTask> _encoded_tasks;
+
+        std::vector<std::thread> _encoders;
+        std::thread _writer;
+
+        std::atomic<std::uint64_t> _images{0};
+        std::atomic<std::uint64_t> _crops{0};
+        std::atomic<std::uint64_t> _failed_images{0};
+        std::atomic<std::uint64_t> _failed_writes{0};
+        std::atomic<std::uint64_t> _blocked_pushes{0};
+        std::atomic<std::uint64_t> _blocked_time_us{0};
+        std::atomic<std::uint64_t> _read_time_us{0};
+        std::atomic<std::uint64_t> _encode_time_us{0};
+        std::atomic<std::uint64_t> _write_time_us{0};
+
+        void run_encoder();
+
+        void run_writer();
+
+        EncodedCrops encode(const CropTask &task);
+    };
+
+
+    boost::property_tree::ptree to_json(const CropWriterStats &stats);
+
+} // namespace output
\ No newline at end of file
@@ -0,0 +1,177 @@
+#include "folder_results.hpp"
+
+#include "tracing/tracing.hpp"
+
+#include <filesystem>
+#include <vector>
+
+
+namespace {
+
+    const char *FILE_HEADER = "{\"results\": [\n";
+    const char *ENTRIES_SEPARATOR = ",\n";
+    const char *FILE_FOOTER = "\n]}\n";
+
+    std::string partial_file_path(const std::string &folder_path) {
+        return (std::filesystem::path(folder_path) / output::FOLDER_RESULTS_FILE_NAME).string() +
+               output::PARTIAL_FOLDER_RESULTS_SUFFIX;
+    }
+
+}
+
+
+namespace output {
+
+    FolderResultsWriter::FolderResultsWriter() {
+        _writer_thread = std::thread([this]() { run(); });
+    }
+
+
+    FolderResultsWriter::~FolderResultsWriter() {
+        close();
+    }
+
+
+    void FolderResultsWriter::append(const std::string &image_path, std::string result_json) {
+        // the pretty printed jsons end with a line break, the entries are separated by the writer
+        const auto end = result_json.find_last_not_of(" \t\r\n");
+        result_json.erase(end == std::string::npos ? 0 : end + 1);
+        push(Event{std::filesystem::path(image_path).parent_path().string(), std::move(result_json), false});
+    }
+
+
+    void FolderResultsWriter::complete(const std::string &folder_path) {
+        push(Event{folder_path, std::string(), true});
+    }
+
+
+    bool FolderResultsWriter::close() {
+        {
+            std::lock_guard lk{_mutex};
+            _closed = true;
+        }
+        _conditional_variable.notify_all();
+
+        if (_writer_thread.joinable()) {
+            _writer_thread.join();
+        }
+        return !_failed;
+    }
+
+
+    void FolderResultsWriter::push(Event &&event) {
+        {
+            std::lock_guard lk{_mutex};
+            if (_closed) {
+                return;
+            }
+            _events.emplace_back(std::move(event));
+        }
+        _conditional_variable.notify_one();
+    }
+
+
+    void FolderResultsWriter::run() {
+        tracing::set_thread_name("folder_results");
+        std::deque<Event> events;
+        for (;;) {
+            {
+                std::unique_lock lk{_mutex};
+                _conditional_variable.wait(lk, [this]() { return _closed || !_events.empty(); });
+                if (_events.empty()) {
+                    break;
+                }
+                // taken at once, so the callers never wait for the files
+                events.swap(_events);
+            }
+
+            tracing::Scope scope{"write_folder_results"};
+            for (const auto &event: events) {
+                if (event.is_completion) {
+                    finalize(event.folder_path);
+                } else {
+                    write_entry(event.folder_path, event.result_json);
+                }
+            }
+            events.clear();
+        }
+
+        // the folders of a cancelled job or without a completion
+        std::vector<std::string> left_folders;
+        for (const auto &[folder_path, folder]: _folders) {
+            left_folders.push_back(folder_path);
+        }
+        for (const auto &folder_path: left_folders) {
+            finalize(folder_path);
+        }
+    }
+
+
+    void FolderResultsWriter::write_entry(const std::string &folder_path, const std::string &result_json) {
+        auto &folder = _folders[folder_path];
+        if (folder.failed || (!folder.stream.is_open() && !open(folder_path, folder))) {
+            return;
+        }
+
+        if (folder.entries_number > 0) {
+            folder.stream << ENTRIES_SEPARATOR;
+        }
+        folder.stream << result_json;
+        folder.entries_number++;
+    }
+
+
+    void FolderResultsWriter::finalize(const std::string &folder_path) {
+        // a folder without results, all its images have failed, still gets its file
+        auto &folder = _folders[folder_path];
+        if (!folder.failed && (folder.stream.is_open() || open(folder_path, folder))) {
+            folder.stream << FILE_FOOTER;
+            folder.stream.close();
+            _open_files_number--;
+
+            std::error_code error_code;
+            if (folder.stream.fail()) {
+                folder.failed = true;
+            } else {
+                std::filesystem::rename(partial_file_path(folder_path),
+                                        std::filesystem::path(folder_path) / FOLDER_RESULTS_FILE_NAME, error_code);
+                folder.failed = static_cast<bool>(error_code);
+            }
+        }
+
+        _failed = _failed || folder.failed;
+        _folders.erase(folder_path);
+    }
+
+
+    bool FolderResultsWriter::open(const std::string &folder_path, FolderFile &folder) {
+        if (_open_files_number >= MAX_OPEN_FILES) {
+            for (auto &[other_folder_path, other_folder]: _folders) {
+                if (other_folder.stream.is_open()) {
+                    other_folder.stream.close();
+                    other_folder.failed = other_folder.stream.fail();
+                    _failed = _failed || other_folder.failed;
+                    _open_files_number--;
+                    break;
+                }
+            }
+        }
+
+        folder.stream.clear();
+        folder.stream.open(partial_file_path(folder_path),
+                           (folder.entries_number == 0) ? std::ios::out | std::ios::trunc
+                                                        : std::ios::out | std::ios::app);
+        if (!folder.stream.is_open()) {
+            folder.failed = true;
+            _failed = true;
+            return false;
+        }
+
+        _open_files_number++;
+        if (folder.entries_number == 0) {
+            folder.stream << FILE_HEADER;
+        }
+        return true;
+    }
+
+} // namespace output
\ No newline at end of file
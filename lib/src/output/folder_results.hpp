@@ -0,0 +1,81 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+
+namespace output {
+
+    constexpr const char *FOLDER_RESULTS_FILE_NAME = "result.json";
+    constexpr const char *PARTIAL_FOLDER_RESULTS_SUFFIX = ".partial";
+
+
+    // Streams the result jsons into one result.json per image folder from an own thread, so the callers only
+    // queue a string. A folder's file is written as result.json.partial and renamed once the folder is
+    // completed, only the entries waiting in the queue are kept in memory.
+    class FolderResultsWriter {
+    public:
+        // the writer keeps at most that many files open, the others are reopened for appending
+        static constexpr std::size_t MAX_OPEN_FILES{64};
+
+        FolderResultsWriter();
+
+        FolderResultsWriter(const FolderResultsWriter &) = delete;
+
+        FolderResultsWriter &operator=(const FolderResultsWriter &) = delete;
+
+        ~FolderResultsWriter();
+
+        // the entry goes into the result.json of the image folder, the appends after the close are ignored
+        void append(const std::string &image_path, std::string result_json);
+
+        // to be called after the last append of the folder's images; a folder completed again is rewritten
+        void complete(const std::string &folder_path);
+
+        // finalizes the folders left, returns false if any file failed to be written
+        bool close();
+
+    private:
+        struct Event {
+            std::string folder_path;
+            std::string result_json;
+            bool is_completion;
+        };
+
+        struct FolderFile {
+            std::ofstream stream;
+            std::uint64_t entries_number{0};
+            bool failed{false};
+        };
+
+        std::mutex _mutex;
+        std::condition_variable _conditional_variable;
+        std::deque<Event> _events;
+        bool _closed{false};
+
+        // owned by the writer thread
+        std::unordered_map<std::string, FolderFile> _folders;
+        std::size_t _open_files_number{0};
+        bool _failed{false};
+
+        std::thread _writer_thread;
+
+        void push(Event &&event);
+
+        void run();
+
+        void write_entry(const std::string &folder_path, const std::string &result_json);
+
+        void finalize(const std::string &folder_path);
+
+        // opens the partial file of the folder, closing another one beyond MAX_OPEN_FILES
+        bool open(const std::string &folder_path, FolderFile &folder);
+    };
+
+} // namespace output
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include "autoscaler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace processing {
+
+    Autoscaler::Autoscaler(const AutoscalingConfig &config)
+            : _min_workers_number{config.min_workers_number}, _max_workers_number{config.max_workers_number} {
+    }
+
+
+    ScalingDecision Autoscaler::decide(const ScalingSample &sample) {
+        const auto workers_number = std::max<std::size_t>(sample.workers_number, 1);
+        if (sample.workers_number < _min_workers_number) {
+            _idle_periods = 0;
+            return {_min_workers_number, "below minimum"};
+        }
+        if (sample.workers_number > _max_workers_number) {
+            _idle_periods = 0;
+            return {_max_workers_number, "above maximum"};
+        }
+
+        const auto period_us = static_cast<double>(std::max<std::int64_t>(sample.period.count(), 1));
+        const auto utilization = static_cast<double>(sample.busy_time.count()) /
+                                 (period_us * static_cast<double>(workers_number));
+        const auto service_time_us = (sample.processed_tasks > 0)
+                                     ? static_cast<double>(sample.busy_time.count()) /
+                                       static_cast<double>(sample.processed_tasks)
+                                     : 0.0;
+        const auto queue_wait_us = (sample.processed_tasks > 0)
+                                   ? static_cast<double>(sample.queue_wait.count()) /
+                                     static_cast<double>(sample.processed_tasks)
+                                   : 0.0;
+        // the workers needed to drain the backlog within one period
+        const auto needed_workers = static_cast<double>(sample.queued_tasks) * service_time_us / period_us;
+
+        const bool backlogged = (sample.queued_tasks > 0) &&
+                                ((needed_workers > static_cast<double>(workers_number)) ||
+                                 (queue_wait_us > period_us));
+        if (backlogged) {
+            _idle_periods = 0;
+            if (sample.workers_number >= _max_workers_number) {
+                return {sample.workers_number, "backlog, at maximum"};
+            }
+            if (sample.cpu_utilization >= CPU_SATURATION) {
+                return {sample.workers_number, "backlog, cpu saturated"};
+            }
+
+            // at most doubles per period, the next sample shows whether the new workers helped
+            auto target = static_cast<std::size_t>(std::ceil(needed_workers));
+            target = std::clamp(target, sample.workers_number + 1, sample.workers_number * 2);
+            return {std::min(target, _max_workers_number), "backlog"};
+        }
+
+        if ((sample.queued_tasks == 0) && (utilization < IDLE_UTILIZATION)) {
+            if ((++_idle_periods >= IDLE_PERIODS_BEFORE_SHRINK) && (sample.workers_number > _min_workers_number)) {
+                _idle_periods = 0;
+                return {sample.workers_number - 1, "idle"};
+            }
+        } else {
+            _idle_periods = 0;
+        }
+
+        return {sample.workers_number, "steady"};
+    }
+
+} // namespace processing
\ No newline at end of file
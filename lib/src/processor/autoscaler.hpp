@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+namespace processing {
+
+    struct AutoscalingConfig {
+        std::size_t min_workers_number;
+        std::size_t max_workers_number;
+        std::chrono::milliseconds period{200};
+        // every scaling decision is appended to the file as one line, nothing is written if empty
+        std::string log_file_path;
+    };
+
+
+    // what the workers did during the last period
+    struct ScalingSample {
+        std::size_t workers_number;
+        std::size_t queued_tasks;
+        std::uint64_t processed_tasks;
+        std::chrono::microseconds busy_time;  // decoding and detection time summed over the workers
+        std::chrono::microseconds queue_wait; // queue wait time summed over the processed tasks
+        std::chrono::microseconds period;
+        double cpu_utilization;               // process cpu time over the machine capacity, 0 to 1
+    };
+
+
+    struct ScalingDecision {
+        std::size_t workers_number;
+        const char *reason;
+    };
+
+
+    struct ScalingEvent {
+        std::chrono::steady_clock::time_point time;
+        std::size_t from_workers_number;
+        std::size_t to_workers_number;
+        std::string reason;
+        ScalingSample sample;
+    };
+
+
+    // Grows the workers set when the backlog can't be drained within a period and the cpu still has headroom,
+    // shrinks it one worker at a time after several idle periods, so a short pause doesn't cause a thrash.
+    class Autoscaler {
+    public:
+        static constexpr double CPU_SATURATION{0.9};
+        static constexpr double IDLE_UTILIZATION{0.5};
+        static constexpr std::size_t IDLE_PERIODS_BEFORE_SHRINK{5};
+
+        explicit Autoscaler(const AutoscalingConfig &config);
+
+        ScalingDecision decide(const ScalingSample &sample);
+
+    private:
+        const std::size_t _min_workers_number;
+        const std::size_t _max_workers_number;
+        std::size_t _idle_periods{0};
+    };
+
+} // namespace processing
\ No newline at end of file
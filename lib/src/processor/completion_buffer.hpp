@@ -0,0 +1,105 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+
+namespace processing {
+
+    // Bounded lock-free multi-producer multi-consumer queue: every cell carries a sequence number telling
+    // whether it is free for the producer of a lap or filled for its consumer, so neither side takes a lock.
+    template<typename T>
+    class CompletionBuffer {
+    public:
+        // the capacity is rounded up to a power of two
+        explicit CompletionBuffer(std::size_t capacity) : _capacity{round_up(capacity)}, _mask{_capacity - 1},
+                                                          _cells{std::make_unique<Cell[]>(_capacity)} {
+            for (std::size_t i = 0; i < _capacity; i++) {
+                _cells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        CompletionBuffer(const CompletionBuffer &) = delete;
+
+        CompletionBuffer &operator=(const CompletionBuffer &) = delete;
+
+        // returns false if the buffer is full, the value is left untouched then
+        bool try_push(T &value) {
+            auto position = _enqueue_position.load(std::memory_order_relaxed);
+            for (;;) {
+                auto &cell = _cells[position & _mask];
+                const auto sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+                if (difference == 0) {
+                    if (_enqueue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        cell.value = std::move(value);
+                        cell.sequence.store(position + 1, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = _enqueue_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // returns false if the buffer is empty
+        bool try_pop(T &value) {
+            auto position = _dequeue_position.load(std::memory_order_relaxed);
+            for (;;) {
+                auto &cell = _cells[position & _mask];
+                const auto sequence = cell.sequence.load(std::memory_order_acquire);
+                const auto difference = static_cast<std::ptrdiff_t>(sequence) -
+                                        static_cast<std::ptrdiff_t>(position + 1);
+                if (difference == 0) {
+                    if (_dequeue_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                        value = std::move(cell.value);
+                        cell.value = T{};
+                        cell.sequence.store(position + _capacity, std::memory_order_release);
+                        return true;
+                    }
+                } else if (difference < 0) {
+                    return false;
+                } else {
+                    position = _dequeue_position.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // exact when no push or pop runs concurrently
+        std::size_t approximate_size() const {
+            const auto enqueue_position = _enqueue_position.load(std::memory_order_acquire);
+            const auto dequeue_position = _dequeue_position.load(std::memory_order_acquire);
+            return (enqueue_position > dequeue_position) ? enqueue_position - dequeue_position : 0;
+        }
+
+        std::size_t capacity() const {
+            return _capacity;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<std::size_t> sequence;
+            T value;
+        };
+
+        static std::size_t round_up(std::size_t capacity) {
+            std::size_t rounded = 2;
+            while (rounded < capacity) {
+                rounded <<= 1;
+            }
+            return rounded;
+        }
+
+        const std::size_t _capacity;
+        const std::size_t _mask;
+        const std::unique_ptr<Cell[]> _cells;
+
+        // on separate cache lines, so the producers and the consumers don't invalidate each other
+        alignas(64) std::atomic<std::size_t> _enqueue_position{0};
+        alignas(64) std::atomic<std::size_t> _dequeue_position{0};
+    };
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,148 @@
+#include "detector_pool.hpp"
+
+#include "detector/error.hpp"
+#include "tracing/tracing.hpp"
+
+#include <exception>
+#include <thread>
+
+
+namespace processing {
+
+    DetectorPool::DetectorPool(boost::property_tree::ptree settings, std::uint64_t version,
+                               std::vector<cv::Size> warmup_image_sizes)
+            : _settings{std::move(settings)}, _version{version}, _warmup_image_sizes{std::move(warmup_image_sizes)},
+              _worker_shares{std::make_shared<detection::router::WorkerShares>()} {
+    }
+
+
+    std::unique_ptr<detection::Detector> DetectorPool::acquire() {
+        {
+            std::lock_guard lk{_mutex};
+            if (!_parked.empty()) {
+                auto detector = std::move(_parked.back());
+                _parked.pop_back();
+                return detector;
+            }
+        }
+
+        // built outside the lock, the model loading may take a while
+        tracing::Scope scope{"create_detector"};
+        auto detector = create_detector();
+        warm_up(*detector);
+        std::lock_guard lk{_mutex};
+        _created++;
+        return detector;
+    }
+
+
+    std::vector<std::unique_ptr<detection::Detector>> DetectorPool::acquire(std::size_t detectors_number) {
+        std::vector<std::unique_ptr<detection::Detector>> detectors(detectors_number);
+        std::vector<std::exception_ptr> errors(detectors_number);
+        const auto acquire_into = [this, &detectors, &errors](std::size_t i) {
+            try {
+                detectors[i] = acquire();
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        };
+
+        // the calling thread builds the first detector
+        std::vector<std::thread> threads;
+        for (std::size_t i = 1; i < detectors_number; i++) {
+            threads.emplace_back(acquire_into, i);
+        }
+        if (detectors_number > 0) {
+            acquire_into(0);
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+
+        for (const auto &error: errors) {
+            if (error) {
+                for (auto &detector: detectors) {
+                    park(std::move(detector));
+                }
+                std::rethrow_exception(error);
+            }
+        }
+        return detectors;
+    }
+
+
+    void DetectorPool::park(std::unique_ptr<detection::Detector> detector) {
+        if (!detector) {
+            return;
+        }
+
+        std::lock_guard lk{_mutex};
+        _parked.emplace_back(std::move(detector));
+    }
+
+
+    std::size_t DetectorPool::created_detectors() const {
+        std::lock_guard lk{_mutex};
+        return _created;
+    }
+
+
+    std::size_t DetectorPool::parked_detectors() const {
+        std::lock_guard lk{_mutex};
+        return _parked.size();
+    }
+
+
+    std::uint64_t DetectorPool::version() const {
+        return _version;
+    }
+
+
+    const std::vector<cv::Size> &DetectorPool::warmup_image_sizes() const {
+        return _warmup_image_sizes;
+    }
+
+
+    std::chrono::microseconds DetectorPool::warmup_duration() const {
+        return std::chrono::microseconds(_warmup_duration_us.load(std::memory_order_relaxed));
+    }
+
+
+    std::unique_ptr<detection::Detector> DetectorPool::create_detector() {
+        {
+            std::lock_guard lk{_bundle_mutex};
+            if (!_is_bundle_mapped) {
+                _model_bundle = detection::map_bundle(_settings);
+                _is_bundle_mapped = true;
+            }
+        }
+
+        if (_model_bundle) {
+            return detection::create_detector(*_model_bundle);
+        }
+        return detection::create_detector(_settings, _worker_shares);
+    }
+
+
+    void DetectorPool::warm_up(detection::Detector &detector) {
+        if (_warmup_image_sizes.empty()) {
+            return;
+        }
+
+        tracing::Scope scope{"warm_up_detector"};
+        const auto start_time = std::chrono::steady_clock::now();
+        for (const auto &image_size: _warmup_image_sizes) {
+            // noise rather than a flat image, so a cascade goes past its first stages
+            cv::Mat image(image_size, CV_8UC3);
+            cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(256));
+            try {
+                detector.warm_up(image);
+            } catch (const detection::ProcessingError &) {
+                // the warm-up is best effort, the image is detected again once it serves
+            }
+        }
+        _warmup_duration_us.fetch_add(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start_time).count()), std::memory_order_relaxed);
+    }
+
+} // namespace processing
\ No newline at end of file
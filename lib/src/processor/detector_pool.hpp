@@ -0,0 +1,72 @@
+#pragma once
+
+#include "detector/detector_factory.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+
+namespace processing {
+
+    // Detector contexts are expensive to build, so a retired worker parks its detector here
+    // and the next started worker takes it instead of loading the model again.
+    // A pool serves one version of the detector description, a reload replaces the whole pool.
+    // The router detectors of a pool share the worker limits of their routes.
+    // A "bundle" description is mapped once per pool, its detectors are created from the same mapping.
+    // A new detector is warmed up on a synthetic image of every warm-up size before it is handed out, every route
+    // of a router included, so the lazy allocations of its first detections aren't paid by the first images.
+    class DetectorPool {
+    public:
+        explicit DetectorPool(boost::property_tree::ptree settings, std::uint64_t version = 1,
+                              std::vector<cv::Size> warmup_image_sizes = {});
+
+        // a parked detector if there is one, otherwise a new one; throws detection::CreationError
+        std::unique_ptr<detection::Detector> acquire();
+
+        // the detectors which aren't parked are built concurrently; throws the first detection::CreationError,
+        // the detectors built by then are parked
+        std::vector<std::unique_ptr<detection::Detector>> acquire(std::size_t detectors_number);
+
+        void park(std::unique_ptr<detection::Detector> detector);
+
+        std::size_t created_detectors() const;
+
+        std::size_t parked_detectors() const;
+
+        std::uint64_t version() const;
+
+        const std::vector<cv::Size> &warmup_image_sizes() const;
+
+        // the warm-up time of all the detectors built so far
+        std::chrono::microseconds warmup_duration() const;
+
+    private:
+        const boost::property_tree::ptree _settings;
+        const std::uint64_t _version;
+        const std::vector<cv::Size> _warmup_image_sizes;
+        const std::shared_ptr<detection::router::WorkerShares> _worker_shares;
+        std::atomic<std::uint64_t> _warmup_duration_us{0};
+
+        mutable std::mutex _mutex;
+        std::vector<std::unique_ptr<detection::Detector>> _parked;
+        std::size_t _created{0};
+
+        // mapped by the first detector creation, a failed mapping is tried again by the next one
+        std::mutex _bundle_mutex;
+        bool _is_bundle_mapped{false};
+        std::unique_ptr<detection::bundle::ModelBundle> _model_bundle;
+
+        std::unique_ptr<detection::Detector> create_detector();
+
+        void warm_up(detection::Detector &detector);
+    };
+
+} // namespace processing
\ No newline at end of file
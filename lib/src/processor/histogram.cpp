@@ -0,0 +1,121 @@
+#include "histogram.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+
+namespace processing {
+
+    void Histogram::record(std::uint64_t value) noexcept {
+        _buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+        _count.fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(value, std::memory_order_relaxed);
+
+        auto current_max = _max.load(std::memory_order_relaxed);
+        while ((value > current_max) &&
+               !_max.compare_exchange_weak(current_max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+
+    void Histogram::merge(const Histogram &other) noexcept {
+        for (std::size_t i = 0; i < BUCKETS_NUMBER; i++) {
+            const auto bucket_count = other._buckets[i].load(std::memory_order_relaxed);
+            if (bucket_count != 0) {
+                _buckets[i].fetch_add(bucket_count, std::memory_order_relaxed);
+            }
+        }
+        _count.fetch_add(other._count.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        _sum.fetch_add(other._sum.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+        const auto other_max = other._max.load(std::memory_order_relaxed);
+        auto current_max = _max.load(std::memory_order_relaxed);
+        while ((other_max > current_max) &&
+               !_max.compare_exchange_weak(current_max, other_max, std::memory_order_relaxed)) {
+        }
+    }
+
+
+    void Histogram::reset() noexcept {
+        for (auto &bucket: _buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        _count.store(0, std::memory_order_relaxed);
+        _sum.store(0, std::memory_order_relaxed);
+        _max.store(0, std::memory_order_relaxed);
+    }
+
+
+    std::uint64_t Histogram::count() const noexcept {
+        return _count.load(std::memory_order_relaxed);
+    }
+
+
+    std::uint64_t Histogram::sum() const noexcept {
+        return _sum.load(std::memory_order_relaxed);
+    }
+
+
+    std::uint64_t Histogram::max() const noexcept {
+        return _max.load(std::memory_order_relaxed);
+    }
+
+
+    std::uint64_t Histogram::percentile(double quantile) const noexcept {
+        // buckets are summed instead of trusting _count, so a concurrent record can't push the rank out of range
+        std::uint64_t total = 0;
+        for (const auto &bucket: _buckets) {
+            total += bucket.load(std::memory_order_relaxed);
+        }
+        if (total == 0) {
+            return 0;
+        }
+
+        const auto rank = std::max<std::uint64_t>(
+                1, static_cast<std::uint64_t>(std::ceil(std::clamp(quantile, 0.0, 1.0) * static_cast<double>(total))));
+
+        std::uint64_t accumulated = 0;
+        for (std::size_t i = 0; i < BUCKETS_NUMBER; i++) {
+            accumulated += _buckets[i].load(std::memory_order_relaxed);
+            if (accumulated >= rank) {
+                return std::min(bucket_upper_bound(i), max());
+            }
+        }
+
+        return max();
+    }
+
+
+    std::size_t Histogram::bucket_index(std::uint64_t value) noexcept {
+        if (value < LINEAR_BUCKETS_NUMBER) {
+            return static_cast<std::size_t>(value);
+        }
+
+        std::size_t most_significant_bit = 0;
+        for (auto rest = value; rest > 1; rest >>= 1) {
+            most_significant_bit++;
+        }
+
+        // keep the 5 most significant bits: the leading one and 4 bits of the sub-bucket
+        const std::size_t shift = most_significant_bit - 4;
+        const auto sub_bucket = static_cast<std::size_t>(value >> shift) - SUB_BUCKETS_NUMBER;
+        return LINEAR_BUCKETS_NUMBER + (shift - 1) * SUB_BUCKETS_NUMBER + sub_bucket;
+    }
+
+
+    std::uint64_t Histogram::bucket_upper_bound(std::size_t index) noexcept {
+        if (index < LINEAR_BUCKETS_NUMBER) {
+            return static_cast<std::uint64_t>(index);
+        }
+
+        const std::size_t shift = (index - LINEAR_BUCKETS_NUMBER) / SUB_BUCKETS_NUMBER + 1;
+        const std::uint64_t sub_bucket = (index - LINEAR_BUCKETS_NUMBER) % SUB_BUCKETS_NUMBER + SUB_BUCKETS_NUMBER;
+        if (sub_bucket + 1 >= (std::uint64_t{1} << (64 - shift))) {
+            return std::numeric_limits<std::uint64_t>::max();
+        }
+
+        return ((sub_bucket + 1) << shift) - 1;
+    }
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+namespace processing {
+
+    // Log-linear (HDR style) histogram of non-negative integer values: exact below 32,
+    // then 16 sub-buckets per power of two, so every bucket is within ~6% of the recorded value.
+    // Recording is a single relaxed atomic increment, reading is safe from any thread at any time.
+    class Histogram {
+    public:
+        static constexpr std::size_t LINEAR_BUCKETS_NUMBER{32};
+        static constexpr std::size_t SUB_BUCKETS_NUMBER{16};
+        static constexpr std::size_t BUCKETS_NUMBER{LINEAR_BUCKETS_NUMBER + 59 * SUB_BUCKETS_NUMBER};
+
+        Histogram() = default;
+
+        Histogram(const Histogram &) = delete;
+
+        Histogram &operator=(const Histogram &) = delete;
+
+        void record(std::uint64_t value) noexcept;
+
+        // adds all values recorded by another histogram
+        void merge(const Histogram &other) noexcept;
+
+        void reset() noexcept;
+
+        std::uint64_t count() const noexcept;
+
+        std::uint64_t sum() const noexcept;
+
+        std::uint64_t max() const noexcept;
+
+        // the upper bound of the bucket holding the given quantile (0.0 .. 1.0), 0 for an empty histogram
+        std::uint64_t percentile(double quantile) const noexcept;
+
+        static std::size_t bucket_index(std::uint64_t value) noexcept;
+
+        static std::uint64_t bucket_upper_bound(std::size_t index) noexcept;
+
+    private:
+        std::array<std::atomic<std::uint64_t>, BUCKETS_NUMBER> _buckets{};
+        std::atomic<std::uint64_t> _count{0};
+        std::atomic<std::uint64_t> _sum{0};
+        std::atomic<std::uint64_t> _max{0};
+    };
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,227 @@
+#include "job.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+
+
+namespace processing {
+
+    FeedGate::FeedGate(std::size_t capacity) : _capacity{std::max<std::uint64_t>(capacity, 1)} {
+    }
+
+
+    void FeedGate::enter(std::uint64_t images_number) {
+        std::unique_lock lk{_mutex};
+        _conditional_variable.wait(lk, [this, images_number]() {
+            return _opened || (_images_number == 0) || (_images_number + images_number <= _capacity);
+        });
+        _images_number += images_number;
+    }
+
+
+    void FeedGate::leave(std::uint64_t images_number) {
+        {
+            std::lock_guard lk{_mutex};
+            _images_number -= std::min(images_number, _images_number);
+        }
+        _conditional_variable.notify_all();
+    }
+
+
+    void FeedGate::open() {
+        {
+            std::lock_guard lk{_mutex};
+            _opened = true;
+        }
+        _conditional_variable.notify_all();
+    }
+
+
+    Job::Job(Scheduler &scheduler, ResultCallback &&callback, PRIORITY_CLASS priority,
+             std::optional<Clock::time_point> deadline, DEADLINE_POLICY deadline_policy,
+             DETECTION_MODE detection_mode, std::shared_ptr<FeedGate> feed_gate)
+            : callback{std::move(callback)}, priority{priority}, deadline{deadline}, deadline_policy{deadline_policy},
+              detection_mode{detection_mode}, feed_gate{std::move(feed_gate)}, _scheduler{scheduler},
+              _start_time{Clock::now()} {
+    }
+
+
+    void Job::cancel() {
+        if (_cancelled.exchange(true)) {
+            return;
+        }
+
+        // the paused walker goes on to see the cancellation
+        if (feed_gate) {
+            feed_gate->open();
+        }
+        _scheduler.cancel(*this);
+        complete_if_done();
+    }
+
+
+    Progress Job::progress() const {
+        // a task may be dequeued between the two loads, so queued is clamped instead of trusted
+        const auto dequeued = _dequeued.load(std::memory_order_relaxed);
+        const auto enqueued = _enqueued.load(std::memory_order_relaxed);
+        const auto detected = _detected.load(std::memory_order_relaxed);
+        const auto finish_time_us = _finish_time_us.load(std::memory_order_relaxed);
+
+        const auto elapsed_us = (finish_time_us >= 0)
+                                ? finish_time_us
+                                : std::chrono::duration_cast<std::chrono::microseconds>(
+                        Clock::now() - _start_time).count();
+
+        return Progress{_discovered.load(std::memory_order_relaxed),
+                        (enqueued > dequeued) ? enqueued - dequeued : 0,
+                        _decoded.load(std::memory_order_relaxed),
+                        detected,
+                        _failed.load(std::memory_order_relaxed),
+                        _dropped.load(std::memory_order_relaxed),
+                        (elapsed_us > 0) ? static_cast<double>(detected) * 1e6 / static_cast<double>(elapsed_us) : 0.0,
+                        _walk_finished.load(std::memory_order_relaxed),
+                        finish_time_us >= 0,
+                        _cancelled.load(std::memory_order_relaxed)};
+    }
+
+
+    RESULT_CODE Job::wait() {
+        {
+            std::unique_lock lk{_mutex};
+            _completed_conditional_variable.wait(lk, [this] { return is_completed(); });
+        }
+
+        if (!_walk_succeeded) {
+            return RESULT_CODE::PROCESS_UNEXPECTED_ERROR;
+        }
+
+        return _cancelled ? RESULT_CODE::PROCESS_CANCELLED : RESULT_CODE::PROCESS_SUCCESS;
+    }
+
+
+    bool Job::is_cancelled() const {
+        return _cancelled.load(std::memory_order_relaxed);
+    }
+
+
+    bool Job::is_expired() const {
+        return deadline && (Clock::now() > deadline.value());
+    }
+
+
+    void Job::wait_for_room(std::uint64_t images_number) {
+        if (feed_gate) {
+            feed_gate->enter(images_number);
+        }
+    }
+
+
+    void Job::on_discovered(std::uint64_t images_number) {
+        _discovered.fetch_add(images_number, std::memory_order_relaxed);
+    }
+
+
+    void Job::on_queued(std::uint64_t images_number) {
+        _enqueued.fetch_add(images_number, std::memory_order_relaxed);
+    }
+
+
+    void Job::on_dequeued(std::uint64_t images_number) {
+        _dequeued.fetch_add(images_number, std::memory_order_relaxed);
+    }
+
+
+    void Job::on_decoded() {
+        _decoded.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    void Job::on_detected() {
+        _detected.fetch_add(1, std::memory_order_acq_rel);
+        complete_if_done();
+    }
+
+
+    void Job::on_failed() {
+        if (feed_gate) {
+            feed_gate->leave();
+        }
+        _failed.fetch_add(1, std::memory_order_acq_rel);
+        complete_if_done();
+    }
+
+
+    void Job::on_dropped(std::uint64_t images_number) {
+        if (feed_gate) {
+            feed_gate->leave(images_number);
+        }
+        _dropped.fetch_add(images_number, std::memory_order_acq_rel);
+        complete_if_done();
+    }
+
+
+    void Job::finish_walk(bool walk_succeeded) {
+        _walk_succeeded = walk_succeeded;
+        _walk_finished = true;
+        complete_if_done();
+    }
+
+
+    bool Job::is_walk_finished() const {
+        return _walk_finished;
+    }
+
+
+    void Job::on_folder_opened() {
+        _open_folders.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+
+    void Job::on_folder_completed() {
+        _open_folders.fetch_sub(1, std::memory_order_acq_rel);
+        complete_if_done();
+    }
+
+
+    bool Job::is_completed() const {
+        // every discovered image ends up exactly once as detected, failed or dropped
+        return _walk_finished && (_open_folders.load() == 0) &&
+               (_detected.load() + _failed.load() + _dropped.load() == _discovered.load());
+    }
+
+
+    void Job::complete_if_done() {
+        if (!is_completed()) {
+            return;
+        }
+
+        std::lock_guard lk{_mutex};
+        std::int64_t not_finished{-1};
+        _finish_time_us.compare_exchange_strong(
+                not_finished,
+                std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - _start_time).count());
+        _completed_conditional_variable.notify_all();
+    }
+
+
+    FolderCompletion::FolderCompletion(std::shared_ptr<Job> job, std::string folder_path, FolderCallback callback)
+            : _job{std::move(job)}, _folder_path{std::move(folder_path)}, _callback{std::move(callback)} {
+        _job->on_folder_opened();
+    }
+
+
+    FolderCompletion::~FolderCompletion() {
+        try {
+            _callback(_folder_path);
+        } catch (...) {
+            // the consumer errors are not the processing errors
+        }
+        _job->on_folder_completed();
+    }
+
+
+    const std::string &FolderCompletion::folder_path() const {
+        return _folder_path;
+    }
+
+} // namespace processing
\ No newline at end of file
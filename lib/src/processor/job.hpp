@@ -0,0 +1,193 @@
+#pragma once
+
+#include "processor_wrapper/include/processor.h"
+
+#include <opencv2/core.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace processing {
+
+    using Clock = std::chrono::steady_clock;
+
+    class Scheduler;
+
+
+    struct ImageResult {
+        std::string image_path;
+        std::vector<cv::Rect> faces;
+        bool deadline_exceeded{false};
+        std::uint64_t image_index{0};   // position in the submitted images of an in-memory job
+        std::uint64_t config_version{0}; // the detector description version which has detected the image
+        std::size_t faces_number{0};     // the faces stay empty unless the job detects in DETECTION_FULL
+        std::string route;               // the route of a router detector which has detected the image
+    };
+
+
+    using ResultCallback = std::function<void(const ImageResult &result)>;
+
+    using FolderCallback = std::function<void(const std::string &folder_path)>;
+
+
+    // Bounds the images of a job which have been queued but not taken by the consumer yet, so a slow consumer
+    // pauses the folder walk of its own job instead of the shared workers. An image leaves once its result is
+    // taken, or once it has failed or has been dropped.
+    class FeedGate {
+    public:
+        explicit FeedGate(std::size_t capacity);
+
+        FeedGate(const FeedGate &) = delete;
+
+        FeedGate &operator=(const FeedGate &) = delete;
+
+        // blocks the walker while the gate is full, a frame sequence larger than the capacity waits for it to empty
+        void enter(std::uint64_t images_number = 1);
+
+        void leave(std::uint64_t images_number = 1);
+
+        // lifts the bound for good and lets the waiting walker go on
+        void open();
+
+    private:
+        const std::uint64_t _capacity;
+
+        std::mutex _mutex;
+        std::condition_variable _conditional_variable;
+        std::uint64_t _images_number{0};
+        bool _opened{false};
+    };
+
+
+    // Counters only grow, each one is read with a single relaxed load, so polling is cheap from any thread.
+    // Images in flight are queued - decoded - failed - dropped at the moment of the snapshot.
+    struct Progress {
+        std::uint64_t discovered;   // images found by the folder walk
+        std::uint64_t queued;       // waiting in the scheduler
+        std::uint64_t decoded;
+        std::uint64_t detected;     // delivered to the callback
+        std::uint64_t failed;       // decoding or detection errors
+        std::uint64_t dropped;      // expired or cancelled before a worker took them
+        double images_per_second;   // detected images over the job lifetime
+        bool walk_finished;
+        bool finished;
+        bool cancelled;
+    };
+
+
+    // All images of one process() call share the job: its callback, priority class, deadline and progress.
+    class Job {
+    public:
+        Job(Scheduler &scheduler, ResultCallback &&callback, PRIORITY_CLASS priority,
+            std::optional<Clock::time_point> deadline, DEADLINE_POLICY deadline_policy,
+            DETECTION_MODE detection_mode = DETECTION_MODE::DETECTION_FULL,
+            std::shared_ptr<FeedGate> feed_gate = nullptr);
+
+        Job(const Job &) = delete;
+
+        Job &operator=(const Job &) = delete;
+
+        // stops the folder walk and drops the queued images, the images already taken by workers are finished
+        void cancel();
+
+        Progress progress() const;
+
+        // blocks until every image of the job is completed,
+        // returns PROCESS_SUCCESS, PROCESS_CANCELLED or PROCESS_UNEXPECTED_ERROR for a failed folder walk
+        RESULT_CODE wait();
+
+        bool is_cancelled() const;
+
+        bool is_expired() const;
+
+        const ResultCallback callback;
+        const PRIORITY_CLASS priority;
+        const std::optional<Clock::time_point> deadline;
+        const DEADLINE_POLICY deadline_policy;
+        const DETECTION_MODE detection_mode;
+        // set when the consumer takes the results at its own pace, opened by cancel()
+        const std::shared_ptr<FeedGate> feed_gate;
+
+        // the processor side of the job lifecycle, a frame sequence task counts its frames at once
+
+        // pauses the walker while the feed gate is full, before the images are discovered
+        void wait_for_room(std::uint64_t images_number = 1);
+
+        void on_discovered(std::uint64_t images_number = 1);
+
+        void on_queued(std::uint64_t images_number = 1);
+
+        void on_dequeued(std::uint64_t images_number = 1);
+
+        void on_decoded();
+
+        void on_detected();
+
+        void on_failed();
+
+        void on_dropped(std::uint64_t images_number = 1);
+
+        void finish_walk(bool walk_succeeded);
+
+        bool is_walk_finished() const;
+
+        void on_folder_opened();
+
+        void on_folder_completed();
+
+    private:
+        Scheduler &_scheduler;
+        const Clock::time_point _start_time;
+
+        std::atomic<std::uint64_t> _discovered{0};
+        std::atomic<std::uint64_t> _enqueued{0};
+        std::atomic<std::uint64_t> _dequeued{0};
+        std::atomic<std::uint64_t> _decoded{0};
+        std::atomic<std::uint64_t> _detected{0};
+        std::atomic<std::uint64_t> _failed{0};
+        std::atomic<std::uint64_t> _dropped{0};
+        std::atomic<std::uint64_t> _open_folders{0};
+        std::atomic<std::int64_t> _finish_time_us{-1};
+        std::atomic<bool> _walk_finished{false};
+        std::atomic<bool> _walk_succeeded{true};
+        std::atomic<bool> _cancelled{false};
+
+        mutable std::mutex _mutex;
+        std::condition_variable _completed_conditional_variable;
+
+        bool is_completed() const;
+
+        void complete_if_done();
+    };
+
+
+    // Shared by the folder walk and the tasks of one folder, calls back once the last of them has let it go:
+    // the walk has left the folder and every image of it has been delivered, has failed or has been dropped.
+    // The job isn't completed before, so its wait() returns after the last folder callback.
+    class FolderCompletion {
+    public:
+        FolderCompletion(std::shared_ptr<Job> job, std::string folder_path, FolderCallback callback);
+
+        FolderCompletion(const FolderCompletion &) = delete;
+
+        FolderCompletion &operator=(const FolderCompletion &) = delete;
+
+        ~FolderCompletion();
+
+        const std::string &folder_path() const;
+
+    private:
+        const std::shared_ptr<Job> _job;
+        const std::string _folder_path;
+        const FolderCallback _callback;
+    };
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,643 @@
+#include "process_pool.hpp"
+
+#include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <boost/property_tree/json_parser.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define PROCESS_POOL_SUPPORTED
+
+#include <boost/interprocess/shared_memory_object.hpp>
+#include <boost/interprocess/sync/interprocess_semaphore.hpp>
+
+#include <csignal>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+
+namespace {
+
+    const char *WORKER_EXECUTABLE_NAME{"detection_worker"};
+
+}
+
+
+namespace processing {
+
+    std::filesystem::path default_worker_executable_path() {
+        if (const char *worker_path = std::getenv("DETECTION_WORKER_PATH")) {
+            return worker_path;
+        }
+
+        std::error_code error;
+        const auto executable_path = std::filesystem::read_symlink("/proc/self/exe", error);
+        if (!error && std::filesystem::exists(executable_path.parent_path() / WORKER_EXECUTABLE_NAME, error)) {
+            return executable_path.parent_path() / WORKER_EXECUTABLE_NAME;
+        }
+
+#ifdef DETECTION_WORKER_DIRECTORY
+        return std::filesystem::path(DETECTION_WORKER_DIRECTORY) / WORKER_EXECUTABLE_NAME;
+#else
+        return WORKER_EXECUTABLE_NAME;
+#endif
+    }
+
+} // namespace processing
+
+
+#ifdef PROCESS_POOL_SUPPORTED
+
+namespace {
+
+    namespace ipc = boost::interprocess;
+
+    const std::size_t MAX_IMAGE_PATH_LENGTH{4096};
+    const std::size_t MAX_FACES_NUMBER{1024};
+    const std::size_t MAX_ERROR_MESSAGE_LENGTH{512};
+    const std::size_t SLOTS_PER_WORKER{2};
+
+    const auto WORKER_START_TIMEOUT = std::chrono::seconds(120);
+    const auto WORKER_STOP_TIMEOUT = std::chrono::seconds(5);
+    const auto SUPERVISOR_PERIOD = std::chrono::milliseconds(20);
+
+    const auto WORKER_RESTART_DELAY = std::chrono::milliseconds(100);
+    const auto MAX_WORKER_RESTART_DELAY = std::chrono::seconds(5);
+
+    const int WORKER_EXIT_CREATION_FAILED{3};
+
+    const char *CRASH_AFTER_JOB_VARIABLE{"DETECTION_WORKER_CRASH_AFTER_JOB"};
+
+
+    enum class SLOT_STATE : std::uint8_t {
+        FREE = 0,
+        RESERVED = 1,   // the parent thread is writing the job
+        QUEUED = 2,     // waiting for a worker
+        CLAIMED = 3,    // a worker is processing the job, the worker pid is stored in the state word
+        DONE = 4,       // the worker pid is kept until the parent thread takes the result
+        FAILED = 5
+    };
+
+
+    // state and owner pid share one word so a worker claims a job and records itself atomically
+    std::uint64_t make_state_word(SLOT_STATE state, pid_t pid = 0) {
+        return (static_cast<std::uint64_t>(static_cast<std::uint32_t>(pid)) << 8) | static_cast<std::uint64_t>(state);
+    }
+
+    SLOT_STATE state_of(std::uint64_t state_word) {
+        return static_cast<SLOT_STATE>(state_word & 0xFF);
+    }
+
+    pid_t pid_of(std::uint64_t state_word) {
+        return static_cast<pid_t>(static_cast<std::uint32_t>(state_word >> 8));
+    }
+
+    bool is_finished(SLOT_STATE state) {
+        return (state == SLOT_STATE::DONE) || (state == SLOT_STATE::FAILED);
+    }
+
+
+    struct SharedRect {
+        std::int32_t x;
+        std::int32_t y;
+        std::int32_t width;
+        std::int32_t height;
+    };
+
+
+    struct JobSlot {
+        std::atomic<std::uint64_t> state_word{make_state_word(SLOT_STATE::FREE)};
+        std::uint64_t sequence{0};
+        std::uint32_t attempts{0};
+        ipc::interprocess_semaphore done{0};
+
+        char image_path[MAX_IMAGE_PATH_LENGTH]{};
+        std::uint32_t faces_number{0};
+        SharedRect faces[MAX_FACES_NUMBER]{};
+        char error_message[MAX_ERROR_MESSAGE_LENGTH]{};
+    };
+
+    static_assert(std::atomic<std::uint64_t>::is_always_lock_free, "shared memory ring needs lock free atomics");
+
+}
+
+namespace processing {
+
+    struct SharedJobRing {
+        explicit SharedJobRing(std::size_t slots) : free_slots{static_cast<unsigned int>(slots)},
+                                                    slots_number{slots} {}
+
+        ipc::interprocess_semaphore queued_jobs{0};
+        ipc::interprocess_semaphore free_slots;
+        std::atomic<bool> stopping{false};
+        std::atomic<std::uint64_t> next_sequence{0};
+        std::atomic<std::uint32_t> ready_workers{0};
+        std::atomic<std::uint32_t> failed_workers{0};
+        std::size_t slots_number;
+
+        JobSlot *slots() {
+            return reinterpret_cast<JobSlot *>(this + 1);
+        }
+    };
+
+    static_assert(alignof(JobSlot) <= alignof(SharedJobRing), "job slots are placed right after the ring header");
+
+}
+
+namespace {
+
+    // none after a worker death in the middle of an image, doubled by every failed start in a row
+    std::chrono::steady_clock::duration restart_delay(std::uint32_t failed_starts) {
+        if (failed_starts == 0) {
+            return std::chrono::steady_clock::duration::zero();
+        }
+        const auto delay = WORKER_RESTART_DELAY * (1u << std::min(failed_starts - 1, 16u));
+        return std::min<std::chrono::steady_clock::duration>(delay, MAX_WORKER_RESTART_DELAY);
+    }
+
+
+    void copy_message(char *destination, std::size_t destination_size, const std::string &message) {
+        const auto length = std::min(message.size(), destination_size - 1);
+        std::memcpy(destination, message.data(), length);
+        destination[length] = '\0';
+    }
+
+
+    // the oldest queued job first, so retried images don't wait behind the whole ring
+    JobSlot *claim_job(processing::SharedJobRing &ring) {
+        while (true) {
+            JobSlot *oldest_slot = nullptr;
+            std::uint64_t oldest_state_word = 0;
+            for (std::size_t i = 0; i < ring.slots_number; i++) {
+                auto &slot = ring.slots()[i];
+                const auto state_word = slot.state_word.load();
+                if ((state_of(state_word) == SLOT_STATE::QUEUED) &&
+                    ((oldest_slot == nullptr) || (slot.sequence < oldest_slot->sequence))) {
+                    oldest_slot = &slot;
+                    oldest_state_word = state_word;
+                }
+            }
+
+            if (oldest_slot == nullptr) {
+                return nullptr;
+            }
+
+            if (oldest_slot->state_word.compare_exchange_strong(oldest_state_word,
+                                                                make_state_word(SLOT_STATE::CLAIMED, getpid()))) {
+                return oldest_slot;
+            }
+        }
+    }
+
+
+    void process_job(JobSlot &slot, detection::Detector &detector) {
+        try {
+            auto img = cv::imread(slot.image_path, cv::IMREAD_COLOR);
+            if (img.empty()) {
+                copy_message(slot.error_message, MAX_ERROR_MESSAGE_LENGTH, "can't decode image");
+                slot.state_word.store(make_state_word(SLOT_STATE::FAILED, getpid()));
+                return;
+            }
+
+            auto detections = detector.detect(img);
+            slot.faces_number = static_cast<std::uint32_t>(std::min(detections.size(), MAX_FACES_NUMBER));
+            for (std::uint32_t i = 0; i < slot.faces_number; i++) {
+                slot.faces[i] = SharedRect{detections[i].x, detections[i].y,
+                                           detections[i].width, detections[i].height};
+            }
+            slot.state_word.store(make_state_word(SLOT_STATE::DONE, getpid()));
+        } catch (std::exception const &e) {
+            copy_message(slot.error_message, MAX_ERROR_MESSAGE_LENGTH, e.what());
+            slot.state_word.store(make_state_word(SLOT_STATE::FAILED, getpid()));
+        } catch (...) {
+            copy_message(slot.error_message, MAX_ERROR_MESSAGE_LENGTH, "unknown detection error");
+            slot.state_word.store(make_state_word(SLOT_STATE::FAILED, getpid()));
+        }
+    }
+
+
+    int worker_main(processing::SharedJobRing &ring, const std::string &detector_description) {
+        // the pool runs a worker per core, so each one detects on a single thread
+        cv::setNumThreads(0);
+
+        std::unique_ptr<detection::Detector> detector;
+        try {
+            std::istringstream description_stream{detector_description};
+            boost::property_tree::ptree detector_settings;
+            boost::property_tree::read_json(description_stream, detector_settings);
+            detector = detection::create_detector(detector_settings);
+        } catch (...) {
+            ring.failed_workers++;
+            return WORKER_EXIT_CREATION_FAILED;
+        }
+        ring.ready_workers++;
+
+        // fault injection for the tests: a death between the result and its notification
+        const bool crash_after_job = (std::getenv(CRASH_AFTER_JOB_VARIABLE) != nullptr);
+        while (true) {
+            ring.queued_jobs.wait();
+            if (ring.stopping) {
+                break;
+            }
+
+            auto slot = claim_job(ring);
+            if (slot == nullptr) {
+                continue; // wake up compensation after a crash of another worker
+            }
+
+            process_job(*slot, *detector);
+            if (crash_after_job) {
+                raise(SIGKILL);
+            }
+            slot->done.post();
+        }
+
+        return EXIT_SUCCESS;
+    }
+
+
+    std::string write_description(const boost::property_tree::ptree &detector_settings) {
+        std::ostringstream description_stream;
+        boost::property_tree::write_json(description_stream, detector_settings, false);
+        return description_stream.str();
+    }
+
+}
+
+namespace processing {
+
+    bool is_process_pool_supported() noexcept {
+        return true;
+    }
+
+
+    int run_worker_process(const std::string &shared_memory_name, const std::string &detector_description) noexcept {
+        try {
+            ipc::shared_memory_object shared_memory{ipc::open_only, shared_memory_name.c_str(), ipc::read_write};
+            ipc::mapped_region region{shared_memory, ipc::read_write};
+            return worker_main(*static_cast<SharedJobRing *>(region.get_address()), detector_description);
+        } catch (...) {
+            return WORKER_EXIT_CREATION_FAILED;
+        }
+    }
+
+
+    ProcessPool::ProcessPool(std::size_t workers_number, const boost::property_tree::ptree &detector_settings,
+                             std::filesystem::path worker_executable_path)
+            : _worker_executable_path{std::move(worker_executable_path)},
+              _detector_description{write_description(detector_settings)}, _workers_number{workers_number} {
+        if (!std::filesystem::exists(_worker_executable_path)) {
+            RAISE_ERROR(detection::CreationError,
+                        "worker executable is not found: " + _worker_executable_path.string());
+        }
+
+        // unique within the host, the name lives until the pool is destroyed, so the restarted workers attach too
+        static std::atomic<std::uint64_t> pools_number{0};
+        _shared_memory_name = "detection_pool_" + std::to_string(getpid()) + "_" + std::to_string(pools_number++);
+        const std::size_t slots_number = workers_number * SLOTS_PER_WORKER;
+        try {
+            ipc::shared_memory_object shared_memory{ipc::create_only, _shared_memory_name.c_str(), ipc::read_write};
+            shared_memory.truncate(static_cast<ipc::offset_t>(sizeof(SharedJobRing) + slots_number * sizeof(JobSlot)));
+            _shared_memory = std::make_unique<ipc::mapped_region>(shared_memory, ipc::read_write);
+        } catch (std::exception const &e) {
+            ipc::shared_memory_object::remove(_shared_memory_name.c_str());
+            RAISE_ERROR(detection::CreationError, std::string("shared memory allocation failed: ") + e.what());
+        }
+
+        _ring = new(_shared_memory->get_address()) SharedJobRing{slots_number};
+        for (std::size_t i = 0; i < slots_number; i++) {
+            new(&_ring->slots()[i]) JobSlot{};
+        }
+
+        for (std::size_t i = 0; i < workers_number; i++) {
+            auto pid = start_worker();
+            if (pid < 0) {
+                fail_creation("worker process creation failed");
+            }
+        }
+
+        // an exited worker, e.g. one which couldn't attach to the ring, fails the start without the timeout
+        const auto start_deadline = std::chrono::steady_clock::now() + WORKER_START_TIMEOUT;
+        while ((_ring->ready_workers + _ring->failed_workers < workers_number) &&
+               (std::chrono::steady_clock::now() < start_deadline)) {
+            for (auto pid: _worker_pids) {
+                int status = 0;
+                if (waitpid(pid, &status, WNOHANG) == pid) {
+                    fail_creation("worker process has exited on start with " + std::to_string(status));
+                }
+            }
+            std::this_thread::sleep_for(SUPERVISOR_PERIOD);
+        }
+
+        if (_ring->ready_workers != workers_number) {
+            fail_creation("detector creation failed in worker process");
+        }
+
+        _supervisor = std::thread([this]() { supervise(); });
+    }
+
+
+    ProcessPool::~ProcessPool() {
+        _stopping = true;
+        if (_supervisor.joinable()) {
+            _supervisor.join();
+        }
+        stop_workers();
+        ipc::shared_memory_object::remove(_shared_memory_name.c_str());
+    }
+
+
+    std::vector<cv::Rect> ProcessPool::run(const std::string &image_path) {
+        if (image_path.size() >= MAX_IMAGE_PATH_LENGTH) {
+            RAISE_ERROR(detection::ProcessingError, "image path is too long for the job ring: " + image_path);
+        }
+        if (_failed) {
+            RAISE_ERROR(detection::ProcessingError, "worker processes have failed to start: " + image_path);
+        }
+
+        _ring->free_slots.wait();
+
+        JobSlot *slot = nullptr;
+        for (std::size_t i = 0; (slot == nullptr) && (i < _ring->slots_number); i++) {
+            auto free_state_word = make_state_word(SLOT_STATE::FREE);
+            if (_ring->slots()[i].state_word.compare_exchange_strong(free_state_word,
+                                                                     make_state_word(SLOT_STATE::RESERVED))) {
+                slot = &_ring->slots()[i];
+            }
+        }
+        if (slot == nullptr) {
+            _ring->free_slots.post();
+            RAISE_ERROR(detection::ProcessingError, "job ring is inconsistent");
+        }
+
+        copy_message(slot->image_path, MAX_IMAGE_PATH_LENGTH, image_path);
+        slot->faces_number = 0;
+        slot->error_message[0] = '\0';
+        slot->attempts = 0;
+        slot->sequence = _ring->next_sequence++;
+        slot->state_word.store(make_state_word(SLOT_STATE::QUEUED));
+        _ring->queued_jobs.post();
+
+        // the supervisor also notifies the result of a worker which has died before its notification, a stale
+        // notification of the previous job in the slot is skipped by the state check
+        auto state = SLOT_STATE::QUEUED;
+        while (!is_finished(state)) {
+            slot->done.wait();
+            state = state_of(slot->state_word.load());
+        }
+        std::vector<cv::Rect> detections;
+        std::string error_message;
+        if (state == SLOT_STATE::DONE) {
+            for (std::uint32_t i = 0; i < slot->faces_number; i++) {
+                detections.emplace_back(slot->faces[i].x, slot->faces[i].y,
+                                        slot->faces[i].width, slot->faces[i].height);
+            }
+        } else {
+            error_message = slot->error_message;
+        }
+
+        slot->state_word.store(make_state_word(SLOT_STATE::FREE));
+        _ring->free_slots.post();
+
+        if (state != SLOT_STATE::DONE) {
+            RAISE_ERROR(detection::ProcessingError, image_path + " :: " + error_message);
+        }
+
+        return detections;
+    }
+
+
+    bool ProcessPool::is_failed() const noexcept {
+        return _failed;
+    }
+
+
+    std::vector<int> ProcessPool::worker_pids() const {
+        std::lock_guard lk{_worker_pids_mutex};
+        return _worker_pids;
+    }
+
+
+    int ProcessPool::spawn_worker() noexcept {
+        const auto executable_path = _worker_executable_path.string();
+        std::vector<char *> arguments{const_cast<char *>(executable_path.c_str()),
+                                      const_cast<char *>(_shared_memory_name.c_str()),
+                                      const_cast<char *>(_detector_description.c_str()),
+                                      nullptr};
+        pid_t pid = -1;
+        if (posix_spawn(&pid, executable_path.c_str(), nullptr, nullptr, arguments.data(), environ) != 0) {
+            return -1;
+        }
+        return pid;
+    }
+
+
+    int ProcessPool::start_worker() {
+        auto pid = spawn_worker();
+        if (pid > 0) {
+            _worker_pids.push_back(pid);
+        }
+
+        return pid;
+    }
+
+
+    void ProcessPool::fail_creation(const std::string &message) {
+        stop_workers();
+        ipc::shared_memory_object::remove(_shared_memory_name.c_str());
+        RAISE_ERROR(detection::CreationError, message);
+    }
+
+
+    void ProcessPool::supervise() {
+        std::uint32_t failed_starts = 0;
+        std::size_t pending_restarts = 0;
+        auto restart_time = std::chrono::steady_clock::now();
+        auto ready_workers = _ring->ready_workers.load();
+        while (!_stopping) {
+            std::this_thread::sleep_for(SUPERVISOR_PERIOD);
+            const auto now = std::chrono::steady_clock::now();
+
+            // a restarted worker which has created its detector ends the streak
+            if (_ring->ready_workers.load() != ready_workers) {
+                ready_workers = _ring->ready_workers.load();
+                failed_starts = 0;
+            }
+
+            for (auto it = _worker_pids.begin(); it != _worker_pids.end();) {
+                int status = 0;
+                if (waitpid(*it, &status, WNOHANG) != *it) {
+                    ++it;
+                    continue;
+                }
+
+                const auto dead_worker_pid = *it;
+                {
+                    std::lock_guard lk{_worker_pids_mutex};
+                    it = _worker_pids.erase(it);
+                }
+                // a death in the middle of an image is bounded by the attempts of the image
+                if (recover_jobs_of(dead_worker_pid) == 0) {
+                    failed_starts++;
+                }
+
+                // the worker may have consumed a queued job notification before claiming a slot
+                _ring->queued_jobs.post();
+
+                pending_restarts++;
+                restart_time = now + restart_delay(failed_starts);
+            }
+
+            if (failed_starts >= MAX_FAILED_WORKER_STARTS) {
+                _failed = true;
+            }
+            if (_failed) {
+                // also the images queued by a run() which has checked the state just before
+                fail_queued_jobs("worker processes have failed to start " + std::to_string(failed_starts) +
+                                 " times in a row");
+                continue;
+            }
+
+            while ((pending_restarts > 0) && (now >= restart_time)) {
+                auto pid = spawn_worker();
+                if (pid < 0) {
+                    failed_starts++;
+                    restart_time = now + restart_delay(failed_starts);
+                    break;
+                }
+                std::lock_guard lk{_worker_pids_mutex};
+                _worker_pids.push_back(pid);
+                pending_restarts--;
+            }
+        }
+    }
+
+
+    std::size_t ProcessPool::recover_jobs_of(int worker_pid) {
+        std::size_t jobs_number = 0;
+        for (std::size_t i = 0; i < _ring->slots_number; i++) {
+            auto &slot = _ring->slots()[i];
+            auto state_word = slot.state_word.load();
+            if (pid_of(state_word) != worker_pid) {
+                continue;
+            }
+
+            jobs_number++;
+            if (is_finished(state_of(state_word))) {
+                // the worker may have died before notifying its result
+                slot.done.post();
+                continue;
+            }
+
+            slot.attempts++;
+            if (slot.attempts >= MAX_JOB_ATTEMPTS) {
+                copy_message(slot.error_message, MAX_ERROR_MESSAGE_LENGTH,
+                             "worker process crashed " + std::to_string(slot.attempts) + " times on the image");
+                slot.state_word.store(make_state_word(SLOT_STATE::FAILED));
+                slot.done.post();
+            } else {
+                slot.state_word.store(make_state_word(SLOT_STATE::QUEUED));
+                _ring->queued_jobs.post();
+            }
+        }
+        return jobs_number;
+    }
+
+
+    void ProcessPool::fail_queued_jobs(const std::string &message) {
+        for (std::size_t i = 0; i < _ring->slots_number; i++) {
+            auto &slot = _ring->slots()[i];
+            // taken over from the workers, which may still claim it
+            auto queued_state_word = make_state_word(SLOT_STATE::QUEUED);
+            if (!slot.state_word.compare_exchange_strong(queued_state_word, make_state_word(SLOT_STATE::RESERVED))) {
+                continue;
+            }
+
+            copy_message(slot.error_message, MAX_ERROR_MESSAGE_LENGTH, message);
+            slot.state_word.store(make_state_word(SLOT_STATE::FAILED));
+            slot.done.post();
+        }
+    }
+
+
+    void ProcessPool::stop_workers() noexcept {
+        _ring->stopping = true;
+        for (std::size_t i = 0; i < _worker_pids.size(); i++) {
+            _ring->queued_jobs.post();
+        }
+
+        const auto stop_deadline = std::chrono::steady_clock::now() + WORKER_STOP_TIMEOUT;
+        for (auto pid: _worker_pids) {
+            int status = 0;
+            auto wait_result = waitpid(pid, &status, WNOHANG);
+            while ((wait_result == 0) && (std::chrono::steady_clock::now() < stop_deadline)) {
+                std::this_thread::sleep_for(SUPERVISOR_PERIOD);
+                wait_result = waitpid(pid, &status, WNOHANG);
+            }
+            if (wait_result == 0) {
+                kill(pid, SIGKILL);
+                waitpid(pid, &status, 0);
+            }
+        }
+        _worker_pids.clear();
+    }
+
+} // namespace processing
+
+#else
+
+namespace processing {
+
+    struct SharedJobRing {
+    };
+
+
+    bool is_process_pool_supported() noexcept {
+        return false;
+    }
+
+
+    int run_worker_process(const std::string &shared_memory_name, const std::string &detector_description) noexcept {
+        return EXIT_FAILURE;
+    }
+
+
+    ProcessPool::ProcessPool(std::size_t workers_number, const boost::property_tree::ptree &detector_settings,
+                             std::filesystem::path worker_executable_path)
+            : _worker_executable_path{std::move(worker_executable_path)}, _workers_number{workers_number} {
+        RAISE_ERROR(detection::CreationError, "worker processes are not supported on this platform");
+    }
+
+
+    ProcessPool::~ProcessPool() = default;
+
+
+    std::vector<cv::Rect> ProcessPool::run(const std::string &image_path) {
+        RAISE_ERROR(detection::ProcessingError, "worker processes are not supported on this platform");
+    }
+
+
+    bool ProcessPool::is_failed() const noexcept {
+        return true;
+    }
+
+
+    std::vector<int> ProcessPool::worker_pids() const {
+        return {};
+    }
+
+} // namespace processing
+
+#endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <atomic>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace processing {
+
+    struct SharedJobRing;
+
+
+    bool is_process_pool_supported() noexcept;
+
+
+    // DETECTION_WORKER_PATH if set, otherwise the detection_worker next to the running executable, or in the
+    // build output directory
+    std::filesystem::path default_worker_executable_path();
+
+
+    // the main of the detection_worker executable: attaches to the job ring of a pool and detects its images
+    // until the pool stops, returns the exit code
+    int run_worker_process(const std::string &shared_memory_name, const std::string &detector_description) noexcept;
+
+
+    // Runs detection in worker processes spawned from the detection_worker executable, so a worker never starts
+    // as a fork of the host with its threads and their held locks. Jobs are passed through a ring of slots in
+    // named shared memory, so a crash inside a decoder or a detector kills only one worker: the supervisor
+    // restarts it and puts its in-flight image back into the ring, giving up after MAX_JOB_ATTEMPTS, or delivers
+    // the result the worker has written just before its death. A worker dying without an image in hand, e.g. on
+    // a detector which can't be created anymore, is restarted after a growing delay; after
+    // MAX_FAILED_WORKER_STARTS such deaths in a row the pool is failed.
+    class ProcessPool {
+    public:
+        static constexpr std::uint32_t MAX_JOB_ATTEMPTS{3};
+        static constexpr std::uint32_t MAX_FAILED_WORKER_STARTS{5};
+
+        // throws detection::CreationError if a worker can't be started or can't create its detector
+        ProcessPool(std::size_t workers_number, const boost::property_tree::ptree &detector_settings,
+                    std::filesystem::path worker_executable_path = default_worker_executable_path());
+
+        ~ProcessPool();
+
+        ProcessPool(const ProcessPool &) = delete;
+
+        ProcessPool &operator=(const ProcessPool &) = delete;
+
+        // blocks the calling thread until a worker process returns the detections for the image,
+        // throws detection::ProcessingError if the image can't be processed
+        std::vector<cv::Rect> run(const std::string &image_path);
+
+        // the workers aren't restarted anymore, every image fails
+        bool is_failed() const noexcept;
+
+        // the running worker processes, e.g. for the monitoring
+        std::vector<int> worker_pids() const;
+
+    private:
+        const std::filesystem::path _worker_executable_path;
+        const std::string _detector_description;
+        std::size_t _workers_number;
+
+        std::string _shared_memory_name;
+        std::unique_ptr<boost::interprocess::mapped_region> _shared_memory;
+        SharedJobRing *_ring{nullptr};
+
+        // changed by the supervisor only once the pool is created
+        mutable std::mutex _worker_pids_mutex;
+        std::vector<int> _worker_pids;
+        std::atomic<bool> _stopping{false};
+        std::atomic<bool> _failed{false};
+        std::thread _supervisor;
+
+        // returns the pid of the started worker, or -1
+        int spawn_worker() noexcept;
+
+        int start_worker();
+
+        // gives up the workers started so far and the shared memory, then throws detection::CreationError
+        [[noreturn]] void fail_creation(const std::string &message);
+
+        void supervise();
+
+        // returns the number of the jobs the worker has had in hand
+        std::size_t recover_jobs_of(int worker_pid);
+
+        void fail_queued_jobs(const std::string &message);
+
+        void stop_workers() noexcept;
+    };
+
+} // namespace processing
\ No newline at end of file
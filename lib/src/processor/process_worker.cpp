@@ -0,0 +1,13 @@
+#include "process_pool.hpp"
+
+#include <cstdlib>
+
+
+// detection_worker <shared memory name> <detector description json>, spawned by a ProcessPool
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        return EXIT_FAILURE;
+    }
+
+    return processing::run_worker_process(argv[1], argv[2]);
+}
\ No newline at end of file
@@ -4,115 +4,150 @@
 
 #include <boost/property_tree/json_parser.hpp>
 
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
 #include <set>
+#include <utility>
 
 
-// TODO: add logging
-
 namespace {
 
-    template<typename DataType, std::size_t MAX_POOL_SIZE>
-    class TaskQueue {
-    public:
-
-        enum class TASK_TYPE : std::uint8_t {
-            PROCESS = 1,
-            STOP = 2
-        };
+    // how long the head of a class may wait before it is served ahead of the higher classes
+    const std::array<std::chrono::milliseconds, processing::Scheduler::PRIORITY_CLASSES_NUMBER> AGING_LIMITS{
+            std::chrono::milliseconds(0),     // PRIORITY_INTERACTIVE, the highest class is never promoted
+            std::chrono::milliseconds(500),   // PRIORITY_NORMAL
+            std::chrono::milliseconds(2000)   // PRIORITY_BACKFILL
+    };
 
-        struct Task {
-            TASK_TYPE type;
-            DataType data;
+    const std::set<std::string> IMAGE_EXTENSIONS{".jpg", ".bmp", ".jpeg"};
 
-            operator bool() const {
-                return type != TASK_TYPE::STOP;
-            }
-        };
 
-        explicit TaskQueue() : _has_task{false}, _opened{true} {
+    // std::clock() is the cpu time of the whole process on POSIX, elsewhere it is the wall time
+    // and the cpu saturation is never reported
+    double cpu_utilization(std::clock_t cpu_time, processing::Clock::duration wall_time) {
+        const auto threads_number = std::max(std::thread::hardware_concurrency(), 1U);
+        const auto wall_seconds = std::chrono::duration<double>(wall_time).count();
+        if (wall_seconds <= 0) {
+            return 0;
         }
+        return std::clamp(static_cast<double>(cpu_time) / CLOCKS_PER_SEC / wall_seconds / threads_number, 0.0, 1.0);
+    }
 
-        ~TaskQueue() {
-            close();
-        }
 
-        void add(DataType &&data) {
-            if (!_opened) {
-                _task_conditional_variable.notify_all();
-                return; // TODO: throw exception
-            }
+    std::chrono::microseconds elapsed_since(processing::Clock::time_point start_time) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(processing::Clock::now() - start_time);
+    }
 
-            std::lock_guard<std::mutex> rw_lock{_rw_mutex};
 
-            if (_awaiting_data_pool.size() >= MAX_POOL_SIZE) {
-                return; // TODO: add waiting until queue become smaller
-            }
+    // closes a pipeline stage in the stats and the trace, returns the stage end as the next stage start
+    processing::Clock::time_point finish_stage(processing::StatsShard &stats, processing::Stage stage, const char *name,
+                                               processing::Clock::time_point start_time) {
+        const auto end_time = processing::Clock::now();
+        stats.record(stage, std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time));
+        tracing::complete(name, start_time, end_time);
+        return end_time;
+    }
 
-            _awaiting_data_pool.emplace_back(std::move(data));
 
-            _has_task = true;
-            _task_conditional_variable.notify_one();
+    bool read_file(const std::string &file_path, std::vector<uchar> &data) {
+        std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+        if (!file) {
+            return false;
         }
 
-        Task wait_for_task() {
-            std::unique_lock rw_lock{_rw_mutex};
-
-            _task_conditional_variable.wait(rw_lock, [this] {
-                return (_has_task || !_opened);
-            });
-
-            if (_has_task && !_awaiting_data_pool.empty()) {
-                auto front_item = _awaiting_data_pool.front();
-                _awaiting_data_pool.pop_front();
-
-                if (!_awaiting_data_pool.empty()) {
-                    _has_task = true;
-                } else {
-                    _has_task = false;
-                }
+        const auto size = file.tellg();
+        if (size <= 0) {
+            return false;
+        }
+        data.resize(static_cast<std::size_t>(size));
+        file.seekg(0);
+        return static_cast<bool>(file.read(reinterpret_cast<char *>(data.data()), size));
+    }
 
-                _task_conditional_variable.notify_one();
-                return Task{TASK_TYPE::PROCESS, front_item};
-            }
 
-            if (_opened) {
-                _has_task = false;
-            }
-            _task_conditional_variable.notify_one();
-            return Task{TASK_TYPE::STOP, DataType{}};
+    // records the read and decode stages or their failure, an empty image is a failure;
+    // the stage start time is moved to the end of the decoding
+    cv::Mat read_image(const std::string &image_path, processing::StatsShard &stats,
+                       processing::Clock::time_point &stage_start_time, std::size_t &file_size) {
+        std::vector<uchar> image_data;
+        if (!read_file(image_path, image_data)) {
+            stats.record_failure(processing::Failure::READ);
+            return {};
         }
+        file_size = image_data.size();
+        stats.bytes_read.fetch_add(image_data.size(), std::memory_order_relaxed);
+        stage_start_time = finish_stage(stats, processing::Stage::READ, "read", stage_start_time);
 
-        void close() {
-            _opened = false;
-            _task_conditional_variable.notify_all();
+        cv::Mat image;
+        try {
+            image = cv::imdecode(image_data, cv::IMREAD_COLOR);
+        } catch (...) {
+            // image stays empty
         }
+        if (image.empty()) {
+            stats.record_failure(processing::Failure::DECODE);
+            return {};
+        }
+        stage_start_time = finish_stage(stats, processing::Stage::DECODE, "decode", stage_start_time);
+        return image;
+    }
 
-    private:
-        std::mutex _rw_mutex;
-        std::condition_variable _task_conditional_variable;
-
-        std::atomic<bool> _has_task;
-        std::atomic<bool> _opened;
-
-        std::list<DataType> _awaiting_data_pool;
-    };
 
-}
+    // the faces in DETECTION_FULL, only their number in the other modes; returns the index of the image's route
+    std::size_t detect_faces(detection::Detector &detector, const cv::Mat &image,
+                             const detection::ImageSource &source, DETECTION_MODE mode,
+                             processing::ImageResult &result) {
+        const auto &route_names = detector.route_names();
+        std::size_t route_index = 0;
+        if (!route_names.empty()) {
+            route_index = detector.route_index(image, source);
+            result.route = route_names[route_index];
+        }
+        if (mode == DETECTION_MODE::DETECTION_FULL) {
+            result.faces = detector.detect(image, source);
+            result.faces_number = result.faces.size();
+        } else {
+            result.faces_number = detector.count(image, (mode == DETECTION_MODE::DETECTION_COUNT)
+                                                        ? detection::Mode::COUNT : detection::Mode::PRESENCE,
+                                                 source);
+        }
+        return route_index;
+    }
 
 
-namespace processing {
+    // the per route stats of the router detectors, by the stats indexes of the detector's routes
+    void record_route(processing::StatsShard &stats, const std::vector<std::size_t> &route_stats_indexes,
+                      std::size_t route_index, const processing::ImageResult &result,
+                      processing::Clock::duration detect_time) noexcept {
+        if (route_index < route_stats_indexes.size()) {
+            stats.record_route(route_stats_indexes[route_index],
+                               std::chrono::duration_cast<std::chrono::microseconds>(detect_time),
+                               result.faces_number);
+        }
+    }
 
-    RESULT_CODE Processor::init(const InitConfig &config) noexcept {
 
-        if ((config.workers_number < 1) || (config.workers_number > _MAX_WORKER_COUNT)) {
-            return RESULT_CODE::INIT_INCORRECT_WORKER_NUMBER;
+    // for the faces detected in full elsewhere
+    void reduce_to_mode(DETECTION_MODE mode, processing::ImageResult &result) {
+        result.faces_number = result.faces.size();
+        if (mode == DETECTION_MODE::DETECTION_FULL) {
+            return;
+        }
+        if (mode == DETECTION_MODE::DETECTION_PRESENCE) {
+            result.faces_number = std::min<std::size_t>(result.faces_number, 1);
         }
+        result.faces.clear();
+    }
 
-        if (!std::filesystem::exists(config.detector_description_file_path)) {
+
+    RESULT_CODE read_detector_settings(const std::string &detector_description_file_path,
+                                       boost::property_tree::ptree &detector_settings) {
+        if (!std::filesystem::exists(detector_description_file_path)) {
             return RESULT_CODE::INIT_FILES_WAS_NOT_FOUND;
         }
 
-        std::ifstream file(config.detector_description_file_path);
+        std::ifstream file(detector_description_file_path);
         std::stringstream buffer;
         if (file) {
             buffer << file.rdbuf();
@@ -121,69 +156,972 @@ namespace processing {
             return RESULT_CODE::INIT_BAD_SETTINGS_FILE;
         }
 
-        boost::property_tree::ptree detector_settings;
         try {
             boost::property_tree::read_json(buffer, detector_settings);
         }
         catch (std::exception const &e) {
             return RESULT_CODE::INIT_BAD_SETTINGS_FILE;
         }
+        return RESULT_CODE::INIT_SUCCESS;
+    }
+
+
+    std::string format_scaling_event(const processing::ScalingEvent &event) {
+        std::ostringstream oss;
+        oss << std::chrono::duration_cast<std::chrono::milliseconds>(event.time.time_since_epoch()).count()
+            << " ms: " << event.from_workers_number << " -> " << event.to_workers_number << " workers ("
+            << event.reason << "), queued " << event.sample.queued_tasks
+            << ", processed " << event.sample.processed_tasks
+            << ", busy " << event.sample.busy_time.count() << " us"
+            << ", queue wait " << event.sample.queue_wait.count() << " us"
+            << ", cpu " << std::fixed << std::setprecision(2) << event.sample.cpu_utilization;
+        return oss.str();
+    }
+
+}
+
+
+namespace processing {
+
+    Processor::Processor() : _scheduler{_MAX_QUEUED_TASKS_PER_CLASS, AGING_LIMITS} {
+    }
+
+
+    Processor::~Processor() {
+        {
+            std::lock_guard lk{_background_mutex};
+            _background_stopped = true;
+        }
+        _background_conditional_variable.notify_all();
+        if (_scaling_thread.joinable()) {
+            _scaling_thread.join();
+        }
+        if (_stats_export_thread.joinable()) {
+            _stats_export_thread.join();
+        }
+
+        {
+            std::lock_guard lk{_walkers_mutex};
+            for (auto &walker: _walkers) {
+                if (auto job = walker.job.lock()) {
+                    job->cancel();
+                }
+                walker.thread.join();
+            }
+            _walkers.clear();
+        }
+
+        _scheduler.close();
+        std::lock_guard lk{_workers_mutex};
+        for (auto &worker: _workers) {
+            worker.thread.join();
+        }
+    }
+
+
+    RESULT_CODE Processor::init(const InitConfig &config) noexcept {
+        if (_workers_number != 0) {
+            return RESULT_CODE::INIT_DOUBLE_INITIALIZATION;
+        }
+
+        const auto init_start_time = Clock::now();
+        auto workers_number = config.workers_number;
+        if (config.autoscaling) {
+            const auto &autoscaling = config.autoscaling.value();
+            if ((autoscaling.min_workers_number < 1) ||
+                (autoscaling.min_workers_number > autoscaling.max_workers_number) ||
+                (autoscaling.max_workers_number > _MAX_WORKER_COUNT) || (autoscaling.period.count() <= 0)) {
+                return RESULT_CODE::INIT_INCORRECT_WORKER_NUMBER;
+            }
+            if (config.execution_mode != EXECUTION_MODE::EXECUTION_THREADS) {
+                return RESULT_CODE::INIT_UNSUPPORTED_EXECUTION_MODE;
+            }
+            workers_number = std::clamp(workers_number, autoscaling.min_workers_number,
+                                        autoscaling.max_workers_number);
+        }
+
+        if ((workers_number < 1) || (workers_number > _MAX_WORKER_COUNT)) {
+            return RESULT_CODE::INIT_INCORRECT_WORKER_NUMBER;
+        }
+
+        if (config.detector_pool && (config.execution_mode != EXECUTION_MODE::EXECUTION_THREADS)) {
+            return RESULT_CODE::INIT_UNSUPPORTED_EXECUTION_MODE;
+        }
+
+        boost::property_tree::ptree detector_settings;
+        if (!config.detector_pool) {
+            const auto read_result = read_detector_settings(config.detector_description_file_path,
+                                                            detector_settings);
+            if (read_result != RESULT_CODE::INIT_SUCCESS) {
+                return read_result;
+            }
+        }
+
+        std::lock_guard lk{_workers_mutex};
+        if (config.worker_budget && !config.worker_budget->try_acquire(workers_number)) {
+            return RESULT_CODE::INIT_INCORRECT_WORKER_NUMBER;
+        }
+        // the slots are returned by the workers, or right here if the init fails
+        const auto release_budget = [&config, workers_number]() {
+            if (config.worker_budget) {
+                config.worker_budget->release(workers_number);
+            }
+        };
+
+        if (config.execution_mode == EXECUTION_MODE::EXECUTION_PROCESSES) {
+            if (!is_process_pool_supported()) {
+                release_budget();
+                return RESULT_CODE::INIT_UNSUPPORTED_EXECUTION_MODE;
+            }
 
-        for (int i = 0; i < config.workers_number; i++) {
             try {
-                _detectors_pool.emplace_back(detection::create_detector(detector_settings));
+                _process_pool = std::make_unique<ProcessPool>(workers_number, detector_settings);
             } catch (...) {
-                _detectors_pool.clear();
+                release_budget();
                 return RESULT_CODE::INIT_BAD_DATA_FILE;
             }
+
+            _worker_budget = config.worker_budget;
+            _config_version = 1;
+            _workers_number = workers_number;
+            for (std::size_t i = 0; i < _workers_number; i++) {
+                start_worker(nullptr, nullptr);
+            }
+            _stats.record_ready(elapsed_since(init_start_time), std::chrono::microseconds(0));
+            return RESULT_CODE::INIT_SUCCESS;
+        }
+
+        // the initial detectors are built right away, so a bad model fails init() instead of a later scaling,
+        // and warmed up before the workers start, so the first images don't pay for the lazy allocations
+        auto detector_pool = config.detector_pool ? config.detector_pool
+                                                  : std::make_shared<DetectorPool>(detector_settings, 1,
+                                                                                   config.warmup_image_sizes);
+        const auto warmup_start_duration = detector_pool->warmup_duration();
+        std::vector<std::unique_ptr<detection::Detector>> detectors;
+        try {
+            tracing::Scope scope{"create_detectors"};
+            detectors = detector_pool->acquire(workers_number);
+        } catch (...) {
+            release_budget();
+            return RESULT_CODE::INIT_BAD_DATA_FILE;
+        }
+
+        {
+            std::lock_guard pool_lk{_detector_pool_mutex};
+            _detector_pool = detector_pool;
+            _config_version = detector_pool->version();
+        }
+        _worker_budget = config.worker_budget;
+        _workers_number = workers_number;
+        _autoscaling = config.autoscaling;
+        for (auto &detector: detectors) {
+            start_worker(detector_pool, std::move(detector));
+        }
+
+        if (_autoscaling) {
+            _scaling_thread = std::thread([this]() { run_scaling(); });
         }
+        _stats.record_ready(elapsed_since(init_start_time), detector_pool->warmup_duration() - warmup_start_duration);
+        return RESULT_CODE::INIT_SUCCESS;
+    }
+
+
+    RESULT_CODE Processor::reload(const std::string &detector_description_file_path) noexcept {
+        if (_workers_number == 0) {
+            return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+        }
+
+        if (_process_pool) {
+            return RESULT_CODE::INIT_UNSUPPORTED_EXECUTION_MODE;
+        }
+
+        boost::property_tree::ptree detector_settings;
+        const auto read_result = read_detector_settings(detector_description_file_path, detector_settings);
+        if (read_result != RESULT_CODE::INIT_SUCCESS) {
+            return read_result;
+        }
+
+        std::lock_guard reload_lk{_reload_mutex};
+        tracing::Scope scope{"reload", detector_description_file_path};
+        try {
+            auto detector_pool = std::make_shared<DetectorPool>(detector_settings, _config_version.load() + 1,
+                                                                current_detector_pool()->warmup_image_sizes());
+
+            // a detector for every active worker is built before the swap, so the workers switch without waiting
+            // for a model loading, and a bad model fails the reload while the old description is still served
+            auto detectors = detector_pool->acquire(std::max<std::size_t>(_active_workers_number.load(), 1));
+            for (auto &detector: detectors) {
+                detector_pool->park(std::move(detector));
+            }
 
+            std::lock_guard pool_lk{_detector_pool_mutex};
+            _detector_pool = detector_pool;
+            _config_version = detector_pool->version();
+        } catch (...) {
+            return RESULT_CODE::INIT_BAD_DATA_FILE;
+        }
         return RESULT_CODE::INIT_SUCCESS;
     }
 
 
+    std::uint64_t Processor::config_version() const {
+        return _config_version.load();
+    }
+
+
+    std::shared_ptr<DetectorPool> Processor::detector_pool() const {
+        return current_detector_pool();
+    }
+
+
     RESULT_CODE
     Processor::process(const std::string &path_to_image_folder, NotificationCallback &&notification) noexcept {
-        std::set<std::string> extensions{".jpg", ".bmp", ".jpeg"};
+        return process(path_to_image_folder, ShardConfig{}, std::move(notification));
+    }
+
+
+    RESULT_CODE Processor::process(const std::string &path_to_image_folder, const ShardConfig &shard,
+                                   NotificationCallback &&notification) noexcept {
+        ProcessOptions options;
+        options.shard = shard;
+        return process(path_to_image_folder, options, [notification](const ImageResult &result) {
+            notification(result.image_path, result.faces);
+        });
+    }
+
+
+    RESULT_CODE Processor::process(const std::string &path_to_image, const ProcessOptions &options,
+                                   ResultCallback &&callback) noexcept {
+        std::shared_ptr<Job> job;
+        auto start_result = start(path_to_image, options, std::move(callback), job);
+        if (start_result != RESULT_CODE::PROCESS_SUCCESS) {
+            return start_result;
+        }
+
+        return job->wait();
+    }
+
+
+    RESULT_CODE Processor::start(const std::string &path_to_image, const ProcessOptions &options,
+                                 ResultCallback &&callback, std::shared_ptr<Job> &job) noexcept {
+        auto validation_result = validate(options);
+        if (validation_result != RESULT_CODE::PROCESS_SUCCESS) {
+            return validation_result;
+        }
 
-        if (!std::filesystem::exists(path_to_image_folder)) {
+        if (!std::filesystem::exists(path_to_image)) {
             return RESULT_CODE::PROCESS_IMAGE_FOLDER_IS_NOT_EXISTS;
         }
 
-        TaskQueue<std::string, 1000> paths_queue;
-        std::vector<std::thread> workers;
-        for (auto &detector: _detectors_pool) {
-            workers.emplace_back([&detector, notification, &paths_queue]() {
-                while (auto task = paths_queue.wait_for_task()) {
-                    try {
-                        auto img = cv::imread(task.data, cv::IMREAD_COLOR);
-                        if (!img.empty()) {
-                            auto detections = detector->detect(img);
-                            notification(task.data, detections);
+        // the worker processes keep failing to start, every image would fail
+        if (_process_pool && _process_pool->is_failed()) {
+            return RESULT_CODE::PROCESS_UNEXPECTED_ERROR;
+        }
+
+        return start_job(options, std::move(callback), job,
+                         [this, path_to_image, options](const std::shared_ptr<Job> &job) {
+                             walk(job, path_to_image, options);
+                         });
+    }
+
+
+    RESULT_CODE Processor::start(std::vector<cv::Mat> images, const ProcessOptions &options,
+                                 ResultCallback &&callback, std::shared_ptr<Job> &job) noexcept {
+        auto validation_result = validate(options);
+        if (validation_result != RESULT_CODE::PROCESS_SUCCESS) {
+            return validation_result;
+        }
+
+        if (_process_pool) {
+            return RESULT_CODE::PROCESS_INCORRECT_OPTIONS;
+        }
+
+        return start_job(options, std::move(callback), job,
+                         [this, images = std::move(images)](const std::shared_ptr<Job> &job) {
+                             feed(job, images);
+                         });
+    }
+
+
+    RESULT_CODE Processor::validate(const ProcessOptions &options) const noexcept {
+        if (_workers_number == 0) {
+            return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+        }
+
+        if (!is_valid_shard(options.shard)) {
+            return RESULT_CODE::PROCESS_INCORRECT_SHARD;
+        }
+
+        if ((static_cast<std::size_t>(options.priority) >= Scheduler::PRIORITY_CLASSES_NUMBER) ||
+            (options.deadline && (options.deadline->count() <= 0)) ||
+            (options.detection_mode < DETECTION_MODE::DETECTION_FULL) ||
+            (options.detection_mode > DETECTION_MODE::DETECTION_PRESENCE)) {
+            return RESULT_CODE::PROCESS_INCORRECT_OPTIONS;
+        }
+
+        if (options.sequence) {
+            const auto &sequence = options.sequence.value();
+            if (_process_pool || (sequence.keyframe_interval < 1) || (sequence.min_frames < 2) ||
+                !(sequence.scene_change_threshold >= 0) || !(sequence.search_margin >= 0) ||
+                !(sequence.min_match_score >= -1) || !(sequence.min_match_score <= 1)) {
+                return RESULT_CODE::PROCESS_INCORRECT_OPTIONS;
+            }
+        }
+
+        return RESULT_CODE::PROCESS_SUCCESS;
+    }
+
+
+    RESULT_CODE Processor::start_job(const ProcessOptions &options, ResultCallback &&callback,
+                                     std::shared_ptr<Job> &job,
+                                     std::function<void(const std::shared_ptr<Job> &job)> &&feed) noexcept {
+        try {
+            std::optional<Clock::time_point> deadline;
+            if (options.deadline) {
+                deadline = Clock::now() + options.deadline.value();
+            }
+            job = std::make_shared<Job>(_scheduler, std::move(callback), options.priority, deadline,
+                                        options.deadline_policy, options.detection_mode, options.feed_gate);
+
+            std::lock_guard lk{_walkers_mutex};
+            join_finished_walkers();
+            _walkers.emplace_back(Walker{std::thread([job, feed = std::move(feed)]() { feed(job); }), job});
+        } catch (...) {
+            job.reset();
+            return RESULT_CODE::PROCESS_UNEXPECTED_ERROR;
+        }
+
+        return RESULT_CODE::PROCESS_SUCCESS;
+    }
+
+
+    LatencyReport Processor::latency_report(PRIORITY_CLASS priority) const {
+        const auto &latencies = _latencies[static_cast<std::size_t>(priority)];
+        return LatencyReport{latencies.count(),
+                             _dropped_images[static_cast<std::size_t>(priority)].load(),
+                             _late_images[static_cast<std::size_t>(priority)].load(),
+                             std::chrono::microseconds(latencies.percentile(0.5)),
+                             std::chrono::microseconds(latencies.percentile(0.99)),
+                             std::chrono::microseconds(latencies.max())};
+    }
+
+
+    std::size_t Processor::active_workers_number() const {
+        return _active_workers_number.load();
+    }
+
+
+    std::vector<ScalingEvent> Processor::scaling_events() const {
+        std::lock_guard lk{_scaling_events_mutex};
+        return {_scaling_events.begin(), _scaling_events.end()};
+    }
+
+
+    const Stats &Processor::stats() const {
+        return _stats;
+    }
+
+
+    RESULT_CODE Processor::export_stats(const std::string &file_path, std::chrono::milliseconds period) noexcept {
+        if (file_path.empty() || (period.count() <= 0)) {
+            return RESULT_CODE::INCORRECT_PARAMETERS;
+        }
+
+        std::lock_guard lk{_background_mutex};
+        if (_stats_export_thread.joinable() || _background_stopped) {
+            return RESULT_CODE::INCORRECT_PARAMETERS;
+        }
+
+        try {
+            _stats_export_thread = std::thread([this, file_path, period]() { run_stats_export(file_path, period); });
+        } catch (...) {
+            return RESULT_CODE::UNEXPECTED_ERROR;
+        }
+        return RESULT_CODE::SUCCESS;
+    }
+
+
+    void Processor::walk(const std::shared_ptr<Job> &job, const std::filesystem::path &path_to_image,
+                         const ProcessOptions &options) {
+        tracing::set_thread_name("walker");
+
+        const auto enqueue = [this, &job](const std::filesystem::path &image_path,
+                                          std::shared_ptr<FolderCompletion> folder) {
+            job->wait_for_room();
+            job->on_discovered();
+            Task task{image_path.string(), job, Clock::time_point{}, cv::Mat{}, 0, std::move(folder)};
+            if (!_scheduler.push(std::move(task))) {
+                job->on_dropped();
+            }
+        };
+
+        // the completions of the folders on the current walk branch by depth, the walk is depth-first,
+        // so a folder is left for good once an entry of a shallower folder or of a sibling comes
+        std::vector<std::shared_ptr<FolderCompletion>> folders;
+
+        // with the sequences on, the images of the folders on the walk branch are held back until the folder
+        // is left, then the folder goes as one sequence task or as the tasks of its images
+        struct PendingFolder {
+            std::filesystem::path folder_path;
+            std::vector<std::filesystem::path> image_paths;
+            std::shared_ptr<FolderCompletion> completion;
+        };
+        std::vector<PendingFolder> pending_folders;
+        const auto flush_pending_folders = [this, &job, &options, &enqueue, &pending_folders](std::size_t depth) {
+            while (pending_folders.size() > depth) {
+                auto &pending_folder = pending_folders.back();
+                auto frame_paths = order_frames(pending_folder.image_paths, options.sequence->min_frames);
+                if (frame_paths.empty()) {
+                    for (const auto &image_path: pending_folder.image_paths) {
+                        enqueue(image_path, pending_folder.completion);
+                    }
+                } else {
+                    const auto frames_number = frame_paths.size();
+                    job->wait_for_room(frames_number);
+                    job->on_discovered(frames_number);
+                    Task task{pending_folder.folder_path.string(), job, Clock::time_point{}, cv::Mat{}, 0,
+                              std::move(pending_folder.completion),
+                              std::make_shared<const FrameSequence>(
+                                      FrameSequence{std::move(frame_paths), options.sequence.value()})};
+                    if (!_scheduler.push(std::move(task))) {
+                        job->on_dropped(frames_number);
+                    }
+                }
+                pending_folders.pop_back();
+            }
+        };
+
+        try {
+            // closed before finish_walk(), which may complete the job
+            const auto path_string = path_to_image.string();
+            tracing::Scope walk_scope{"walk", path_string};
+
+            if (std::filesystem::is_regular_file(path_to_image)) {
+                enqueue(path_to_image, nullptr);
+            } else {
+                for (auto itEntry = std::filesystem::recursive_directory_iterator(path_to_image);
+                     (itEntry != std::filesystem::recursive_directory_iterator()) && !job->is_cancelled();
+                     ++itEntry) {
+                    const auto depth = static_cast<std::size_t>(itEntry.depth());
+                    if (options.folder_callback) {
+                        folders.resize(depth + 1);
+                        if (folders[depth] &&
+                            (folders[depth]->folder_path() != itEntry->path().parent_path().string())) {
+                            folders[depth].reset();
+                        }
+                    }
+                    if (options.sequence) {
+                        const bool is_same_folder = (pending_folders.size() > depth) &&
+                                                    (pending_folders[depth].folder_path ==
+                                                     itEntry->path().parent_path());
+                        flush_pending_folders(is_same_folder ? depth + 1 : depth);
+                    }
+
+                    if (itEntry->is_regular_file()) {
+                        if (IMAGE_EXTENSIONS.count(itEntry->path().filename().extension().string()) &&
+                            is_path_in_shard(itEntry->path().lexically_relative(path_to_image), options.shard)) {
+                            if (options.folder_callback && !folders[depth]) {
+                                folders[depth] = std::make_shared<FolderCompletion>(
+                                        job, itEntry->path().parent_path().string(), options.folder_callback);
+                            }
+                            auto folder = options.folder_callback ? folders[depth] : nullptr;
+                            if (options.sequence) {
+                                pending_folders.resize(depth + 1);
+                                pending_folders[depth].folder_path = itEntry->path().parent_path();
+                                pending_folders[depth].image_paths.push_back(itEntry->path());
+                                pending_folders[depth].completion = std::move(folder);
+                            } else {
+                                enqueue(itEntry->path(), std::move(folder));
+                            }
                         }
-                    } catch (...) {
-                        continue; // pass
                     }
                 }
-            });
+                if (options.sequence && !job->is_cancelled()) {
+                    flush_pending_folders(0);
+                }
+            }
+        } catch (...) {
+            pending_folders.clear();
+            folders.clear();
+            job->finish_walk(false);
+            return;
+        }
+
+        // the folders left are completed by their last tasks
+        pending_folders.clear();
+        folders.clear();
+        job->finish_walk(true);
+    }
+
+
+    void Processor::feed(const std::shared_ptr<Job> &job, const std::vector<cv::Mat> &images) {
+        tracing::set_thread_name("walker");
+
+        for (std::size_t i = 0; (i < images.size()) && !job->is_cancelled(); i++) {
+            job->wait_for_room();
+            job->on_discovered();
+            if (!_scheduler.push(Task{std::string(), job, Clock::time_point{}, images[i], i})) {
+                job->on_dropped();
+            }
+        }
+        job->finish_walk(true);
+    }
+
+
+    void Processor::join_finished_walkers() {
+        for (auto it = _walkers.begin(); it != _walkers.end();) {
+            auto job = it->job.lock();
+            if (!job || job->is_walk_finished()) {
+                it->thread.join();
+                it = _walkers.erase(it);
+            } else {
+                ++it;
+            }
         }
+    }
+
+
+    std::shared_ptr<DetectorPool> Processor::current_detector_pool() const {
+        std::lock_guard lk{_detector_pool_mutex};
+        return _detector_pool;
+    }
+
 
-        for (auto itEntry = std::filesystem::recursive_directory_iterator(path_to_image_folder);
-             itEntry != std::filesystem::recursive_directory_iterator();
-             ++itEntry) {
-            if (itEntry->is_regular_file()) {
-                if (extensions.count(itEntry->path().filename().extension().string())) {
-                    paths_queue.add(itEntry->path().string());
+    void Processor::start_worker(std::shared_ptr<DetectorPool> pool, std::unique_ptr<detection::Detector> detector) {
+        _active_workers_number++;
+        _target_workers_number = std::max(_target_workers_number.load(), _active_workers_number.load());
+        auto &worker = _workers.emplace_back();
+        worker.thread = std::thread([this, &worker, pool = std::move(pool), detector = std::move(detector)]() mutable {
+            run_worker(worker, std::move(pool), std::move(detector));
+        });
+    }
+
+
+    void Processor::run_worker(Worker &worker, std::shared_ptr<DetectorPool> pool,
+                               std::unique_ptr<detection::Detector> detector) {
+        tracing::set_thread_name("worker");
+        auto &stats = _stats.acquire_shard();
+        auto route_stats_indexes = resolve_routes(detector.get());
+        while (!retire_surplus_worker()) {
+            // without autoscaling nobody retires, so the worker may sleep until a task or the close
+            auto task = _autoscaling ? _scheduler.pop(_autoscaling->period) : _scheduler.pop();
+            if (task) {
+                const auto *previous_detector = detector.get();
+                refresh_detector(pool, detector);
+                if (detector.get() != previous_detector) {
+                    route_stats_indexes = resolve_routes(detector.get());
+                }
+                const auto config_version = pool ? pool->version() : _config_version.load();
+                if (task->sequence) {
+                    process_sequence(task.value(), detector.get(), route_stats_indexes, config_version, stats);
+                } else {
+                    process_task(task.value(), detector.get(), route_stats_indexes, config_version, stats);
                 }
+            } else if (_scheduler.is_closed()) {
+                break;
             }
         }
-        paths_queue.close();
 
-        for (auto &worker: workers) {
-            worker.join();
+        // an outdated pool is freed with its parked detectors once its last worker has switched or retired
+        if (pool) {
+            pool->park(std::move(detector));
         }
+        if (_worker_budget) {
+            _worker_budget->release();
+        }
+        _stats.release_shard(stats);
+        worker.finished = true;
+    }
 
-        return RESULT_CODE::PROCESS_SUCCESS;
+
+    void Processor::refresh_detector(std::shared_ptr<DetectorPool> &pool,
+                                     std::unique_ptr<detection::Detector> &detector) {
+        if (!pool || (pool->version() == _config_version.load())) {
+            return;
+        }
+
+        auto current_pool = current_detector_pool();
+        try {
+            auto current_detector = current_pool->acquire();
+            // the outdated detector is freed right away instead of being parked in its outdated pool
+            detector = std::move(current_detector);
+            pool = std::move(current_pool);
+        } catch (...) {
+            // the reload has built a detector for every worker, so this is a resources shortage,
+            // the worker goes on with the old description and retries before its next image
+        }
+    }
+
+
+    bool Processor::retire_surplus_worker() {
+        auto active_workers_number = _active_workers_number.load();
+        while (active_workers_number > _target_workers_number.load()) {
+            if (_active_workers_number.compare_exchange_weak(active_workers_number, active_workers_number - 1)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    void Processor::run_scaling() {
+        tracing::set_thread_name("autoscaler");
+        const auto &config = _autoscaling.value();
+        Autoscaler autoscaler{config};
+        std::ofstream log_file;
+        if (!config.log_file_path.empty()) {
+            log_file.open(config.log_file_path, std::ios::out | std::ios::app);
+        }
+
+        auto sample_time = Clock::now();
+        auto sample_cpu_time = std::clock();
+        std::string last_reason;
+
+        while (!wait_background_period(config.period)) {
+            const auto now = Clock::now();
+            const auto cpu_time = std::clock();
+
+            ScalingSample sample{_active_workers_number.load(),
+                                 _scheduler.queued_tasks(),
+                                 _processed_tasks.exchange(0),
+                                 std::chrono::microseconds(_busy_time_us.exchange(0)),
+                                 std::chrono::microseconds(_queue_wait_us.exchange(0)),
+                                 std::chrono::duration_cast<std::chrono::microseconds>(now - sample_time),
+                                 cpu_utilization(cpu_time - sample_cpu_time, now - sample_time)};
+            sample_time = now;
+            sample_cpu_time = cpu_time;
+
+            const auto decision = autoscaler.decide(sample);
+            if (decision.workers_number != sample.workers_number) {
+                scale(decision.workers_number);
+            }
+
+            // the unchanged steady state isn't logged, a repeated hold reason is logged once
+            if ((decision.workers_number != sample.workers_number) || (last_reason != decision.reason)) {
+                last_reason = decision.reason;
+                if ((decision.workers_number == sample.workers_number) && (last_reason == "steady")) {
+                    continue;
+                }
+
+                ScalingEvent event{now, sample.workers_number, decision.workers_number, decision.reason, sample};
+                if (log_file) {
+                    log_file << format_scaling_event(event) << std::endl;
+                }
+
+                std::lock_guard events_lk{_scaling_events_mutex};
+                _scaling_events.emplace_back(std::move(event));
+                if (_scaling_events.size() > _MAX_SCALING_EVENTS) {
+                    _scaling_events.pop_front();
+                }
+            }
+        }
+    }
+
+
+    bool Processor::wait_background_period(std::chrono::milliseconds period) {
+        std::unique_lock lk{_background_mutex};
+        return _background_conditional_variable.wait_for(lk, period, [this] { return _background_stopped; });
+    }
+
+
+    void Processor::run_stats_export(const std::string &file_path, std::chrono::milliseconds period) {
+        // the file is replaced by a rename, so a scraper never reads a half written file
+        const auto temporary_file_path = file_path + ".tmp";
+        bool stopped = false;
+        while (!stopped) {
+            stopped = wait_background_period(period);
+
+            std::ofstream file(temporary_file_path, std::ios::out | std::ios::trunc);
+            if (!file) {
+                continue;
+            }
+            file << _stats.to_prometheus();
+            file.close();
+
+            std::error_code error;
+            std::filesystem::rename(temporary_file_path, file_path, error);
+        }
+    }
+
+
+    void Processor::scale(std::size_t workers_number) {
+        std::lock_guard lk{_workers_mutex};
+        for (auto it = _workers.begin(); it != _workers.end();) {
+            if (it->finished) {
+                it->thread.join();
+                it = _workers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        // set before the workers are started, so none of them retires right away
+        _target_workers_number = workers_number;
+        while (_active_workers_number.load() < workers_number) {
+            if (_worker_budget && !_worker_budget->try_acquire()) {
+                // the other processors use the budget, the next sample retries
+                _target_workers_number = _active_workers_number.load();
+                return;
+            }
+
+            try {
+                auto detector_pool = current_detector_pool();
+                auto detector = detector_pool->acquire();
+                start_worker(std::move(detector_pool), std::move(detector));
+            } catch (...) {
+                // the model has been loaded at init(), so this is a resources shortage, the next sample retries
+                if (_worker_budget) {
+                    _worker_budget->release();
+                }
+                _target_workers_number = _active_workers_number.load();
+                return;
+            }
+        }
+    }
+
+
+    std::vector<std::size_t> Processor::resolve_routes(const detection::Detector *detector) {
+        std::vector<std::size_t> route_stats_indexes;
+        if (detector != nullptr) {
+            for (const auto &route_name: detector->route_names()) {
+                route_stats_indexes.push_back(_stats.route_index(route_name));
+            }
+        }
+        return route_stats_indexes;
+    }
+
+
+    bool Processor::drop_outdated_image(Job &job) noexcept {
+        if (job.is_cancelled()) {
+            _stats.record_dropped();
+            job.on_dropped();
+            return true;
+        }
+
+        if (job.is_expired() && (job.deadline_policy == DEADLINE_POLICY::DEADLINE_DROP)) {
+            _dropped_images[static_cast<std::size_t>(job.priority)]++;
+            _stats.record_dropped();
+            job.on_dropped();
+            return true;
+        }
+        return false;
+    }
+
+
+    void Processor::deliver(Job &job, ImageResult &result, Clock::time_point enqueue_time,
+                            Clock::time_point start_time, StatsShard &stats) {
+        const auto priority_class = static_cast<std::size_t>(job.priority);
+        _busy_time_us.fetch_add(static_cast<std::uint64_t>(elapsed_since(start_time).count()),
+                                std::memory_order_relaxed);
+        _processed_tasks.fetch_add(1, std::memory_order_relaxed);
+
+        result.deadline_exceeded = job.is_expired();
+        if (result.deadline_exceeded) {
+            _late_images[priority_class]++;
+        }
+
+        const auto callback_start_time = Clock::now();
+        try {
+            job.callback(result);
+        } catch (...) {
+            stats.record_failure(Failure::CALLBACK);
+        }
+        finish_stage(stats, Stage::CALLBACK, "callback", callback_start_time);
+        stats.images.fetch_add(1, std::memory_order_relaxed);
+        stats.faces.fetch_add(result.faces_number, std::memory_order_relaxed);
+
+        const auto latency = elapsed_since(enqueue_time);
+        _latencies[priority_class].record(static_cast<std::uint64_t>(latency.count()));
+        _stats.record_first_image(latency);
+        job.on_detected();
+    }
+
+
+    void Processor::park(Task &task, const detection::BusyError &error, StatsShard &stats) noexcept {
+        auto &job = *task.job;
+        task.is_retried = true;
+        const auto images_number = task.images_number();
+        try {
+            // shared, the scheduler takes the task out of it once the route is free
+            auto parked_task = std::make_shared<Task>(std::move(task));
+            auto requeue = [this, parked_task]() {
+                const auto parked_job = parked_task->job;
+                const auto parked_images_number = parked_task->images_number();
+                if (_scheduler.requeue(std::move(*parked_task))) {
+                    return true;
+                }
+                parked_job->on_dropped(parked_images_number);
+                return false;
+            };
+            if (!error.notify_when_free(std::function<bool()>{requeue})) {
+                // the route has got free meanwhile
+                requeue();
+            }
+        } catch (...) {
+            stats.record_failure(Failure::DETECT);
+            for (std::size_t i = 0; i < images_number; i++) {
+                job.on_failed();
+            }
+        }
+    }
+
+
+    void Processor::process_task(Task &task, detection::Detector *detector,
+                                 const std::vector<std::size_t> &route_stats_indexes, std::uint64_t config_version,
+                                 StatsShard &stats) {
+        auto &job = *task.job;
+        if (drop_outdated_image(job)) {
+            return;
+        }
+
+        tracing::Scope image_scope{"image", task.image_path};
+        const auto start_time = Clock::now();
+        const auto queue_wait = std::chrono::duration_cast<std::chrono::microseconds>(start_time - task.enqueue_time);
+        stats.record(Stage::QUEUE_WAIT, queue_wait);
+        _queue_wait_us.fetch_add(static_cast<std::uint64_t>(queue_wait.count()), std::memory_order_relaxed);
+
+        ImageResult result;
+        result.image_path = task.image_path;
+        result.image_index = task.image_index;
+        result.config_version = config_version;
+        if (!task.image.empty()) {
+            // an in-memory image, or a walked one decoded before its route was busy
+            if (!task.is_retried) {
+                job.on_decoded();
+            }
+            std::size_t route_index = 0;
+            try {
+                route_index = detect_faces(*detector, task.image,
+                                           detection::ImageSource{task.image_path, task.file_size},
+                                           job.detection_mode, result);
+            } catch (const detection::BusyError &error) {
+                park(task, error, stats);
+                return;
+            } catch (...) {
+                stats.record_failure(Failure::DETECT);
+                job.on_failed();
+                return;
+            }
+            const auto end_time = finish_stage(stats, Stage::DETECT, "detect", start_time);
+            record_route(stats, route_stats_indexes, route_index, result, end_time - start_time);
+        } else if (_process_pool) {
+            try {
+                result.faces = _process_pool->run(task.image_path);
+                reduce_to_mode(job.detection_mode, result);
+            } catch (...) {
+                stats.record_failure(Failure::DETECT);
+                job.on_failed();
+                return;
+            }
+            job.on_decoded();
+            finish_stage(stats, Stage::DETECT, "detect", start_time);
+        } else {
+            auto stage_start_time = start_time;
+            std::size_t file_size = 0;
+            const auto img = read_image(task.image_path, stats, stage_start_time, file_size);
+            if (img.empty()) {
+                job.on_failed();
+                return;
+            }
+            job.on_decoded();
+
+            std::size_t route_index = 0;
+            try {
+                route_index = detect_faces(*detector, img, detection::ImageSource{task.image_path, file_size},
+                                           job.detection_mode, result);
+            } catch (const detection::BusyError &error) {
+                task.image = img;
+                task.file_size = file_size;
+                park(task, error, stats);
+                return;
+            } catch (...) {
+                stats.record_failure(Failure::DETECT);
+                job.on_failed();
+                return;
+            }
+            const auto end_time = finish_stage(stats, Stage::DETECT, "detect", stage_start_time);
+            record_route(stats, route_stats_indexes, route_index, result, end_time - stage_start_time);
+        }
+        deliver(job, result, task.enqueue_time, start_time, stats);
+    }
+
+
+    void Processor::process_sequence(Task &task, detection::Detector *detector,
+                                     const std::vector<std::size_t> &route_stats_indexes,
+                                     std::uint64_t config_version, StatsShard &stats) {
+        auto &job = *task.job;
+        const auto &frame_paths = task.sequence->frame_paths;
+        tracing::Scope sequence_scope{"sequence", task.image_path};
+        const auto queue_wait = elapsed_since(task.enqueue_time);
+        stats.record(Stage::QUEUE_WAIT, queue_wait);
+        _queue_wait_us.fetch_add(static_cast<std::uint64_t>(queue_wait.count()), std::memory_order_relaxed);
+
+        // a sequence back from a busy route goes on with its tracker and the frame decoded already
+        if (!task.tracker) {
+            task.tracker = std::make_shared<SequenceTracker>(task.sequence->config);
+        }
+        auto &tracker = *task.tracker;
+        for (auto frame_index = task.first_frame; frame_index < frame_paths.size(); frame_index++) {
+            const auto &frame_path = frame_paths[frame_index];
+            auto frame = std::exchange(task.image, cv::Mat{});
+            auto file_size = std::exchange(task.file_size, 0);
+            if (drop_outdated_image(job)) {
+                continue;
+            }
+
+            tracing::Scope image_scope{"image", frame_path};
+            const auto start_time = Clock::now();
+            auto stage_start_time = start_time;
+            if (frame.empty()) {
+                frame = read_image(frame_path, stats, stage_start_time, file_size);
+                if (frame.empty()) {
+                    job.on_failed();
+                    continue;
+                }
+                job.on_decoded();
+            }
+
+            // the followed faces need the boxes, so the frames are detected in full and reduced to the mode
+            ImageResult result;
+            result.image_path = frame_path;
+            result.config_version = config_version;
+            auto frame_kind = FrameKind::KEYFRAME;
+            std::optional<double> drift;
+            std::size_t route_index = 0;
+            try {
+                frame_kind = tracker.track(frame, result.faces);
+                if (frame_kind != FrameKind::TRACKED) {
+                    route_index = detect_faces(*detector, frame, detection::ImageSource{frame_path, file_size},
+                                               DETECTION_MODE::DETECTION_FULL, result);
+                    drift = tracker.reset(result.faces);
+                }
+            } catch (const detection::BusyError &error) {
+                // the stopped tracker detects the frame again as a keyframe
+                task.image = frame;
+                task.file_size = file_size;
+                task.first_frame = frame_index;
+                park(task, error, stats);
+                return;
+            } catch (...) {
+                stats.record_failure(Failure::DETECT);
+                job.on_failed();
+                continue;
+            }
+            const auto end_time = finish_stage(stats, Stage::DETECT,
+                                               (frame_kind == FrameKind::TRACKED) ? "track" : "detect",
+                                               stage_start_time);
+            stats.record_frame(frame_kind,
+                               std::chrono::duration_cast<std::chrono::microseconds>(end_time - stage_start_time));
+            if (drift) {
+                stats.record_drift(drift.value());
+            }
+            if (frame_kind != FrameKind::TRACKED) {
+                record_route(stats, route_stats_indexes, route_index, result, end_time - stage_start_time);
+            }
+
+            reduce_to_mode(job.detection_mode, result);
+            deliver(job, result, task.enqueue_time, start_time, stats);
+        }
     }
 
 } // namespace processing
\ No newline at end of file
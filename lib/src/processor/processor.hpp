@@ -3,9 +3,27 @@
 #include "processor_wrapper/include/processor.h"
 
 #include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+#include "tracing/tracing.hpp"
 
+#include "autoscaler.hpp"
+#include "detector_pool.hpp"
+#include "histogram.hpp"
+#include "job.hpp"
+#include "process_pool.hpp"
+#include "scheduler.hpp"
+#include "sequence_tracker.hpp"
+#include "sharding.hpp"
+#include "stats.hpp"
+#include "worker_budget.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <thread>
 #include <vector>
 
@@ -15,6 +33,49 @@ namespace processing {
     struct InitConfig {
         std::size_t workers_number;
         std::string detector_description_file_path;
+        EXECUTION_MODE execution_mode{EXECUTION_MODE::EXECUTION_THREADS};
+        // the workers number is then only the initial one, it is clamped into the autoscaling bounds;
+        // supported by EXECUTION_THREADS only
+        std::optional<AutoscalingConfig> autoscaling;
+        // shared by the processors of the host process, every worker takes a slot, may be null
+        std::shared_ptr<WorkerBudget> worker_budget;
+        // the pool of another processor serving the same description, the description file path is ignored then;
+        // the workers of both processors park and take the loaded detectors there; EXECUTION_THREADS only
+        std::shared_ptr<DetectorPool> detector_pool;
+        // every new detector detects a synthetic image of each size before it serves, also on a reload or
+        // a scaling up; empty to skip the warm-up; ignored with a shared detector pool and by EXECUTION_PROCESSES
+        std::vector<cv::Size> warmup_image_sizes{{640, 480}};
+    };
+
+
+    struct ProcessOptions {
+        ShardConfig shard{};
+        PRIORITY_CLASS priority{PRIORITY_CLASS::PRIORITY_NORMAL};
+        // applies to every image of the submission, counted from the process() call
+        std::optional<std::chrono::milliseconds> deadline;
+        DEADLINE_POLICY deadline_policy{DEADLINE_POLICY::DEADLINE_DROP};
+        // the worker processes of EXECUTION_PROCESSES detect in full, only the result is reduced to the mode
+        DETECTION_MODE detection_mode{DETECTION_MODE::DETECTION_FULL};
+        // the walked folders of numbered frames are detected in full on the keyframes only, the faces are followed
+        // in between; every sequence goes to one worker in the frame order, the other folders are unaffected;
+        // supported by EXECUTION_THREADS only
+        std::optional<SequenceConfig> sequence;
+        // called once for every walked folder with images after the callbacks of all its images,
+        // on a worker or the walker thread; not called for a single image or the in-memory images
+        FolderCallback folder_callback;
+        // bounds the images queued but not taken by the consumer yet, the walk of the job pauses while it is full;
+        // the consumer lets the images of the taken results leave
+        std::shared_ptr<FeedGate> feed_gate;
+    };
+
+
+    struct LatencyReport {
+        std::uint64_t images_number;
+        std::uint64_t dropped_images_number; // not started before the deadline with DEADLINE_DROP
+        std::uint64_t late_images_number;    // delivered after the deadline
+        std::chrono::microseconds p50;
+        std::chrono::microseconds p99;
+        std::chrono::microseconds max;
     };
 
 
@@ -24,16 +85,175 @@ namespace processing {
 
     class Processor {
     public:
-        ~Processor() = default;
+        Processor();
+
+        ~Processor();
 
         RESULT_CODE init(const InitConfig &config) noexcept;
 
+        // builds the detectors of the new description while the workers go on with the current ones, then swaps
+        // the description in: a worker switches between two images, so the images in flight finish on the old
+        // detectors; the description versions start from 1 at init() and tag the results;
+        // supported by EXECUTION_THREADS only
+        RESULT_CODE reload(const std::string &detector_description_file_path) noexcept;
+
+        std::uint64_t config_version() const;
+
+        // the pool of the current description, to be shared with another processor
+        std::shared_ptr<DetectorPool> detector_pool() const;
+
         RESULT_CODE process(const std::string &path_to_image_folder, NotificationCallback &&notification) noexcept;
 
+        // processes only the images whose relative path hashes into the given shard
+        RESULT_CODE process(const std::string &path_to_image_folder, const ShardConfig &shard,
+                            NotificationCallback &&notification) noexcept;
+
+        // the path may also point to a single image, which is how interactive requests are submitted;
+        // process() calls from several threads share the workers according to their priority classes
+        RESULT_CODE process(const std::string &path_to_image, const ProcessOptions &options,
+                            ResultCallback &&callback) noexcept;
+
+        // the non-blocking process(): the folder is walked in the background and the returned job is used
+        // to poll the progress, cancel or wait for the result code
+        RESULT_CODE start(const std::string &path_to_image, const ProcessOptions &options,
+                          ResultCallback &&callback, std::shared_ptr<Job> &job) noexcept;
+
+        // start() for decoded images, which are detected in place without a copy and must stay valid until the job
+        // is completed; the results carry the image index instead of a path, the shard option is ignored;
+        // supported by EXECUTION_THREADS only
+        RESULT_CODE start(std::vector<cv::Mat> images, const ProcessOptions &options,
+                          ResultCallback &&callback, std::shared_ptr<Job> &job) noexcept;
+
+        // submission to completion latency of the images of a priority class since init()
+        LatencyReport latency_report(PRIORITY_CLASS priority) const;
+
+        std::size_t active_workers_number() const;
+
+        // the latest scaling decisions, oldest first
+        std::vector<ScalingEvent> scaling_events() const;
+
+        const Stats &stats() const;
+
+        // rewrites the file with the stats in Prometheus text format every period until the destruction
+        RESULT_CODE export_stats(const std::string &file_path, std::chrono::milliseconds period) noexcept;
+
     private:
         const std::size_t _MAX_WORKER_COUNT{10};
+        const std::size_t _MAX_QUEUED_TASKS_PER_CLASS{1000};
+
+        const std::size_t _MAX_SCALING_EVENTS{1000};
+
+        std::size_t _workers_number{0};
+        // the pool of the current description, the workers keep the pool of their detector until they switch
+        mutable std::mutex _detector_pool_mutex;
+        std::shared_ptr<DetectorPool> _detector_pool;
+        // checked by the workers before every image, the pool is taken under the lock only after a reload
+        std::atomic<std::uint64_t> _config_version{0};
+        std::mutex _reload_mutex;
+        std::shared_ptr<WorkerBudget> _worker_budget;
+        std::unique_ptr<ProcessPool> _process_pool;
+
+        Scheduler _scheduler;
+
+        struct Worker {
+            std::thread thread;
+            std::atomic<bool> finished{false};
+        };
+
+        std::mutex _workers_mutex;
+        std::list<Worker> _workers;
+        std::atomic<std::size_t> _active_workers_number{0};
+        // workers above the target retire after their current task
+        std::atomic<std::size_t> _target_workers_number{0};
+
+        std::optional<AutoscalingConfig> _autoscaling;
+        std::thread _scaling_thread;
+        std::thread _stats_export_thread;
+        // wakes the scaling and stats export threads at the destruction
+        std::mutex _background_mutex;
+        std::condition_variable _background_conditional_variable;
+        bool _background_stopped{false};
+        mutable std::mutex _scaling_events_mutex;
+        std::deque<ScalingEvent> _scaling_events;
+
+        Stats _stats;
+
+        // reset by every scaling sample
+        std::atomic<std::uint64_t> _processed_tasks{0};
+        std::atomic<std::uint64_t> _busy_time_us{0};
+        std::atomic<std::uint64_t> _queue_wait_us{0};
+
+        struct Walker {
+            std::thread thread;
+            std::weak_ptr<Job> job;
+        };
+
+        std::mutex _walkers_mutex;
+        std::list<Walker> _walkers;
+
+        std::array<Histogram, Scheduler::PRIORITY_CLASSES_NUMBER> _latencies;
+        std::array<std::atomic<std::uint64_t>, Scheduler::PRIORITY_CLASSES_NUMBER> _dropped_images{};
+        std::array<std::atomic<std::uint64_t>, Scheduler::PRIORITY_CLASSES_NUMBER> _late_images{};
+
+        RESULT_CODE validate(const ProcessOptions &options) const noexcept;
+
+        // runs the feeding of the new job's tasks on a walker thread
+        RESULT_CODE start_job(const ProcessOptions &options, ResultCallback &&callback, std::shared_ptr<Job> &job,
+                              std::function<void(const std::shared_ptr<Job> &job)> &&feed) noexcept;
+
+        void walk(const std::shared_ptr<Job> &job, const std::filesystem::path &path_to_image,
+                  const ProcessOptions &options);
+
+        void feed(const std::shared_ptr<Job> &job, const std::vector<cv::Mat> &images);
+
+        // expects _walkers_mutex to be locked
+        void join_finished_walkers();
+
+        std::shared_ptr<DetectorPool> current_detector_pool() const;
+
+        // expects _workers_mutex to be locked
+        void start_worker(std::shared_ptr<DetectorPool> pool, std::unique_ptr<detection::Detector> detector);
+
+        void run_worker(Worker &worker, std::shared_ptr<DetectorPool> pool,
+                        std::unique_ptr<detection::Detector> detector);
+
+        // takes a detector of the current description if the worker's one is outdated,
+        // keeps the outdated one if the new one can't be built
+        void refresh_detector(std::shared_ptr<DetectorPool> &pool, std::unique_ptr<detection::Detector> &detector);
+
+        bool retire_surplus_worker();
+
+        void run_scaling();
+
+        // returns true once the processor is being destroyed
+        bool wait_background_period(std::chrono::milliseconds period);
+
+        void run_stats_export(const std::string &file_path, std::chrono::milliseconds period);
+
+        // grows the workers set right away, a shrink is done by the workers themselves
+        void scale(std::size_t workers_number);
+
+        // the stats indexes of the routes of a detector, resolved once for every detector a worker takes
+        std::vector<std::size_t> resolve_routes(const detection::Detector *detector);
+
+        // drops the image of a cancelled job or of an expired one with DEADLINE_DROP, returns whether it has
+        bool drop_outdated_image(Job &job) noexcept;
+
+        // hands the result over to the job and records it, the start time is when a worker has taken the image
+        void deliver(Job &job, ImageResult &result, Clock::time_point enqueue_time, Clock::time_point start_time,
+                     StatsShard &stats);
+
+        // hands the task of a busy route over to the route, which puts it back into the scheduler once it is free;
+        // the workers go on with the other tasks meanwhile
+        void park(Task &task, const detection::BusyError &error, StatsShard &stats) noexcept;
+
+        void process_task(Task &task, detection::Detector *detector,
+                          const std::vector<std::size_t> &route_stats_indexes, std::uint64_t config_version,
+                          StatsShard &stats);
 
-        std::vector<std::unique_ptr<detection::Detector>> _detectors_pool;
+        void process_sequence(Task &task, detection::Detector *detector,
+                              const std::vector<std::size_t> &route_stats_indexes, std::uint64_t config_version,
+                              StatsShard &stats);
     };
 
 } // namespace processing
\ No newline at end of file
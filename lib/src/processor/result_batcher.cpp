@@ -0,0 +1,143 @@
+#include "result_batcher.hpp"
+
+#include "tracing/tracing.hpp"
+
+#include <algorithm>
+
+
+namespace processing {
+
+    ResultBatcher::ResultBatcher(std::size_t capacity, std::shared_ptr<FeedGate> feed_gate)
+            : _feed_gate{std::move(feed_gate)}, _buffer{capacity} {
+    }
+
+
+    ResultBatcher::ResultBatcher(const BatchingConfig &config, BatchCallback &&callback, std::size_t capacity,
+                                 std::shared_ptr<FeedGate> feed_gate)
+            : _config{config}, _callback{std::move(callback)}, _feed_gate{std::move(feed_gate)},
+              _buffer{std::max(capacity, 2 * std::max<std::size_t>(config.max_batch_size, 1))} {
+        _delivery_thread = std::thread([this]() { run_delivery(); });
+    }
+
+
+    ResultBatcher::~ResultBatcher() {
+        close();
+    }
+
+
+    void ResultBatcher::push(const ImageResult &result) {
+        auto value = result;
+        if (!_buffer.try_push(value)) {
+            // the feed gate keeps the buffer from filling up, so the list grows only once nobody bounds the job
+            std::lock_guard lk{_overflow_mutex};
+            if (_closed) {
+                return;
+            }
+            _overflow.emplace_back(std::move(value));
+            _overflow_size++;
+        }
+
+        // pairs with the fence of wait_for_results(): either the waiter sees the result or it is woken
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((_waiters_number.load() > 0) && (pending_number() >= _wake_threshold.load())) {
+            std::lock_guard lk{_mutex};
+            _conditional_variable.notify_all();
+        }
+    }
+
+
+    std::size_t ResultBatcher::poll(std::vector<ImageResult> &results, std::size_t max_results,
+                                    std::chrono::milliseconds timeout) {
+        if (max_results == 0) {
+            return 0;
+        }
+
+        auto taken_number = take(results, max_results);
+        if ((taken_number == 0) && (timeout.count() > 0)) {
+            wait_for_results(1, timeout);
+            taken_number = take(results, max_results);
+        }
+        return taken_number;
+    }
+
+
+    void ResultBatcher::close() {
+        {
+            std::lock_guard lk{_mutex};
+            _closed = true;
+        }
+        _conditional_variable.notify_all();
+
+        if (_delivery_thread.joinable() && (_delivery_thread.get_id() != std::this_thread::get_id())) {
+            _delivery_thread.join();
+        }
+    }
+
+
+    void ResultBatcher::run_delivery() {
+        tracing::set_thread_name("result_delivery");
+        const auto max_batch_size = std::max<std::size_t>(_config->max_batch_size, 1);
+        std::vector<ImageResult> batch;
+        batch.reserve(max_batch_size);
+
+        bool closed = false;
+        while (!closed || (pending_number() > 0)) {
+            closed = wait_for_results(max_batch_size, _config->max_delay);
+
+            // full batches right away, then the remainder, which has been pending for up to max_delay
+            while (take(batch, max_batch_size) > 0) {
+                tracing::Scope scope{"deliver_batch"};
+                try {
+                    _callback(batch);
+                } catch (...) {
+                    // the consumer errors are not the processing errors
+                }
+                batch.clear();
+            }
+        }
+    }
+
+
+    bool ResultBatcher::wait_for_results(std::size_t threshold, std::chrono::milliseconds timeout) {
+        std::unique_lock lk{_mutex};
+        _wake_threshold = threshold;
+        _waiters_number++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        _conditional_variable.wait_for(lk, timeout, [this, threshold]() {
+            return _closed || (pending_number() >= threshold);
+        });
+        _waiters_number--;
+        return _closed;
+    }
+
+
+    std::size_t ResultBatcher::pending_number() const {
+        return _buffer.approximate_size() + _overflow_size.load();
+    }
+
+
+    std::size_t ResultBatcher::take(std::vector<ImageResult> &results, std::size_t max_results) {
+        std::size_t taken_number = 0;
+        ImageResult result;
+        while ((taken_number < max_results) && _buffer.try_pop(result)) {
+            results.emplace_back(std::move(result));
+            taken_number++;
+        }
+        if ((taken_number < max_results) && (_overflow_size.load() > 0)) {
+            std::lock_guard lk{_overflow_mutex};
+            while ((taken_number < max_results) && !_overflow.empty()) {
+                results.emplace_back(std::move(_overflow.front()));
+                _overflow.pop_front();
+                _overflow_size--;
+                taken_number++;
+            }
+        }
+
+        // the room of the taken results lets the paused walk of the job go on
+        if (_feed_gate && (taken_number > 0)) {
+            _feed_gate->leave(taken_number);
+        }
+        return taken_number;
+    }
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "completion_buffer.hpp"
+#include "job.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+
+namespace processing {
+
+    struct BatchingConfig {
+        std::size_t max_batch_size{64};
+        // a partial batch is delivered once it has been pending that long
+        std::chrono::milliseconds max_delay{50};
+    };
+
+
+    using BatchCallback = std::function<void(const std::vector<ImageResult> &batch)>;
+
+
+    // Gathers the results of a job in a lock-free completion buffer, so the workers hand a result over without
+    // crossing into the consumer. The results are either delivered in batches by an own thread, one callback
+    // at a time, or pulled by the consumer with poll(). The consumer pace is imposed on the walk of the job
+    // through its feed gate, the workers never wait for the consumer.
+    class ResultBatcher {
+    public:
+        static constexpr std::size_t DEFAULT_CAPACITY{4096};
+
+        // the pull mode, the results are taken with poll(); the taken results leave the feed gate
+        explicit ResultBatcher(std::size_t capacity = DEFAULT_CAPACITY, std::shared_ptr<FeedGate> feed_gate = nullptr);
+
+        // the push mode, the buffer holds at least two batches
+        ResultBatcher(const BatchingConfig &config, BatchCallback &&callback,
+                      std::size_t capacity = DEFAULT_CAPACITY, std::shared_ptr<FeedGate> feed_gate = nullptr);
+
+        ResultBatcher(const ResultBatcher &) = delete;
+
+        ResultBatcher &operator=(const ResultBatcher &) = delete;
+
+        ~ResultBatcher();
+
+        // the job result callback, never blocks: a result beyond the buffer capacity waits in an overflow list,
+        // which only fills up once the feed gate is opened or without one
+        void push(const ImageResult &result);
+
+        // moves up to max_results results into the vector, waits up to the timeout for the first one;
+        // returns the number of moved results
+        std::size_t poll(std::vector<ImageResult> &results, std::size_t max_results,
+                         std::chrono::milliseconds timeout);
+
+        // delivers the pending results and stops the delivery thread, to be called once the job is completed;
+        // wakes the waiting poll() calls, the results which don't fit the buffer afterwards are dropped
+        void close();
+
+    private:
+        const std::optional<BatchingConfig> _config;
+        const BatchCallback _callback;
+        const std::shared_ptr<FeedGate> _feed_gate;
+        CompletionBuffer<ImageResult> _buffer;
+
+        std::mutex _overflow_mutex;
+        std::deque<ImageResult> _overflow;
+        std::atomic<std::size_t> _overflow_size{0};
+
+        // the waiters sleep on the mutex only, a producer locks it just when someone waits for enough results
+        std::mutex _mutex;
+        std::condition_variable _conditional_variable;
+        std::atomic<std::size_t> _waiters_number{0};
+        std::atomic<std::size_t> _wake_threshold{1};
+        std::atomic<bool> _closed{false};
+
+        std::thread _delivery_thread;
+
+        void run_delivery();
+
+        // waits until the buffer holds the threshold results, the timeout expires or the batcher is closed;
+        // returns true if the batcher is closed
+        bool wait_for_results(std::size_t threshold, std::chrono::milliseconds timeout);
+
+        std::size_t pending_number() const;
+
+        std::size_t take(std::vector<ImageResult> &results, std::size_t max_results);
+    };
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,172 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <iterator>
+
+
+namespace processing {
+
+    std::size_t Task::images_number() const {
+        return sequence ? sequence->frame_paths.size() - first_frame : 1;
+    }
+
+
+    Scheduler::Scheduler(std::size_t max_queued_tasks_per_class,
+                         std::array<std::chrono::milliseconds, PRIORITY_CLASSES_NUMBER> aging_limits)
+            : _max_queued_tasks_per_class{max_queued_tasks_per_class}, _aging_limits{aging_limits} {
+    }
+
+
+    bool Scheduler::push(Task &&task) {
+        auto &queue = _queues[static_cast<std::size_t>(task.job->priority)];
+
+        std::unique_lock lk{_mutex};
+        _space_conditional_variable.wait(lk, [this, &queue, &task] {
+            return !_opened || task.job->is_cancelled() || (queue.size() < _max_queued_tasks_per_class);
+        });
+
+        if (!_opened || task.job->is_cancelled()) {
+            return false;
+        }
+
+        task.enqueue_time = Clock::now();
+        task.job->on_queued(task.images_number());
+        queue.emplace_back(std::move(task));
+        _task_conditional_variable.notify_one();
+        return true;
+    }
+
+
+    bool Scheduler::requeue(Task &&task) {
+        auto &queue = _queues[static_cast<std::size_t>(task.job->priority)];
+        {
+            std::lock_guard lk{_mutex};
+            if (!_opened || task.job->is_cancelled()) {
+                return false;
+            }
+
+            task.job->on_queued(task.images_number());
+            queue.emplace_front(std::move(task));
+        }
+        _task_conditional_variable.notify_one();
+        return true;
+    }
+
+
+    std::optional<Task> Scheduler::pop() {
+        std::unique_lock lk{_mutex};
+        _task_conditional_variable.wait(lk, [this] { return !_opened || has_tasks(); });
+
+        if (!_opened) {
+            return std::nullopt;
+        }
+
+        return take_task();
+    }
+
+
+    std::optional<Task> Scheduler::pop(std::chrono::milliseconds timeout) {
+        std::unique_lock lk{_mutex};
+        if (!_task_conditional_variable.wait_for(lk, timeout, [this] { return !_opened || has_tasks(); }) ||
+            !_opened) {
+            return std::nullopt;
+        }
+
+        return take_task();
+    }
+
+
+    void Scheduler::cancel(Job &job) {
+        std::vector<Task> cancelled_tasks;
+        {
+            std::lock_guard lk{_mutex};
+            auto &queue = _queues[static_cast<std::size_t>(job.priority)];
+            for (auto it = queue.begin(); it != queue.end();) {
+                if (it->job.get() == &job) {
+                    cancelled_tasks.emplace_back(std::move(*it));
+                    it = queue.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+        _space_conditional_variable.notify_all();
+
+        // the job callbacks are never called under the scheduler lock
+        for (auto &task: cancelled_tasks) {
+            task.job->on_dequeued(task.images_number());
+            task.job->on_dropped(task.images_number());
+        }
+    }
+
+
+    void Scheduler::close() {
+        std::vector<Task> left_tasks;
+        {
+            std::lock_guard lk{_mutex};
+            _opened = false;
+            for (auto &queue: _queues) {
+                std::move(queue.begin(), queue.end(), std::back_inserter(left_tasks));
+                queue.clear();
+            }
+        }
+        _task_conditional_variable.notify_all();
+        _space_conditional_variable.notify_all();
+
+        for (auto &task: left_tasks) {
+            task.job->on_dequeued(task.images_number());
+            task.job->on_dropped(task.images_number());
+        }
+    }
+
+
+    bool Scheduler::is_closed() const {
+        std::lock_guard lk{_mutex};
+        return !_opened;
+    }
+
+
+    std::size_t Scheduler::queued_tasks() const {
+        std::lock_guard lk{_mutex};
+        std::size_t tasks_number = 0;
+        for (const auto &queue: _queues) {
+            tasks_number += queue.size();
+        }
+        return tasks_number;
+    }
+
+
+    bool Scheduler::has_tasks() const {
+        return std::any_of(_queues.begin(), _queues.end(), [](const auto &queue) { return !queue.empty(); });
+    }
+
+
+    Task Scheduler::take_task() {
+        // the highest non-empty class, unless the aged head of a lower class is promoted over it, which happens
+        // at most once per aging limit of the class
+        std::size_t selected_class = 0;
+        while (_queues[selected_class].empty()) {
+            selected_class++;
+        }
+        const auto now = Clock::now();
+        for (auto priority_class = selected_class + 1; priority_class < PRIORITY_CLASSES_NUMBER; priority_class++) {
+            const auto &queue = _queues[priority_class];
+            const auto aging_limit = _aging_limits[priority_class];
+            if (!queue.empty() && (now - queue.front().enqueue_time > aging_limit) &&
+                (now - _last_promotion_times[priority_class] > aging_limit)) {
+                _last_promotion_times[priority_class] = now;
+                selected_class = priority_class;
+                break;
+            }
+        }
+
+        auto &queue = _queues[selected_class];
+        auto task = std::move(queue.front());
+        queue.pop_front();
+        task.job->on_dequeued(task.images_number());
+
+        _space_conditional_variable.notify_all();
+        return task;
+    }
+
+} // namespace processing
\ No newline at end of file
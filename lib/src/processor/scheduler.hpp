@@ -0,0 +1,103 @@
+#pragma once
+
+#include "job.hpp"
+#include "sequence_tracker.hpp"
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace processing {
+
+    struct FrameSequence {
+        std::vector<std::string> frame_paths;
+        SequenceConfig config;
+    };
+
+
+    struct Task {
+        std::string image_path;
+        std::shared_ptr<Job> job;
+        Clock::time_point enqueue_time;
+        // an image submitted in memory, the image_path is empty then
+        cv::Mat image;
+        std::uint64_t image_index{0};
+        // set for the walked images when the folders are tracked, released once the task is done
+        std::shared_ptr<FolderCompletion> folder;
+        // the frames of a walked folder recognized as a sequence, detected in order by the single worker taking
+        // the task, the image_path is the folder then
+        std::shared_ptr<const FrameSequence> sequence;
+
+        // set once the route of the task has been busy: a walked image keeps its decoded image and file size
+        // meanwhile, a sequence the frame to go on from and the tracker of the frames before
+        bool is_retried{false};
+        std::size_t file_size{0};
+        std::size_t first_frame{0};
+        std::shared_ptr<SequenceTracker> tracker;
+
+        // the images the task stands for in the job progress
+        std::size_t images_number() const;
+    };
+
+
+    // Priority queue shared by all jobs. The highest class is served first, but the head of a lower class
+    // is promoted once it has waited longer than its aging limit, at most once per aging limit of the class,
+    // so a backfill keeps moving under a steady stream of interactive work without a deep backlog taking over
+    // the workers. Every class has its own capacity, so a full backfill never blocks the enqueueing of
+    // latency-sensitive images.
+    class Scheduler {
+    public:
+        static constexpr std::size_t PRIORITY_CLASSES_NUMBER{3};
+
+        explicit Scheduler(std::size_t max_queued_tasks_per_class,
+                           std::array<std::chrono::milliseconds, PRIORITY_CLASSES_NUMBER> aging_limits);
+
+        // blocks while the class queue is full, returns false if the scheduler is closed
+        bool push(Task &&task);
+
+        // puts a task taken before back at the head of its class without waiting for the space, the enqueue time
+        // is kept; returns false, keeping the task, if the scheduler is closed or the job is cancelled
+        bool requeue(Task &&task);
+
+        // blocks until a task is available, returns nothing once the scheduler is closed
+        std::optional<Task> pop();
+
+        // same as pop(), but also returns nothing once the timeout has expired
+        std::optional<Task> pop(std::chrono::milliseconds timeout);
+
+        // removes the queued tasks of the job and reports them dropped
+        void cancel(Job &job);
+
+        // wakes every waiting thread, the tasks left in the queues are reported dropped
+        void close();
+
+        bool is_closed() const;
+
+        std::size_t queued_tasks() const;
+
+    private:
+        const std::size_t _max_queued_tasks_per_class;
+        const std::array<std::chrono::milliseconds, PRIORITY_CLASSES_NUMBER> _aging_limits;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _task_conditional_variable;
+        std::condition_variable _space_conditional_variable;
+        bool _opened{true};
+
+        std::array<std::deque<Task>, PRIORITY_CLASSES_NUMBER> _queues;
+        std::array<Clock::time_point, PRIORITY_CLASSES_NUMBER> _last_promotion_times{};
+
+        bool has_tasks() const;
+
+        // expects _mutex to be locked and a task to be available
+        Task take_task();
+    };
+
+} // namespace processing
\ No newline at end of file
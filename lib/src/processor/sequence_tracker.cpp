@@ -0,0 +1,235 @@
+#include "sequence_tracker.hpp"
+
+#include <opencv2/imgproc.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace {
+
+    const cv::Size THUMBNAIL_SIZE{32, 32};
+    // the face templates are downscaled to this width, enough to tell a face from its surroundings
+    const int TEMPLATE_WIDTH = 24;
+    const char *DIGITS = "0123456789";
+
+
+    double intersection_over_union(const cv::Rect &first, const cv::Rect &second) {
+        const auto intersection_area = (first & second).area();
+        const auto union_area = first.area() + second.area() - intersection_area;
+        return (union_area > 0) ? static_cast<double>(intersection_area) / union_area : 0.0;
+    }
+
+
+    // the normalized correlation of the best match, -1 if the image is smaller than the template
+    double best_match(const cv::Mat &image, const cv::Mat &face_template, cv::Point &location) {
+        if ((image.cols < face_template.cols) || (image.rows < face_template.rows)) {
+            return -1.0;
+        }
+
+        cv::Mat scores;
+        cv::matchTemplate(image, face_template, scores, cv::TM_CCOEFF_NORMED);
+        double best_score = -1.0;
+        cv::minMaxLoc(scores, nullptr, &best_score, nullptr, &location);
+        return best_score;
+    }
+
+}
+
+
+namespace processing {
+
+    std::vector<std::string> order_frames(const std::vector<std::filesystem::path> &image_paths,
+                                          std::size_t min_frames) {
+        if (image_paths.size() < std::max<std::size_t>(min_frames, 2)) {
+            return {};
+        }
+
+        // the frame numbers are compared by their length first, so "frame_10" follows "frame_9"
+        struct Frame {
+            std::string number;
+            std::string path;
+        };
+        std::vector<Frame> frames;
+        std::string frame_name_prefix;
+        for (const auto &image_path: image_paths) {
+            const auto stem = image_path.stem().string();
+            const auto number_start = stem.find_last_not_of(DIGITS) + 1;
+            if (number_start == stem.size()) {
+                return {};
+            }
+
+            const auto name_prefix = stem.substr(0, number_start) + image_path.extension().string();
+            if (frames.empty()) {
+                frame_name_prefix = name_prefix;
+            } else if (name_prefix != frame_name_prefix) {
+                return {};
+            }
+
+            auto number = stem.substr(number_start);
+            number.erase(0, std::min(number.find_first_not_of('0'), number.size() - 1));
+            frames.push_back(Frame{std::move(number), image_path.string()});
+        }
+
+        const auto frame_order = [](const Frame &first, const Frame &second) {
+            return (first.number.size() != second.number.size()) ? (first.number.size() < second.number.size())
+                                                                  : (first.number < second.number);
+        };
+        std::sort(frames.begin(), frames.end(), frame_order);
+        // "frame_1" and "frame_01" leave the order ambiguous
+        if (std::adjacent_find(frames.begin(), frames.end(), [](const Frame &first, const Frame &second) {
+            return first.number == second.number;
+        }) != frames.end()) {
+            return {};
+        }
+
+        std::vector<std::string> frame_paths;
+        frame_paths.reserve(frames.size());
+        for (auto &frame: frames) {
+            frame_paths.emplace_back(std::move(frame.path));
+        }
+        return frame_paths;
+    }
+
+
+    double faces_drift(const std::vector<cv::Rect> &followed_faces, const std::vector<cv::Rect> &detected_faces) {
+        const auto faces_number = followed_faces.size() + detected_faces.size();
+        if (faces_number == 0) {
+            return 0.0;
+        }
+
+        const auto best_overlap = [](const cv::Rect &face, const std::vector<cv::Rect> &faces) {
+            double overlap = 0.0;
+            for (const auto &other_face: faces) {
+                overlap = std::max(overlap, intersection_over_union(face, other_face));
+            }
+            return overlap;
+        };
+
+        double drift_sum = 0.0;
+        for (const auto &face: followed_faces) {
+            drift_sum += 1.0 - best_overlap(face, detected_faces);
+        }
+        for (const auto &face: detected_faces) {
+            drift_sum += 1.0 - best_overlap(face, followed_faces);
+        }
+        return drift_sum / static_cast<double>(faces_number);
+    }
+
+
+    SequenceTracker::SequenceTracker(const SequenceConfig &config) : _config{config} {
+    }
+
+
+    FrameKind SequenceTracker::track(const cv::Mat &frame, std::vector<cv::Rect> &faces) {
+        faces.clear();
+        _followed_keyframe_faces.reset();
+
+        if (frame.channels() == 1) {
+            _gray_frame = frame;
+        } else {
+            cv::cvtColor(frame, _gray_frame, cv::COLOR_BGR2GRAY);
+        }
+        cv::Mat thumbnail;
+        cv::resize(_gray_frame, thumbnail, THUMBNAIL_SIZE, 0, 0, cv::INTER_AREA);
+        std::swap(thumbnail, _thumbnail);
+
+        // a failed detection leaves the tracker stopped, so the next frame is detected again
+        if (!_started) {
+            return FrameKind::KEYFRAME;
+        }
+        _started = false;
+
+        const auto difference = cv::norm(_thumbnail, thumbnail, cv::NORM_L1) / THUMBNAIL_SIZE.area();
+        if (difference > _config.scene_change_threshold) {
+            return FrameKind::SCENE_CHANGE;
+        }
+
+        std::vector<cv::Rect> followed_faces;
+        bool face_lost = false;
+        for (const auto &track: _tracks) {
+            if (auto box = follow(track)) {
+                followed_faces.push_back(box.value());
+            } else {
+                face_lost = true;
+            }
+        }
+
+        // the lost faces count as drifted
+        if (_followed_frames + 1 >= _config.keyframe_interval) {
+            _followed_keyframe_faces = std::move(followed_faces);
+            return FrameKind::KEYFRAME;
+        }
+        if (face_lost) {
+            return FrameKind::LOST_FACE;
+        }
+
+        // the templates follow the slow changes of the faces, the drift this brings is measured on the keyframes
+        for (std::size_t i = 0; i < _tracks.size(); i++) {
+            _tracks[i] = make_track(followed_faces[i]);
+        }
+        _followed_frames++;
+        _started = true;
+        faces = std::move(followed_faces);
+        return FrameKind::TRACKED;
+    }
+
+
+    std::optional<double> SequenceTracker::reset(const std::vector<cv::Rect> &faces) {
+        const cv::Rect frame_rect(0, 0, _gray_frame.cols, _gray_frame.rows);
+        _tracks.clear();
+        for (const auto &face: faces) {
+            const auto box = face & frame_rect;
+            if (!box.empty()) {
+                _tracks.push_back(make_track(box));
+            }
+        }
+        _followed_frames = 0;
+        _started = true;
+
+        if (!_followed_keyframe_faces) {
+            return std::nullopt;
+        }
+        const auto keyframe_drift = faces_drift(_followed_keyframe_faces.value(), faces);
+        _followed_keyframe_faces.reset();
+        return keyframe_drift;
+    }
+
+
+    std::optional<cv::Rect> SequenceTracker::follow(const Track &track) const {
+        const cv::Rect frame_rect(0, 0, _gray_frame.cols, _gray_frame.rows);
+        const auto margin_x = static_cast<int>(std::lround(track.box.width * _config.search_margin));
+        const auto margin_y = static_cast<int>(std::lround(track.box.height * _config.search_margin));
+        const auto window = cv::Rect(track.box.x - margin_x, track.box.y - margin_y,
+                                     track.box.width + 2 * margin_x, track.box.height + 2 * margin_y) & frame_rect;
+
+        cv::Mat scaled_window;
+        if (!window.empty()) {
+            cv::resize(_gray_frame(window), scaled_window, cv::Size(), track.scale, track.scale, cv::INTER_AREA);
+        }
+        cv::Point location;
+        if (!(best_match(scaled_window, track.scaled_template, location) >= _config.min_match_score)) {
+            return std::nullopt;
+        }
+
+        // the downscaled match is a few pixels off, it is refined at the full resolution around it
+        const auto radius = static_cast<int>(std::ceil(1.0 / track.scale)) + 1;
+        const auto refine_window = cv::Rect(window.x + static_cast<int>(std::lround(location.x / track.scale)) - radius,
+                                            window.y + static_cast<int>(std::lround(location.y / track.scale)) - radius,
+                                            track.box.width + 2 * radius, track.box.height + 2 * radius) & frame_rect;
+        if (!(best_match(_gray_frame(refine_window), track.face_template, location) >= _config.min_match_score)) {
+            return std::nullopt;
+        }
+        return cv::Rect(refine_window.x + location.x, refine_window.y + location.y,
+                        track.box.width, track.box.height);
+    }
+
+
+    SequenceTracker::Track SequenceTracker::make_track(const cv::Rect &box) const {
+        Track track{box, std::min(1.0, static_cast<double>(TEMPLATE_WIDTH) / box.width),
+                    _gray_frame(box).clone(), cv::Mat()};
+        cv::resize(track.face_template, track.scaled_template, cv::Size(), track.scale, track.scale, cv::INTER_AREA);
+        return track;
+    }
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+
+namespace processing {
+
+    struct SequenceConfig {
+        // a full detection every given number of frames, the frames in between follow the faces of the last one
+        std::size_t keyframe_interval{10};
+        // a folder is a sequence once it has this many images, all named by one prefix and a frame number
+        std::size_t min_frames{8};
+        // mean absolute difference of the grayscale thumbnails of two frames, 0-255, from which on the frame
+        // is a scene change and is detected in full
+        double scene_change_threshold{25.0};
+        // the search window of a face extends its previous box by this fraction of the box size on every side
+        double search_margin{0.25};
+        // normalized correlation with the previous face below which the face is lost and the frame is detected
+        double min_match_score{0.7};
+    };
+
+
+    enum class FrameKind : std::size_t {
+        KEYFRAME = 0,   // the first frame of a sequence or the keyframe_interval one, detected in full
+        SCENE_CHANGE,   // detected in full
+        LOST_FACE,      // detected in full
+        TRACKED
+    };
+
+
+    // the images of a folder in the order of their frame numbers if they make a sequence, nothing otherwise
+    std::vector<std::string> order_frames(const std::vector<std::filesystem::path> &image_paths,
+                                          std::size_t min_frames);
+
+
+    // every face of both sets against its best match in the other one: 0 when the sets match, 1 when no face
+    // overlaps a face of the other set
+    double faces_drift(const std::vector<cv::Rect> &followed_faces, const std::vector<cv::Rect> &detected_faces);
+
+
+    // Follows the faces of a frame sequence between the full detections: a face is searched by its grayscale
+    // template in a small window around its previous box, both downscaled to a template of a few dozen pixels,
+    // and the match is refined at the full resolution within a few pixels, so a followed frame costs a fraction
+    // of a detection. Not thread-safe, one tracker per sequence.
+    class SequenceTracker {
+    public:
+        explicit SequenceTracker(const SequenceConfig &config);
+
+        // follows the faces onto the next frame; any other kind than TRACKED leaves the faces empty,
+        // the frame is then detected in full and the detection is passed to reset()
+        FrameKind track(const cv::Mat &frame, std::vector<cv::Rect> &faces);
+
+        // starts following the faces detected on the last tracked frame; on a KEYFRAME which could be followed
+        // returns the faces_drift() of the followed faces from the detected ones
+        std::optional<double> reset(const std::vector<cv::Rect> &faces);
+
+    private:
+        struct Track {
+            cv::Rect box;
+            double scale;
+            cv::Mat face_template;
+            cv::Mat scaled_template;
+        };
+
+        const SequenceConfig _config;
+        bool _started{false};
+        std::size_t _followed_frames{0};
+        cv::Mat _gray_frame;
+        cv::Mat _thumbnail;
+        std::vector<Track> _tracks;
+        // the faces followed onto the current KEYFRAME, to be compared with its detection
+        std::optional<std::vector<cv::Rect>> _followed_keyframe_faces;
+
+        std::optional<cv::Rect> follow(const Track &track) const;
+
+        Track make_track(const cv::Rect &box) const;
+    };
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "sharding.hpp"
+
+
+namespace processing {
+
+    std::uint64_t stable_path_hash(const std::filesystem::path &relative_path) {
+        const std::uint64_t FNV_OFFSET_BASIS{14695981039346656037ULL};
+        const std::uint64_t FNV_PRIME{1099511628211ULL};
+
+        std::uint64_t hash{FNV_OFFSET_BASIS};
+        for (const auto symbol: relative_path.generic_string()) {
+            hash ^= static_cast<std::uint8_t>(symbol);
+            hash *= FNV_PRIME;
+        }
+
+        return hash;
+    }
+
+
+    bool is_valid_shard(const ShardConfig &shard) {
+        return (shard.count > 0) && (shard.index < shard.count);
+    }
+
+
+    bool is_path_in_shard(const std::filesystem::path &relative_path, const ShardConfig &shard) {
+        if (shard.count <= 1) {
+            return true;
+        }
+
+        return (stable_path_hash(relative_path) % shard.count) == shard.index;
+    }
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+
+namespace processing {
+
+    struct ShardConfig {
+        std::size_t index{0};
+        std::size_t count{1};
+    };
+
+
+    // FNV-1a 64 over the generic (forward slash separated) form of the path,
+    // so every process and every platform assigns a file to the same shard
+    std::uint64_t stable_path_hash(const std::filesystem::path &relative_path);
+
+    bool is_valid_shard(const ShardConfig &shard);
+
+    bool is_path_in_shard(const std::filesystem::path &relative_path, const ShardConfig &shard);
+
+} // namespace processing
\ No newline at end of file
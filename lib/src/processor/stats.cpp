@@ -0,0 +1,426 @@
+#include "stats.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <new>
+#include <sstream>
+
+
+namespace {
+
+    const std::array<const char *, processing::StatsShard::STAGES_NUMBER> STAGE_NAMES{
+            "queue_wait", "read", "decode", "detect", "callback"};
+
+    const std::array<const char *, processing::StatsShard::FAILURES_NUMBER> FAILURE_NAMES{
+            "read", "decode", "detect", "callback"};
+
+    const std::array<const char *, processing::StatsShard::FRAME_KINDS_NUMBER> FRAME_KIND_NAMES{
+            "keyframe", "scene_change", "lost_face", "tracked"};
+
+    const std::array<double, 4> QUANTILES{0.5, 0.9, 0.99, 0.999};
+
+    const char *METRIC_PREFIX = "face_detection_";
+
+}
+
+
+namespace processing {
+
+    void StatsShard::record(Stage stage, std::chrono::microseconds duration) noexcept {
+        stage_durations_us[static_cast<std::size_t>(stage)].record(
+                static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0)));
+    }
+
+
+    void StatsShard::record_failure(Failure failure) noexcept {
+        failures[static_cast<std::size_t>(failure)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    void StatsShard::record_frame(FrameKind kind, std::chrono::microseconds duration) noexcept {
+        frame_durations_us[static_cast<std::size_t>(kind)].record(
+                static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0)));
+    }
+
+
+    void StatsShard::record_drift(double drift) noexcept {
+        drift_percents.record(static_cast<std::uint64_t>(std::lround(std::clamp(drift, 0.0, 1.0) * 100)));
+    }
+
+
+    void StatsShard::record_route(std::size_t route, std::chrono::microseconds duration,
+                                  std::uint64_t faces) noexcept {
+        if (route >= MAX_ROUTES_NUMBER) {
+            return;
+        }
+
+        // only this shard's worker allocates, the readers see the counters once they are published
+        auto *route_counters = routes[route].load(std::memory_order_acquire);
+        if (route_counters == nullptr) {
+            route_counters = new(std::nothrow) RouteCounters;
+            if (route_counters == nullptr) {
+                return;
+            }
+            routes[route].store(route_counters, std::memory_order_release);
+        }
+
+        route_counters->detect_durations_us.record(
+                static_cast<std::uint64_t>(std::max<std::int64_t>(duration.count(), 0)));
+        route_counters->images.fetch_add(1, std::memory_order_relaxed);
+        route_counters->faces.fetch_add(faces, std::memory_order_relaxed);
+    }
+
+
+    StatsShard::~StatsShard() {
+        for (auto &route_counters: routes) {
+            delete route_counters.load(std::memory_order_relaxed);
+        }
+    }
+
+
+    struct Stats::Snapshot {
+        double uptime_seconds{0};
+        std::uint64_t images{0};
+        std::uint64_t faces{0};
+        std::uint64_t bytes_read{0};
+        std::uint64_t dropped{0};
+        std::int64_t time_to_ready_us{-1};
+        std::int64_t warmup_us{-1};
+        std::int64_t first_image_latency_us{-1};
+        std::array<std::uint64_t, StatsShard::FAILURES_NUMBER> failures{};
+        std::array<Histogram, StatsShard::STAGES_NUMBER> stage_durations_us;
+        std::array<Histogram, StatsShard::FRAME_KINDS_NUMBER> frame_durations_us;
+        Histogram drift_percents;
+        // by the route index, a route without images is left out of the exports
+        std::vector<std::string> route_names;
+        std::deque<RouteCounters> routes;
+    };
+
+
+    Stats::Stats() : _start_time{std::chrono::steady_clock::now()} {
+    }
+
+
+    StatsShard &Stats::acquire_shard() {
+        std::lock_guard lk{_mutex};
+        if (!_free_shards.empty()) {
+            auto *shard = _free_shards.back();
+            _free_shards.pop_back();
+            return *shard;
+        }
+        return _shards.emplace_back();
+    }
+
+
+    void Stats::release_shard(StatsShard &shard) {
+        std::lock_guard lk{_mutex};
+        _free_shards.push_back(&shard);
+    }
+
+
+    void Stats::record_dropped() noexcept {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+
+    std::size_t Stats::route_index(std::string_view route_name) {
+        std::lock_guard lk{_routes_mutex};
+        const auto it = std::find(_route_names.begin(), _route_names.end(), route_name);
+        if (it != _route_names.end()) {
+            return static_cast<std::size_t>(it - _route_names.begin());
+        }
+        if (_route_names.size() >= StatsShard::MAX_ROUTES_NUMBER) {
+            return StatsShard::MAX_ROUTES_NUMBER;
+        }
+        _route_names.emplace_back(route_name);
+        return _route_names.size() - 1;
+    }
+
+
+    void Stats::record_ready(std::chrono::microseconds time_to_ready,
+                             std::chrono::microseconds warmup_duration) noexcept {
+        _warmup_us.store(std::max<std::int64_t>(warmup_duration.count(), 0), std::memory_order_relaxed);
+        _time_to_ready_us.store(std::max<std::int64_t>(time_to_ready.count(), 0), std::memory_order_relaxed);
+    }
+
+
+    void Stats::record_first_image(std::chrono::microseconds latency) noexcept {
+        if (_first_image_latency_us.load(std::memory_order_relaxed) >= 0) {
+            return;
+        }
+        std::int64_t not_recorded = -1;
+        _first_image_latency_us.compare_exchange_strong(not_recorded, std::max<std::int64_t>(latency.count(), 0),
+                                                        std::memory_order_relaxed);
+    }
+
+
+    void Stats::take_snapshot(Snapshot &snapshot) const {
+        snapshot.uptime_seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - _start_time).count();
+        snapshot.dropped = _dropped.load(std::memory_order_relaxed);
+        snapshot.time_to_ready_us = _time_to_ready_us.load(std::memory_order_relaxed);
+        snapshot.warmup_us = _warmup_us.load(std::memory_order_relaxed);
+        snapshot.first_image_latency_us = _first_image_latency_us.load(std::memory_order_relaxed);
+
+        {
+            std::lock_guard lk{_routes_mutex};
+            snapshot.route_names = _route_names;
+        }
+        for (std::size_t i = 0; i < snapshot.route_names.size(); i++) {
+            snapshot.routes.emplace_back();
+        }
+
+        std::lock_guard lk{_mutex};
+        for (const auto &shard: _shards) {
+            snapshot.images += shard.images.load(std::memory_order_relaxed);
+            snapshot.faces += shard.faces.load(std::memory_order_relaxed);
+            snapshot.bytes_read += shard.bytes_read.load(std::memory_order_relaxed);
+            for (std::size_t i = 0; i < StatsShard::FAILURES_NUMBER; i++) {
+                snapshot.failures[i] += shard.failures[i].load(std::memory_order_relaxed);
+            }
+            for (std::size_t i = 0; i < StatsShard::STAGES_NUMBER; i++) {
+                snapshot.stage_durations_us[i].merge(shard.stage_durations_us[i]);
+            }
+            for (std::size_t i = 0; i < StatsShard::FRAME_KINDS_NUMBER; i++) {
+                snapshot.frame_durations_us[i].merge(shard.frame_durations_us[i]);
+            }
+            snapshot.drift_percents.merge(shard.drift_percents);
+            for (std::size_t i = 0; i < snapshot.routes.size(); i++) {
+                const auto *route_counters = shard.routes[i].load(std::memory_order_acquire);
+                if (route_counters == nullptr) {
+                    continue;
+                }
+                auto &route = snapshot.routes[i];
+                route.detect_durations_us.merge(route_counters->detect_durations_us);
+                route.images.fetch_add(route_counters->images.load(std::memory_order_relaxed),
+                                       std::memory_order_relaxed);
+                route.faces.fetch_add(route_counters->faces.load(std::memory_order_relaxed),
+                                      std::memory_order_relaxed);
+            }
+        }
+    }
+
+
+    boost::property_tree::ptree Stats::to_json() const {
+        Snapshot snapshot;
+        take_snapshot(snapshot);
+
+        boost::property_tree::ptree root;
+        root.add("uptime_seconds", snapshot.uptime_seconds);
+        root.add("images", snapshot.images);
+        root.add("faces", snapshot.faces);
+        root.add("bytes_read", snapshot.bytes_read);
+        root.add("dropped", snapshot.dropped);
+
+        if (snapshot.time_to_ready_us >= 0) {
+            boost::property_tree::ptree startup;
+            startup.add("time_to_ready_us", snapshot.time_to_ready_us);
+            startup.add("warmup_us", snapshot.warmup_us);
+            if (snapshot.first_image_latency_us >= 0) {
+                startup.add("first_image_latency_us", snapshot.first_image_latency_us);
+            }
+            root.add_child("startup", startup);
+        }
+
+        boost::property_tree::ptree failures;
+        for (std::size_t i = 0; i < StatsShard::FAILURES_NUMBER; i++) {
+            failures.add(FAILURE_NAMES[i], snapshot.failures[i]);
+        }
+        root.add_child("failures", failures);
+
+        boost::property_tree::ptree stages;
+        for (std::size_t i = 0; i < StatsShard::STAGES_NUMBER; i++) {
+            const auto &durations = snapshot.stage_durations_us[i];
+            boost::property_tree::ptree stage;
+            stage.add("count", durations.count());
+            stage.add("sum_us", durations.sum());
+            stage.add("p50_us", durations.percentile(0.5));
+            stage.add("p90_us", durations.percentile(0.9));
+            stage.add("p99_us", durations.percentile(0.99));
+            stage.add("max_us", durations.max());
+            stages.add_child(STAGE_NAMES[i], stage);
+        }
+        root.add_child("stages", stages);
+
+        std::uint64_t frames_number = 0;
+        std::uint64_t detected_frames_duration_us = 0;
+        std::uint64_t frames_duration_us = 0;
+        boost::property_tree::ptree sequences;
+        for (std::size_t i = 0; i < StatsShard::FRAME_KINDS_NUMBER; i++) {
+            const auto &durations = snapshot.frame_durations_us[i];
+            frames_number += durations.count();
+            frames_duration_us += durations.sum();
+            if (static_cast<FrameKind>(i) != FrameKind::TRACKED) {
+                detected_frames_duration_us += durations.sum();
+            }
+
+            boost::property_tree::ptree frames;
+            frames.add("frames", durations.count());
+            frames.add("mean_us", (durations.count() > 0) ? durations.sum() / durations.count() : 0);
+            sequences.add_child(FRAME_KIND_NAMES[i], frames);
+        }
+        if (frames_number > 0) {
+            // against a full detection of every frame at the mean detection duration of the sequences
+            const auto tracked_frames_number =
+                    snapshot.frame_durations_us[static_cast<std::size_t>(FrameKind::TRACKED)].count();
+            const auto detected_frames_number = frames_number - tracked_frames_number;
+            if ((detected_frames_number > 0) && (frames_duration_us > 0)) {
+                sequences.add("estimated_speedup",
+                              static_cast<double>(detected_frames_duration_us) / detected_frames_number *
+                              frames_number / frames_duration_us);
+            }
+
+            boost::property_tree::ptree drift;
+            drift.add("keyframes", snapshot.drift_percents.count());
+            drift.add("p50", snapshot.drift_percents.percentile(0.5));
+            drift.add("p90", snapshot.drift_percents.percentile(0.9));
+            drift.add("p99", snapshot.drift_percents.percentile(0.99));
+            drift.add("max", snapshot.drift_percents.max());
+            sequences.add_child("drift_percents", drift);
+            root.add_child("sequences", sequences);
+        }
+
+        boost::property_tree::ptree routes;
+        for (std::size_t i = 0; i < snapshot.routes.size(); i++) {
+            const auto &route_counters = snapshot.routes[i];
+            const auto &durations = route_counters.detect_durations_us;
+            if (durations.count() == 0) {
+                continue;
+            }
+            boost::property_tree::ptree route;
+            route.add("images", route_counters.images.load(std::memory_order_relaxed));
+            route.add("faces", route_counters.faces.load(std::memory_order_relaxed));
+            route.add("p50_us", durations.percentile(0.5));
+            route.add("p90_us", durations.percentile(0.9));
+            route.add("p99_us", durations.percentile(0.99));
+            route.add("max_us", durations.max());
+            routes.push_back(std::make_pair(snapshot.route_names[i], route));
+        }
+        if (!routes.empty()) {
+            root.add_child("routes", routes);
+        }
+        return root;
+    }
+
+
+    std::string Stats::to_prometheus() const {
+        Snapshot snapshot;
+        take_snapshot(snapshot);
+
+        std::ostringstream oss;
+        const auto add_counter = [&oss](const char *name, const char *help, std::uint64_t value) {
+            oss << "# HELP " << METRIC_PREFIX << name << " " << help << "\n"
+                << "# TYPE " << METRIC_PREFIX << name << " counter\n"
+                << METRIC_PREFIX << name << " " << value << "\n";
+        };
+
+        oss << "# HELP " << METRIC_PREFIX << "uptime_seconds Seconds since the processor creation\n"
+            << "# TYPE " << METRIC_PREFIX << "uptime_seconds gauge\n"
+            << METRIC_PREFIX << "uptime_seconds " << snapshot.uptime_seconds << "\n";
+        add_counter("images_total", "Images delivered to the callback", snapshot.images);
+        add_counter("faces_total", "Faces found in the delivered images", snapshot.faces);
+        add_counter("read_bytes_total", "Bytes read from the image files", snapshot.bytes_read);
+        add_counter("dropped_images_total", "Images expired or cancelled before processing", snapshot.dropped);
+
+        const auto add_gauge = [&oss](const char *name, const char *help, std::int64_t value) {
+            if (value < 0) {
+                return;
+            }
+            oss << "# HELP " << METRIC_PREFIX << name << " " << help << "\n"
+                << "# TYPE " << METRIC_PREFIX << name << " gauge\n"
+                << METRIC_PREFIX << name << " " << value << "\n";
+        };
+        add_gauge("time_to_ready_microseconds", "Duration of the processor init until its workers were ready",
+                  snapshot.time_to_ready_us);
+        add_gauge("warmup_microseconds", "Warm-up time of the initial detectors summed up", snapshot.warmup_us);
+        add_gauge("first_image_latency_microseconds", "Submission to completion latency of the first image",
+                  snapshot.first_image_latency_us);
+
+        oss << "# HELP " << METRIC_PREFIX << "failures_total Image failures by reason\n"
+            << "# TYPE " << METRIC_PREFIX << "failures_total counter\n";
+        for (std::size_t i = 0; i < StatsShard::FAILURES_NUMBER; i++) {
+            oss << METRIC_PREFIX << "failures_total{reason=\"" << FAILURE_NAMES[i] << "\"} "
+                << snapshot.failures[i] << "\n";
+        }
+
+        oss << "# HELP " << METRIC_PREFIX << "stage_duration_microseconds Per image duration of a pipeline stage\n"
+            << "# TYPE " << METRIC_PREFIX << "stage_duration_microseconds summary\n";
+        for (std::size_t i = 0; i < StatsShard::STAGES_NUMBER; i++) {
+            const auto &durations = snapshot.stage_durations_us[i];
+            for (auto quantile: QUANTILES) {
+                oss << METRIC_PREFIX << "stage_duration_microseconds{stage=\"" << STAGE_NAMES[i]
+                    << "\",quantile=\"" << quantile << "\"} " << durations.percentile(quantile) << "\n";
+            }
+            oss << METRIC_PREFIX << "stage_duration_microseconds_sum{stage=\"" << STAGE_NAMES[i] << "\"} "
+                << durations.sum() << "\n"
+                << METRIC_PREFIX << "stage_duration_microseconds_count{stage=\"" << STAGE_NAMES[i] << "\"} "
+                << durations.count() << "\n";
+        }
+
+        if (std::any_of(snapshot.frame_durations_us.begin(), snapshot.frame_durations_us.end(),
+                        [](const Histogram &durations) { return durations.count() > 0; })) {
+            oss << "# HELP " << METRIC_PREFIX << "sequence_frames_total Frames of the sequences by kind, "
+                << "all but the tracked ones are detected in full\n"
+                << "# TYPE " << METRIC_PREFIX << "sequence_frames_total counter\n";
+            for (std::size_t i = 0; i < StatsShard::FRAME_KINDS_NUMBER; i++) {
+                oss << METRIC_PREFIX << "sequence_frames_total{kind=\"" << FRAME_KIND_NAMES[i] << "\"} "
+                    << snapshot.frame_durations_us[i].count() << "\n";
+            }
+            oss << "# HELP " << METRIC_PREFIX << "sequence_frame_microseconds_total Detection or tracking time "
+                << "of the sequence frames by kind\n"
+                << "# TYPE " << METRIC_PREFIX << "sequence_frame_microseconds_total counter\n";
+            for (std::size_t i = 0; i < StatsShard::FRAME_KINDS_NUMBER; i++) {
+                oss << METRIC_PREFIX << "sequence_frame_microseconds_total{kind=\"" << FRAME_KIND_NAMES[i] << "\"} "
+                    << snapshot.frame_durations_us[i].sum() << "\n";
+            }
+            oss << "# HELP " << METRIC_PREFIX << "sequence_drift_percent Drift of the followed faces from "
+                << "the detected ones on the keyframes\n"
+                << "# TYPE " << METRIC_PREFIX << "sequence_drift_percent summary\n";
+            for (auto quantile: QUANTILES) {
+                oss << METRIC_PREFIX << "sequence_drift_percent{quantile=\"" << quantile << "\"} "
+                    << snapshot.drift_percents.percentile(quantile) << "\n";
+            }
+            oss << METRIC_PREFIX << "sequence_drift_percent_sum " << snapshot.drift_percents.sum() << "\n"
+                << METRIC_PREFIX << "sequence_drift_percent_count " << snapshot.drift_percents.count() << "\n";
+        }
+
+        std::vector<std::pair<const std::string *, const RouteCounters *>> routes;
+        for (std::size_t i = 0; i < snapshot.routes.size(); i++) {
+            if (snapshot.routes[i].detect_durations_us.count() > 0) {
+                routes.emplace_back(&snapshot.route_names[i], &snapshot.routes[i]);
+            }
+        }
+        if (routes.empty()) {
+            return oss.str();
+        }
+        oss << "# HELP " << METRIC_PREFIX << "route_images_total Images detected by a route of the router detector\n"
+            << "# TYPE " << METRIC_PREFIX << "route_images_total counter\n";
+        for (const auto &[name, route_counters]: routes) {
+            oss << METRIC_PREFIX << "route_images_total{route=\"" << *name << "\"} "
+                << route_counters->images.load(std::memory_order_relaxed) << "\n";
+        }
+        oss << "# HELP " << METRIC_PREFIX << "route_faces_total Faces found by a route of the router detector\n"
+            << "# TYPE " << METRIC_PREFIX << "route_faces_total counter\n";
+        for (const auto &[name, route_counters]: routes) {
+            oss << METRIC_PREFIX << "route_faces_total{route=\"" << *name << "\"} "
+                << route_counters->faces.load(std::memory_order_relaxed) << "\n";
+        }
+        oss << "# HELP " << METRIC_PREFIX << "route_detect_duration_microseconds Per image detection duration "
+            << "of a route\n"
+            << "# TYPE " << METRIC_PREFIX << "route_detect_duration_microseconds summary\n";
+        for (const auto &[name, route_counters]: routes) {
+            const auto &durations = route_counters->detect_durations_us;
+            for (auto quantile: QUANTILES) {
+                oss << METRIC_PREFIX << "route_detect_duration_microseconds{route=\"" << *name
+                    << "\",quantile=\"" << quantile << "\"} " << durations.percentile(quantile) << "\n";
+            }
+            oss << METRIC_PREFIX << "route_detect_duration_microseconds_sum{route=\"" << *name << "\"} "
+                << durations.sum() << "\n"
+                << METRIC_PREFIX << "route_detect_duration_microseconds_count{route=\"" << *name << "\"} "
+                << durations.count() << "\n";
+        }
+        return oss.str();
+    }
+
+} // namespace processing
\ No newline at end of file
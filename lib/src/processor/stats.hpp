@@ -0,0 +1,137 @@
+#pragma once
+
+#include "histogram.hpp"
+#include "sequence_tracker.hpp"
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+namespace processing {
+
+    enum class Stage : std::size_t {
+        QUEUE_WAIT = 0,
+        READ,
+        DECODE,
+        DETECT,    // in the process execution mode it also covers the reading and decoding done by the worker process
+        CALLBACK
+    };
+
+    enum class Failure : std::size_t {
+        READ = 0,
+        DECODE,
+        DETECT,
+        CALLBACK
+    };
+
+
+    // the detections of a route of a router detector
+    struct RouteCounters {
+        Histogram detect_durations_us;
+        std::atomic<std::uint64_t> images{0};
+        std::atomic<std::uint64_t> faces{0};
+    };
+
+
+    // Written by one worker thread only, so the relaxed increments never contend for a cache line.
+    struct StatsShard {
+        static constexpr std::size_t STAGES_NUMBER{5};
+        static constexpr std::size_t FAILURES_NUMBER{4};
+        static constexpr std::size_t FRAME_KINDS_NUMBER{4};
+        // the routes over this number, counted across the reloads by their names, aren't recorded
+        static constexpr std::size_t MAX_ROUTES_NUMBER{32};
+
+        std::array<Histogram, STAGES_NUMBER> stage_durations_us;
+        std::atomic<std::uint64_t> images{0};
+        std::atomic<std::uint64_t> faces{0};
+        std::atomic<std::uint64_t> bytes_read{0};
+        std::array<std::atomic<std::uint64_t>, FAILURES_NUMBER> failures{};
+        // the frames of the sequences by kind, with the duration of their detection or tracking
+        std::array<Histogram, FRAME_KINDS_NUMBER> frame_durations_us;
+        // how far the followed faces have drifted from the detected ones on the scheduled keyframes
+        Histogram drift_percents;
+        // by the index of Stats::route_index(), allocated by the first detection of the route in the shard
+        std::array<std::atomic<RouteCounters *>, MAX_ROUTES_NUMBER> routes{};
+
+        StatsShard() = default;
+
+        StatsShard(const StatsShard &) = delete;
+
+        StatsShard &operator=(const StatsShard &) = delete;
+
+        ~StatsShard();
+
+        void record(Stage stage, std::chrono::microseconds duration) noexcept;
+
+        void record_failure(Failure failure) noexcept;
+
+        void record_frame(FrameKind kind, std::chrono::microseconds duration) noexcept;
+
+        // the drift is 0 to 1, see SequenceTracker::reset()
+        void record_drift(double drift) noexcept;
+
+        // the detection of an image by a route, the duration covers the wait for the route; the routes
+        // from MAX_ROUTES_NUMBER on are skipped
+        void record_route(std::size_t route, std::chrono::microseconds duration, std::uint64_t faces) noexcept;
+    };
+
+
+    // Always-on processing counters and per-stage latency histograms of a processor.
+    // Every worker writes into its own shard, readers merge the shards on demand.
+    class Stats {
+    public:
+        Stats();
+
+        // a released shard keeps its values, so the totals survive the workers retired by autoscaling
+        StatsShard &acquire_shard();
+
+        void release_shard(StatsShard &shard);
+
+        void record_dropped() noexcept;
+
+        // the index of the named route in the shards, resolved once per built router rather than per image;
+        // StatsShard::MAX_ROUTES_NUMBER once there are that many routes
+        std::size_t route_index(std::string_view route_name);
+
+        // the init() duration until the workers have started with built and warmed up detectors,
+        // and the warm-up time of those detectors summed up
+        void record_ready(std::chrono::microseconds time_to_ready, std::chrono::microseconds warmup_duration) noexcept;
+
+        // submission to completion latency, only the first delivered image counts
+        void record_first_image(std::chrono::microseconds latency) noexcept;
+
+        boost::property_tree::ptree to_json() const;
+
+        // Prometheus text exposition format, every metric is prefixed with "face_detection_"
+        std::string to_prometheus() const;
+
+    private:
+        const std::chrono::steady_clock::time_point _start_time;
+        std::atomic<std::uint64_t> _dropped{0};
+        // -1 until recorded
+        std::atomic<std::int64_t> _time_to_ready_us{-1};
+        std::atomic<std::int64_t> _warmup_us{-1};
+        std::atomic<std::int64_t> _first_image_latency_us{-1};
+
+        mutable std::mutex _mutex;
+        std::list<StatsShard> _shards;
+        std::vector<StatsShard *> _free_shards;
+
+        // the routes are only ever added, by their names
+        mutable std::mutex _routes_mutex;
+        std::vector<std::string> _route_names;
+
+        struct Snapshot;
+
+        void take_snapshot(Snapshot &snapshot) const;
+    };
+
+} // namespace processing
\ No newline at end of file
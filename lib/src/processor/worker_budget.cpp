@@ -0,0 +1,35 @@
+#include "worker_budget.hpp"
+
+
+namespace processing {
+
+    WorkerBudget::WorkerBudget(std::size_t workers_number) : _capacity{workers_number}, _available{workers_number} {
+    }
+
+
+    bool WorkerBudget::try_acquire(std::size_t workers_number) {
+        auto available = _available.load();
+        while (available >= workers_number) {
+            if (_available.compare_exchange_weak(available, available - workers_number)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+
+    void WorkerBudget::release(std::size_t workers_number) {
+        _available.fetch_add(workers_number);
+    }
+
+
+    std::size_t WorkerBudget::available() const {
+        return _available.load();
+    }
+
+
+    std::size_t WorkerBudget::capacity() const {
+        return _capacity;
+    }
+
+} // namespace processing
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+
+namespace processing {
+
+    // The workers number shared by several processors of one host process: every worker thread or process
+    // takes a slot for its lifetime, so the processors together never run more workers than the cpu budget.
+    class WorkerBudget {
+    public:
+        explicit WorkerBudget(std::size_t workers_number);
+
+        WorkerBudget(const WorkerBudget &) = delete;
+
+        WorkerBudget &operator=(const WorkerBudget &) = delete;
+
+        // takes all the slots or none of them
+        bool try_acquire(std::size_t workers_number = 1);
+
+        void release(std::size_t workers_number = 1);
+
+        std::size_t available() const;
+
+        std::size_t capacity() const;
+
+    private:
+        const std::size_t _capacity;
+        std::atomic<std::size_t> _available;
+    };
+
+} // namespace processing
\ No newline at end of file
@@ -8,6 +8,7 @@ enum RESULT_CODE {
 
     SUCCESS = 0,
     UNEXPECTED_ERROR = SUCCESS + 1,
+    INCORRECT_PARAMETERS = SUCCESS + 2,
 
     INIT_SUCCESS = 100,
     INIT_UNEXPECTED_ERROR = INIT_SUCCESS + 1,
@@ -16,19 +17,257 @@ enum RESULT_CODE {
     INIT_BAD_DATA_FILE = INIT_SUCCESS + 4,
     INIT_INCORRECT_WORKER_NUMBER = INIT_SUCCESS + 5,
     INIT_DOUBLE_INITIALIZATION = INIT_SUCCESS + 6,
+    INIT_UNSUPPORTED_EXECUTION_MODE = INIT_SUCCESS + 7,
 
     PROCESS_SUCCESS = 200,
     PROCESS_UNEXPECTED_ERROR = PROCESS_SUCCESS + 1,
     PROCESS_IMAGE_FOLDER_IS_NOT_EXISTS = PROCESS_SUCCESS + 2,
-    PROCESS_UNINITIALIZED_LIB = PROCESS_SUCCESS + 3
+    PROCESS_UNINITIALIZED_LIB = PROCESS_SUCCESS + 3,
+    PROCESS_INCORRECT_SHARD = PROCESS_SUCCESS + 4,
+    PROCESS_INCORRECT_OPTIONS = PROCESS_SUCCESS + 5,
+    PROCESS_CANCELLED = PROCESS_SUCCESS + 6
+
+};
+
+enum EXECUTION_MODE {
+
+    EXECUTION_THREADS = 0,   // workers are threads of the host process
+    EXECUTION_PROCESSES = 1  // workers are processes of the detection_worker executable found next to the host one
+                             // or at DETECTION_WORKER_PATH, a crashed worker is restarted and its image retried
+
+};
+
+enum PRIORITY_CLASS {
+
+    PRIORITY_INTERACTIVE = 0, // served first
+    PRIORITY_NORMAL = 1,
+    PRIORITY_BACKFILL = 2     // served when nothing else waits, or once its oldest image waited too long
+
+};
+
+enum DEADLINE_POLICY {
+
+    DEADLINE_DROP = 0, // images not started before the deadline are skipped without notification
+    DEADLINE_FLAG = 1  // late images are processed and marked with "deadline_exceeded" in the result json
+
+};
+
+enum DETECTION_MODE {
+
+    DETECTION_FULL = 0,     // the face rects
+    DETECTION_COUNT = 1,    // the faces number only, cheaper for the counting jobs
+    DETECTION_PRESENCE = 2  // whether there is a face: the faces number is 0 or 1, the search stops at the first face
 
 };
 
 RESULT_CODE init(int workers_number, const char *detector_description_file_path);
 
+RESULT_CODE init_with_mode(int workers_number, const char *detector_description_file_path, EXECUTION_MODE mode);
+
+// starts with min_workers_number threads and grows up to max_workers_number while the queue backlog grows
+// and the cpu has headroom, idle workers are retired; scaling_log_path may be null
+RESULT_CODE init_autoscaled(int min_workers_number, int max_workers_number,
+                            const char *detector_description_file_path, const char *scaling_log_path);
+
+// swaps in a new detector description while the jobs go on, the images in flight finish on the old detectors;
+// every successful reload increments the description version, 1 after init, the result jsons carry it as
+// "config_version"; returns INIT_SUCCESS or an init error, the old description is kept then
+RESULT_CODE reload(const char *detector_description_file_path);
+
 using NotificationFunction = void (*)(const char *);
 RESULT_CODE process(const char *path_to_image_folder, NotificationFunction notification_fn_ptr);
 
+// processes the part of the folder selected by stable hash of the image path relative to the folder,
+// so shard_count independent processes cover the whole folder without overlap
+RESULT_CODE process_shard(const char *path_to_image_folder, int shard_index, int shard_count,
+                          NotificationFunction notification_fn_ptr);
+
+// the path may be a folder or a single image, deadline_ms <= 0 means no deadline;
+// may be called from several threads at once, the workers serve the calls by priority class
+RESULT_CODE process_with_priority(const char *path_to_images, PRIORITY_CLASS priority, int deadline_ms,
+                                  DEADLINE_POLICY deadline_policy, NotificationFunction notification_fn_ptr);
+
+struct FolderResults;
+
+struct ProcessParameters {
+    int shard_index;
+    int shard_count;
+    PRIORITY_CLASS priority;
+    int deadline_ms; // <= 0 means no deadline
+    DEADLINE_POLICY deadline_policy;
+    FolderResults *folder_results; // may be null, the job completes its walked folders in the results
+    // not DETECTION_FULL: the result jsons carry "faces_number" and no detections, the results have no faces
+    DETECTION_MODE detection_mode;
+    // > 0: the folders of numbered frames ("frame_000001.jpg", ...) are detected in full every given number
+    // of frames and on the scene changes, the faces are followed in between; EXECUTION_THREADS only
+    int keyframe_interval;
+};
+
+// fills the parameters with the defaults: the whole folder, PRIORITY_NORMAL, no deadline, no folder results,
+// DETECTION_FULL, no frame sequences
+void init_process_parameters(ProcessParameters *parameters);
+
+// one "result.json" per image folder: the result jsons appended by the notification function are streamed into
+// the file of their image folder by a library thread, the file of a folder is finalized once a job given
+// the results in its parameters has completed every image of the folder
+RESULT_CODE open_folder_results(FolderResults **results);
+
+// queues the result json without waiting for the file writing, may be called from any thread
+RESULT_CODE append_folder_result(FolderResults *results, const char *image_path, const char *result_json);
+
+// finalizes the folders left, e.g. of a cancelled job, and frees the results, to be called after wait_job();
+// returns UNEXPECTED_ERROR if any file has failed to be written
+RESULT_CODE close_folder_results(FolderResults *results);
+
+struct JobHandle;
+
+struct JobProgress {
+    unsigned long long discovered;  // images found by the folder walk so far
+    unsigned long long queued;      // waiting for a worker
+    unsigned long long decoded;
+    unsigned long long detected;    // delivered to the notification function
+    unsigned long long failed;      // decoding or detection errors
+    unsigned long long dropped;     // expired or cancelled before processing
+    double images_per_second;
+    int walk_finished;
+    int finished;
+    int cancelled;
+};
+
+// non-blocking process: on PROCESS_SUCCESS *job receives a handle, which must be released with release_job()
+RESULT_CODE start_process(const char *path_to_images, const ProcessParameters *parameters,
+                          NotificationFunction notification_fn_ptr, JobHandle **job);
+
+// cheap enough to be polled at high frequency from any thread
+RESULT_CODE get_job_progress(JobHandle *job, JobProgress *progress);
+
+// stops the folder walk and drops the queued images, the images in flight are still delivered
+RESULT_CODE cancel_job(JobHandle *job);
+
+// blocks until the job has finished, returns PROCESS_SUCCESS, PROCESS_CANCELLED or a process error
+RESULT_CODE wait_job(JobHandle *job);
+
+// waits for the job and frees the handle
+void release_job(JobHandle *job);
+
+struct FaceRect {
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+struct DetectionResult {
+    const char *image_path;
+    const FaceRect *faces;          // null without faces, so always outside DETECTION_FULL
+    int faces_number;               // the length of faces
+    int detected_faces_number;      // in every mode, the count of DETECTION_COUNT, 0 or 1 in DETECTION_PRESENCE
+    int deadline_exceeded;
+    unsigned long long config_version;
+};
+
+struct BatchingParameters {
+    int max_batch_size; // <= 0 means 64
+    int max_delay_ms;   // <= 0 means 50
+};
+
+// receives a batch of results, the pointers are valid during the call only
+using BatchNotificationFunction = void (*)(const DetectionResult *results, int results_number);
+
+// start_process() passing the results in batches from one library thread: a batch is passed once it holds
+// max_batch_size results or after max_delay_ms, so the function is crossed once per batch instead of per image;
+// wait_job() returns after the last batch has been passed
+RESULT_CODE start_process_batched(const char *path_to_images, const ProcessParameters *parameters,
+                                  const BatchingParameters *batching, BatchNotificationFunction batch_fn_ptr,
+                                  JobHandle **job);
+
+// start_process() without a notification function, the results are pulled with poll_results()
+RESULT_CODE start_process_polled(const char *path_to_images, const ProcessParameters *parameters, JobHandle **job);
+
+// copies up to max_results results into the array, waiting up to timeout_ms for the first one;
+// the pointers stay valid until the next poll_results() or release_job() of the job, which must not run
+// concurrently; the job is drained once it has finished and *results_number is 0;
+// the folder walk of the job pauses while 4096 of its images wait to be polled, the workers go on with the other
+// jobs; wait_job() lifts the bound to return before polling, release_job() drops the results left unpolled
+RESULT_CODE poll_results(JobHandle *job, DetectionResult *results, int max_results, int timeout_ms,
+                         int *results_number);
+
+// passes the processing counters and per-stage latency percentiles since init as a json to the function:
+// images, faces, bytes_read, dropped, failures by reason and stages with count, sum, p50, p90, p99 and max;
+// startup with the init time_to_ready_us, the warmup_us of its detectors and the first_image_latency_us;
+// with a router detector also routes with images, faces and the detection p50, p90, p99 and max of every route,
+// whose name the result jsons carry as "route"; with frame sequences also sequences with the frames and their
+// mean duration by kind (keyframe, scene_change, lost_face, tracked), the estimated speedup over the detection
+// of every frame and the drift percents of the followed faces from the detected ones on the keyframes
+RESULT_CODE get_stats(NotificationFunction stats_fn_ptr);
+
+// rewrites the file with the stats in Prometheus text format every period_ms until the library is unloaded
+RESULT_CODE export_stats(const char *prometheus_file_path, int period_ms);
+
+// records the walk, read, decode, detect and callback stages of every image, and the detector internals,
+// keeping the latest events_per_thread events of every thread, events_per_thread <= 0 means the default
+RESULT_CODE start_tracing(int events_per_thread);
+
+// stops the tracing and writes the events as Chrome trace-event json, to be opened by ui.perfetto.dev
+RESULT_CODE stop_tracing(const char *trace_file_path);
+
+// Several independent processors in one host process, e.g. a haar one for the thumbnails next to a caffe one
+// for the full-size images; every processor owns its workers, queue, detectors and stats. The functions above
+// without a processor handle work on the default processor created by init().
+
+struct ProcessorHandle;
+
+// the workers number shared by the processors created with it, every worker thread or process takes a slot
+// for its lifetime, so the processors together never run more workers than the budget
+struct CpuBudget;
+
+RESULT_CODE create_cpu_budget(int workers_number, CpuBudget **budget);
+
+// the processors created with the budget keep it until their destruction
+void destroy_cpu_budget(CpuBudget *budget);
+
+struct ProcessorParameters {
+    int workers_number;
+    int max_workers_number;         // autoscaled from workers_number up to it when it is greater
+    EXECUTION_MODE execution_mode;
+    const char *scaling_log_path;   // may be null
+    CpuBudget *cpu_budget;          // may be null, the processor fails to be created if the budget is short then
+    // may be null, otherwise the description file path is ignored and the processor takes the loaded detectors
+    // of the given one, the idle workers of both park them there; EXECUTION_THREADS only
+    ProcessorHandle *share_detectors_with;
+    // every new detector detects a synthetic image of this size before it serves, 0 to skip the warm-up
+    int warmup_image_width;
+    int warmup_image_height;
+};
+
+// fills the parameters with the defaults: 2 worker threads, no autoscaling, no budget, own detectors,
+// a 640x480 warm-up
+void init_processor_parameters(ProcessorParameters *parameters);
+
+// returns INIT_SUCCESS or an init error
+RESULT_CODE create_processor(const char *detector_description_file_path, const ProcessorParameters *parameters,
+                             ProcessorHandle **processor);
+
+// stops the workers, to be called after the processor's jobs have been released
+void destroy_processor(ProcessorHandle *processor);
+
+RESULT_CODE processor_reload(ProcessorHandle *processor, const char *detector_description_file_path);
+
+RESULT_CODE processor_start_process(ProcessorHandle *processor, const char *path_to_images,
+                                    const ProcessParameters *parameters, NotificationFunction notification_fn_ptr,
+                                    JobHandle **job);
+
+RESULT_CODE processor_start_process_batched(ProcessorHandle *processor, const char *path_to_images,
+                                            const ProcessParameters *parameters, const BatchingParameters *batching,
+                                            BatchNotificationFunction batch_fn_ptr, JobHandle **job);
+
+RESULT_CODE processor_start_process_polled(ProcessorHandle *processor, const char *path_to_images,
+                                           const ProcessParameters *parameters, JobHandle **job);
+
+RESULT_CODE processor_get_stats(ProcessorHandle *processor, NotificationFunction stats_fn_ptr);
+
+RESULT_CODE processor_export_stats(ProcessorHandle *processor, const char *prometheus_file_path, int period_ms);
+
 }
 
 #endif //PROCESSOR_H
@@ -1,58 +1,648 @@
 #include "processor/processor.hpp"
+#include "processor/result_batcher.hpp"
+#include "output/folder_results.hpp"
 
 #include <boost/property_tree/json_parser.hpp>
 
 
-std::unique_ptr<processing::Processor> ptr;
+struct ProcessorHandle {
+    std::unique_ptr<processing::Processor> processor;
+};
+
+
+struct CpuBudget {
+    std::shared_ptr<processing::WorkerBudget> budget;
+};
+
+
+struct JobHandle {
+    std::shared_ptr<processing::Job> job;
+    // set for the batched and the polled jobs
+    std::shared_ptr<processing::ResultBatcher> batcher;
+    bool is_polled{false};
+
+    // the memory the last polled results point to
+    std::vector<processing::ImageResult> polled_results;
+    std::vector<FaceRect> polled_faces;
+};
+
+
+struct FolderResults {
+    std::shared_ptr<output::FolderResultsWriter> writer;
+};
+
+
+namespace {
+
+    // the instance of the functions without a processor handle, created by init()
+    ProcessorHandle default_processor;
+
+
+    processing::ResultCallback make_json_notification(NotificationFunction notification_fn_ptr,
+                                                      DETECTION_MODE detection_mode) {
+        return [notification_fn_ptr, detection_mode](const processing::ImageResult &result) {
+
+            boost::property_tree::ptree root;
+            root.add("image_path", result.image_path.c_str());
+            root.add("config_version", result.config_version);
+            if (!result.route.empty()) {
+                root.add("route", result.route);
+            }
+            if (result.deadline_exceeded) {
+                root.add("deadline_exceeded", true);
+            }
+            if (detection_mode == DETECTION_MODE::DETECTION_FULL) {
+                boost::property_tree::ptree detections;
+                for (auto &face: result.faces) {
+                    boost::property_tree::ptree detection_obj;
+                    detection_obj.add("x", face.x);
+                    detection_obj.add("y", face.y);
+                    detection_obj.add("width", face.width);
+                    detection_obj.add("height", face.height);
+                    detections.push_back(std::make_pair("", detection_obj));
+                }
+                root.add_child("detections", detections);
+            } else {
+                root.add("faces_number", result.faces_number);
+            }
+
+            std::ostringstream oss;
+            boost::property_tree::write_json(oss, root);
+            try {
+                (*notification_fn_ptr)(oss.str().c_str());
+            } catch (...) {
+                // pass
+            }
+        };
+    }
+
+
+    // fills the C views of the results, the views point into the results and the faces
+    void make_detection_results(const std::vector<processing::ImageResult> &results, std::vector<FaceRect> &faces,
+                                std::vector<DetectionResult> &detection_results) {
+        std::size_t faces_number = 0;
+        for (const auto &result: results) {
+            faces_number += result.faces.size();
+        }
+
+        // reserved up front, so the views never point into a reallocated array
+        faces.clear();
+        faces.reserve(faces_number);
+        detection_results.clear();
+        detection_results.reserve(results.size());
+        for (const auto &result: results) {
+            const auto first_face_index = faces.size();
+            for (const auto &face: result.faces) {
+                faces.push_back(FaceRect{face.x, face.y, face.width, face.height});
+            }
+            // the faces of DETECTION_FULL only, the other modes count without them
+            const auto *result_faces = result.faces.empty() ? nullptr : faces.data() + first_face_index;
+            detection_results.push_back(DetectionResult{result.image_path.c_str(), result_faces,
+                                                        static_cast<int>(result.faces.size()),
+                                                        static_cast<int>(result.faces_number),
+                                                        result.deadline_exceeded ? 1 : 0,
+                                                        result.config_version});
+        }
+    }
+
+
+    RESULT_CODE start_job(ProcessorHandle *processor, const char *path_to_images,
+                          const ProcessParameters *parameters, processing::ResultCallback &&callback,
+                          std::shared_ptr<processing::Job> &job,
+                          std::shared_ptr<processing::FeedGate> feed_gate = nullptr) {
+        if ((processor == nullptr) || !processor->processor) {
+            return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+        }
+
+        if ((parameters == nullptr) || (path_to_images == nullptr)) {
+            return RESULT_CODE::PROCESS_INCORRECT_OPTIONS;
+        }
+
+        if ((parameters->shard_index < 0) || (parameters->shard_count < 1)) {
+            return RESULT_CODE::PROCESS_INCORRECT_SHARD;
+        }
+
+        processing::ProcessOptions options;
+        options.shard = processing::ShardConfig{static_cast<std::size_t>(parameters->shard_index),
+                                                static_cast<std::size_t>(parameters->shard_count)};
+        options.priority = parameters->priority;
+        options.deadline_policy = parameters->deadline_policy;
+        options.detection_mode = parameters->detection_mode;
+        if (parameters->deadline_ms > 0) {
+            options.deadline = std::chrono::milliseconds(parameters->deadline_ms);
+        }
+        if (parameters->keyframe_interval > 0) {
+            options.sequence = processing::SequenceConfig{};
+            options.sequence->keyframe_interval = static_cast<std::size_t>(parameters->keyframe_interval);
+        }
+        if (parameters->folder_results != nullptr) {
+            // shared, so a late completion of a cancelled job never outlives the writer
+            options.folder_callback = [writer = parameters->folder_results->writer](const std::string &folder_path) {
+                writer->complete(folder_path);
+            };
+        }
+        options.feed_gate = std::move(feed_gate);
+
+        return processor->processor->start(std::string(path_to_images), options, std::move(callback), job);
+    }
+
+
+    RESULT_CODE start_batcher_job(ProcessorHandle *processor, const char *path_to_images,
+                                  const ProcessParameters *parameters,
+                                  std::shared_ptr<processing::ResultBatcher> batcher,
+                                  std::shared_ptr<processing::FeedGate> feed_gate, bool is_polled, JobHandle **job) {
+        if (job == nullptr) {
+            return RESULT_CODE::PROCESS_INCORRECT_OPTIONS;
+        }
+
+        std::shared_ptr<processing::Job> started_job;
+        auto res = start_job(processor, path_to_images, parameters, [batcher](const processing::ImageResult &result) {
+            batcher->push(result);
+        }, started_job, std::move(feed_gate));
+        if (res == RESULT_CODE::PROCESS_SUCCESS) {
+            *job = new JobHandle{std::move(started_job), std::move(batcher), is_polled};
+        }
+        return res;
+    }
+
+
+    RESULT_CODE process_with_parameters(const char *path_to_images, const ProcessParameters *parameters,
+                                        NotificationFunction notification_fn_ptr) {
+        JobHandle *job = nullptr;
+        auto res = start_process(path_to_images, parameters, notification_fn_ptr, &job);
+        if (res != RESULT_CODE::PROCESS_SUCCESS) {
+            return res;
+        }
+
+        res = wait_job(job);
+        release_job(job);
+        return res;
+    }
+
+}
 
 extern "C"
 {
 
 RESULT_CODE init(int workers_number, const char *detector_description_file_path) {
-    if (ptr) {
+    return init_with_mode(workers_number, detector_description_file_path, EXECUTION_MODE::EXECUTION_THREADS);
+}
+
+
+RESULT_CODE init_with_mode(int workers_number, const char *detector_description_file_path, EXECUTION_MODE mode) {
+    if (default_processor.processor) {
+        return RESULT_CODE::INIT_DOUBLE_INITIALIZATION;
+    }
+
+    default_processor.processor = std::make_unique<processing::Processor>();
+
+    auto res = default_processor.processor->init(
+            processing::InitConfig{static_cast<std::size_t>(workers_number), detector_description_file_path, mode});
+    return res;
+}
+
+
+RESULT_CODE init_autoscaled(int min_workers_number, int max_workers_number,
+                            const char *detector_description_file_path, const char *scaling_log_path) {
+    if (default_processor.processor) {
         return RESULT_CODE::INIT_DOUBLE_INITIALIZATION;
     }
 
-    ptr = std::make_unique<processing::Processor>();
+    if ((min_workers_number < 1) || (max_workers_number < min_workers_number)) {
+        return RESULT_CODE::INIT_INCORRECT_WORKER_NUMBER;
+    }
+
+    default_processor.processor = std::make_unique<processing::Processor>();
+
+    processing::InitConfig config{static_cast<std::size_t>(min_workers_number), detector_description_file_path};
+    config.autoscaling = processing::AutoscalingConfig{static_cast<std::size_t>(min_workers_number),
+                                                       static_cast<std::size_t>(max_workers_number)};
+    if (scaling_log_path != nullptr) {
+        config.autoscaling->log_file_path = scaling_log_path;
+    }
+    return default_processor.processor->init(config);
+}
+
+
+RESULT_CODE reload(const char *detector_description_file_path) {
+    return processor_reload(&default_processor, detector_description_file_path);
+}
+
+
+RESULT_CODE create_cpu_budget(int workers_number, CpuBudget **budget) {
+    if ((workers_number < 1) || (budget == nullptr)) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    try {
+        *budget = new CpuBudget{std::make_shared<processing::WorkerBudget>(static_cast<std::size_t>(workers_number))};
+    } catch (...) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+    return RESULT_CODE::SUCCESS;
+}
+
+
+void destroy_cpu_budget(CpuBudget *budget) {
+    // the processors created with the budget keep it
+    delete budget;
+}
+
+
+void init_processor_parameters(ProcessorParameters *parameters) {
+    if (parameters == nullptr) {
+        return;
+    }
+
+    *parameters = ProcessorParameters{2, 0, EXECUTION_MODE::EXECUTION_THREADS, nullptr, nullptr, nullptr, 640, 480};
+}
+
 
-    auto res = ptr->init(
-            processing::InitConfig{static_cast<std::size_t>(workers_number), detector_description_file_path});
+RESULT_CODE create_processor(const char *detector_description_file_path, const ProcessorParameters *parameters,
+                             ProcessorHandle **processor) {
+    if ((detector_description_file_path == nullptr) || (parameters == nullptr) || (processor == nullptr)) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    if (parameters->workers_number < 1) {
+        return RESULT_CODE::INIT_INCORRECT_WORKER_NUMBER;
+    }
+
+    processing::InitConfig config{static_cast<std::size_t>(parameters->workers_number),
+                                  detector_description_file_path, parameters->execution_mode};
+    if ((parameters->warmup_image_width < 0) || (parameters->warmup_image_height < 0)) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+    config.warmup_image_sizes.clear();
+    if ((parameters->warmup_image_width > 0) && (parameters->warmup_image_height > 0)) {
+        config.warmup_image_sizes.emplace_back(parameters->warmup_image_width, parameters->warmup_image_height);
+    }
+    if (parameters->max_workers_number > parameters->workers_number) {
+        config.autoscaling = processing::AutoscalingConfig{static_cast<std::size_t>(parameters->workers_number),
+                                                           static_cast<std::size_t>(parameters->max_workers_number)};
+        if (parameters->scaling_log_path != nullptr) {
+            config.autoscaling->log_file_path = parameters->scaling_log_path;
+        }
+    }
+    if (parameters->cpu_budget != nullptr) {
+        config.worker_budget = parameters->cpu_budget->budget;
+    }
+    if (parameters->share_detectors_with != nullptr) {
+        if (!parameters->share_detectors_with->processor) {
+            return RESULT_CODE::INCORRECT_PARAMETERS;
+        }
+        config.detector_pool = parameters->share_detectors_with->processor->detector_pool();
+    }
+
+    std::unique_ptr<ProcessorHandle> handle;
+    try {
+        handle = std::make_unique<ProcessorHandle>(ProcessorHandle{std::make_unique<processing::Processor>()});
+    } catch (...) {
+        return RESULT_CODE::INIT_UNEXPECTED_ERROR;
+    }
+
+    auto res = handle->processor->init(config);
+    if (res == RESULT_CODE::INIT_SUCCESS) {
+        *processor = handle.release();
+    }
     return res;
 }
 
 
+void destroy_processor(ProcessorHandle *processor) {
+    delete processor;
+}
+
+
+RESULT_CODE processor_reload(ProcessorHandle *processor, const char *detector_description_file_path) {
+    if ((processor == nullptr) || !processor->processor) {
+        return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+    }
+
+    if (detector_description_file_path == nullptr) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    return processor->processor->reload(detector_description_file_path);
+}
+
+
 RESULT_CODE process(const char *path_to_image_folder, NotificationFunction notification_fn_ptr) {
-    if (!ptr) {
+    return process_shard(path_to_image_folder, 0, 1, notification_fn_ptr);
+}
+
+
+RESULT_CODE process_shard(const char *path_to_image_folder, int shard_index, int shard_count,
+                          NotificationFunction notification_fn_ptr) {
+    ProcessParameters parameters;
+    init_process_parameters(&parameters);
+    parameters.shard_index = shard_index;
+    parameters.shard_count = shard_count;
+    return process_with_parameters(path_to_image_folder, &parameters, notification_fn_ptr);
+}
+
+
+RESULT_CODE process_with_priority(const char *path_to_images, PRIORITY_CLASS priority, int deadline_ms,
+                                  DEADLINE_POLICY deadline_policy, NotificationFunction notification_fn_ptr) {
+    ProcessParameters parameters;
+    init_process_parameters(&parameters);
+    parameters.priority = priority;
+    parameters.deadline_ms = deadline_ms;
+    parameters.deadline_policy = deadline_policy;
+    return process_with_parameters(path_to_images, &parameters, notification_fn_ptr);
+}
+
+
+void init_process_parameters(ProcessParameters *parameters) {
+    if (parameters == nullptr) {
+        return;
+    }
+
+    *parameters = ProcessParameters{0, 1, PRIORITY_CLASS::PRIORITY_NORMAL, 0, DEADLINE_POLICY::DEADLINE_DROP,
+                                    nullptr, DETECTION_MODE::DETECTION_FULL, 0};
+}
+
+
+RESULT_CODE open_folder_results(FolderResults **results) {
+    if (results == nullptr) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    try {
+        *results = new FolderResults{std::make_shared<output::FolderResultsWriter>()};
+    } catch (...) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+    return RESULT_CODE::SUCCESS;
+}
+
+
+RESULT_CODE append_folder_result(FolderResults *results, const char *image_path, const char *result_json) {
+    if ((results == nullptr) || (image_path == nullptr) || (result_json == nullptr)) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    try {
+        results->writer->append(image_path, result_json);
+    } catch (...) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+    return RESULT_CODE::SUCCESS;
+}
+
+
+RESULT_CODE close_folder_results(FolderResults *results) {
+    if (results == nullptr) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    const auto is_written = results->writer->close();
+    delete results;
+    return is_written ? RESULT_CODE::SUCCESS : RESULT_CODE::UNEXPECTED_ERROR;
+}
+
+
+RESULT_CODE start_process(const char *path_to_images, const ProcessParameters *parameters,
+                          NotificationFunction notification_fn_ptr, JobHandle **job) {
+    return processor_start_process(&default_processor, path_to_images, parameters, notification_fn_ptr, job);
+}
+
+
+RESULT_CODE processor_start_process(ProcessorHandle *processor, const char *path_to_images,
+                                    const ProcessParameters *parameters, NotificationFunction notification_fn_ptr,
+                                    JobHandle **job) {
+    if ((processor == nullptr) || !processor->processor) {
         return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
     }
 
-    auto transformed_notification = [notification_fn_ptr](std::string processed_image_path,
-                                                          std::vector<cv::Rect> faces) {
+    if ((job == nullptr) || (parameters == nullptr)) {
+        return RESULT_CODE::PROCESS_INCORRECT_OPTIONS;
+    }
 
-        boost::property_tree::ptree root;
-        root.add("image_path", processed_image_path.c_str());
-        boost::property_tree::ptree detections;
-        for (auto &face: faces) {
-            boost::property_tree::ptree detection_obj;
-            detection_obj.add("x", face.x);
-            detection_obj.add("y", face.y);
-            detection_obj.add("width", face.width);
-            detection_obj.add("height", face.height);
-            detections.push_back(std::make_pair("", detection_obj));
-        }
-        root.add_child("detections", detections);
+    std::shared_ptr<processing::Job> started_job;
+    auto res = start_job(processor, path_to_images, parameters,
+                         make_json_notification(notification_fn_ptr, parameters->detection_mode), started_job);
+    if (res == RESULT_CODE::PROCESS_SUCCESS) {
+        *job = new JobHandle{std::move(started_job)};
+    }
+    return res;
+}
 
-        std::ostringstream oss;
-        boost::property_tree::write_json(oss, root);
-        try {
-            (*notification_fn_ptr)(oss.str().c_str());
-        } catch (...) {
-            // pass
-        }
-    };
 
-    auto res = ptr->process(std::string(path_to_image_folder), std::move(transformed_notification));
+RESULT_CODE start_process_batched(const char *path_to_images, const ProcessParameters *parameters,
+                                  const BatchingParameters *batching, BatchNotificationFunction batch_fn_ptr,
+                                  JobHandle **job) {
+    return processor_start_process_batched(&default_processor, path_to_images, parameters, batching, batch_fn_ptr,
+                                           job);
+}
+
+
+RESULT_CODE processor_start_process_batched(ProcessorHandle *processor, const char *path_to_images,
+                                            const ProcessParameters *parameters, const BatchingParameters *batching,
+                                            BatchNotificationFunction batch_fn_ptr, JobHandle **job) {
+    if ((processor == nullptr) || !processor->processor) {
+        return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+    }
+
+    if ((batching == nullptr) || (batch_fn_ptr == nullptr)) {
+        return RESULT_CODE::PROCESS_INCORRECT_OPTIONS;
+    }
+
+    processing::BatchingConfig config;
+    if (batching->max_batch_size > 0) {
+        config.max_batch_size = static_cast<std::size_t>(batching->max_batch_size);
+    }
+    if (batching->max_delay_ms > 0) {
+        config.max_delay = std::chrono::milliseconds(batching->max_delay_ms);
+    }
+
+    // only the delivery thread of the job calls it, so the views memory is reused between the batches
+    auto faces = std::make_shared<std::vector<FaceRect>>();
+    auto detection_results = std::make_shared<std::vector<DetectionResult>>();
+    std::shared_ptr<processing::FeedGate> feed_gate;
+    std::shared_ptr<processing::ResultBatcher> batcher;
+    try {
+        feed_gate = std::make_shared<processing::FeedGate>(processing::ResultBatcher::DEFAULT_CAPACITY);
+        batcher = std::make_shared<processing::ResultBatcher>(
+                config, [batch_fn_ptr, faces, detection_results](const std::vector<processing::ImageResult> &batch) {
+                    make_detection_results(batch, *faces, *detection_results);
+                    (*batch_fn_ptr)(detection_results->data(), static_cast<int>(detection_results->size()));
+                }, processing::ResultBatcher::DEFAULT_CAPACITY, feed_gate);
+    } catch (...) {
+        return RESULT_CODE::PROCESS_UNEXPECTED_ERROR;
+    }
+
+    auto res = start_batcher_job(processor, path_to_images, parameters, batcher, std::move(feed_gate), false, job);
+    if (res != RESULT_CODE::PROCESS_SUCCESS) {
+        batcher->close();
+    }
     return res;
 }
 
+
+RESULT_CODE start_process_polled(const char *path_to_images, const ProcessParameters *parameters, JobHandle **job) {
+    return processor_start_process_polled(&default_processor, path_to_images, parameters, job);
+}
+
+
+RESULT_CODE processor_start_process_polled(ProcessorHandle *processor, const char *path_to_images,
+                                           const ProcessParameters *parameters, JobHandle **job) {
+    if ((processor == nullptr) || !processor->processor) {
+        return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+    }
+
+    std::shared_ptr<processing::FeedGate> feed_gate;
+    std::shared_ptr<processing::ResultBatcher> batcher;
+    try {
+        feed_gate = std::make_shared<processing::FeedGate>(processing::ResultBatcher::DEFAULT_CAPACITY);
+        batcher = std::make_shared<processing::ResultBatcher>(processing::ResultBatcher::DEFAULT_CAPACITY, feed_gate);
+    } catch (...) {
+        return RESULT_CODE::PROCESS_UNEXPECTED_ERROR;
+    }
+    return start_batcher_job(processor, path_to_images, parameters, std::move(batcher), std::move(feed_gate), true,
+                             job);
+}
+
+
+RESULT_CODE poll_results(JobHandle *job, DetectionResult *results, int max_results, int timeout_ms,
+                         int *results_number) {
+    if ((job == nullptr) || !job->batcher || (results == nullptr) || (max_results < 1) ||
+        (results_number == nullptr)) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    try {
+        job->polled_results.clear();
+        job->batcher->poll(job->polled_results, static_cast<std::size_t>(max_results),
+                           std::chrono::milliseconds(std::max(timeout_ms, 0)));
+
+        std::vector<DetectionResult> detection_results;
+        make_detection_results(job->polled_results, job->polled_faces, detection_results);
+        std::copy(detection_results.begin(), detection_results.end(), results);
+        *results_number = static_cast<int>(detection_results.size());
+    } catch (...) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+    return RESULT_CODE::SUCCESS;
+}
+
+
+RESULT_CODE get_job_progress(JobHandle *job, JobProgress *progress) {
+    if ((job == nullptr) || (progress == nullptr)) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+
+    const auto snapshot = job->job->progress();
+    *progress = JobProgress{snapshot.discovered, snapshot.queued, snapshot.decoded, snapshot.detected,
+                            snapshot.failed, snapshot.dropped, snapshot.images_per_second,
+                            snapshot.walk_finished, snapshot.finished, snapshot.cancelled};
+    return RESULT_CODE::SUCCESS;
+}
+
+
+RESULT_CODE cancel_job(JobHandle *job) {
+    if (job == nullptr) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+
+    job->job->cancel();
+    return RESULT_CODE::SUCCESS;
+}
+
+
+RESULT_CODE wait_job(JobHandle *job) {
+    if (job == nullptr) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+
+    if (job->is_polled) {
+        // nobody may poll before the return, so the results left are kept beyond the bound instead
+        job->job->feed_gate->open();
+    }
+    auto res = job->job->wait();
+    if (job->batcher) {
+        // the remaining results are passed before the return
+        job->batcher->close();
+    }
+    return res;
+}
+
+
+void release_job(JobHandle *job) {
+    if (job == nullptr) {
+        return;
+    }
+
+    if (job->is_polled) {
+        // nobody polls the results anymore, the results left are dropped instead of kept
+        job->batcher->close();
+    }
+    wait_job(job);
+    delete job;
+}
+
+RESULT_CODE get_stats(NotificationFunction stats_fn_ptr) {
+    return processor_get_stats(&default_processor, stats_fn_ptr);
+}
+
+
+RESULT_CODE processor_get_stats(ProcessorHandle *processor, NotificationFunction stats_fn_ptr) {
+    if ((processor == nullptr) || !processor->processor) {
+        return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+    }
+
+    if (stats_fn_ptr == nullptr) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    try {
+        std::ostringstream oss;
+        boost::property_tree::write_json(oss, processor->processor->stats().to_json());
+        (*stats_fn_ptr)(oss.str().c_str());
+    } catch (...) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+    return RESULT_CODE::SUCCESS;
+}
+
+
+RESULT_CODE export_stats(const char *prometheus_file_path, int period_ms) {
+    return processor_export_stats(&default_processor, prometheus_file_path, period_ms);
+}
+
+
+RESULT_CODE processor_export_stats(ProcessorHandle *processor, const char *prometheus_file_path, int period_ms) {
+    if ((processor == nullptr) || !processor->processor) {
+        return RESULT_CODE::PROCESS_UNINITIALIZED_LIB;
+    }
+
+    if (prometheus_file_path == nullptr) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    return processor->processor->export_stats(prometheus_file_path, std::chrono::milliseconds(period_ms));
+}
+
+RESULT_CODE start_tracing(int events_per_thread) {
+    tracing::start((events_per_thread > 0) ? static_cast<std::size_t>(events_per_thread)
+                                           : tracing::DEFAULT_EVENTS_PER_THREAD);
+    return RESULT_CODE::SUCCESS;
+}
+
+
+RESULT_CODE stop_tracing(const char *trace_file_path) {
+    tracing::stop();
+
+    if (trace_file_path == nullptr) {
+        return RESULT_CODE::INCORRECT_PARAMETERS;
+    }
+
+    std::ofstream file(trace_file_path, std::ios::out | std::ios::trunc);
+    if (!file) {
+        return RESULT_CODE::UNEXPECTED_ERROR;
+    }
+    tracing::write_chrome_trace(file);
+    return file ? RESULT_CODE::SUCCESS : RESULT_CODE::UNEXPECTED_ERROR;
+}
+
 }
\ No newline at end of file
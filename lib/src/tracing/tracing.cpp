@@ -0,0 +1,284 @@
+#include "tracing.hpp"
+
+#include <algorithm>
+#include <list>
+#include <map>
+#include <mutex>
+#include <vector>
+
+
+namespace tracing {
+
+    std::atomic<bool> enabled{false};
+
+}
+
+
+namespace {
+
+    struct Event {
+        const char *name{nullptr};
+        std::string detail;
+        std::int64_t start_ns{0};
+        std::int64_t duration_ns{0};
+        std::uint32_t thread_id{0};
+    };
+
+
+    // written by one thread at a time, the mutex is taken by the owner for every event and
+    // by write_chrome_trace(), so it is never contended while the trace isn't being written
+    struct ThreadBuffer {
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::size_t next_event{0};
+        bool wrapped{false};
+
+        void reset(std::size_t events_per_thread) {
+            events.clear();
+            events.resize(events_per_thread);
+            next_event = 0;
+            wrapped = false;
+        }
+    };
+
+
+    std::int64_t nanoseconds_since_clock_epoch(std::chrono::steady_clock::time_point time_point) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(time_point.time_since_epoch()).count();
+    }
+
+
+    // buffers of finished threads are reused by new ones, so per-call walker threads don't grow the memory
+    struct Registry {
+        std::mutex mutex;
+        std::size_t events_per_thread{tracing::DEFAULT_EVENTS_PER_THREAD};
+        // nanoseconds of the steady clock, written by start() while the threads record
+        std::atomic<std::int64_t> epoch_ns{nanoseconds_since_clock_epoch(std::chrono::steady_clock::now())};
+        std::list<ThreadBuffer> buffers;
+        std::vector<ThreadBuffer *> free_buffers;
+        std::map<std::uint32_t, std::string> thread_names;
+        std::uint32_t next_thread_id{1};
+    };
+
+
+    // never destroyed, the thread exit handlers may run after the static destructors
+    Registry &registry() {
+        static auto *instance = new Registry();
+        return *instance;
+    }
+
+
+    struct ThreadState {
+        ThreadBuffer *buffer{nullptr};
+        std::uint32_t thread_id{0};
+        const char *name{nullptr};
+
+        ~ThreadState() {
+            if (buffer != nullptr) {
+                auto &reg = registry();
+                std::lock_guard lk{reg.mutex};
+                reg.free_buffers.push_back(buffer);
+            }
+        }
+    };
+
+
+    thread_local ThreadState thread_state;
+
+
+    ThreadState &current_thread_state() {
+        if (thread_state.buffer == nullptr) {
+            auto &reg = registry();
+            std::lock_guard lk{reg.mutex};
+            if (reg.free_buffers.empty()) {
+                reg.buffers.emplace_back().reset(reg.events_per_thread);
+                thread_state.buffer = &reg.buffers.back();
+            } else {
+                thread_state.buffer = reg.free_buffers.back();
+                reg.free_buffers.pop_back();
+            }
+            thread_state.thread_id = reg.next_thread_id++;
+            if (thread_state.name != nullptr) {
+                reg.thread_names[thread_state.thread_id] = thread_state.name;
+            }
+        }
+        return thread_state;
+    }
+
+
+    void write_escaped(std::ostream &os, const std::string &value) {
+        for (auto c: value) {
+            switch (c) {
+                case '"':
+                    os << "\\\"";
+                    break;
+                case '\\':
+                    os << "\\\\";
+                    break;
+                case '\n':
+                    os << "\\n";
+                    break;
+                case '\t':
+                    os << "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        os << ' ';
+                    } else {
+                        os << c;
+                    }
+            }
+        }
+    }
+
+
+    void write_microseconds(std::ostream &os, std::int64_t nanoseconds) {
+        os << nanoseconds / 1000 << '.';
+        const auto fraction = nanoseconds % 1000;
+        os << static_cast<char>('0' + fraction / 100) << static_cast<char>('0' + fraction / 10 % 10)
+           << static_cast<char>('0' + fraction % 10);
+    }
+
+
+    void record(const char *name, const std::string *detail, std::chrono::steady_clock::time_point start_time,
+                std::chrono::steady_clock::time_point end_time) {
+        auto &state = current_thread_state();
+        const auto epoch_ns = registry().epoch_ns.load(std::memory_order_relaxed);
+
+        std::lock_guard lk{state.buffer->mutex};
+        auto &events = state.buffer->events;
+        if (events.empty()) {
+            return;
+        }
+
+        auto &event = events[state.buffer->next_event];
+        event.name = name;
+        if (detail != nullptr) {
+            event.detail = *detail;
+        } else {
+            event.detail.clear();
+        }
+        event.start_ns = std::max<std::int64_t>(nanoseconds_since_clock_epoch(start_time) - epoch_ns, 0);
+        event.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - start_time).count();
+        event.thread_id = state.thread_id;
+
+        if (++state.buffer->next_event == events.size()) {
+            state.buffer->next_event = 0;
+            state.buffer->wrapped = true;
+        }
+    }
+
+}
+
+
+namespace tracing {
+
+    void start(std::size_t events_per_thread) {
+        auto &reg = registry();
+        std::lock_guard lk{reg.mutex};
+        reg.events_per_thread = std::max<std::size_t>(events_per_thread, 1);
+        reg.epoch_ns.store(nanoseconds_since_clock_epoch(std::chrono::steady_clock::now()),
+                           std::memory_order_relaxed);
+        for (auto &buffer: reg.buffers) {
+            std::lock_guard buffer_lk{buffer.mutex};
+            buffer.reset(reg.events_per_thread);
+        }
+        enabled = true;
+    }
+
+
+    void stop() {
+        enabled = false;
+    }
+
+
+    void set_thread_name(const char *name) {
+        thread_state.name = name;
+        if (thread_state.buffer == nullptr) {
+            // registered with the first event of the thread
+            return;
+        }
+
+        auto &reg = registry();
+        std::lock_guard lk{reg.mutex};
+        reg.thread_names[thread_state.thread_id] = name;
+    }
+
+
+    void complete(const char *name, std::chrono::steady_clock::time_point start_time,
+                  std::chrono::steady_clock::time_point end_time) {
+        if (!is_enabled()) {
+            return;
+        }
+
+        try {
+            record(name, nullptr, start_time, end_time);
+        } catch (...) {
+            // pass
+        }
+    }
+
+
+    void write_chrome_trace(std::ostream &os) {
+        auto &reg = registry();
+        std::lock_guard lk{reg.mutex};
+
+        os << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        os << R"({"name":"process_name","ph":"M","pid":1,"tid":0,"args":{"name":"face detection"}})";
+        for (const auto &[thread_id, name]: reg.thread_names) {
+            os << ",\n" << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << thread_id
+               << R"(,"args":{"name":")";
+            write_escaped(os, name);
+            os << "\"}}";
+        }
+
+        for (auto &buffer: reg.buffers) {
+            std::lock_guard buffer_lk{buffer.mutex};
+            const auto events_number = buffer.wrapped ? buffer.events.size() : buffer.next_event;
+            const auto first_event = buffer.wrapped ? buffer.next_event : 0;
+            for (std::size_t i = 0; i < events_number; i++) {
+                const auto &event = buffer.events[(first_event + i) % buffer.events.size()];
+                os << ",\n{\"name\":\"" << event.name << R"(","cat":"processing","ph":"X","pid":1,"tid":)"
+                   << event.thread_id << ",\"ts\":";
+                write_microseconds(os, event.start_ns);
+                os << ",\"dur\":";
+                write_microseconds(os, event.duration_ns);
+                if (!event.detail.empty()) {
+                    os << ",\"args\":{\"image\":\"";
+                    write_escaped(os, event.detail);
+                    os << "\"}";
+                }
+                os << '}';
+            }
+        }
+        os << "\n]}\n";
+    }
+
+
+    Scope::Scope(const char *name) noexcept {
+        if (is_enabled()) {
+            _name = name;
+            _start_time = std::chrono::steady_clock::now();
+        }
+    }
+
+
+    Scope::Scope(const char *name, const std::string &detail) {
+        if (is_enabled()) {
+            _name = name;
+            _detail = &detail;
+            _start_time = std::chrono::steady_clock::now();
+        }
+    }
+
+
+    Scope::~Scope() {
+        if (_name != nullptr) {
+            try {
+                record(_name, _detail, _start_time, std::chrono::steady_clock::now());
+            } catch (...) {
+                // pass
+            }
+        }
+    }
+
+} // namespace tracing
\ No newline at end of file
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+
+// Opt-in tracing of the processing pipeline into per-thread ring buffers, exported as Chrome trace-event json
+// (chrome://tracing, ui.perfetto.dev). While tracing is off every hook is a single relaxed load.
+namespace tracing {
+
+    constexpr std::size_t DEFAULT_EVENTS_PER_THREAD{1 << 16};
+
+    extern std::atomic<bool> enabled;
+
+    inline bool is_enabled() noexcept {
+        return enabled.load(std::memory_order_relaxed);
+    }
+
+    // starts recording, every thread keeps the latest events_per_thread events; drops the previous recording
+    void start(std::size_t events_per_thread = DEFAULT_EVENTS_PER_THREAD);
+
+    // stops recording, the recorded events are kept for write_chrome_trace()
+    void stop();
+
+    // the name shown for the current thread in the trace viewer, must be a string literal
+    void set_thread_name(const char *name);
+
+    // records an event measured by the caller, for the places which already take the time points
+    void complete(const char *name, std::chrono::steady_clock::time_point start_time,
+                  std::chrono::steady_clock::time_point end_time);
+
+    void write_chrome_trace(std::ostream &os);
+
+
+    // Records one complete event from the construction to the destruction on the current thread.
+    // The name must be a string literal, the detail (an image path) is copied only while tracing is on.
+    class Scope {
+    public:
+        explicit Scope(const char *name) noexcept;
+
+        Scope(const char *name, const std::string &detail);
+
+        Scope(const Scope &) = delete;
+
+        Scope &operator=(const Scope &) = delete;
+
+        ~Scope();
+
+    private:
+        const char *_name{nullptr};
+        const std::string *_detail{nullptr};
+        std::chrono::steady_clock::time_point _start_time;
+    };
+
+} // namespace tracing
\ No newline at end of file
@@ -1,4 +1,6 @@
+#include "detector/caffe_detector.hpp"
 #include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -63,3 +65,49 @@ BOOST_AUTO_TEST_CASE(caffe_detector_test_with_no_face)
 
     BOOST_CHECK_EQUAL(detections.size(), 0);
 }
+
+
+
+BOOST_AUTO_TEST_CASE(caffe_detector_test_aspect_input_shape)
+{
+    const char *data = R"({
+    "type": "caffe",
+    "settings": {
+        "network_structure_file": "deploy.prototxt",
+        "weights_file_name": "res10_300x300_ssd_iter_140000.caffemodel",
+        "target_image_size": 300,
+        "confidence_level": "0.97"
+    }
+})";
+    std::stringstream buffer;
+    buffer << data;
+
+    boost::property_tree::ptree detector_settings;
+    boost::property_tree::read_json(buffer, detector_settings);
+    auto square_detector = detection::create_detector(detector_settings);
+    detector_settings.put("settings.input_shape", "aspect");
+    auto aspect_detector = detection::create_detector(detector_settings);
+
+    auto loaded_image = cv::imread(
+            (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(),
+            cv::IMREAD_COLOR);
+
+    // 603x803 is scaled to 225x300 and rounded up to the stride of 32
+    auto *caffe_detector = dynamic_cast<detection::caffe::CaffeDetector *>(aspect_detector.get());
+    BOOST_REQUIRE(caffe_detector != nullptr);
+    BOOST_CHECK(caffe_detector->prepare_image_for_detection(loaded_image).size() == cv::Size(256, 320));
+
+    // both shapes find the face at the same place of the image
+    const cv::Rect image_rect(0, 0, loaded_image.cols, loaded_image.rows);
+    auto square_detections = square_detector->detect(loaded_image);
+    auto aspect_detections = aspect_detector->detect(loaded_image);
+    BOOST_REQUIRE_EQUAL(square_detections.size(), 1);
+    BOOST_REQUIRE_EQUAL(aspect_detections.size(), 1);
+    BOOST_CHECK((aspect_detections[0] & image_rect) == aspect_detections[0]);
+    const auto intersection_area = (square_detections[0] & aspect_detections[0]).area();
+    BOOST_CHECK_GT(2 * intersection_area, square_detections[0].area());
+    BOOST_CHECK_GT(2 * intersection_area, aspect_detections[0].area());
+
+    detector_settings.put("settings.input_shape", "round");
+    BOOST_CHECK_THROW(detection::create_detector(detector_settings), detection::CreationError);
+}
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "detector/detector_factory.hpp"
+#include "detector/haar_detector.hpp"
 
 #include <boost/test/unit_test.hpp>
 #include <boost/property_tree/ptree.hpp>
@@ -77,3 +78,100 @@ BOOST_AUTO_TEST_CASE(haar_detector_test_with_no_face)
 
     BOOST_CHECK_EQUAL(detections.size(), 0);
 }
+
+
+BOOST_AUTO_TEST_CASE(haar_detector_test_presence_matches_full_detection)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 400,
+            "height": 400
+        },
+        "scale_factor": "1.1"
+    }
+})";
+    std::stringstream buffer;
+    buffer << data;
+
+    boost::property_tree::ptree detector_settings;
+    boost::property_tree::read_json(buffer, detector_settings);
+
+    auto detector = detection::create_detector(detector_settings);
+
+    // the fine scale steps put the windows of some faces on the boundaries of the presence bands
+    std::size_t images_number = 0;
+    for (const auto &entry: std::filesystem::directory_iterator(std::filesystem::current_path() / "test_resources")) {
+        const auto image = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+        if (image.empty()) {
+            continue;
+        }
+        images_number++;
+
+        const auto faces_number = detector->count(image, detection::Mode::FULL);
+        BOOST_CHECK_EQUAL(detector->count(image, detection::Mode::PRESENCE), (faces_number > 0) ? 1 : 0);
+        BOOST_CHECK_EQUAL(detector->count(image, detection::Mode::COUNT), faces_number);
+    }
+    BOOST_CHECK_GT(images_number, 0);
+}
+
+
+BOOST_AUTO_TEST_CASE(haar_detector_test_presence_bands_of_default_description)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+    std::stringstream buffer;
+    buffer << data;
+
+    boost::property_tree::ptree detector_settings;
+    boost::property_tree::read_json(buffer, detector_settings);
+
+    auto detector = detection::create_detector(detector_settings);
+    auto haar_detector = dynamic_cast<detection::haar::HaarDetector *>(detector.get());
+    BOOST_REQUIRE(haar_detector != nullptr);
+
+    // the bands cover all the face sizes, and a pyramid level is searched by one band only, so a negative image
+    // doesn't cost more than the full detection
+    const auto &bands = haar_detector->presence_bands();
+    BOOST_REQUIRE_GT(bands.size(), 1);
+    BOOST_CHECK_EQUAL(bands.front().second.width, 200);
+    BOOST_CHECK_EQUAL(bands.back().first.width, 10);
+    for (std::size_t i = 1; i < bands.size(); i++) {
+        BOOST_CHECK_GE(bands[i].second.width, bands[i - 1].first.width);
+        BOOST_CHECK_LT(bands[i].second.width, bands[i - 1].first.width * 2.0);
+    }
+
+    std::size_t images_number = 0;
+    for (const auto &entry: std::filesystem::directory_iterator(std::filesystem::current_path() / "test_resources")) {
+        const auto image = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+        if (image.empty()) {
+            continue;
+        }
+        images_number++;
+
+        const auto faces_number = detector->count(image, detection::Mode::FULL);
+        BOOST_CHECK_EQUAL(detector->count(image, detection::Mode::PRESENCE), (faces_number > 0) ? 1 : 0);
+    }
+    BOOST_CHECK_GT(images_number, 0);
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+#include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+#include "processor/detector_pool.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <fstream>
+
+
+namespace {
+
+    const char *HAAR_DESCRIPTION = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+
+    boost::property_tree::ptree bundle_description(const std::string &bundle_file_name) {
+        boost::property_tree::ptree settings;
+        settings.put("bundle_file_name", bundle_file_name);
+        boost::property_tree::ptree description;
+        description.put("type", "bundle");
+        description.put_child("settings", settings);
+        return description;
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(model_bundle_test_bundled_detector_detects_as_the_file_one)
+{
+    {
+        std::ofstream description_file("bundle_description.json", std::ios::trunc);
+        description_file << HAAR_DESCRIPTION;
+    }
+    detection::compile_bundle("bundle_description.json", "haar.bundle");
+    BOOST_REQUIRE(std::filesystem::exists("haar.bundle"));
+
+    // the cascade is stored without its formatting
+    {
+        const detection::bundle::ModelBundle model_bundle{"haar.bundle"};
+        BOOST_REQUIRE(model_bundle.contains("haarcascade.xml"));
+        BOOST_CHECK(model_bundle.entry("haarcascade.xml").size() < std::filesystem::file_size("haarcascade.xml"));
+        BOOST_CHECK_EQUAL(model_bundle.description().get<std::string>("settings.cascade_file_name"),
+                          "haarcascade.xml");
+    }
+
+    auto detector = detection::create_detector(bundle_description("haar.bundle"));
+    const auto image = cv::imread(
+            (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(),
+            cv::IMREAD_COLOR);
+    BOOST_CHECK_EQUAL(detector->detect(image).size(), 1);
+
+    std::stringstream buffer;
+    buffer << HAAR_DESCRIPTION;
+    boost::property_tree::ptree file_description;
+    boost::property_tree::read_json(buffer, file_description);
+    const auto expected_detections = detection::create_detector(file_description)->detect(image);
+    const auto detections = detector->detect(image);
+    BOOST_REQUIRE_EQUAL(detections.size(), expected_detections.size());
+    for (std::size_t i = 0; i < detections.size(); i++) {
+        BOOST_CHECK(detections[i] == expected_detections[i]);
+    }
+
+    std::filesystem::remove("bundle_description.json");
+    std::filesystem::remove("haar.bundle");
+}
+
+
+BOOST_AUTO_TEST_CASE(model_bundle_test_broken_bundle_is_rejected)
+{
+    {
+        std::ofstream description_file("bundle_description.json", std::ios::trunc);
+        description_file << HAAR_DESCRIPTION;
+    }
+    detection::compile_bundle("bundle_description.json", "haar.bundle");
+    const auto bundle_size = std::filesystem::file_size("haar.bundle");
+
+    std::filesystem::copy_file("haar.bundle", "truncated.bundle", std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file("truncated.bundle", bundle_size / 2);
+    BOOST_CHECK_THROW(detection::create_detector(bundle_description("truncated.bundle")), detection::CreationError);
+
+    {
+        std::ofstream not_bundle_file("not.bundle", std::ios::trunc);
+        not_bundle_file << HAAR_DESCRIPTION;
+    }
+    BOOST_CHECK_THROW(detection::create_detector(bundle_description("not.bundle")), detection::CreationError);
+    BOOST_CHECK_THROW(detection::create_detector(bundle_description("missing.bundle")), detection::CreationError);
+
+    for (const auto *file_name: {"bundle_description.json", "haar.bundle", "truncated.bundle", "not.bundle"}) {
+        std::filesystem::remove(file_name);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(model_bundle_test_detector_pool_maps_the_bundle_once)
+{
+    {
+        std::ofstream description_file("bundle_description.json", std::ios::trunc);
+        description_file << HAAR_DESCRIPTION;
+    }
+    detection::compile_bundle("bundle_description.json", "haar.bundle");
+
+    processing::DetectorPool pool{bundle_description("haar.bundle")};
+    auto detectors = pool.acquire(2);
+
+    // the later detectors are created from the mapping of the first one, so the removed file isn't opened again
+    std::filesystem::remove("haar.bundle");
+    detectors.push_back(pool.acquire());
+    BOOST_CHECK_EQUAL(pool.created_detectors(), 3);
+
+    const auto image = cv::imread(
+            (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(),
+            cv::IMREAD_COLOR);
+    for (auto &detector: detectors) {
+        BOOST_CHECK_EQUAL(detector->detect(image).size(), 1);
+    }
+
+    std::filesystem::remove("bundle_description.json");
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+#include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <atomic>
+#include <thread>
+
+
+namespace {
+
+    boost::property_tree::ptree read_description(const char *data) {
+        std::stringstream buffer;
+        buffer << data;
+        boost::property_tree::ptree description;
+        boost::property_tree::read_json(buffer, description);
+        return description;
+    }
+
+
+    const char *HAAR_DESCRIPTION = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+}
+
+
+BOOST_AUTO_TEST_CASE(router_detector_test_images_take_the_first_matching_route)
+{
+    auto description = read_description(R"({
+    "type": "router",
+    "settings": {
+        "routes": [
+            {"name": "thumbnails", "max_width": 100, "max_height": 100},
+            {"name": "panoramas", "min_aspect_ratio": 2.5, "max_workers": 1},
+            {"name": "archive", "path_contains": "archive/"},
+            {"name": "wide", "min_width": 1000}
+        ]
+    }
+})");
+    for (auto &[key, route]: description.get_child("settings.routes")) {
+        route.add_child("detector", read_description(HAAR_DESCRIPTION));
+    }
+    auto detector = detection::create_detector(description);
+
+    const auto image = cv::imread(
+            (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(),
+            cv::IMREAD_COLOR);
+    BOOST_REQUIRE(image.cols > 100);
+    BOOST_REQUIRE(image.cols < 1000);
+    cv::Mat thumbnail, panorama;
+    cv::resize(image, thumbnail, cv::Size(80, 60));
+    cv::resize(image, panorama, cv::Size(1500, 500));
+
+    BOOST_CHECK_EQUAL(detector->route(thumbnail, {}), "thumbnails");
+    BOOST_CHECK_EQUAL(detector->route(panorama, {}), "panoramas");
+    BOOST_CHECK_EQUAL(detector->route(image, {"photos/archive/1.bmp", 1000}), "archive");
+    BOOST_CHECK_THROW(detector->route(image, {"photos/1.bmp", 1000}), detection::ProcessingError);
+    BOOST_CHECK_THROW(detector->detect(image), detection::ProcessingError);
+    // the warm-up reaches every route, whichever route the image would take
+    BOOST_CHECK_NO_THROW(detector->warm_up(image));
+
+    // the routed image is detected by the route's detector
+    const auto faces = detector->detect(image, {"photos/archive/1.bmp", 1000});
+    BOOST_CHECK_EQUAL(faces.size(), 1);
+    BOOST_CHECK(faces == detection::create_detector(read_description(HAAR_DESCRIPTION))->detect(image));
+}
+
+
+BOOST_AUTO_TEST_CASE(router_detector_test_worker_shares_limit_the_route_workers)
+{
+    detection::router::WorkerShares shares;
+    std::atomic<int> active_workers{0};
+    std::atomic<int> max_active_workers{0};
+    std::vector<std::thread> workers;
+    for (int i = 0; i < 4; i++) {
+        workers.emplace_back([&]() {
+            for (int j = 0; j < 20; j++) {
+                while (!shares.try_acquire("groups", 2)) {
+                    std::this_thread::yield();
+                }
+                const auto active = ++active_workers;
+                auto max_active = max_active_workers.load();
+                while ((active > max_active) && !max_active_workers.compare_exchange_weak(max_active, active)) {
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                active_workers--;
+                shares.release("groups");
+
+                // an unlimited route is never busy
+                BOOST_REQUIRE(shares.try_acquire("portraits", 0));
+                shares.release("portraits");
+            }
+        });
+    }
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    BOOST_CHECK_LE(max_active_workers.load(), 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(router_detector_test_busy_route_calls_back_instead_of_waiting)
+{
+    auto description = read_description(R"({
+    "type": "router",
+    "settings": {
+        "routes": [
+            {"name": "all", "max_workers": 1}
+        ]
+    }
+})");
+    for (auto &[key, route]: description.get_child("settings.routes")) {
+        route.add_child("detector", read_description(HAAR_DESCRIPTION));
+    }
+    auto shares = std::make_shared<detection::router::WorkerShares>();
+    auto detector = detection::create_detector(description, shares);
+
+    const auto image = cv::imread(
+            (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(),
+            cv::IMREAD_COLOR);
+
+    // another worker holds the only slot of the route
+    BOOST_REQUIRE(shares->try_acquire("all", 1));
+    std::vector<int> callbacks;
+    try {
+        detector->detect(image);
+        BOOST_FAIL("the busy route has detected");
+    } catch (const detection::BusyError &error) {
+        // the first woken image gives the slot up, e.g. its job is cancelled, so the next one gets it
+        BOOST_CHECK(error.notify_when_free([&callbacks]() {
+            callbacks.push_back(1);
+            return false;
+        }));
+        BOOST_CHECK(error.notify_when_free([&callbacks]() {
+            callbacks.push_back(2);
+            return true;
+        }));
+        BOOST_CHECK(error.notify_when_free([&callbacks]() {
+            callbacks.push_back(3);
+            return true;
+        }));
+    }
+    BOOST_CHECK(callbacks.empty());
+
+    shares->release("all");
+    BOOST_CHECK(callbacks == std::vector<int>({1, 2}));
+
+    // the slot the detection gives back wakes the last one
+    BOOST_CHECK_EQUAL(detector->detect(image).size(), 1);
+    BOOST_CHECK(callbacks == std::vector<int>({1, 2, 3}));
+
+    // a route which has got free meanwhile doesn't take a callback
+    BOOST_REQUIRE(shares->try_acquire("all", 1));
+    try {
+        detector->count(image, detection::Mode::COUNT);
+        BOOST_FAIL("the busy route has counted");
+    } catch (const detection::BusyError &error) {
+        shares->release("all");
+        BOOST_CHECK(!error.notify_when_free([]() { return true; }));
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(router_detector_test_bad_routes_are_rejected)
+{
+    BOOST_CHECK_THROW(detection::create_detector(read_description(R"({"type": "router", "settings": {"routes": []}})")),
+                      detection::CreationError);
+    BOOST_CHECK_THROW(detection::create_detector(read_description(
+            R"({"type": "router", "settings": {"routes": [{"name": "no_detector"}]}})")), detection::CreationError);
+}
\ No newline at end of file
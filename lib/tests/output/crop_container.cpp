@@ -0,0 +1,93 @@
+#include "output/crop_container.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <thread>
+
+
+namespace {
+
+    output::ContainerRecord make_record(std::size_t index) {
+        output::ContainerRecord record;
+        record.metadata = "{\"index\":" + std::to_string(index) + "}";
+        for (std::size_t crop_index = 0; crop_index < index % 4; crop_index++) {
+            record.crops.emplace_back(100 + 37 * index + crop_index, static_cast<unsigned char>(index + crop_index));
+        }
+        return record;
+    }
+
+
+    std::string make_key(std::size_t index) {
+        return "folder_" + std::to_string(index % 7) + "/image\t" + std::to_string(index) + ".jpg";
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(crop_container_test_concurrent_appends_are_read_back)
+{
+    const std::size_t RECORDS_NUMBER = 400;
+    const std::filesystem::path directory{"crop_container_test"};
+
+    {
+        // small segments and buffer, so the rotation and the direct writes are covered too
+        output::ContainerConfig config;
+        config.max_segment_size = 16 * 1024;
+        config.write_buffer_size = 1024;
+        output::ContainerWriter writer(directory, config);
+
+        std::vector<std::thread> workers;
+        for (std::size_t worker = 0; worker < 4; worker++) {
+            workers.emplace_back([&writer, worker]() {
+                for (std::size_t i = worker; i < RECORDS_NUMBER; i += 4) {
+                    writer.append(make_key(i), make_record(i));
+                }
+            });
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+        writer.close();
+        BOOST_CHECK_THROW(writer.append(make_key(0), make_record(0)), output::ContainerError);
+    }
+    BOOST_CHECK(std::filesystem::exists(directory / output::segment_file_name(1)));
+
+    output::ContainerReader reader(directory);
+    BOOST_CHECK_EQUAL(reader.keys().size(), RECORDS_NUMBER);
+    BOOST_CHECK(!reader.contains("folder_0/missing.jpg"));
+    BOOST_CHECK_THROW(reader.read("folder_0/missing.jpg"), output::ContainerError);
+
+    for (std::size_t i = 0; i < RECORDS_NUMBER; i++) {
+        const auto expected_record = make_record(i);
+        const auto record = reader.read(make_key(i));
+        BOOST_REQUIRE_EQUAL(record.metadata, expected_record.metadata);
+        BOOST_REQUIRE(record.crops == expected_record.crops);
+        BOOST_REQUIRE_EQUAL(reader.crops_number(make_key(i)), expected_record.crops.size());
+        if (!expected_record.crops.empty()) {
+            BOOST_REQUIRE(reader.read_crop(make_key(i), expected_record.crops.size() - 1) ==
+                          expected_record.crops.back());
+        }
+    }
+    BOOST_CHECK_THROW(reader.read_crop(make_key(1), 1), output::ContainerError);
+
+    std::filesystem::remove_all(directory);
+}
+
+
+BOOST_AUTO_TEST_CASE(crop_container_test_last_record_of_a_key_wins)
+{
+    const std::filesystem::path directory{"crop_container_test"};
+    {
+        output::ContainerWriter writer(directory);
+        writer.append("image.jpg", make_record(1));
+        writer.append("other.jpg", make_record(2));
+        writer.append("image.jpg", make_record(3));
+    }
+
+    output::ContainerReader reader(directory);
+    BOOST_REQUIRE_EQUAL(reader.keys().size(), 2);
+    BOOST_CHECK_EQUAL(reader.keys()[0], "image.jpg");
+    BOOST_CHECK_EQUAL(reader.read("image.jpg").metadata, make_record(3).metadata);
+
+    std::filesystem::remove_all(directory);
+}
\ No newline at end of file
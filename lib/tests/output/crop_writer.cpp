@@ -0,0 +1,91 @@
+#include "output/crop_writer.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <filesystem>
+#include <thread>
+
+
+BOOST_AUTO_TEST_CASE(bounded_queue_test_full_queue_blocks_the_producer)
+{
+    output::BoundedQueue<int> queue{1};
+    std::chrono::steady_clock::duration blocked_time;
+    BOOST_CHECK(queue.push(1, blocked_time));
+    BOOST_CHECK(blocked_time == std::chrono::steady_clock::duration::zero());
+
+    std::chrono::steady_clock::duration producer_blocked_time;
+    std::thread producer([&queue, &producer_blocked_time]() { queue.push(2, producer_blocked_time); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(queue.pop().value(), 1);
+    producer.join();
+    BOOST_CHECK(producer_blocked_time >= std::chrono::milliseconds(40));
+
+    queue.close();
+    BOOST_CHECK(!queue.push(3, blocked_time));
+    std::vector<int> values;
+    BOOST_CHECK(queue.pop_all(values));
+    BOOST_CHECK(values == std::vector<int>{2});
+    BOOST_CHECK(!queue.pop_all(values));
+    BOOST_CHECK_EQUAL(queue.max_size(), 1);
+}
+
+
+BOOST_AUTO_TEST_CASE(crop_writer_test_crops_are_written_in_the_faces_order)
+{
+    const auto image_path = (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string();
+    const auto image = cv::imread(image_path, cv::IMREAD_COLOR);
+    BOOST_REQUIRE(!image.empty());
+
+    const std::size_t IMAGES_NUMBER = 20;
+    output::CropWriterConfig config;
+    config.encoders_number = 2;
+    config.queue_capacity = 2;
+    config.jpeg_quality = 80;
+    output::CropWriter writer{config};
+
+    // the writes run on the single writer thread, the results are checked after the close
+    std::vector<std::pair<std::size_t, output::EncodedCrops>> written;
+    for (std::size_t i = 0; i < IMAGES_NUMBER; i++) {
+        writer.push(output::CropTask{
+                image_path,
+                {cv::Rect(0, 0, 10, 20), cv::Rect(image.cols, image.rows, 10, 10),
+                 cv::Rect(image.cols - 5, 0, 10, 10)},
+                [&written, i](output::EncodedCrops &&crops) { written.emplace_back(i, std::move(crops)); }});
+    }
+    writer.push(output::CropTask{"missing.jpg", {cv::Rect(0, 0, 10, 10)},
+                                 [&written, index = IMAGES_NUMBER](output::EncodedCrops &&crops) {
+                                     written.emplace_back(index, std::move(crops));
+                                 }});
+    writer.push(output::CropTask{image_path, {}, [](output::EncodedCrops &&) { throw std::runtime_error("write"); }});
+    writer.close();
+
+    BOOST_REQUIRE_EQUAL(written.size(), IMAGES_NUMBER + 1);
+    for (const auto &[index, crops]: written) {
+        if (index == IMAGES_NUMBER) {
+            BOOST_CHECK(crops.empty());
+            continue;
+        }
+        BOOST_REQUIRE_EQUAL(crops.size(), 3);
+        BOOST_CHECK(crops[1].empty());
+
+        const auto first_crop = cv::imdecode(crops[0], cv::IMREAD_COLOR);
+        BOOST_CHECK_EQUAL(first_crop.cols, 10);
+        BOOST_CHECK_EQUAL(first_crop.rows, 20);
+        // clamped by the image
+        const auto last_crop = cv::imdecode(crops[2], cv::IMREAD_COLOR);
+        BOOST_CHECK_EQUAL(last_crop.cols, 5);
+        BOOST_CHECK_EQUAL(last_crop.rows, 10);
+    }
+
+    const auto stats = writer.stats();
+    BOOST_CHECK_EQUAL(stats.images, IMAGES_NUMBER + 2);
+    BOOST_CHECK_EQUAL(stats.crops, 2 * IMAGES_NUMBER);
+    BOOST_CHECK_EQUAL(stats.failed_images, 1);
+    BOOST_CHECK_EQUAL(stats.failed_writes, 1);
+    BOOST_CHECK_EQUAL(stats.queued_images, 0);
+    BOOST_CHECK(stats.max_queued_images <= config.queue_capacity);
+    BOOST_CHECK_EQUAL(stats.queue_capacity, config.queue_capacity);
+    BOOST_CHECK(stats.blocked_pushes <= IMAGES_NUMBER + 2);
+}
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include "output/folder_results.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <filesystem>
+#include <thread>
+
+
+namespace {
+
+    boost::property_tree::ptree read_folder_results(const std::filesystem::path &folder_path) {
+        boost::property_tree::ptree root;
+        boost::property_tree::read_json((folder_path / output::FOLDER_RESULTS_FILE_NAME).string(), root);
+        return root;
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(folder_results_writer_test_one_file_per_folder)
+{
+    const std::size_t FOLDERS_NUMBER = 100;
+    const std::size_t IMAGES_PER_FOLDER = 10;
+    const std::filesystem::path results_dir{"folder_results_test"};
+    for (std::size_t folder = 0; folder < FOLDERS_NUMBER; folder++) {
+        std::filesystem::create_directories(results_dir / std::to_string(folder));
+    }
+
+    output::FolderResultsWriter writer;
+
+    // more folders in flight than the open files limit, so some files are reopened for appending
+    std::vector<std::thread> workers;
+    for (std::size_t worker = 0; worker < 4; worker++) {
+        workers.emplace_back([&writer, &results_dir, worker]() {
+            for (std::size_t image = worker; image < IMAGES_PER_FOLDER; image += 4) {
+                for (std::size_t folder = 0; folder < FOLDERS_NUMBER; folder++) {
+                    const auto image_path = results_dir / std::to_string(folder) / (std::to_string(image) + ".jpg");
+                    writer.append(image_path.string(),
+                                  "{\"image_path\": \"" + image_path.generic_string() + "\"}\n");
+                }
+            }
+        });
+    }
+    for (auto &worker: workers) {
+        worker.join();
+    }
+
+    // the completed folder is final before the close, the other one is finalized by the close
+    writer.complete((results_dir / "0").string());
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!std::filesystem::exists(results_dir / "0" / output::FOLDER_RESULTS_FILE_NAME) &&
+           (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    BOOST_CHECK_EQUAL(read_folder_results(results_dir / "0").get_child("results").size(), IMAGES_PER_FOLDER);
+    BOOST_CHECK(!std::filesystem::exists(results_dir / "1" / output::FOLDER_RESULTS_FILE_NAME));
+
+    BOOST_CHECK(writer.close());
+    for (std::size_t folder = 0; folder < FOLDERS_NUMBER; folder++) {
+        const auto results = read_folder_results(results_dir / std::to_string(folder)).get_child("results");
+        BOOST_REQUIRE_EQUAL(results.size(), IMAGES_PER_FOLDER);
+        for (const auto &[key, result]: results) {
+            BOOST_CHECK_EQUAL(std::filesystem::path(result.get<std::string>("image_path")).parent_path().filename(),
+                              std::to_string(folder));
+        }
+        BOOST_CHECK(!std::filesystem::exists(
+                results_dir / std::to_string(folder) /
+                (std::string{output::FOLDER_RESULTS_FILE_NAME} + output::PARTIAL_FOLDER_RESULTS_SUFFIX)));
+    }
+
+    std::filesystem::remove_all(results_dir);
+}
+
+
+BOOST_AUTO_TEST_CASE(folder_results_writer_test_completed_folder_without_results)
+{
+    const std::filesystem::path results_dir{"folder_results_test"};
+    std::filesystem::create_directories(results_dir);
+
+    output::FolderResultsWriter writer;
+    writer.complete(results_dir.string());
+    BOOST_CHECK(writer.close());
+    writer.append((results_dir / "late.jpg").string(), "{}");
+
+    BOOST_CHECK(read_folder_results(results_dir).get_child("results").empty());
+
+    std::filesystem::remove_all(results_dir);
+}
\ No newline at end of file
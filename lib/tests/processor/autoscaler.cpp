@@ -0,0 +1,122 @@
+#include "processor/processor.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+
+namespace {
+
+    processing::ScalingSample make_sample(std::size_t workers_number, std::size_t queued_tasks,
+                                          std::uint64_t processed_tasks, std::chrono::microseconds busy_time,
+                                          double cpu_utilization = 0.1) {
+        const std::chrono::microseconds period(200000);
+        return processing::ScalingSample{workers_number, queued_tasks, processed_tasks, busy_time,
+                                         std::chrono::microseconds(0), period, cpu_utilization};
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(autoscaler_test_grows_on_backlog)
+{
+    processing::Autoscaler autoscaler{processing::AutoscalingConfig{1, 8}};
+
+    // 2 fully busy workers with 50 ms per image and 100 queued images need 25 workers, the growth is capped
+    auto decision = autoscaler.decide(make_sample(2, 100, 8, std::chrono::microseconds(400000)));
+    BOOST_CHECK_EQUAL(decision.workers_number, 4);
+    decision = autoscaler.decide(make_sample(4, 100, 16, std::chrono::microseconds(800000)));
+    BOOST_CHECK_EQUAL(decision.workers_number, 8);
+    decision = autoscaler.decide(make_sample(8, 100, 32, std::chrono::microseconds(1600000)));
+    BOOST_CHECK_EQUAL(decision.workers_number, 8);
+}
+
+
+BOOST_AUTO_TEST_CASE(autoscaler_test_holds_when_cpu_is_saturated)
+{
+    processing::Autoscaler autoscaler{processing::AutoscalingConfig{1, 8}};
+
+    auto decision = autoscaler.decide(make_sample(2, 100, 8, std::chrono::microseconds(400000), 0.95));
+    BOOST_CHECK_EQUAL(decision.workers_number, 2);
+}
+
+
+BOOST_AUTO_TEST_CASE(autoscaler_test_shrinks_after_idle_periods)
+{
+    processing::Autoscaler autoscaler{processing::AutoscalingConfig{2, 8}};
+
+    for (std::size_t i = 1; i < processing::Autoscaler::IDLE_PERIODS_BEFORE_SHRINK; i++) {
+        BOOST_CHECK_EQUAL(autoscaler.decide(make_sample(3, 0, 0, std::chrono::microseconds(0))).workers_number, 3);
+    }
+    BOOST_CHECK_EQUAL(autoscaler.decide(make_sample(3, 0, 0, std::chrono::microseconds(0))).workers_number, 2);
+
+    // never below the minimum
+    for (std::size_t i = 0; i < 2 * processing::Autoscaler::IDLE_PERIODS_BEFORE_SHRINK; i++) {
+        BOOST_CHECK_EQUAL(autoscaler.decide(make_sample(2, 0, 0, std::chrono::microseconds(0))).workers_number, 2);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(autoscaler_test_scaling_by_processor)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    const std::size_t COPIES = 10;
+    std::filesystem::path images_dir(std::filesystem::current_path() / "test_resources_autoscaling");
+    std::filesystem::remove_all(images_dir);
+    for (std::size_t i = 0; i < COPIES; i++) {
+        std::filesystem::copy(std::filesystem::current_path() / "test_resources", images_dir / std::to_string(i),
+                              std::filesystem::copy_options::recursive);
+    }
+
+    processing::InitConfig init_config{1, detector_config_path.string()};
+    init_config.autoscaling = processing::AutoscalingConfig{1, 4, std::chrono::milliseconds(20)};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+    BOOST_CHECK_EQUAL(processor.active_workers_number(), 1);
+
+    std::atomic<std::size_t> images_counter = 0;
+    auto processor_process_result = processor.process(images_dir.string(),
+                                                      [&images_counter](std::string processed_image_path,
+                                                                        std::vector<cv::Rect> faces) {
+                                                          images_counter++;
+                                                      });
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(processor_process_result));
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(images_counter), 6 * COPIES);
+
+    // the decisions depend on the machine, only the bounds are checked
+    for (const auto &event: processor.scaling_events()) {
+        BOOST_TEST_MESSAGE(event.from_workers_number << " -> " << event.to_workers_number << ": " << event.reason);
+        BOOST_CHECK_GE(event.to_workers_number, 1);
+        BOOST_CHECK_LE(event.to_workers_number, 4);
+    }
+
+    std::filesystem::remove_all(images_dir);
+    std::filesystem::remove(detector_config_path);
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "processor/process_pool.hpp"
+#include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include <chrono>
+#include <csignal>
+#include <filesystem>
+#include <future>
+#include <sstream>
+#include <thread>
+
+
+namespace {
+
+    const auto JOB_START_TIME = std::chrono::milliseconds(300);
+
+
+    boost::property_tree::ptree make_haar_settings(const std::string &cascade_file_name) {
+        std::stringstream buffer;
+        buffer << R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": ")" << cascade_file_name << R"(",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "1.05"
+    }
+})";
+        boost::property_tree::ptree settings;
+        boost::property_tree::read_json(buffer, settings);
+        return settings;
+    }
+
+
+    // a mosaic of the test faces, large enough for a detection to last well beyond the JOB_START_TIME
+    std::string write_slow_image() {
+        const auto image = cv::imread(
+                (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(),
+                cv::IMREAD_COLOR);
+        cv::Mat mosaic;
+        cv::repeat(image, 3000 / image.rows + 1, 3000 / image.cols + 1, mosaic);
+        const auto image_path = (std::filesystem::current_path() / "process_pool_slow_image.bmp").string();
+        cv::imwrite(image_path, mosaic);
+        return image_path;
+    }
+
+
+    // waits for a worker other than the given one and kills it once it has claimed the image
+    int kill_worker_in_job(const processing::ProcessPool &pool, int previous_worker_pid) {
+        auto worker_pids = pool.worker_pids();
+        while (worker_pids.empty() || (worker_pids.front() == previous_worker_pid)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            worker_pids = pool.worker_pids();
+        }
+        std::this_thread::sleep_for(JOB_START_TIME);
+        kill(worker_pids.front(), SIGKILL);
+        return worker_pids.front();
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(process_pool_test_crashed_worker_is_restarted_and_its_image_retried)
+{
+    if (!processing::is_process_pool_supported()) {
+        return;
+    }
+
+    const auto settings = make_haar_settings("haarcascade.xml");
+    const auto image_path = write_slow_image();
+    const auto expected_faces = detection::create_detector(settings)->detect(cv::imread(image_path, cv::IMREAD_COLOR));
+
+    processing::ProcessPool pool(1, settings);
+    auto faces = std::async(std::launch::async, [&pool, &image_path]() { return pool.run(image_path); });
+    const auto killed_worker_pid = kill_worker_in_job(pool, 0);
+
+    // the restarted worker detects the image from the start
+    BOOST_CHECK(faces.get() == expected_faces);
+    BOOST_REQUIRE_EQUAL(pool.worker_pids().size(), 1);
+    BOOST_CHECK_NE(pool.worker_pids().front(), killed_worker_pid);
+    BOOST_CHECK(!pool.is_failed());
+
+    std::filesystem::remove(image_path);
+}
+
+
+BOOST_AUTO_TEST_CASE(process_pool_test_image_crashing_every_attempt_is_failed)
+{
+    if (!processing::is_process_pool_supported()) {
+        return;
+    }
+
+    const auto settings = make_haar_settings("haarcascade.xml");
+    const auto image_path = write_slow_image();
+
+    processing::ProcessPool pool(1, settings);
+    auto faces = std::async(std::launch::async, [&pool, &image_path]() { return pool.run(image_path); });
+    int killed_worker_pid = 0;
+    for (std::uint32_t attempt = 0; attempt < processing::ProcessPool::MAX_JOB_ATTEMPTS; attempt++) {
+        killed_worker_pid = kill_worker_in_job(pool, killed_worker_pid);
+    }
+    BOOST_CHECK_THROW(faces.get(), detection::ProcessingError);
+
+    // the crashes in the middle of an image don't fail the pool
+    BOOST_CHECK(!pool.is_failed());
+    const auto test_image_path = (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp");
+    BOOST_CHECK_EQUAL(pool.run(test_image_path.string()).size(), 1);
+
+    std::filesystem::remove(image_path);
+}
+
+
+BOOST_AUTO_TEST_CASE(process_pool_test_worker_crashed_before_notifying_its_result)
+{
+    if (!processing::is_process_pool_supported()) {
+        return;
+    }
+
+    // every worker dies right after writing the result of its first image, before notifying it
+    setenv("DETECTION_WORKER_CRASH_AFTER_JOB", "1", 1);
+    processing::ProcessPool pool(1, make_haar_settings("haarcascade.xml"));
+    unsetenv("DETECTION_WORKER_CRASH_AFTER_JOB");
+
+    const auto test_image_path = (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp");
+    for (std::uint32_t i = 0; i < processing::ProcessPool::MAX_FAILED_WORKER_STARTS; i++) {
+        auto faces = std::async(std::launch::async, [&pool, &test_image_path]() {
+            return pool.run(test_image_path.string());
+        });
+        BOOST_REQUIRE(faces.wait_for(std::chrono::seconds(30)) == std::future_status::ready);
+        BOOST_CHECK_EQUAL(faces.get().size(), 1);
+    }
+    BOOST_CHECK(!pool.is_failed());
+}
+
+
+BOOST_AUTO_TEST_CASE(process_pool_test_failing_worker_starts_fail_the_pool)
+{
+    if (!processing::is_process_pool_supported()) {
+        return;
+    }
+
+    // the detectors can't be created anymore once the cascade is gone
+    const std::string cascade_file_name = "process_pool_haarcascade.xml";
+    std::filesystem::copy_file(std::filesystem::current_path() / "haarcascade.xml",
+                               std::filesystem::current_path() / cascade_file_name,
+                               std::filesystem::copy_options::overwrite_existing);
+    processing::ProcessPool pool(1, make_haar_settings(cascade_file_name));
+    std::filesystem::remove(std::filesystem::current_path() / cascade_file_name);
+
+    kill(pool.worker_pids().front(), SIGKILL);
+    const auto start_time = std::chrono::steady_clock::now();
+    while (!pool.is_failed() && (std::chrono::steady_clock::now() - start_time < std::chrono::seconds(30))) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    BOOST_REQUIRE(pool.is_failed());
+    BOOST_CHECK(pool.worker_pids().empty());
+
+    const auto test_image_path = (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp");
+    BOOST_CHECK_THROW(pool.run(test_image_path.string()), detection::ProcessingError);
+}
\ No newline at end of file
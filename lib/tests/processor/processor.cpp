@@ -5,7 +5,10 @@
 
 #include <opencv2/imgcodecs.hpp>
 
+#include <algorithm>
 #include <atomic>
+#include <map>
+#include <mutex>
 
 
 BOOST_AUTO_TEST_CASE(processor_test_simple_by_haar_detector)
@@ -107,3 +110,764 @@ BOOST_AUTO_TEST_CASE(processor_test_simple_by_caffe_detector)
 
     std::filesystem::remove(detector_config_path);
 }
+
+
+BOOST_AUTO_TEST_CASE(processor_test_worker_processes_by_haar_detector)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    if (!processing::is_process_pool_supported()) {
+        return;
+    }
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    // a broken image must be skipped without aborting the run
+    std::filesystem::path images_dir(std::filesystem::current_path() / "test_resources_with_broken_image");
+    std::filesystem::remove_all(images_dir);
+    std::filesystem::copy(std::filesystem::current_path() / "test_resources", images_dir,
+                          std::filesystem::copy_options::recursive);
+    std::ofstream broken_image_file(images_dir / "broken.jpg", std::ios::binary);
+    broken_image_file << "\xFF\xD8\xFF\xE0 definitely not a jpeg";
+    broken_image_file.close();
+
+    processing::InitConfig init_config{4, detector_config_path.string(), EXECUTION_MODE::EXECUTION_PROCESSES};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    std::atomic<std::size_t> images_counter = 0;
+    std::atomic<std::size_t> faces_counter = 0;
+    auto processor_process_result = processor.process(images_dir.string(),
+                                                      [&images_counter, &faces_counter](
+                                                              std::string processed_image_path,
+                                                              std::vector<cv::Rect> faces) {
+                                                          images_counter++;
+                                                          faces_counter += faces.size();
+                                                      });
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(processor_process_result));
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(images_counter), 6);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(faces_counter), 3);
+
+    std::filesystem::remove_all(images_dir);
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_priority_classes_under_mixed_load)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 400,
+            "height": 400
+        },
+        "scale_factor": "1.2"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    // the backfill is many linked copies of the test images, a backlog of seconds whose queued heads are past
+    // the aging limits, the interactive requests are single images
+    const std::size_t BACKFILL_COPIES = 150;
+    std::filesystem::path backfill_dir(std::filesystem::current_path() / "test_resources_backfill");
+    std::filesystem::remove_all(backfill_dir);
+    for (std::size_t i = 0; i < BACKFILL_COPIES; i++) {
+        std::filesystem::copy(std::filesystem::current_path() / "test_resources", backfill_dir / std::to_string(i),
+                              std::filesystem::copy_options::recursive |
+                              std::filesystem::copy_options::create_hard_links);
+    }
+    std::filesystem::path interactive_image_path(
+            std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp");
+
+    processing::InitConfig init_config{2, detector_config_path.string()};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    std::atomic<std::size_t> backfill_images_counter = 0;
+    std::thread backfill([&processor, &backfill_dir, &backfill_images_counter]() {
+        processing::ProcessOptions options;
+        options.priority = PRIORITY_CLASS::PRIORITY_BACKFILL;
+        auto processor_process_result = processor.process(backfill_dir.string(), options,
+                                                          [&backfill_images_counter](
+                                                                  const processing::ImageResult &result) {
+                                                              backfill_images_counter++;
+                                                          });
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                          static_cast<std::size_t>(processor_process_result));
+    });
+
+    // the interactive requests arrive once the backfill head has waited past its aging limit
+    std::this_thread::sleep_for(std::chrono::milliseconds(2500));
+    const std::size_t INTERACTIVE_REQUESTS = 10;
+    std::size_t interactive_faces_counter = 0;
+    for (std::size_t i = 0; i < INTERACTIVE_REQUESTS; i++) {
+        processing::ProcessOptions options;
+        options.priority = PRIORITY_CLASS::PRIORITY_INTERACTIVE;
+        auto processor_process_result = processor.process(interactive_image_path.string(), options,
+                                                          [&interactive_faces_counter](
+                                                                  const processing::ImageResult &result) {
+                                                              interactive_faces_counter += result.faces.size();
+                                                          });
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                          static_cast<std::size_t>(processor_process_result));
+    }
+    backfill.join();
+
+    BOOST_CHECK_EQUAL(interactive_faces_counter, INTERACTIVE_REQUESTS);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(backfill_images_counter), 6 * BACKFILL_COPIES);
+
+    for (auto priority: {PRIORITY_CLASS::PRIORITY_INTERACTIVE, PRIORITY_CLASS::PRIORITY_BACKFILL}) {
+        auto report = processor.latency_report(priority);
+        BOOST_TEST_MESSAGE("priority class " << priority << ": " << report.images_number << " images, p50 "
+                                             << report.p50.count() << " us, p99 " << report.p99.count() << " us");
+    }
+    const auto interactive_report = processor.latency_report(PRIORITY_CLASS::PRIORITY_INTERACTIVE);
+    const auto backfill_report = processor.latency_report(PRIORITY_CLASS::PRIORITY_BACKFILL);
+    BOOST_CHECK_EQUAL(interactive_report.images_number, INTERACTIVE_REQUESTS);
+    // the interactive images never wait behind the aged backlog; the absolute bounds depend on the machine speed,
+    // so only the order of the classes is checked
+    BOOST_WARN_GT(backfill_report.p99.count(), std::chrono::microseconds(std::chrono::seconds(2)).count());
+    BOOST_CHECK_LT(interactive_report.p99.count(), backfill_report.p99.count());
+    BOOST_WARN_LT(interactive_report.p99.count(), std::chrono::microseconds(std::chrono::seconds(2)).count());
+
+    std::filesystem::remove_all(backfill_dir);
+    std::filesystem::remove(detector_config_path);
+}
+
+
+BOOST_AUTO_TEST_CASE(processor_test_expired_images_are_dropped)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    processing::InitConfig init_config{1, detector_config_path.string()};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    std::filesystem::path images_dir(std::filesystem::current_path() / "test_resources");
+    std::atomic<std::size_t> images_counter = 0;
+    processing::ProcessOptions options;
+    options.deadline = std::chrono::milliseconds(1);
+    options.deadline_policy = DEADLINE_POLICY::DEADLINE_DROP;
+    auto processor_process_result = processor.process(images_dir.string(), options,
+                                                      [&images_counter](const processing::ImageResult &result) {
+                                                          images_counter++;
+                                                      });
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(processor_process_result));
+
+    // every image is either delivered or dropped, never both
+    auto report = processor.latency_report(PRIORITY_CLASS::PRIORITY_NORMAL);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(images_counter), report.images_number);
+    BOOST_CHECK_EQUAL(report.images_number + report.dropped_images_number, 6);
+
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_cancelled_job_reports_consistent_progress)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    const std::size_t COPIES = 10;
+    std::filesystem::path images_dir(std::filesystem::current_path() / "test_resources_cancel");
+    std::filesystem::remove_all(images_dir);
+    for (std::size_t i = 0; i < COPIES; i++) {
+        std::filesystem::copy(std::filesystem::current_path() / "test_resources", images_dir / std::to_string(i),
+                              std::filesystem::copy_options::recursive);
+    }
+
+    processing::InitConfig init_config{1, detector_config_path.string()};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    std::atomic<std::size_t> images_counter = 0;
+    std::shared_ptr<processing::Job> job;
+    auto processor_start_result = processor.start(images_dir.string(), processing::ProcessOptions{},
+                                                  [&images_counter](const processing::ImageResult &result) {
+                                                      images_counter++;
+                                                  }, job);
+    BOOST_REQUIRE_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                        static_cast<std::size_t>(processor_start_result));
+
+    job->cancel();
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_CANCELLED),
+                      static_cast<std::size_t>(job->wait()));
+
+    // every discovered image is accounted exactly once, nothing stays in flight after wait()
+    auto progress = job->progress();
+    BOOST_CHECK(progress.finished);
+    BOOST_CHECK(progress.cancelled);
+    BOOST_CHECK_EQUAL(progress.queued, 0);
+    BOOST_CHECK_EQUAL(progress.detected, static_cast<std::size_t>(images_counter));
+    BOOST_CHECK_EQUAL(progress.detected + progress.failed + progress.dropped, progress.discovered);
+    BOOST_CHECK_LE(progress.discovered, 6 * COPIES);
+
+    std::filesystem::remove_all(images_dir);
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_in_memory_images_by_haar_detector)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    std::vector<cv::Mat> images;
+    for (const auto &entry: std::filesystem::recursive_directory_iterator(
+            std::filesystem::current_path() / "test_resources")) {
+        if (entry.is_regular_file()) {
+            images.emplace_back(cv::imread(entry.path().string(), cv::IMREAD_COLOR));
+        }
+    }
+    BOOST_REQUIRE_EQUAL(images.size(), 6);
+
+    processing::InitConfig init_config{4, detector_config_path.string()};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    std::mutex results_mutex;
+    std::vector<std::uint64_t> image_indices;
+    std::size_t faces_counter = 0;
+    std::shared_ptr<processing::Job> job;
+    auto processor_start_result = processor.start(images, processing::ProcessOptions{},
+                                                  [&](const processing::ImageResult &result) {
+                                                      std::lock_guard lk{results_mutex};
+                                                      BOOST_CHECK(result.image_path.empty());
+                                                      image_indices.push_back(result.image_index);
+                                                      faces_counter += result.faces.size();
+                                                  }, job);
+    BOOST_REQUIRE_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                        static_cast<std::size_t>(processor_start_result));
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(job->wait()));
+
+    // every image is delivered once and is identified by its position in the submission
+    std::sort(image_indices.begin(), image_indices.end());
+    BOOST_CHECK_EQUAL(image_indices.size(), 6);
+    for (std::size_t i = 0; i < image_indices.size(); i++) {
+        BOOST_CHECK_EQUAL(image_indices[i], i);
+    }
+    BOOST_CHECK_EQUAL(faces_counter, 3);
+
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_folder_callback_follows_the_folder_results)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    processing::InitConfig init_config{4, detector_config_path.string()};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    std::mutex results_mutex;
+    std::map<std::string, std::size_t> folder_results_numbers;
+    std::map<std::string, std::size_t> completed_folder_results_numbers;
+    std::size_t late_results_number = 0;
+    std::size_t repeated_completions_number = 0;
+    processing::ProcessOptions options;
+    options.folder_callback = [&](const std::string &folder_path) {
+        std::lock_guard lk{results_mutex};
+        repeated_completions_number += completed_folder_results_numbers.count(folder_path);
+        completed_folder_results_numbers[folder_path] = folder_results_numbers[folder_path];
+    };
+
+    std::shared_ptr<processing::Job> job;
+    const auto images_dir = std::filesystem::current_path() / "test_resources";
+    auto processor_start_result = processor.start(images_dir.string(), options,
+                                                  [&](const processing::ImageResult &result) {
+                                                      const auto folder_path = std::filesystem::path(
+                                                              result.image_path).parent_path().string();
+                                                      std::lock_guard lk{results_mutex};
+                                                      folder_results_numbers[folder_path]++;
+                                                      late_results_number +=
+                                                              completed_folder_results_numbers.count(folder_path);
+                                                  }, job);
+    BOOST_REQUIRE_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                        static_cast<std::size_t>(processor_start_result));
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(job->wait()));
+
+    // every folder with images is completed once, after all its results and before the job
+    std::lock_guard lk{results_mutex};
+    BOOST_CHECK_EQUAL(late_results_number, 0);
+    BOOST_CHECK_EQUAL(repeated_completions_number, 0);
+    BOOST_CHECK_EQUAL(completed_folder_results_numbers.size(), 4);
+    BOOST_CHECK(completed_folder_results_numbers == folder_results_numbers);
+    BOOST_CHECK_EQUAL(completed_folder_results_numbers[images_dir.string()], 2);
+    BOOST_CHECK_EQUAL(completed_folder_results_numbers[(images_dir / "inner_folder_1" / "inner_folder_1_2").string()],
+                      2);
+
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_reload_swaps_the_description_while_processing)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    processing::InitConfig init_config{2, detector_config_path.string()};
+
+    processing::Processor processor;
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_UNINITIALIZED_LIB),
+                      static_cast<std::size_t>(processor.reload(detector_config_path.string())));
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+    BOOST_CHECK_EQUAL(processor.config_version(), 1);
+
+    // a failed reload keeps the description
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_FILES_WAS_NOT_FOUND),
+                      static_cast<std::size_t>(processor.reload(
+                              (std::filesystem::current_path() / "missing_config.json").string())));
+    BOOST_CHECK_EQUAL(processor.config_version(), 1);
+
+    std::mutex results_mutex;
+    std::vector<std::uint64_t> config_versions;
+    const auto callback = [&](const processing::ImageResult &result) {
+        std::lock_guard lk{results_mutex};
+        config_versions.push_back(result.config_version);
+    };
+
+    // the reload runs while the job is being processed, the images are served by either description
+    std::shared_ptr<processing::Job> job;
+    const auto images_dir = std::filesystem::current_path() / "test_resources";
+    BOOST_REQUIRE_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                        static_cast<std::size_t>(processor.start(images_dir.string(), processing::ProcessOptions{},
+                                                                 callback, job)));
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor.reload(detector_config_path.string())));
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(job->wait()));
+    BOOST_CHECK_EQUAL(processor.config_version(), 2);
+    {
+        std::lock_guard lk{results_mutex};
+        BOOST_CHECK_EQUAL(config_versions.size(), 6);
+        BOOST_CHECK(std::all_of(config_versions.begin(), config_versions.end(),
+                                [](std::uint64_t version) { return (version == 1) || (version == 2); }));
+        config_versions.clear();
+    }
+
+    // every image started after the reload is detected by the new description
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(processor.process(images_dir.string(), processing::ProcessOptions{},
+                                                                 callback)));
+    std::lock_guard lk{results_mutex};
+    BOOST_CHECK_EQUAL(config_versions.size(), 6);
+    BOOST_CHECK(std::all_of(config_versions.begin(), config_versions.end(),
+                            [](std::uint64_t version) { return version == 2; }));
+
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_processors_share_the_worker_budget_and_detectors)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    auto budget = std::make_shared<processing::WorkerBudget>(3);
+    const auto images_dir = std::filesystem::current_path() / "test_resources";
+    {
+        processing::InitConfig first_config{2, detector_config_path.string()};
+        first_config.worker_budget = budget;
+        processing::Processor first_processor;
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                          static_cast<std::size_t>(first_processor.init(first_config)));
+        BOOST_CHECK_EQUAL(budget->available(), 1);
+
+        // the second processor gets the rest of the budget only
+        processing::InitConfig second_config{2, std::string()};
+        second_config.worker_budget = budget;
+        second_config.detector_pool = first_processor.detector_pool();
+        processing::Processor second_processor;
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_INCORRECT_WORKER_NUMBER),
+                          static_cast<std::size_t>(second_processor.init(second_config)));
+        BOOST_CHECK_EQUAL(budget->available(), 1);
+
+        second_config.workers_number = 1;
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                          static_cast<std::size_t>(second_processor.init(second_config)));
+        BOOST_CHECK_EQUAL(budget->available(), 0);
+        BOOST_CHECK(second_processor.detector_pool() == first_processor.detector_pool());
+
+        std::atomic<std::size_t> first_images_counter = 0;
+        std::atomic<std::size_t> second_images_counter = 0;
+        std::shared_ptr<processing::Job> first_job;
+        std::shared_ptr<processing::Job> second_job;
+        BOOST_REQUIRE_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                            static_cast<std::size_t>(first_processor.start(
+                                    images_dir.string(), processing::ProcessOptions{},
+                                    [&first_images_counter](const processing::ImageResult &) {
+                                        first_images_counter++;
+                                    }, first_job)));
+        BOOST_REQUIRE_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                            static_cast<std::size_t>(second_processor.start(
+                                    images_dir.string(), processing::ProcessOptions{},
+                                    [&second_images_counter](const processing::ImageResult &) {
+                                        second_images_counter++;
+                                    }, second_job)));
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                          static_cast<std::size_t>(first_job->wait()));
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                          static_cast<std::size_t>(second_job->wait()));
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(first_images_counter), 6);
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(second_images_counter), 6);
+    }
+
+    // the stopped workers return their slots
+    BOOST_CHECK_EQUAL(budget->available(), 3);
+
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_count_and_presence_modes_give_the_faces_number_only)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(processing::InitConfig{2, detector_config_path.string()});
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    const auto images_dir = std::filesystem::current_path() / "test_resources";
+    for (auto mode: {DETECTION_MODE::DETECTION_FULL, DETECTION_MODE::DETECTION_COUNT,
+                     DETECTION_MODE::DETECTION_PRESENCE}) {
+        processing::ProcessOptions options;
+        options.detection_mode = mode;
+        std::atomic<std::size_t> images_counter = 0;
+        std::atomic<std::size_t> faces_counter = 0;
+        std::atomic<std::size_t> rects_counter = 0;
+        auto processor_process_result = processor.process(images_dir.string(), options,
+                                                          [&](const processing::ImageResult &result) {
+                                                              images_counter++;
+                                                              faces_counter += result.faces_number;
+                                                              rects_counter += result.faces.size();
+                                                          });
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                          static_cast<std::size_t>(processor_process_result));
+
+        // every face image has a single face, so the presence of the faces gives the same number
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(images_counter), 6);
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(faces_counter), 3);
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(rects_counter), (mode == DETECTION_MODE::DETECTION_FULL) ? 3 : 0);
+    }
+
+    processing::ProcessOptions options;
+    options.detection_mode = static_cast<DETECTION_MODE>(3);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_INCORRECT_OPTIONS),
+                      static_cast<std::size_t>(processor.process(images_dir.string(), options,
+                                                                 [](const processing::ImageResult &) {})));
+
+    std::filesystem::remove(detector_config_path);
+}
+
+BOOST_AUTO_TEST_CASE(processor_test_frame_sequences_are_tracked_in_order)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    // the frames of a face moving by a few pixels, numbered without the padding, so only the numbers order them
+    const auto image = cv::imread(
+            (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(), cv::IMREAD_COLOR);
+    BOOST_REQUIRE(!image.empty());
+    const std::size_t FRAMES_NUMBER = 12;
+    const auto frames_dir = std::filesystem::current_path() / "frame_sequence";
+    std::filesystem::create_directories(frames_dir);
+    std::vector<std::string> frame_paths;
+    for (std::size_t i = 0; i < FRAMES_NUMBER; i++) {
+        frame_paths.push_back((frames_dir / ("frame_" + std::to_string(i + 1) + ".bmp")).string());
+        BOOST_REQUIRE(cv::imwrite(frame_paths.back(),
+                                  image(cv::Rect(48 - 4 * static_cast<int>(i), 24 - 2 * static_cast<int>(i), 540,
+                                                 740))));
+    }
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(processing::InitConfig{4, detector_config_path.string()});
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    processing::ProcessOptions options;
+    options.sequence = processing::SequenceConfig{};
+    options.sequence->keyframe_interval = 5;
+    std::mutex results_mutex;
+    std::vector<std::string> result_paths;
+    auto processor_process_result = processor.process(frames_dir.string(), options,
+                                                      [&](const processing::ImageResult &result) {
+                                                          std::lock_guard lk{results_mutex};
+                                                          result_paths.push_back(result.image_path);
+                                                      });
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(processor_process_result));
+    BOOST_CHECK(result_paths == frame_paths);
+
+    // at least the keyframes are detected in full
+    const auto stats = processor.stats().to_json();
+    BOOST_CHECK_EQUAL(stats.get<std::size_t>("sequences.keyframe.frames") +
+                      stats.get<std::size_t>("sequences.scene_change.frames") +
+                      stats.get<std::size_t>("sequences.lost_face.frames") +
+                      stats.get<std::size_t>("sequences.tracked.frames"), FRAMES_NUMBER);
+    BOOST_CHECK(stats.get<std::size_t>("sequences.tracked.frames") <= FRAMES_NUMBER - 3);
+
+    // the folders which aren't sequences are detected image by image
+    std::atomic<std::size_t> images_counter = 0;
+    std::atomic<std::size_t> faces_counter = 0;
+    const auto images_dir = std::filesystem::current_path() / "test_resources";
+    processor_process_result = processor.process(images_dir.string(), options,
+                                                 [&](const processing::ImageResult &result) {
+                                                     images_counter++;
+                                                     faces_counter += result.faces.size();
+                                                 });
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(processor_process_result));
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(images_counter), 6);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(faces_counter), 3);
+
+    options.sequence->keyframe_interval = 0;
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_INCORRECT_OPTIONS),
+                      static_cast<std::size_t>(processor.process(frames_dir.string(), options,
+                                                                 [](const processing::ImageResult &) {})));
+
+    std::filesystem::remove_all(frames_dir);
+    std::filesystem::remove(detector_config_path);
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "processor/result_batcher.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <thread>
+
+
+namespace {
+
+    processing::ImageResult make_result(std::size_t index) {
+        processing::ImageResult result;
+        result.image_path = "image_" + std::to_string(index) + ".jpg";
+        result.image_index = index;
+        result.faces.resize(index % 3, cv::Rect(1, 2, 3, 4));
+        return result;
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(completion_buffer_test_concurrent_producers_and_consumers)
+{
+    const std::size_t PRODUCERS_NUMBER = 4;
+    const std::size_t VALUES_PER_PRODUCER = 20000;
+
+    processing::CompletionBuffer<std::size_t> buffer(100);
+    BOOST_CHECK_EQUAL(buffer.capacity(), 128);
+
+    std::vector<std::thread> producers;
+    for (std::size_t producer = 0; producer < PRODUCERS_NUMBER; producer++) {
+        producers.emplace_back([&buffer, producer]() {
+            for (std::size_t i = 0; i < VALUES_PER_PRODUCER; i++) {
+                auto value = producer * VALUES_PER_PRODUCER + i;
+                while (!buffer.try_push(value)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    // every value is taken exactly once
+    std::vector<std::size_t> taken_values;
+    std::size_t value;
+    while (taken_values.size() < PRODUCERS_NUMBER * VALUES_PER_PRODUCER) {
+        if (buffer.try_pop(value)) {
+            taken_values.push_back(value);
+        }
+    }
+    for (auto &producer: producers) {
+        producer.join();
+    }
+
+    BOOST_CHECK(!buffer.try_pop(value));
+    std::sort(taken_values.begin(), taken_values.end());
+    for (std::size_t i = 0; i < taken_values.size(); i++) {
+        BOOST_REQUIRE_EQUAL(taken_values[i], i);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(result_batcher_test_batches_are_bounded_and_complete)
+{
+    const std::size_t RESULTS_NUMBER = 1000;
+
+    std::vector<std::size_t> batch_sizes;
+    std::vector<std::uint64_t> delivered_indices;
+    std::size_t broken_results_number = 0;
+    processing::BatchingConfig config{16, std::chrono::milliseconds(20)};
+    processing::ResultBatcher batcher(config, [&](const std::vector<processing::ImageResult> &batch) {
+        // a single delivery thread calls it, so no lock is needed
+        batch_sizes.push_back(batch.size());
+        for (const auto &result: batch) {
+            broken_results_number += (result.faces.size() != result.image_index % 3) ? 1 : 0;
+            delivered_indices.push_back(result.image_index);
+        }
+    });
+
+    std::vector<std::thread> workers;
+    for (std::size_t worker = 0; worker < 4; worker++) {
+        workers.emplace_back([&batcher, worker]() {
+            for (std::size_t i = worker; i < RESULTS_NUMBER; i += 4) {
+                batcher.push(make_result(i));
+            }
+        });
+    }
+    for (auto &worker: workers) {
+        worker.join();
+    }
+    batcher.close();
+
+    BOOST_CHECK_EQUAL(broken_results_number, 0);
+    BOOST_CHECK(std::all_of(batch_sizes.begin(), batch_sizes.end(), [](std::size_t size) {
+        return (size > 0) && (size <= 16);
+    }));
+    // most of the results come in full batches, not one by one
+    BOOST_CHECK_LT(batch_sizes.size(), RESULTS_NUMBER / 4);
+
+    std::sort(delivered_indices.begin(), delivered_indices.end());
+    BOOST_REQUIRE_EQUAL(delivered_indices.size(), RESULTS_NUMBER);
+    for (std::size_t i = 0; i < delivered_indices.size(); i++) {
+        BOOST_CHECK_EQUAL(delivered_indices[i], i);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(result_batcher_test_partial_batch_is_delivered_after_the_delay)
+{
+    std::atomic<std::size_t> delivered_number{0};
+    processing::BatchingConfig config{64, std::chrono::milliseconds(20)};
+    processing::ResultBatcher batcher(config, [&](const std::vector<processing::ImageResult> &batch) {
+        delivered_number += batch.size();
+    });
+
+    batcher.push(make_result(0));
+    batcher.push(make_result(1));
+
+    // the batch never fills up, the results must not wait for the close
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((delivered_number < 2) && (std::chrono::steady_clock::now() < deadline)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(delivered_number), 2);
+    batcher.close();
+}
+
+
+BOOST_AUTO_TEST_CASE(result_batcher_test_poll)
+{
+    processing::ResultBatcher batcher;
+    std::vector<processing::ImageResult> results;
+    BOOST_CHECK_EQUAL(batcher.poll(results, 10, std::chrono::milliseconds(0)), 0);
+
+    for (std::size_t i = 0; i < 5; i++) {
+        batcher.push(make_result(i));
+    }
+    BOOST_CHECK_EQUAL(batcher.poll(results, 3, std::chrono::milliseconds(0)), 3);
+    BOOST_CHECK_EQUAL(batcher.poll(results, 3, std::chrono::milliseconds(0)), 2);
+    BOOST_REQUIRE_EQUAL(results.size(), 5);
+    for (std::size_t i = 0; i < results.size(); i++) {
+        BOOST_CHECK_EQUAL(results[i].image_index, i);
+    }
+
+    // a waiting poll is woken by the next result
+    std::thread producer([&batcher]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        batcher.push(make_result(5));
+    });
+    results.clear();
+    BOOST_CHECK_EQUAL(batcher.poll(results, 10, std::chrono::seconds(5)), 1);
+    producer.join();
+
+    // a closed batcher doesn't keep a poll waiting
+    batcher.close();
+    const auto start_time = std::chrono::steady_clock::now();
+    BOOST_CHECK_EQUAL(batcher.poll(results, 10, std::chrono::seconds(5)), 0);
+    BOOST_CHECK(std::chrono::steady_clock::now() - start_time < std::chrono::seconds(1));
+}
+
+BOOST_AUTO_TEST_CASE(result_batcher_test_slow_consumer_pauses_the_feeding_only)
+{
+    const std::size_t CAPACITY = 16;
+    const std::size_t RESULTS_NUMBER = 100;
+
+    auto feed_gate = std::make_shared<processing::FeedGate>(CAPACITY);
+    processing::ResultBatcher batcher(CAPACITY, feed_gate);
+
+    // the feeding stands for the walk, each fed image is pushed right away as by a free worker
+    std::atomic<std::size_t> fed_number{0};
+    std::thread feeder([&]() {
+        for (std::size_t i = 0; i < RESULTS_NUMBER; i++) {
+            feed_gate->enter();
+            batcher.push(make_result(i));
+            fed_number++;
+        }
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK_EQUAL(fed_number.load(), CAPACITY);
+
+    // every poll makes room for the taken results
+    std::vector<processing::ImageResult> results;
+    while (results.size() < RESULTS_NUMBER) {
+        batcher.poll(results, 5, std::chrono::seconds(5));
+    }
+    feeder.join();
+    for (std::size_t i = 0; i < results.size(); i++) {
+        BOOST_CHECK_EQUAL(results[i].image_index, i);
+    }
+
+    // an opened gate lets the feeding run ahead, a push never waits for the consumer
+    feed_gate->open();
+    for (std::size_t i = 0; i < 3 * CAPACITY; i++) {
+        feed_gate->enter();
+        batcher.push(make_result(i));
+    }
+    results.clear();
+    BOOST_CHECK_EQUAL(batcher.poll(results, 4 * CAPACITY, std::chrono::milliseconds(0)), 3 * CAPACITY);
+
+    // a closed batcher drops the results which don't fit the buffer
+    batcher.close();
+    for (std::size_t i = 0; i < 2 * CAPACITY; i++) {
+        batcher.push(make_result(i));
+    }
+    results.clear();
+    BOOST_CHECK_EQUAL(batcher.poll(results, 4 * CAPACITY, std::chrono::milliseconds(0)), CAPACITY);
+}
\ No newline at end of file
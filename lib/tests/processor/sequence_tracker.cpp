@@ -0,0 +1,80 @@
+#include "processor/sequence_tracker.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <filesystem>
+
+
+BOOST_AUTO_TEST_CASE(sequence_tracker_test_frames_are_ordered_by_their_numbers)
+{
+    std::vector<std::filesystem::path> image_paths{"frames/frame_10.jpg", "frames/frame_9.jpg",
+                                                   "frames/frame_0011.jpg", "frames/frame_1.jpg"};
+    BOOST_CHECK((processing::order_frames(image_paths, 4) ==
+                 std::vector<std::string>{"frames/frame_1.jpg", "frames/frame_9.jpg", "frames/frame_10.jpg",
+                                          "frames/frame_0011.jpg"}));
+    BOOST_CHECK(processing::order_frames(image_paths, 5).empty());
+
+    // another prefix, another extension, no number, an ambiguous number
+    for (const auto *odd_path: {"frames/shot_12.jpg", "frames/frame_12.bmp", "frames/frame_.jpg",
+                                "frames/frame_01.jpg"}) {
+        auto odd_image_paths = image_paths;
+        odd_image_paths.emplace_back(odd_path);
+        BOOST_CHECK(processing::order_frames(odd_image_paths, 2).empty());
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(sequence_tracker_test_faces_are_followed_between_keyframes)
+{
+    const auto image = cv::imread(
+            (std::filesystem::current_path() / "test_resources" / "face_front_1_rgb.bmp").string(), cv::IMREAD_COLOR);
+    BOOST_REQUIRE(!image.empty());
+
+    // the content moves by (4, 2) pixels from frame to frame
+    const auto frame = [&image](int index) {
+        return image(cv::Rect(40 - 4 * index, 20 - 2 * index, 540, 740)).clone();
+    };
+    const cv::Rect face(200, 250, 180, 180);
+    const auto moved_face = [&face](int index) {
+        return cv::Rect(face.x + 4 * index, face.y + 2 * index, face.width, face.height);
+    };
+
+    processing::SequenceConfig config;
+    config.keyframe_interval = 3;
+    processing::SequenceTracker tracker{config};
+    std::vector<cv::Rect> faces;
+    BOOST_CHECK(tracker.track(frame(0), faces) == processing::FrameKind::KEYFRAME);
+    BOOST_CHECK(faces.empty());
+    BOOST_CHECK(!tracker.reset({face}).has_value());
+
+    for (int index = 1; index < 3; index++) {
+        BOOST_REQUIRE(tracker.track(frame(index), faces) == processing::FrameKind::TRACKED);
+        BOOST_REQUIRE_EQUAL(faces.size(), 1);
+        BOOST_CHECK(faces[0] == moved_face(index));
+    }
+
+    // the followed face matches the detected one exactly, and doesn't match a missing one at all
+    BOOST_CHECK(tracker.track(frame(3), faces) == processing::FrameKind::KEYFRAME);
+    BOOST_CHECK(faces.empty());
+    BOOST_CHECK_CLOSE(tracker.reset({moved_face(3)}).value(), 0.0, 1e-9);
+
+    BOOST_CHECK(tracker.track(frame(4), faces) == processing::FrameKind::TRACKED);
+    BOOST_CHECK(tracker.track(frame(5), faces) == processing::FrameKind::TRACKED);
+    BOOST_CHECK(tracker.track(frame(6), faces) == processing::FrameKind::KEYFRAME);
+    BOOST_CHECK_CLOSE(tracker.reset({}).value(), 1.0, 1e-9);
+
+    BOOST_CHECK(tracker.reset({face}) == std::nullopt);
+    BOOST_CHECK(tracker.track(cv::Mat::zeros(740, 540, CV_8UC3), faces) == processing::FrameKind::SCENE_CHANGE);
+    // a failed detection leaves the next frame to a detection
+    BOOST_CHECK(tracker.track(frame(7), faces) == processing::FrameKind::KEYFRAME);
+    BOOST_CHECK(!tracker.reset({face}).has_value());
+
+    // the face is gone from its search window, whether or not the noise counts as a scene change
+    BOOST_CHECK(tracker.track(frame(7), faces) == processing::FrameKind::TRACKED);
+    cv::Mat noise_frame(740, 540, CV_8UC3);
+    cv::randu(noise_frame, cv::Scalar::all(0), cv::Scalar::all(255));
+    BOOST_CHECK(tracker.track(noise_frame, faces) != processing::FrameKind::TRACKED);
+    BOOST_CHECK(faces.empty());
+}
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "processor/processor.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+#include <mutex>
+#include <set>
+
+
+BOOST_AUTO_TEST_CASE(sharding_test_stable_hash)
+{
+    // reference FNV-1a 64 values, the hash must never change between releases
+    BOOST_CHECK_EQUAL(processing::stable_path_hash(""), 14695981039346656037ULL);
+    BOOST_CHECK_EQUAL(processing::stable_path_hash("a"), 12638187200555641996ULL);
+    BOOST_CHECK_EQUAL(processing::stable_path_hash(std::filesystem::path("inner_folder_1") / "face.bmp"),
+                      processing::stable_path_hash("inner_folder_1/face.bmp"));
+}
+
+
+BOOST_AUTO_TEST_CASE(sharding_test_shard_validity)
+{
+    BOOST_CHECK(processing::is_valid_shard(processing::ShardConfig{}));
+    BOOST_CHECK(processing::is_valid_shard(processing::ShardConfig{2, 3}));
+    BOOST_CHECK(!processing::is_valid_shard(processing::ShardConfig{3, 3}));
+    BOOST_CHECK(!processing::is_valid_shard(processing::ShardConfig{0, 0}));
+}
+
+
+BOOST_AUTO_TEST_CASE(sharding_test_shards_cover_folder_without_overlap)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    processing::InitConfig init_config{2, detector_config_path.string()};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    const std::size_t SHARD_COUNT = 3;
+    std::filesystem::path images_dir(std::filesystem::current_path() / "test_resources");
+    std::mutex processed_paths_mutex;
+    std::multiset<std::string> processed_paths;
+    for (std::size_t shard_index = 0; shard_index < SHARD_COUNT; shard_index++) {
+        auto processor_process_result = processor.process(images_dir.string(),
+                                                          processing::ShardConfig{shard_index, SHARD_COUNT},
+                                                          [&processed_paths_mutex, &processed_paths](
+                                                                  std::string processed_image_path,
+                                                                  std::vector<cv::Rect> faces) {
+                                                              std::lock_guard lk{processed_paths_mutex};
+                                                              processed_paths.insert(processed_image_path);
+                                                          });
+        BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                          static_cast<std::size_t>(processor_process_result));
+    }
+
+    BOOST_CHECK_EQUAL(processed_paths.size(), 6);
+    BOOST_CHECK_EQUAL(std::set<std::string>(processed_paths.begin(), processed_paths.end()).size(), 6);
+
+    auto incorrect_shard_result = processor.process(images_dir.string(), processing::ShardConfig{3, 3},
+                                                    [](std::string processed_image_path,
+                                                       std::vector<cv::Rect> faces) {});
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_INCORRECT_SHARD),
+                      static_cast<std::size_t>(incorrect_shard_result));
+
+    std::filesystem::remove(detector_config_path);
+}
\ No newline at end of file
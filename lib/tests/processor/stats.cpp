@@ -0,0 +1,154 @@
+#include "processor/processor.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE(stats_test_shards_are_merged)
+{
+    processing::Stats stats;
+    auto &first_shard = stats.acquire_shard();
+    auto &second_shard = stats.acquire_shard();
+    BOOST_CHECK_NE(&first_shard, &second_shard);
+
+    first_shard.images++;
+    first_shard.faces += 2;
+    first_shard.record(processing::Stage::DETECT, std::chrono::microseconds(100));
+    second_shard.images++;
+    second_shard.record(processing::Stage::DETECT, std::chrono::microseconds(300));
+    second_shard.record_failure(processing::Failure::DECODE);
+    stats.record_dropped();
+
+    // a released shard is reused and keeps its values
+    stats.release_shard(second_shard);
+    BOOST_CHECK_EQUAL(&stats.acquire_shard(), &second_shard);
+
+    auto json = stats.to_json();
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("images"), 2);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("faces"), 2);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("dropped"), 1);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("failures.decode"), 1);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("failures.detect"), 0);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("stages.detect.count"), 2);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("stages.detect.sum_us"), 400);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("stages.decode.count"), 0);
+
+    auto prometheus = stats.to_prometheus();
+    BOOST_CHECK(prometheus.find("face_detection_images_total 2\n") != std::string::npos);
+    BOOST_CHECK(prometheus.find("face_detection_failures_total{reason=\"decode\"} 1\n") != std::string::npos);
+    BOOST_CHECK(prometheus.find("face_detection_stage_duration_microseconds_count{stage=\"detect\"} 2\n") !=
+                std::string::npos);
+    BOOST_CHECK(prometheus.find("route_") == std::string::npos);
+    BOOST_CHECK(prometheus.find("time_to_ready") == std::string::npos);
+    BOOST_CHECK(json.find("startup") == json.not_found());
+
+    // only the first image counts
+    stats.record_ready(std::chrono::microseconds(5000), std::chrono::microseconds(3000));
+    stats.record_first_image(std::chrono::microseconds(700));
+    stats.record_first_image(std::chrono::microseconds(100));
+    json = stats.to_json();
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("startup.time_to_ready_us"), 5000);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("startup.warmup_us"), 3000);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("startup.first_image_latency_us"), 700);
+    prometheus = stats.to_prometheus();
+    BOOST_CHECK(prometheus.find("face_detection_time_to_ready_microseconds 5000\n") != std::string::npos);
+    BOOST_CHECK(prometheus.find("face_detection_first_image_latency_microseconds 700\n") != std::string::npos);
+
+    // the routes are resolved once by name, the shards count them apart and a route without images isn't exported
+    const auto portraits_route = stats.route_index("portraits");
+    const auto groups_route = stats.route_index("groups");
+    BOOST_CHECK_EQUAL(stats.route_index("portraits"), portraits_route);
+    BOOST_CHECK_NE(portraits_route, groups_route);
+    stats.route_index("landscapes");
+    first_shard.record_route(portraits_route, std::chrono::microseconds(100), 1);
+    second_shard.record_route(portraits_route, std::chrono::microseconds(200), 0);
+    second_shard.record_route(groups_route, std::chrono::microseconds(5000), 7);
+    second_shard.record_route(processing::StatsShard::MAX_ROUTES_NUMBER, std::chrono::microseconds(100), 1);
+    json = stats.to_json();
+    BOOST_CHECK(json.get_child_optional("routes.landscapes") == boost::none);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("routes.portraits.images"), 2);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("routes.portraits.faces"), 1);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("routes.groups.faces"), 7);
+    BOOST_CHECK_GE(json.get<std::size_t>("routes.groups.max_us"), 5000);
+    prometheus = stats.to_prometheus();
+    BOOST_CHECK(prometheus.find("face_detection_route_images_total{route=\"portraits\"} 2\n") != std::string::npos);
+    BOOST_CHECK(prometheus.find("face_detection_route_detect_duration_microseconds_count{route=\"groups\"} 1\n") !=
+                std::string::npos);
+    BOOST_CHECK(prometheus.find("landscapes") == std::string::npos);
+}
+
+
+BOOST_AUTO_TEST_CASE(stats_test_processor_counters)
+{
+    const char *data = R"({
+    "type": "haar",
+    "settings": {
+        "cascade_file_name": "haarcascade.xml",
+        "neighbors_number": 3,
+        "min_object_size": {
+            "width": 10,
+            "height": 10
+        },
+        "max_object_size": {
+            "width": 200,
+            "height": 200
+        },
+        "scale_factor": "2.0"
+    }
+})";
+
+    std::filesystem::path detector_config_path(std::filesystem::current_path() / "config.json");
+    std::ofstream file(detector_config_path);
+    if (file) {
+        file << data;
+        file.close();
+    } else {
+        BOOST_CHECK(false);
+    }
+
+    std::filesystem::path images_dir(std::filesystem::current_path() / "test_resources_stats");
+    std::filesystem::remove_all(images_dir);
+    std::filesystem::copy(std::filesystem::current_path() / "test_resources", images_dir,
+                          std::filesystem::copy_options::recursive);
+    std::ofstream broken_image_file(images_dir / "broken.jpg", std::ios::binary);
+    broken_image_file << "\xFF\xD8\xFF\xE0 definitely not a jpeg";
+    broken_image_file.close();
+
+    processing::InitConfig init_config{2, detector_config_path.string()};
+
+    processing::Processor processor;
+    auto processor_init_result = processor.init(init_config);
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::INIT_SUCCESS),
+                      static_cast<std::size_t>(processor_init_result));
+
+    std::filesystem::path stats_file_path(std::filesystem::current_path() / "stats.prom");
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::SUCCESS),
+                      static_cast<std::size_t>(processor.export_stats(stats_file_path.string(),
+                                                                      std::chrono::milliseconds(10))));
+
+    auto processor_process_result = processor.process(images_dir.string(),
+                                                      [](std::string processed_image_path,
+                                                         std::vector<cv::Rect> faces) {});
+    BOOST_CHECK_EQUAL(static_cast<std::size_t>(RESULT_CODE::PROCESS_SUCCESS),
+                      static_cast<std::size_t>(processor_process_result));
+
+    auto json = processor.stats().to_json();
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("images"), 6);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("faces"), 3);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("failures.decode"), 1);
+    BOOST_CHECK_GT(json.get<std::size_t>("bytes_read"), 0);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("stages.queue_wait.count"), 7);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("stages.detect.count"), 6);
+    BOOST_CHECK_EQUAL(json.get<std::size_t>("stages.callback.count"), 6);
+    // both detectors were built and warmed up by init()
+    BOOST_CHECK_EQUAL(processor.detector_pool()->created_detectors(), 2);
+    BOOST_CHECK_GT(json.get<std::size_t>("startup.warmup_us"), 0);
+    BOOST_CHECK_GT(json.get<std::size_t>("startup.time_to_ready_us"), 0);
+    BOOST_CHECK(json.get_optional<std::size_t>("startup.first_image_latency_us").has_value());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_CHECK(std::filesystem::exists(stats_file_path));
+
+    std::filesystem::remove(stats_file_path);
+    std::filesystem::remove_all(images_dir);
+    std::filesystem::remove(detector_config_path);
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "tracing/tracing.hpp"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <map>
+#include <sstream>
+#include <thread>
+
+
+namespace {
+
+    boost::property_tree::ptree write_trace() {
+        std::stringstream trace;
+        tracing::write_chrome_trace(trace);
+        boost::property_tree::ptree root;
+        boost::property_tree::read_json(trace, root);
+        return root;
+    }
+
+
+    std::map<std::string, std::size_t> count_events(const boost::property_tree::ptree &root) {
+        std::map<std::string, std::size_t> events_number;
+        for (const auto &[key, event]: root.get_child("traceEvents")) {
+            if (event.get<std::string>("ph") == "X") {
+                events_number[event.get<std::string>("name")]++;
+            }
+        }
+        return events_number;
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(tracing_test_scopes_are_recorded_per_thread)
+{
+    tracing::start(16);
+
+    const std::string image_path{"inner \"folder\"/face.jpg"};
+    std::thread worker([&image_path]() {
+        tracing::set_thread_name("test_worker");
+        tracing::Scope image_scope{"image", image_path};
+        tracing::Scope detect_scope{"detect"};
+    });
+    worker.join();
+    {
+        tracing::Scope walk_scope{"walk"};
+    }
+    tracing::stop();
+    {
+        tracing::Scope ignored_scope{"ignored"};
+    }
+
+    auto root = write_trace();
+    auto events_number = count_events(root);
+    BOOST_CHECK_EQUAL(events_number["image"], 1);
+    BOOST_CHECK_EQUAL(events_number["detect"], 1);
+    BOOST_CHECK_EQUAL(events_number["walk"], 1);
+    BOOST_CHECK_EQUAL(events_number.count("ignored"), 0);
+
+    bool thread_name_found = false;
+    bool image_path_found = false;
+    for (const auto &[key, event]: root.get_child("traceEvents")) {
+        if (event.get<std::string>("name") == "thread_name") {
+            thread_name_found |= event.get<std::string>("args.name") == "test_worker";
+        }
+        if (event.get<std::string>("name") == "image") {
+            image_path_found = event.get<std::string>("args.image") == image_path;
+        }
+    }
+    BOOST_CHECK(thread_name_found);
+    BOOST_CHECK(image_path_found);
+}
+
+
+BOOST_AUTO_TEST_CASE(tracing_test_ring_keeps_latest_events)
+{
+    const std::size_t EVENTS_PER_THREAD = 8;
+    tracing::start(EVENTS_PER_THREAD);
+    for (std::size_t i = 0; i < 3 * EVENTS_PER_THREAD; i++) {
+        tracing::Scope scope{"old"};
+    }
+    for (std::size_t i = 0; i < EVENTS_PER_THREAD; i++) {
+        tracing::Scope scope{"new"};
+    }
+    tracing::stop();
+
+    auto events_number = count_events(write_trace());
+    BOOST_CHECK_EQUAL(events_number["new"], EVENTS_PER_THREAD);
+    BOOST_CHECK_EQUAL(events_number.count("old"), 0);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "tuner/tuner.hpp"
+
+#include <boost/test/unit_test.hpp>
+
+
+namespace {
+
+    tuning::Measurement make_measurement(double images_per_second, double recall, double precision,
+                                         bool created = true) {
+        tuning::Measurement measurement;
+        measurement.created = created;
+        measurement.images_per_second = images_per_second;
+        measurement.recall = recall;
+        measurement.precision = precision;
+        return measurement;
+    }
+
+}
+
+
+BOOST_AUTO_TEST_CASE(tuner_test_match_is_one_to_one)
+{
+    // a face detected twice matches one detection, the other one is a false positive
+    tuning::Measurement measurement;
+    tuning::match({{0, 0, 100, 100}, {5, 5, 100, 100}, {300, 300, 50, 50}}, {{2, 2, 100, 100}}, 0.5, measurement);
+    BOOST_CHECK_EQUAL(measurement.true_positives, 1);
+    BOOST_CHECK_EQUAL(measurement.false_positives, 2);
+    BOOST_CHECK_EQUAL(measurement.false_negatives, 0);
+
+    // two faces can't share one detection, and a detection below the intersection over union doesn't count
+    measurement = tuning::Measurement{};
+    tuning::match({{0, 0, 100, 100}, {200, 0, 20, 20}}, {{0, 0, 100, 100}, {5, 0, 100, 100}, {200, 0, 100, 100}},
+                  0.5, measurement);
+    BOOST_CHECK_EQUAL(measurement.true_positives, 1);
+    BOOST_CHECK_EQUAL(measurement.false_positives, 1);
+    BOOST_CHECK_EQUAL(measurement.false_negatives, 2);
+
+    // the counters accumulate over the images
+    tuning::match({}, {{0, 0, 10, 10}}, 0.5, measurement);
+    BOOST_CHECK_EQUAL(measurement.false_negatives, 3);
+}
+
+
+BOOST_AUTO_TEST_CASE(tuner_test_pareto_with_ties)
+{
+    std::vector<tuning::Measurement> measurements{make_measurement(100, 0.9, 0.9),
+                                                  make_measurement(100, 0.9, 0.9),
+                                                  make_measurement(50, 0.8, 0.9),
+                                                  make_measurement(200, 0.5, 0.6),
+                                                  make_measurement(100, 0.9, 0.8),
+                                                  make_measurement(1000, 1.0, 1.0, false)};
+    tuning::mark_pareto(measurements);
+
+    // equal points don't dominate each other, a point worse on one value only is dominated,
+    // a failed point is neither optimal nor dominating
+    BOOST_CHECK(measurements[0].pareto);
+    BOOST_CHECK(measurements[1].pareto);
+    BOOST_CHECK(!measurements[2].pareto);
+    BOOST_CHECK(measurements[3].pareto);
+    BOOST_CHECK(!measurements[4].pareto);
+    BOOST_CHECK(!measurements[5].pareto);
+}
+
+
+BOOST_AUTO_TEST_CASE(tuner_test_pick_meets_the_floors)
+{
+    std::vector<tuning::Measurement> measurements{make_measurement(100, 0.9, 0.9),
+                                                  make_measurement(200, 0.5, 0.6),
+                                                  make_measurement(400, 0.3, 0.95)};
+    tuning::mark_pareto(measurements);
+
+    BOOST_CHECK_EQUAL(tuning::pick(measurements, 0.0, 0.0), 2);
+    BOOST_CHECK_EQUAL(tuning::pick(measurements, 0.5, 0.5), 1);
+    BOOST_CHECK_EQUAL(tuning::pick(measurements, 0.8, 0.8), 0);
+    // no point meets both floors
+    BOOST_CHECK_EQUAL(tuning::pick(measurements, 0.95, 0.5), measurements.size());
+    BOOST_CHECK_EQUAL(tuning::pick(measurements, 0.5, 0.99), measurements.size());
+    BOOST_CHECK_EQUAL(tuning::pick({}, 0.0, 0.0), 0);
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "tuner.hpp"
+
+#include <boost/program_options.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+
+namespace po = boost::program_options;
+
+
+namespace config {
+    constexpr const char *DEFAULT_OUTPUT_FILE_NAME = "tuned_detector_description.json";
+    constexpr double DEFAULT_TARGET_RECALL = 0.9;
+} // namespace config
+
+
+namespace {
+
+    std::vector<std::string> split(const std::string &notation) {
+        std::vector<std::string> values;
+        std::stringstream stream(notation);
+        std::string value;
+        while (std::getline(stream, value, ',')) {
+            if (!value.empty()) {
+                values.push_back(value);
+            }
+        }
+        return values;
+    }
+
+
+    void write_report(std::ostream &os, const std::vector<tuning::Parameter> &parameters,
+                      const std::vector<tuning::Point> &points, const std::vector<tuning::Measurement> &measurements,
+                      std::size_t picked) {
+        os << std::fixed << std::setprecision(3);
+        for (const auto &parameter: parameters) {
+            os << parameter.name << ",";
+        }
+        os << "images_per_second,recall,precision,true_positives,false_positives,false_negatives,pareto,picked\n";
+
+        for (std::size_t i = 0; i < points.size(); i++) {
+            for (const auto &value: points[i].values) {
+                os << value << ",";
+            }
+            const auto &measurement = measurements[i];
+            if (!measurement.created) {
+                os << ",,,,,,0,0\n";
+                continue;
+            }
+            os << measurement.images_per_second << "," << measurement.recall << "," << measurement.precision << ","
+               << measurement.true_positives << "," << measurement.false_positives << ","
+               << measurement.false_negatives << "," << measurement.pareto << "," << (i == picked) << "\n";
+        }
+    }
+
+}
+
+
+int main(int argc, const char **argv) {
+    tuning::Settings settings;
+    std::string description_path;
+    std::string images_dir;
+    std::string labels_path;
+    std::string output_path;
+    std::string report_path;
+    double target_recall;
+    double min_precision;
+    std::string scale_factors;
+    std::string neighbors_numbers;
+    std::string min_object_sizes;
+    std::string max_object_sizes;
+    std::string target_image_sizes;
+    std::string confidence_levels;
+
+    po::options_description options_description("Tuner options");
+    options_description.add_options()
+            ("help,h", "Show help")
+            ("description,d",
+             po::value<std::string>(&description_path)->required(),
+             "set the detector description the tuned values are applied to")
+            ("images_dir,i",
+             po::value<std::string>(&images_dir)->required(),
+             "set the labeled sample images folder")
+            ("labels,l",
+             po::value<std::string>(&labels_path)->required(),
+             "set the labels csv with a \"relative_path,x,y,width,height\" row per face")
+            ("target_recall,r",
+             po::value<double>(&target_recall)->default_value(config::DEFAULT_TARGET_RECALL),
+             "the picked description is the fastest one with at least this recall")
+            ("min_precision",
+             po::value<double>(&min_precision)->default_value(0.0),
+             "the picked description has at least this precision")
+            ("min_iou",
+             po::value<double>(&settings.min_iou)->default_value(0.5),
+             "intersection over union from which a detection matches a labeled face")
+            ("repeats",
+             po::value<std::size_t>(&settings.repeats)->default_value(1),
+             "timed passes over the samples for every point")
+            ("output,o",
+             po::value<std::string>(&output_path)->default_value(config::DEFAULT_OUTPUT_FILE_NAME),
+             "write the picked description into the given file")
+            ("report",
+             po::value<std::string>(&report_path),
+             "write the csv of all measured points into the given file instead of the standard output")
+            ("scale_factors",
+             po::value<std::string>(&scale_factors)->default_value("1.1,1.2,1.3,1.5,2.0"),
+             "haar scale_factor values")
+            ("neighbors_numbers",
+             po::value<std::string>(&neighbors_numbers)->default_value("2,3,4,5"),
+             "haar neighbors_number values")
+            ("min_object_sizes",
+             po::value<std::string>(&min_object_sizes)->default_value("10,20,40"),
+             "haar min_object_size values, applied to the width and the height")
+            ("max_object_sizes",
+             po::value<std::string>(&max_object_sizes)->default_value("200,400"),
+             "haar max_object_size values, applied to the width and the height")
+            ("target_image_sizes",
+             po::value<std::string>(&target_image_sizes)->default_value("150,200,300"),
+             "caffe target_image_size values")
+            ("confidence_levels",
+             po::value<std::string>(&confidence_levels)->default_value("0.5,0.7,0.9,0.97"),
+             "caffe confidence_level values");
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, options_description), vm);
+        if (vm.count("help")) {
+            options_description.print(std::cout);
+            return EXIT_SUCCESS;
+        }
+        po::notify(vm);
+    }
+    catch (const po::error &error) {
+        std::cerr << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    boost::property_tree::ptree base_description;
+    try {
+        boost::property_tree::read_json(description_path, base_description);
+    } catch (const std::exception &error) {
+        std::cerr << "Can't read the detector description: " << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<tuning::Parameter> parameters;
+    const auto detector_type = base_description.get<std::string>("type", "");
+    if (detector_type == "haar") {
+        parameters = {{"scale_factor",     {"scale_factor"},     split(scale_factors)},
+                      {"neighbors_number", {"neighbors_number"}, split(neighbors_numbers)},
+                      {"min_object_size",  {"min_object_size.width", "min_object_size.height"},
+                                                                 split(min_object_sizes)},
+                      {"max_object_size",  {"max_object_size.width", "max_object_size.height"},
+                                                                 split(max_object_sizes)}};
+    } else if (detector_type == "caffe") {
+        parameters = {{"target_image_size", {"target_image_size"}, split(target_image_sizes)},
+                      {"confidence_level",  {"confidence_level"},  split(confidence_levels)}};
+    } else {
+        std::cerr << "Detector type can't be tuned: " << detector_type << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::vector<tuning::LabeledImage> samples;
+    try {
+        samples = tuning::load_samples(images_dir, labels_path);
+    } catch (const std::exception &error) {
+        std::cerr << "Can't load the samples: " << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    if (samples.empty()) {
+        std::cerr << "No images were found in: " << images_dir << "\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto points = tuning::make_grid(base_description, parameters);
+    std::vector<tuning::Measurement> measurements;
+    for (std::size_t i = 0; i < points.size(); i++) {
+        std::cerr << "measuring point " << (i + 1) << "/" << points.size() << "\r";
+        measurements.push_back(tuning::measure(points[i].description, samples, settings));
+    }
+    std::cerr << "\n";
+
+    tuning::mark_pareto(measurements);
+    const auto picked = tuning::pick(measurements, target_recall, min_precision);
+
+    if (report_path.empty()) {
+        write_report(std::cout, parameters, points, measurements, picked);
+    } else {
+        std::ofstream report(report_path, std::ios::out | std::ios::trunc);
+        if (!report) {
+            std::cerr << "Can't create the report file: " << report_path << "\n";
+            return EXIT_FAILURE;
+        }
+        write_report(report, parameters, points, measurements, picked);
+    }
+
+    if (picked == measurements.size()) {
+        std::cerr << "No measured point reaches the recall " << target_recall << " and the precision "
+                  << min_precision << "\n";
+        return EXIT_FAILURE;
+    }
+
+    try {
+        boost::property_tree::write_json(output_path, points[picked].description);
+    } catch (const std::exception &error) {
+        std::cerr << "Can't write the tuned description: " << error.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    const auto &best = measurements[picked];
+    std::cerr << std::fixed << std::setprecision(3) << "Picked " << best.images_per_second << " images/s, recall "
+              << best.recall << ", precision " << best.precision << ", written to " << output_path << "\n";
+    return EXIT_SUCCESS;
+}
\ No newline at end of file
@@ -0,0 +1,226 @@
+#include "tuner.hpp"
+
+#include "detector/detector_factory.hpp"
+#include "detector/error.hpp"
+
+#include <opencv2/imgcodecs.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+
+namespace {
+
+    double intersection_over_union(const cv::Rect &lhs, const cv::Rect &rhs) {
+        const auto intersection = static_cast<double>((lhs & rhs).area());
+        const auto united = static_cast<double>(lhs.area()) + static_cast<double>(rhs.area()) - intersection;
+        return (united > 0) ? intersection / united : 0.0;
+    }
+
+
+    std::map<std::string, std::vector<cv::Rect>> read_labels(const std::filesystem::path &labels_path) {
+        std::ifstream labels_file(labels_path);
+        if (!labels_file) {
+            throw std::runtime_error("can't open the labels file: " + labels_path.string());
+        }
+
+        std::map<std::string, std::vector<cv::Rect>> labels;
+        std::string line;
+        std::size_t line_number = 0;
+        while (std::getline(labels_file, line)) {
+            line_number++;
+            if (line.empty() || (line.rfind("relative_path", 0) == 0)) {
+                continue;
+            }
+
+            std::replace(line.begin(), line.end(), ',', ' ');
+            std::istringstream fields(line);
+            std::string relative_path;
+            cv::Rect face;
+            if (!(fields >> relative_path >> face.x >> face.y >> face.width >> face.height)) {
+                throw std::runtime_error("incorrect labels line " + std::to_string(line_number) + ": " + line);
+            }
+            labels[relative_path].push_back(face);
+        }
+        return labels;
+    }
+
+}
+
+
+namespace tuning {
+
+    std::vector<LabeledImage> load_samples(const std::filesystem::path &images_dir,
+                                           const std::filesystem::path &labels_path) {
+        auto labels = read_labels(labels_path);
+
+        std::vector<LabeledImage> samples;
+        for (const auto &entry: std::filesystem::recursive_directory_iterator(images_dir)) {
+            if (!entry.is_regular_file()) {
+                continue;
+            }
+
+            auto image = cv::imread(entry.path().string(), cv::IMREAD_COLOR);
+            if (image.empty()) {
+                continue;
+            }
+
+            auto relative_path = std::filesystem::relative(entry.path(), images_dir).generic_string();
+            auto it = labels.find(relative_path);
+            samples.push_back({relative_path, std::move(image),
+                               (it != labels.end()) ? std::move(it->second) : std::vector<cv::Rect>{}});
+            if (it != labels.end()) {
+                labels.erase(it);
+            }
+        }
+
+        for (const auto &[relative_path, faces]: labels) {
+            std::cerr << "labeled image was not found or can't be decoded: " << relative_path << "\n";
+        }
+
+        // the walk order isn't defined, the report order must be
+        std::sort(samples.begin(), samples.end(), [](const LabeledImage &lhs, const LabeledImage &rhs) {
+            return lhs.relative_path < rhs.relative_path;
+        });
+        return samples;
+    }
+
+
+    std::vector<Point> make_grid(const boost::property_tree::ptree &base_description,
+                                 const std::vector<Parameter> &parameters) {
+        std::vector<Point> points{Point{base_description, {}}};
+        for (const auto &parameter: parameters) {
+            std::vector<Point> next_points;
+            for (const auto &point: points) {
+                for (const auto &value: parameter.values) {
+                    auto next_point = point;
+                    for (const auto &key: parameter.keys) {
+                        next_point.description.put("settings." + key, value);
+                    }
+                    next_point.values.push_back(value);
+                    next_points.emplace_back(std::move(next_point));
+                }
+            }
+            points = std::move(next_points);
+        }
+        return points;
+    }
+
+
+    Measurement measure(const boost::property_tree::ptree &description, const std::vector<LabeledImage> &samples,
+                        const Settings &settings) {
+        Measurement measurement;
+        std::unique_ptr<detection::Detector> detector;
+        try {
+            detector = detection::create_detector(description);
+        } catch (const detection::CreationError &error) {
+            std::cerr << "detector creation failed: " << error.what() << "\n";
+            return measurement;
+        }
+        measurement.created = true;
+
+        const auto detect = [&detector](const cv::Mat &image) {
+            try {
+                return detector->detect(image);
+            } catch (const detection::ProcessingError &) {
+                return std::vector<cv::Rect>{};
+            }
+        };
+
+        // the first call allocates the detector buffers, it is not a part of the steady state
+        if (!samples.empty()) {
+            detect(samples.front().image);
+        }
+
+        std::chrono::steady_clock::duration detection_time{0};
+        for (std::size_t repeat = 0; repeat < std::max<std::size_t>(settings.repeats, 1); repeat++) {
+            for (const auto &sample: samples) {
+                const auto start = std::chrono::steady_clock::now();
+                auto detected = detect(sample.image);
+                detection_time += std::chrono::steady_clock::now() - start;
+
+                // the detection is deterministic, so the first pass gives the accuracy
+                if (repeat == 0) {
+                    match(detected, sample.faces, settings.min_iou, measurement);
+                }
+            }
+        }
+
+        const auto seconds = std::chrono::duration<double>(detection_time).count();
+        const auto images_number = static_cast<double>(samples.size() * std::max<std::size_t>(settings.repeats, 1));
+        measurement.images_per_second = (seconds > 0) ? images_number / seconds : 0.0;
+
+        const auto expected_number = measurement.true_positives + measurement.false_negatives;
+        const auto detected_number = measurement.true_positives + measurement.false_positives;
+        measurement.recall = expected_number ? static_cast<double>(measurement.true_positives) / expected_number : 1.0;
+        measurement.precision = detected_number ? static_cast<double>(measurement.true_positives) / detected_number
+                                                : 1.0;
+        return measurement;
+    }
+
+
+    void match(const std::vector<cv::Rect> &detected, const std::vector<cv::Rect> &expected, double min_iou,
+               Measurement &measurement) {
+        std::vector<bool> is_matched(detected.size(), false);
+        for (const auto &face: expected) {
+            double best_iou = min_iou;
+            auto best_index = detected.size();
+            for (std::size_t i = 0; i < detected.size(); i++) {
+                const auto iou = intersection_over_union(face, detected[i]);
+                if (!is_matched[i] && (iou >= best_iou)) {
+                    best_iou = iou;
+                    best_index = i;
+                }
+            }
+
+            if (best_index < detected.size()) {
+                is_matched[best_index] = true;
+                measurement.true_positives++;
+            } else {
+                measurement.false_negatives++;
+            }
+        }
+        measurement.false_positives += static_cast<std::size_t>(std::count(is_matched.begin(), is_matched.end(),
+                                                                           false));
+    }
+
+
+    void mark_pareto(std::vector<Measurement> &measurements) {
+        const auto dominates = [](const Measurement &lhs, const Measurement &rhs) {
+            const bool no_worse = (lhs.images_per_second >= rhs.images_per_second) && (lhs.recall >= rhs.recall) &&
+                                  (lhs.precision >= rhs.precision);
+            const bool better = (lhs.images_per_second > rhs.images_per_second) || (lhs.recall > rhs.recall) ||
+                                (lhs.precision > rhs.precision);
+            return no_worse && better;
+        };
+
+        for (auto &measurement: measurements) {
+            measurement.pareto = measurement.created &&
+                                 std::none_of(measurements.begin(), measurements.end(),
+                                              [&](const Measurement &other) {
+                                                  return other.created && dominates(other, measurement);
+                                              });
+        }
+    }
+
+
+    std::size_t pick(const std::vector<Measurement> &measurements, double min_recall, double min_precision) {
+        auto best = measurements.size();
+        for (std::size_t i = 0; i < measurements.size(); i++) {
+            const auto &measurement = measurements[i];
+            if (!measurement.pareto || (measurement.recall < min_recall) || (measurement.precision < min_precision)) {
+                continue;
+            }
+            if ((best == measurements.size()) ||
+                (measurement.images_per_second > measurements[best].images_per_second)) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+} // namespace tuning
\ No newline at end of file
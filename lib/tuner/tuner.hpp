@@ -0,0 +1,76 @@
+#pragma once
+
+#include <opencv2/core.hpp>
+
+#include <boost/property_tree/ptree.hpp>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+
+namespace tuning {
+
+    struct LabeledImage {
+        std::string relative_path;
+        cv::Mat image;
+        std::vector<cv::Rect> faces;
+    };
+
+
+    // one knob of the detector description, a value is written to every key under "settings",
+    // e.g. min_object_size sets both "min_object_size.width" and "min_object_size.height"
+    struct Parameter {
+        std::string name;
+        std::vector<std::string> keys;
+        std::vector<std::string> values;
+    };
+
+
+    struct Point {
+        boost::property_tree::ptree description;
+        std::vector<std::string> values;       // in the parameters order
+    };
+
+
+    struct Measurement {
+        bool created{false};                   // the detector creation failed with these values otherwise
+        double images_per_second{0};
+        double recall{0};
+        double precision{0};
+        std::size_t true_positives{0};
+        std::size_t false_positives{0};
+        std::size_t false_negatives{0};
+        bool pareto{false};
+    };
+
+
+    struct Settings {
+        double min_iou{0.5};                   // a detection matches a labeled face from this intersection over union
+        std::size_t repeats{1};                // passes over the samples timed for every point
+    };
+
+
+    // every decodable image of the folder, the labels csv has a "relative_path,x,y,width,height" row per face,
+    // the images without rows have no faces
+    std::vector<LabeledImage> load_samples(const std::filesystem::path &images_dir,
+                                           const std::filesystem::path &labels_path);
+
+    // the cartesian product of the parameter values applied to the base description
+    std::vector<Point> make_grid(const boost::property_tree::ptree &base_description,
+                                 const std::vector<Parameter> &parameters);
+
+    Measurement measure(const boost::property_tree::ptree &description, const std::vector<LabeledImage> &samples,
+                        const Settings &settings);
+
+    // greedy one-to-one matching by the intersection over union, accumulated into the measurement counters
+    void match(const std::vector<cv::Rect> &detected, const std::vector<cv::Rect> &expected, double min_iou,
+               Measurement &measurement);
+
+    // marks the points no other point beats on throughput, recall and precision at once
+    void mark_pareto(std::vector<Measurement> &measurements);
+
+    // the fastest Pareto-optimal point meeting both floors, measurements.size() if there is none
+    std::size_t pick(const std::vector<Measurement> &measurements, double min_recall, double min_precision);
+
+} // namespace tuning
\ No newline at end of file